@@ -318,7 +318,7 @@ typedef enum {
   MD_EXCEPTION_STREAM            =  6,  /* MDRawExceptionStream */
   MD_SYSTEM_INFO_STREAM          =  7,  /* MDRawSystemInfo */
   MD_THREAD_EX_LIST_STREAM       =  8,
-  MD_MEMORY_64_LIST_STREAM       =  9,
+  MD_MEMORY_64_LIST_STREAM       =  9,  /* MDRawMemory64List */
   MD_COMMENT_STREAM_A            = 10,
   MD_COMMENT_STREAM_W            = 11,
   MD_HANDLE_DATA_STREAM          = 12,
@@ -510,6 +510,24 @@ static const size_t MDRawMemoryList_minsize = offsetof(MDRawMemoryList,
                                                        memory_ranges[0]);
 
 
+/* The memory of a full-memory dump.  The memory for the ranges is stored
+ * contiguously, in the order of the descriptors, starting at |base_rva|,
+ * which is 64 bits wide because it may lie beyond 4GB. */
+typedef struct {
+  uint64_t start_of_memory_range;
+  uint64_t data_size;
+} MDMemoryDescriptor64;  /* MINIDUMP_MEMORY_DESCRIPTOR64 */
+
+typedef struct {
+  uint64_t             number_of_memory_ranges;
+  uint64_t             base_rva;
+  MDMemoryDescriptor64 memory_ranges[1];
+} MDRawMemory64List;  /* MINIDUMP_MEMORY64_LIST */
+
+static const size_t MDRawMemory64List_minsize = offsetof(MDRawMemory64List,
+                                                         memory_ranges[0]);
+
+
 #define MD_EXCEPTION_MAXIMUM_PARAMETERS 15
 
 typedef struct {
@@ -53,7 +53,6 @@ class BasicSourceLineResolver : public SourceLineResolverBase {
   BasicSourceLineResolver();
   virtual ~BasicSourceLineResolver() { }
 
-  using SourceLineResolverBase::LoadModule;
   using SourceLineResolverBase::LoadModuleUsingMapBuffer;
   using SourceLineResolverBase::LoadModuleUsingMemoryBuffer;
   using SourceLineResolverBase::ShouldDeleteMemoryBufferAfterLoadModule;
@@ -64,18 +63,76 @@ class BasicSourceLineResolver : public SourceLineResolverBase {
   using SourceLineResolverBase::FindWindowsFrameInfo;
   using SourceLineResolverBase::FindCFIFrameInfo;
 
+  // When symbol file indexes are used, and |map_file| has an up-to-date
+  // index next to it, loads only the records the index lists as global.
+  // Otherwise, loads the whole file.
+  virtual bool LoadModule(const CodeModule *module, const string &map_file);
+
+  // Sets |*hits| and |*misses| to the number of FindCFIFrameInfo lookups,
+  // summed over all loaded modules, that were answered from the modules'
+  // caches of applied CFI rule sets and that had to parse STACK CFI
+  // records, respectively.
+  void GetCFIFrameInfoCacheStats(uint64_t *hits, uint64_t *misses) const;
+
+  // If |lazy| is true, modules loaded from now on keep each function's
+  // LINE records as text when they are loaded, and parse them the first
+  // time an address inside the function is looked up.  A stack walk
+  // usually touches only a few functions in a module, so this makes
+  // loading large symbol files much faster, although the text takes more
+  // memory than the encoded lines would.  Errors in LINE records are only
+  // logged when they are parsed, and don't mark the module as corrupt.
+  // The default is false.
+  void set_lazy_line_parsing(bool lazy);
+
+  // If |use| is true, LoadModule looks for an index written by
+  // sym_to_index next to each symbol file, named by appending
+  // kSymbolFileIndexSuffix.  If there is one, and it matches the file,
+  // only the MODULE, INFO, FILE, PUBLIC and STACK WIN records are parsed
+  // when the module is loaded.  Each FUNC and STACK CFI INIT record, with
+  // the records following it, is read from the file and parsed the first
+  // time an address near it is looked up, so symbolizing a few addresses
+  // in a large file reads only a small part of it.  The file must stay
+  // in place while the module is loaded.  Modules loaded from buffers
+  // and compressed files are always parsed whole.  While this is on,
+  // ShouldLoadModuleFromSymbolFile returns true, so StackFrameSymbolizer
+  // asks its supplier for the path of each symbol file and passes that to
+  // LoadModule instead of reading the file.  The default is false.
+  void set_use_symbol_file_indexes(bool use) {
+    use_symbol_file_indexes_ = use;
+  }
+  virtual bool ShouldLoadModuleFromSymbolFile() {
+    return use_symbol_file_indexes_;
+  }
+
+  // The loaded modules share a single copy of each distinct function,
+  // public symbol and source file name.  Sets |*references| to the number
+  // of names the modules hold, and |*strings| to the number of distinct
+  // names among them.  |*referenced_bytes| is the total length of the
+  // names the modules hold, and |*stored_bytes| the total length of the
+  // copies actually stored; their ratio is the memory saved by sharing.
+  void GetInternedStringStats(uint64_t *references, uint64_t *strings,
+                              uint64_t *referenced_bytes,
+                              uint64_t *stored_bytes) const;
+
  private:
   // friend declarations:
   friend class BasicModuleFactory;
+  friend class ConcurrentSourceLineResolver;
   friend class ModuleComparer;
   friend class ModuleSerializer;
   template<class> friend class SimpleSerializer;
 
-  // Function derives from SourceLineResolverBase::Function.
+  // Function and PublicSymbol derive from their SourceLineResolverBase
+  // counterparts.
   struct Function;
+  struct PublicSymbol;
+  // LineTable holds a Function's source lines in a compact encoding.
+  class LineTable;
   // Module implements SourceLineResolverBase::Module interface.
   class Module;
 
+  bool use_symbol_file_indexes_;
+
   // Disallow unwanted copy ctor and assignment operator
   BasicSourceLineResolver(const BasicSourceLineResolver&);
   void operator=(const BasicSourceLineResolver&);
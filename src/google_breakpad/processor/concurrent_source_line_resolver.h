@@ -0,0 +1,154 @@
+// Copyright (c) 2016 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// concurrent_source_line_resolver.h: ConcurrentSourceLineResolver is a
+// source line resolver that any number of threads may share.
+//
+// BasicSourceLineResolver and FastSourceLineResolver keep their modules in
+// unsynchronized maps, and BasicSourceLineResolver's modules even update
+// internal state on lookups, so a multi-threaded processor needs one
+// resolver, and one copy of every symbol file, per thread.
+// ConcurrentSourceLineResolver keeps one immutable copy of each module
+// instead, in FastSourceLineResolver's serialized format: text format
+// symbol data is parsed and serialized once, when it is loaded, and
+// serialized data (see sym_to_fast) is used as is.
+//
+// Lookups (HasModule, IsModuleCorrupt, FillSourceLineInfo,
+// FindWindowsFrameInfo and FindCFIFrameInfo) never take a lock.  They
+// read an immutable snapshot of the loaded modules, which loads and
+// unloads replace under a mutex.  Each snapshot is reference counted by
+// the lookups reading it, and freed when the last of them finishes after
+// it has been replaced.  A snapshot is a balanced tree that shares all of
+// its nodes but those on the path to the added or removed module with the
+// snapshot it replaces, so loading or unloading a module takes time
+// logarithmic in the number of modules loaded.  If several threads load
+// the same module at once, the first one parses it while the others wait
+// for, and share, the result.
+//
+// See "google_breakpad/processor/source_line_resolver_interface.h" for
+// documentation of the methods.
+
+#ifndef GOOGLE_BREAKPAD_PROCESSOR_CONCURRENT_SOURCE_LINE_RESOLVER_H__
+#define GOOGLE_BREAKPAD_PROCESSOR_CONCURRENT_SOURCE_LINE_RESOLVER_H__
+
+#include <set>
+#include <string>
+
+#include "common/using_std_string.h"
+#include "google_breakpad/processor/source_line_resolver_interface.h"
+
+namespace google_breakpad {
+
+class ConditionVariable;
+class Mutex;
+
+class ConcurrentSourceLineResolver : public SourceLineResolverInterface {
+ public:
+  ConcurrentSourceLineResolver();
+  virtual ~ConcurrentSourceLineResolver();
+
+  // Loading a module that is already loaded succeeds without doing
+  // anything, so that threads racing to load the same module all see
+  // success.
+  virtual bool LoadModule(const CodeModule *module, const string &map_file);
+  virtual bool LoadModuleUsingMapBuffer(const CodeModule *module,
+                                        const string &map_buffer);
+  virtual bool LoadModuleUsingMemoryBuffer(const CodeModule *module,
+                                           char *memory_buffer,
+                                           size_t memory_buffer_size);
+
+  // Modules keep their own copy of the symbol data, so callers may always
+  // free memory buffers after loading them.
+  virtual bool ShouldDeleteMemoryBufferAfterLoadModule();
+
+  virtual void UnloadModule(const CodeModule *module);
+  virtual bool HasModule(const CodeModule *module);
+  virtual bool IsModuleCorrupt(const CodeModule *module);
+  virtual bool IsThreadSafe() { return true; }
+  virtual void FillSourceLineInfo(StackFrame *frame);
+  virtual WindowsFrameInfo *FindWindowsFrameInfo(const StackFrame *frame);
+  virtual CFIFrameInfo *FindCFIFrameInfo(const StackFrame *frame);
+
+ private:
+  // A loaded module, with the serialized data it points into.
+  struct SharedModule;
+
+  // A node of the tree of loaded modules in a snapshot.
+  struct Node;
+
+  // The loaded modules, at one point in time.
+  struct Snapshot;
+
+  // Holds a reference to the current snapshot while a lookup reads it.
+  class AutoReader;
+
+  // Builds the module for the given symbol data, which may be either text
+  // or serialized.  Returns NULL on failure.
+  static SharedModule *CreateModule(const string &code_file,
+                                    char *memory_buffer,
+                                    size_t memory_buffer_size);
+
+  // Drops a reference to |snapshot|, deleting it if that was the last.
+  static void ReleaseSnapshot(Snapshot *snapshot);
+
+  // Makes the snapshot with the tree |root| the current one, and drops
+  // the resolver's reference to the snapshot it replaces.  Takes over the
+  // caller's reference to |root|.  Call with mutex_ held.
+  void PublishSnapshot(const Node *root);
+
+  // Guards loading_, and replacing snapshot_.
+  Mutex *mutex_;
+
+  // Signaled whenever a load finishes.
+  ConditionVariable *load_finished_;
+
+  // The current snapshot.  Read and written atomically.
+  Snapshot *snapshot_;
+
+  // The number of lookups that are reading snapshot_ and have not yet
+  // referenced the snapshot they found, split by the parity of epoch_
+  // when they started.  Changed atomically.
+  int acquiring_[2];
+
+  // Incremented atomically by PublishSnapshot, so that while it waits for
+  // the lookups counted in one half of acquiring_, new lookups count
+  // themselves in the other.
+  int epoch_;
+
+  // Code files of the modules being loaded.
+  std::set<string> loading_;
+
+  // Disallow unwanted copy ctor and assignment operator
+  ConcurrentSourceLineResolver(const ConcurrentSourceLineResolver&);
+  void operator=(const ConcurrentSourceLineResolver&);
+};
+
+}  // namespace google_breakpad
+
+#endif  // GOOGLE_BREAKPAD_PROCESSOR_CONCURRENT_SOURCE_LINE_RESOLVER_H__
@@ -37,6 +37,12 @@
 // data.  Therefore loading a symbol in FastSourceLineResolver is much faster
 // and more memory-efficient than BasicSourceLineResolver.
 //
+// Serialized symbol data can also be stored on disk, preceded by a small
+// header that identifies the format version and carries a checksum of the
+// data (see ModuleSerializer::SerializeToFile and the sym_to_fast tool).
+// LoadModule maps such files into memory instead of reading them, so that
+// loading is cheap and the page cache can share the data between processes.
+//
 // See "source_line_resolver_base.h" and
 // "google_breakpad/source_line_resolver_interface.h" for more reference.
 //
@@ -47,6 +53,7 @@
 
 #include <map>
 #include <string>
+#include <utility>
 
 #include "google_breakpad/processor/source_line_resolver_base.h"
 
@@ -57,20 +64,32 @@ using std::map;
 class FastSourceLineResolver : public SourceLineResolverBase {
  public:
   FastSourceLineResolver();
-  virtual ~FastSourceLineResolver() { }
+  virtual ~FastSourceLineResolver();
 
   using SourceLineResolverBase::FillSourceLineInfo;
   using SourceLineResolverBase::FindCFIFrameInfo;
   using SourceLineResolverBase::FindWindowsFrameInfo;
   using SourceLineResolverBase::HasModule;
   using SourceLineResolverBase::IsModuleCorrupt;
-  using SourceLineResolverBase::LoadModule;
   using SourceLineResolverBase::LoadModuleUsingMapBuffer;
-  using SourceLineResolverBase::LoadModuleUsingMemoryBuffer;
   using SourceLineResolverBase::UnloadModule;
 
+  // Maps the serialized symbol file map_file into memory and loads it.  The
+  // mapping is kept until the module is unloaded.
+  virtual bool LoadModule(const CodeModule *module, const string &map_file);
+
+  // Checks the header of memory_buffer, if it has one, before loading it.
+  virtual bool LoadModuleUsingMemoryBuffer(const CodeModule *module,
+                                           char *memory_buffer,
+                                           size_t memory_buffer_size);
+
+ protected:
+  // Also unmaps the symbol file LoadModule mapped for the module.
+  virtual void RemoveModule(const string &code_file);
+
  private:
   // Friend declarations.
+  friend class ConcurrentSourceLineResolver;
   friend class ModuleComparer;
   friend class ModuleSerializer;
   friend class FastModuleFactory;
@@ -82,14 +101,34 @@ class FastSourceLineResolver : public SourceLineResolverBase {
   struct PublicSymbol;
   class Module;
 
+  // Header preceding serialized symbol data stored on disk.
+  struct SymbolFileHeader;
+
   // Deserialize raw memory data to construct a WindowsFrameInfo object.
   static WindowsFrameInfo CopyWFI(const char *raw_memory);
 
+  // Returns true if buffer starts with a SymbolFileHeader.  Serialized data
+  // without a header starts with the module's is_corrupt flag, which can
+  // never be mistaken for the header magic.
+  static bool HasSymbolFileHeader(const char *buffer, size_t buffer_size);
+
+  // Validates the SymbolFileHeader at the start of buffer against this
+  // build's format version and the checksum of the data that follows it.
+  static bool CheckSymbolFileHeader(const char *buffer, size_t buffer_size);
+
+  // Computes the checksum stored in a SymbolFileHeader (Adler-32).
+  static uint32_t ComputeChecksum(const char *data, size_t size);
+
   // FastSourceLineResolver requires the memory buffer stays alive during the
   // lifetime of a corresponding module, therefore it needs to redefine this
   // virtual method.
   virtual bool ShouldDeleteMemoryBufferAfterLoadModule();
 
+  // Symbol files mapped by LoadModule, keyed by module code file.
+  typedef std::map<string, std::pair<char*, size_t>, CompareString>
+      MappedFileMap;
+  MappedFileMap mapped_files_;
+
   // Disallow unwanted copy ctor and assignment operator
   FastSourceLineResolver(const FastSourceLineResolver&);
   void operator=(const FastSourceLineResolver&);
@@ -39,6 +39,8 @@
 #define GOOGLE_BREAKPAD_PROCESSOR_MEMORY_REGION_H__
 
 
+#include <stddef.h>
+
 #include "google_breakpad/common/breakpad_types.h"
 
 
@@ -68,6 +70,19 @@ class MemoryRegion {
   virtual bool GetMemoryAtAddress(uint64_t address, uint32_t* value) const = 0;
   virtual bool GetMemoryAtAddress(uint64_t address, uint64_t* value) const = 0;
 
+  // Returns a pointer to the region's contents at address, and sets
+  // available to the number of bytes from there to the end of the
+  // region, for callers that look at many values at once.  The pointer
+  // stays valid as long as the region.  Regions that don't keep their
+  // contents in memory in the byte order of the running program return
+  // NULL, the default; the values must then be read with
+  // GetMemoryAtAddress.  Also returns NULL if address is out of the
+  // region's bounds.
+  virtual const uint8_t* GetBytesAtAddress(uint64_t address,
+                                           uint64_t* available) const {
+    return NULL;
+  }
+
   // Print a human-readable representation of the object to stdout.
   virtual void Print() const = 0;
 };
@@ -88,6 +88,11 @@ class MicrodumpMemoryRegion : public MemoryRegion {
   virtual bool GetMemoryAtAddress(uint64_t address, uint32_t* value) const;
   virtual bool GetMemoryAtAddress(uint64_t address, uint64_t* value) const;
 
+  // The contents are little-endian, so this returns NULL on big-endian
+  // hosts.
+  virtual const uint8_t* GetBytesAtAddress(uint64_t address,
+                                           uint64_t* available) const;
+
   // Print a human-readable representation of the object to stdout.
   virtual void Print() const;
 
@@ -74,6 +74,13 @@
 // Minidump::ReadString will return a string object to the user, and the user
 // is responsible for its deletion.
 //
+// Once Minidump::Read has succeeded, the Minidump and the objects it returns
+// may be used from several threads at once: streams, contexts and memory
+// are read on first use under a lock, and memory is read with positional
+// reads that don't disturb each other.  The exceptions are the Minidump
+// methods that use the file position (ReadBytes, SeekSet, Tell,
+// SeekToStreamType), FreeMemory, and the Print methods.
+//
 // Author: Mark Mentovai
 
 #ifndef GOOGLE_BREAKPAD_PROCESSOR_MINIDUMP_H__
@@ -103,6 +110,8 @@ using std::map;
 using std::vector;
 
 
+class AutoMinidumpLock;
+class MinidumpLock;
 class Minidump;
 template<typename AddressType, typename EntryType> class RangeMap;
 
@@ -208,7 +217,9 @@ class MinidumpMemoryRegion : public MinidumpObject,
 
   // Returns a pointer to the base of the memory region.  Returns the
   // cached value if available, otherwise, reads the minidump file and
-  // caches the memory region.
+  // caches the memory region.  If the minidump file is mapped (see
+  // Minidump::set_map_file), the pointer is into the mapping, and nothing
+  // is copied.
   const uint8_t* GetMemory() const;
 
   // The address of the base of the memory region.
@@ -217,15 +228,24 @@ class MinidumpMemoryRegion : public MinidumpObject,
   // The size, in bytes, of the memory region.
   uint32_t GetSize() const;
 
-  // Frees the cached memory region, if cached.
+  // Frees the cached memory region, if cached.  This must not be called
+  // while another thread may be using the region.
   void FreeMemory();
 
   // Obtains the value of memory at the pointer specified by address.
+  // Regions larger than max_bytes() are not cached; each value is read
+  // from the minidump file instead.
   bool GetMemoryAtAddress(uint64_t address, uint8_t*  value) const;
   bool GetMemoryAtAddress(uint64_t address, uint16_t* value) const;
   bool GetMemoryAtAddress(uint64_t address, uint32_t* value) const;
   bool GetMemoryAtAddress(uint64_t address, uint64_t* value) const;
 
+  // Returns a pointer into GetMemory().  Returns NULL for regions too
+  // large to cache, and for minidumps whose byte order differs from the
+  // running program's.
+  const uint8_t* GetBytesAtAddress(uint64_t address,
+                                   uint64_t* available) const;
+
   // Print a human-readable representation of the object to stdout.
   void Print() const;
 
@@ -235,11 +255,16 @@ class MinidumpMemoryRegion : public MinidumpObject,
  private:
   friend class MinidumpThread;
   friend class MinidumpMemoryList;
+  friend class MinidumpMemory64List;
 
   // Identify the base address and size of the memory region, and the
   // location it may be found in the minidump file.
   void SetDescriptor(MDMemoryDescriptor* descriptor);
 
+  // Like SetDescriptor, but the memory is at rva in the minidump file,
+  // which may not fit in descriptor->memory.rva.
+  void SetDescriptor(MDMemoryDescriptor* descriptor, uint64_t rva);
+
   // Implementation for GetMemoryAtAddress
   template<typename T> bool GetMemoryAtAddressInternal(uint64_t address,
                                                        T*        value) const;
@@ -252,7 +277,12 @@ class MinidumpMemoryRegion : public MinidumpObject,
   // minidump file.
   MDMemoryDescriptor* descriptor_;
 
-  // Cached memory.
+  // The position of the memory region in the minidump file.
+  uint64_t rva_;
+
+  // Cached memory.  It is set at most once between calls to FreeMemory,
+  // and read with acquire semantics, so that threads that find it set
+  // see the memory it holds.
   mutable vector<uint8_t>* memory_;
 };
 
@@ -586,6 +616,72 @@ class MinidumpMemoryList : public MinidumpStream {
 };
 
 
+// MinidumpMemory64List contains the memory of a full-memory minidump,
+// which can be far larger than a MinidumpMemoryList.  Reading the list
+// reads only the descriptors.  Each region's memory is read from the
+// minidump file only when it is used, and regions larger than
+// MinidumpMemoryRegion::max_bytes() are read a value at a time, so
+// processing a dump doesn't load its memory into RAM.
+class MinidumpMemory64List : public MinidumpStream {
+ public:
+  virtual ~MinidumpMemory64List();
+
+  static void set_max_regions(uint32_t max_regions) {
+    max_regions_ = max_regions;
+  }
+  static uint32_t max_regions() { return max_regions_; }
+
+  unsigned int region_count() const { return valid_ ? region_count_ : 0; }
+
+  // Sequential access to memory regions.  Returns NULL for a region whose
+  // memory is too large to be represented by a MinidumpMemoryRegion.
+  MinidumpMemoryRegion* GetMemoryRegionAtIndex(unsigned int index);
+
+  // Random access to memory regions.  Returns the region encompassing
+  // the address identified by address.
+  virtual MinidumpMemoryRegion* GetMemoryRegionForAddress(uint64_t address);
+
+  // Print a human-readable representation of the object to stdout.
+  void Print();
+
+ private:
+  friend class Minidump;
+
+  typedef vector<MDMemoryDescriptor64> MemoryDescriptors64;
+  typedef vector<MDMemoryDescriptor>   MemoryDescriptors;
+  typedef vector<MinidumpMemoryRegion> MemoryRegions;
+
+  static const uint32_t kStreamType = MD_MEMORY_64_LIST_STREAM;
+
+  explicit MinidumpMemory64List(Minidump* minidump);
+
+  bool Read(uint32_t expected_size);
+
+  // The largest number of memory regions that will be read from a minidump.
+  // The default is 1M.
+  static uint32_t max_regions_;
+
+  // Access to memory regions using addresses as the key.  The map is
+  // frozen into a sorted array once it is built.
+  RangeMap<uint64_t, unsigned int> *range_map_;
+
+  // The descriptors as read from the minidump.
+  MemoryDescriptors64 *descriptors_;
+
+  // The descriptors in the form MinidumpMemoryRegion uses.  As with
+  // MinidumpMemoryList, the regions point to these.  Their memory.rva is
+  // unused, as each region's position in the file is passed separately.
+  MemoryDescriptors *region_descriptors_;
+
+  // The list of regions.
+  MemoryRegions *regions_;
+  uint32_t region_count_;
+
+  // The position in the minidump file of the first region's memory.
+  uint64_t base_rva_;
+};
+
+
 // MinidumpException wraps MDRawExceptionStream, which contains information
 // about the exception that caused the minidump to be generated, if the
 // minidump was generated in an exception handler called as a result of an
@@ -882,6 +978,19 @@ class Minidump {
 
   virtual const MDRawHeader* header() const { return valid_ ? &header_ : NULL; }
 
+  // Sets whether the minidump file is read through a read-only memory
+  // mapping rather than an istream.  Memory regions are then used in
+  // place instead of being copied into buffers of their own, and the
+  // other reads become copies out of the mapping.  This must be set
+  // before Read().  It has no effect on a Minidump constructed from an
+  // istream, or where the file cannot be mapped, in which case the file
+  // is read as usual.  The default is false.
+  void set_map_file(bool map_file) { map_file_ = map_file; }
+  bool map_file() const { return map_file_; }
+
+  // Returns true if the minidump file is being read through a mapping.
+  bool is_mapped() const { return mapped_data_ != NULL; }
+
   // Reads the CPU information from the system info stream and generates the
   // appropriate CPU flags.  The returned context_cpu_flags are the same as
   // if the CPU type bits were set in the context_flags of a context record.
@@ -905,6 +1014,7 @@ class Minidump {
   virtual MinidumpThreadList* GetThreadList();
   virtual MinidumpModuleList* GetModuleList();
   virtual MinidumpMemoryList* GetMemoryList();
+  virtual MinidumpMemory64List* GetMemory64List();
   virtual MinidumpException* GetException();
   virtual MinidumpAssertion* GetAssertion();
   virtual MinidumpSystemInfo* GetSystemInfo();
@@ -922,7 +1032,8 @@ class Minidump {
   }
   const MDRawDirectory* GetDirectoryEntryAtIndex(unsigned int index) const;
 
-  // The next 2 methods are lower-level I/O routines.  They use fd_.
+  // The next 3 methods are lower-level I/O routines.  They share one file
+  // position, and are not thread-safe.
 
   // Reads count bytes from the minidump at the current position into
   // the storage area pointed to by bytes.  bytes must be of sufficient
@@ -935,6 +1046,20 @@ class Minidump {
   // Returns the current position of the minidump file.
   off_t Tell();
 
+  // Reads count bytes at offset in the minidump file into the storage
+  // area pointed to by bytes, without using or changing the file position.
+  // Any number of threads may call this at once.  A file opened by path
+  // is read with pread, and a mapped file is read from the mapping.  A
+  // Minidump constructed from an istream has only the istream's
+  // position, so these reads take turns.
+  bool ReadBytesAt(off_t offset, void* bytes, size_t count);
+
+  // Returns a pointer to the count bytes at offset in the mapped minidump
+  // file, without changing the file position.  Returns NULL if the file is
+  // not mapped, or if the bytes are not all within it.  The bytes are as
+  // they are in the file, and are not byte-swapped.
+  const uint8_t* GetMappedBytes(off_t offset, size_t count) const;
+
   // The next 2 methods are medium-level I/O routines.
 
   // ReadString returns a string which is owned by the caller!  offset
@@ -981,9 +1106,15 @@ class Minidump {
 
   template<typename T> T* GetStream(T** stream);
 
+  friend class AutoMinidumpLock;
+
   // Opens the minidump file, or if already open, seeks to the beginning.
   bool Open();
 
+  // Maps the minidump file into memory for reading.  Returns false if it
+  // cannot be mapped.
+  bool MapFile();
+
   // The largest number of top-level streams that will be read from a minidump.
   // Note that streams are only read (and only consume memory) as needed,
   // when directed by the caller.  The default is 128.
@@ -1007,10 +1138,32 @@ class Minidump {
   // This may be empty if the minidump was opened directly from a stream.
   const string              path_;
 
-  // The stream for all file I/O.  Used by ReadBytes and SeekSet.
-  // Set based on the path in Open, or directly in the constructor.
+  // The stream for all file I/O of a minidump that was opened directly
+  // from a stream, set in the constructor.  Used by ReadBytes and SeekSet.
+  // On Windows, it is also set based on the path in Open.
   std::istream*             stream_;
 
+  // The descriptor of the minidump file opened from path_ in Open, or -1.
+  int                       fd_;
+
+  // Whether to map the minidump file in Open, set by set_map_file.
+  bool                      map_file_;
+
+  // The mapped minidump file and its size.  mapped_data_ is NULL unless
+  // Open mapped the file, in which case it is read instead of fd_.
+  const uint8_t*            mapped_data_;
+  size_t                    mapped_size_;
+
+  // The current position in the file when it is read through fd_ or
+  // mapped_data_.
+  off_t                     position_;
+
+  // Serializes reading streams and the objects in them on first use,
+  // since that reading uses the file position.  It is recursive, because
+  // reading one stream can read another.  It is defined in minidump.cc,
+  // so that this header doesn't depend on the platform's threads.
+  MinidumpLock*             lock_;
+
   // swap_ is true if the minidump file should be byte-swapped.  If the
   // minidump was produced by a CPU that is other-endian than the CPU
   // processing the minidump, this will be true.  If the two CPUs are
@@ -69,6 +69,64 @@ class MinidumpProcessor {
 
   ~MinidumpProcessor();
 
+  // Sets the number of threads used to walk the stacks of the threads in
+  // a minidump.  With the default of 1, stacks are walked one after
+  // another on the calling thread.  Larger values walk them on a pool of
+  // that many threads, which requires a thread-safe StackFrameSymbolizer
+  // (see StackFrameSymbolizer::IsThreadSafe), such as one using a
+  // ConcurrentSourceLineResolver; with any other symbolizer, and on
+  // Windows, where the processor doesn't start threads, stacks are still
+  // walked serially.  Process fills in the same ProcessState either way.
+  void set_stackwalk_thread_count(int stackwalk_thread_count) {
+    stackwalk_thread_count_ = stackwalk_thread_count;
+  }
+  int stackwalk_thread_count() const { return stackwalk_thread_count_; }
+
+  // Sets the number of threads used to fetch and load symbols ahead of
+  // the stack walk.  With the default of 0, each module's symbols are
+  // loaded when a frame first lands in it.  Otherwise, once the threads'
+  // contexts are read, the symbols for every module are fetched on a pool
+  // of that many threads, starting with the modules containing the
+  // threads' instruction pointers, and the walk waits only for modules
+  // that are not loaded yet.  Like concurrent stack walking, this
+  // requires a thread-safe StackFrameSymbolizer, and is skipped for any
+  // other, and on Windows.  Symbols are fetched for modules that no stack may need, so
+  // this trades symbol supplier work for latency.
+  void set_symbol_prefetch_thread_count(int symbol_prefetch_thread_count) {
+    symbol_prefetch_thread_count_ = symbol_prefetch_thread_count;
+  }
+  int symbol_prefetch_thread_count() const {
+    return symbol_prefetch_thread_count_;
+  }
+
+  // Sets whether the stacks of a minidump share a memo of the symbols and
+  // caller frame information found for each instruction address, so that
+  // frames that recur across threads are looked up once.  This is on by
+  // default; turning it off gives the same ProcessState, and is meant for
+  // comparing the two.
+  void set_memoize_symbolization(bool memoize_symbolization) {
+    memoize_symbolization_ = memoize_symbolization;
+  }
+  bool memoize_symbolization() const { return memoize_symbolization_; }
+
+  // Sets |lookups| to the number of symbol and frame information lookups
+  // made through the memo by every call to Process so far, and |hits| to
+  // the number of them the memo answered.
+  void GetSymbolizationMemoStats(uint64_t *lookups, uint64_t *hits) const {
+    *lookups = symbolization_lookups_;
+    *hits = symbolization_hits_;
+  }
+
+  // Sets whether threads whose CPU context and stack memory are the same,
+  // byte for byte, as an earlier thread's are walked again.  If this is
+  // on, they are not: the ProcessState lists the earlier thread's
+  // CallStack for each of them too (see ProcessState::threads).  This is
+  // off by default, so that every thread has a CallStack of its own.
+  void set_deduplicate_threads(bool deduplicate_threads) {
+    deduplicate_threads_ = deduplicate_threads;
+  }
+  bool deduplicate_threads() const { return deduplicate_threads_; }
+
   // Processes the minidump file and fills process_state with the result.
   ProcessResult Process(const string &minidump_file,
                         ProcessState* process_state);
@@ -134,6 +192,20 @@ class MinidumpProcessor {
   // guess how likely it is that the crash represents an exploitable
   // memory corruption issue.
   bool enable_exploitability_;
+
+  // The number of threads to walk stacks on.
+  int stackwalk_thread_count_;
+
+  // The number of threads to prefetch symbols on, or 0 not to prefetch.
+  int symbol_prefetch_thread_count_;
+
+  // Whether to use a SymbolizationMemo, and the totals of its statistics.
+  bool memoize_symbolization_;
+  uint64_t symbolization_lookups_;
+  uint64_t symbolization_hits_;
+
+  // Whether to walk only one of each set of identical threads.
+  bool deduplicate_threads_;
 };
 
 }  // namespace google_breakpad
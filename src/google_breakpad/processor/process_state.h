@@ -103,6 +103,11 @@ class ProcessState {
   uint64_t crash_address() const { return crash_address_; }
   string assertion() const { return assertion_; }
   int requesting_thread() const { return requesting_thread_; }
+  // When the minidump was processed with
+  // MinidumpProcessor::set_deduplicate_threads(true), threads whose
+  // contexts and stack memory are identical may share a CallStack, so the
+  // same pointer can appear more than once.  The ProcessState owns each
+  // CallStack once either way.
   const vector<CallStack*>* threads() const { return &threads_; }
   const vector<MemoryRegion*>* thread_memory_regions() const {
     return &thread_memory_regions_;
@@ -161,7 +166,8 @@ class ProcessState {
   int requesting_thread_;
 
   // Stacks for each thread (except possibly the exception handler
-  // thread) at the time of the crash.
+  // thread) at the time of the crash.  See threads() for when threads
+  // share a CallStack.
   vector<CallStack*> threads_;
   vector<MemoryRegion*> thread_memory_regions_;
 
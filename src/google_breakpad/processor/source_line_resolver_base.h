@@ -41,6 +41,7 @@
 #ifndef GOOGLE_BREAKPAD_PROCESSOR_SOURCE_LINE_RESOLVER_BASE_H__
 #define GOOGLE_BREAKPAD_PROCESSOR_SOURCE_LINE_RESOLVER_BASE_H__
 
+#include <list>
 #include <map>
 #include <set>
 #include <string>
@@ -56,6 +57,7 @@ using std::set;
 // ModuleFactory is a simple factory interface for creating a Module instance
 // at run-time.
 class ModuleFactory;
+class SymbolSupplier;
 
 class SourceLineResolverBase : public SourceLineResolverInterface {
  public:
@@ -64,10 +66,67 @@ class SourceLineResolverBase : public SourceLineResolverInterface {
   // LoadMap() method.
   // Place dynamically allocated heap buffer in symbol_data. Caller has the
   // ownership of the buffer, and should call delete [] to free the buffer.
+  // Files whose names end in .gz are decompressed as they are read.
   static bool ReadSymbolFile(const string &file_name,
                              char **symbol_data,
                              size_t *symbol_data_size);
 
+  // Map the file with given file_name read-only into memory.  Unlike
+  // ReadSymbolFile, the mapping is not null-terminated, so it is only
+  // suitable for data that doesn't need to be modified or terminated, such
+  // as serialized symbol data.  On success, *symbol_data_size is set to the
+  // size of the file, and the caller should release the mapping with
+  // UnmapSymbolFile.
+  static bool MapSymbolFile(const string &file_name,
+                            char **symbol_data,
+                            size_t *symbol_data_size);
+
+  // Release a mapping returned by MapSymbolFile.
+  static void UnmapSymbolFile(char *symbol_data, size_t symbol_data_size);
+
+  // Loaded modules normally stay loaded until UnloadModule is called.
+  // Setting a nonzero budget makes the resolver unload the least recently
+  // used modules whenever the modules it holds take up more than |bytes|.
+  // A module's size is the memory its parsed symbols take up, including
+  // any symbol data it points into, and is checked again whenever
+  // HasModule finds it, as lookups may parse more of it.  A module counts
+  // as used whenever it is loaded or HasModule finds it, which
+  // StackFrameSymbolizer does for every frame.  The module loaded or
+  // found most recently, and pinned modules, are never unloaded this way,
+  // so the budget may be exceeded.  A budget of zero, the default, means
+  // no limit.
+  void set_module_cache_budget(size_t bytes);
+  size_t module_cache_budget() const { return module_cache_budget_; }
+
+  // The total size of all loaded modules, as counted against the budget.
+  size_t module_cache_usage() const { return module_cache_usage_; }
+
+  // Keep the module with the same code file as |module| from being
+  // unloaded to stay within the budget, for example while the dump that
+  // uses it is being processed.  The module need not be loaded yet.
+  // Pins nest: each call must be balanced by a call to UnpinModule.
+  // Pinning doesn't affect UnloadModule.
+  void PinModule(const CodeModule *module);
+  void UnpinModule(const CodeModule *module);
+
+  // A resolver that keeps the symbol data its modules point into (see
+  // ShouldDeleteMemoryBufferAfterLoadModule) doesn't own the buffers
+  // passed to LoadModuleUsingMemoryBuffer.  When they came from
+  // |supplier|, as they do with StackFrameSymbolizer, set it here, so
+  // that unloading a module to stay within the budget also hands its
+  // buffer back with FreeSymbolData.  Otherwise the buffer stays with
+  // its owner.
+  void set_symbol_supplier(SymbolSupplier *supplier) {
+    symbol_supplier_ = supplier;
+  }
+
+  // Sets |*hits| and |*misses| to the number of HasModule calls that found
+  // and did not find the module, and |*evictions| to the number of modules
+  // unloaded to stay within the budget.
+  void GetModuleCacheStats(uint64_t *hits,
+                           uint64_t *misses,
+                           uint64_t *evictions) const;
+
  protected:
   // Users are not allowed create SourceLineResolverBase instance directly.
   SourceLineResolverBase(ModuleFactory *module_factory);
@@ -85,9 +144,17 @@ class SourceLineResolverBase : public SourceLineResolverInterface {
   virtual bool HasModule(const CodeModule *module);
   virtual bool IsModuleCorrupt(const CodeModule *module);
   virtual void FillSourceLineInfo(StackFrame *frame);
+  virtual bool GetFunctionTable(const CodeModule *module,
+                                FunctionTable *table);
   virtual WindowsFrameInfo *FindWindowsFrameInfo(const StackFrame *frame);
   virtual CFIFrameInfo *FindCFIFrameInfo(const StackFrame *frame);
 
+  // Deletes the loaded module for |code_file|, along with anything the
+  // resolver keeps alive for it.  UnloadModule and the module cache call
+  // this; subclasses that keep extra per-module resources should override
+  // it to release them too.
+  virtual void RemoveModule(const string &code_file);
+
   // Nested structs and classes.
   struct Line;
   struct Function;
@@ -114,10 +181,48 @@ class SourceLineResolverBase : public SourceLineResolverInterface {
   // Creates a concrete module at run-time.
   ModuleFactory *module_factory_;
 
+  // Records that the resolver itself owns the data that the module for
+  // |code_file| was just loaded from by LoadModuleUsingMemoryBuffer, so
+  // that evicting the module doesn't hand it to the symbol supplier.
+  void OwnModuleData(const string &code_file);
+
  private:
   // ModuleFactory needs to have access to protected type Module.
   friend class ModuleFactory;
 
+  // Marks the module for |code_file| as the most recently used.
+  void TouchModule(const string &code_file);
+
+  // Unloads least recently used modules until the loaded modules fit in
+  // the budget, sparing pinned modules and |keep|.
+  void EvictModules(const string &keep);
+
+  // Bookkeeping for each loaded module.
+  struct ModuleCacheEntry {
+    size_t size;
+    std::list<string>::iterator lru_position;
+
+    // If the module points into symbol data the resolver doesn't own, a
+    // copy of the module to pass to the symbol supplier's FreeSymbolData.
+    const CodeModule *supplied_module;
+  };
+  typedef map<string, ModuleCacheEntry, CompareString> ModuleCacheMap;
+  ModuleCacheMap module_cache_entries_;
+
+  // The code files of the loaded modules, most recently used first.
+  std::list<string> module_lru_;
+
+  // Pin counts of pinned modules, by code file.
+  map<string, int, CompareString> pinned_modules_;
+
+  SymbolSupplier *symbol_supplier_;
+
+  size_t module_cache_budget_;
+  size_t module_cache_usage_;
+  uint64_t module_cache_hits_;
+  uint64_t module_cache_misses_;
+  uint64_t module_cache_evictions_;
+
   // Disallow unwanted copy ctor and assignment operator
   SourceLineResolverBase(const SourceLineResolverBase&);
   void operator=(const SourceLineResolverBase&);
@@ -35,6 +35,7 @@
 #define GOOGLE_BREAKPAD_PROCESSOR_SOURCE_LINE_RESOLVER_INTERFACE_H__
 
 #include <string>
+#include <vector>
 
 #include "common/using_std_string.h"
 #include "google_breakpad/common/breakpad_types.h"
@@ -79,6 +80,12 @@ class SourceLineResolverInterface {
   // alive during the lifetime of the corresponding Module.
   virtual bool ShouldDeleteMemoryBufferAfterLoadModule() = 0;
 
+  // Returns true if LoadModule, given the symbol file's path, loads the
+  // module more cheaply than LoadModuleUsingMemoryBuffer does from the
+  // file's contents, for example because it reads only part of the file.
+  // Callers that can find the path should then call LoadModule.
+  virtual bool ShouldLoadModuleFromSymbolFile() { return false; }
+
   // Request that the specified module be unloaded from this resolver.
   // A resolver may choose to ignore such a request.
   virtual void UnloadModule(const CodeModule *module) = 0;
@@ -89,11 +96,45 @@ class SourceLineResolverInterface {
   // Returns true if the module has been loaded and it is corrupt.
   virtual bool IsModuleCorrupt(const CodeModule *module) = 0;
 
+  // Returns true if all of this resolver's methods may be called from
+  // several threads at once.
+  virtual bool IsThreadSafe() { return false; }
+
   // Fills in the function_base, function_name, source_file_name,
   // and source_line fields of the StackFrame.  The instruction and
   // module_name fields must already be filled in.
   virtual void FillSourceLineInfo(StackFrame *frame) = 0;
 
+  // The extents of a module's functions and public symbols, each sorted
+  // by address, with addresses relative to the module's base.  It lets a
+  // stack scanner tell which addresses FillSourceLineInfo would find a
+  // function name for without looking each one up: an address gets a
+  // name if it falls in a function that has one.  Failing that, it gets
+  // the name of the closest public symbol at or below it, if there is
+  // one and it lies above the closest function below the address.
+  struct FunctionTable {
+    struct Function {
+      MemAddr base;
+      MemAddr size;
+      bool has_name;
+    };
+    struct PublicSymbol {
+      MemAddr address;
+      bool has_name;
+    };
+    std::vector<Function> functions;
+    std::vector<PublicSymbol> public_symbols;
+  };
+
+  // Fills |table| for |module|, which must be loaded, and returns true.
+  // Returns false if the resolver can't list the module's functions, or
+  // if its lookups don't follow the rules above; callers then have to
+  // use FillSourceLineInfo.
+  virtual bool GetFunctionTable(const CodeModule *module,
+                                FunctionTable *table) {
+    return false;
+  }
+
   // If Windows stack walking information is available covering
   // FRAME's instruction address, return a WindowsFrameInfo structure
   // describing it. If the information is not available, returns NULL.
@@ -37,16 +37,21 @@
 
 #include <set>
 #include <string>
+#include <vector>
 
 #include "common/using_std_string.h"
 #include "google_breakpad/common/breakpad_types.h"
 #include "google_breakpad/processor/code_module.h"
+#include "google_breakpad/processor/source_line_resolver_interface.h"
 
 namespace google_breakpad {
 class CFIFrameInfo;
 class CodeModules;
+class ConditionVariable;
+class MissingSymbolCache;
+class Mutex;
 class SymbolSupplier;
-class SourceLineResolverInterface;
+class WorkerThread;
 struct StackFrame;
 struct SystemInfo;
 struct WindowsFrameInfo;
@@ -71,14 +76,30 @@ class StackFrameSymbolizer {
   StackFrameSymbolizer(SymbolSupplier* supplier,
                        SourceLineResolverInterface* resolver);
 
-  virtual ~StackFrameSymbolizer() { }
+  virtual ~StackFrameSymbolizer();
 
   // Encapsulate the step of resolving source line info for a stack frame.
-  // "frame" must not be NULL.
+  // "frame" must not be NULL.  Calls to the supplier are serialized, and
+  // each module's symbols are fetched at most once even when several
+  // threads ask for them at the same time, so this may be called
+  // concurrently as long as IsThreadSafe() returns true.
   virtual SymbolizerResult FillSourceLineInfo(const CodeModules* modules,
                                               const SystemInfo* system_info,
                                               StackFrame* stack_frame);
 
+  // Loads the symbols for |module| as FillSourceLineInfo does, and if
+  // that succeeds, asks the resolver for the module's function table.
+  // Sets |*has_table| to whether |table| was filled; when it wasn't, only
+  // FillSourceLineInfo can tell which of the module's addresses have
+  // function names.  Subclasses that change what FillSourceLineInfo finds
+  // must override this too.  May be called concurrently under the same
+  // conditions as FillSourceLineInfo.
+  virtual SymbolizerResult GetFunctionTable(
+      const CodeModule* module,
+      const SystemInfo* system_info,
+      SourceLineResolverInterface::FunctionTable* table,
+      bool* has_table);
+
   virtual WindowsFrameInfo* FindWindowsFrameInfo(const StackFrame* frame);
 
   virtual CFIFrameInfo* FindCFIFrameInfo(const StackFrame* frame);
@@ -86,12 +107,48 @@ class StackFrameSymbolizer {
   // Reset internal (locally owned) data as if the helper is re-instantiated.
   // A typical case is to call Reset() after processing an individual report
   // before start to process next one, in order to reset internal information
-  // about missing symbols found so far.
-  virtual void Reset() { no_symbol_modules_.clear(); }
+  // about missing symbols found so far.  Stops any prefetch first.
+  virtual void Reset();
+
+  // Starts fetching and loading the symbols for every module in |modules|
+  // on |thread_count| background threads, so that FillSourceLineInfo
+  // finds them already loaded, or waits only for a load that is under
+  // way.  The modules in |first_modules|, such as those containing the
+  // threads' instruction pointers, are fetched before the rest.  Each
+  // module is still fetched at most once.  |modules| and |system_info|
+  // must remain valid until StopPrefetch is called.
+  //
+  // Modules are loaded while stacks are being walked, so this does
+  // nothing unless IsThreadSafe() returns true.  It also does nothing if
+  // a prefetch is already running, or on Windows, where the processor
+  // doesn't start threads.
+  virtual void StartPrefetch(
+      const CodeModules* modules,
+      const SystemInfo* system_info,
+      const std::vector<const CodeModule*>& first_modules,
+      int thread_count);
+
+  // Drops the modules that the prefetch threads haven't started on, and
+  // waits for the threads to finish.
+  virtual void StopPrefetch();
 
   // Returns true if there is valid implementation for stack symbolization.
   virtual bool HasImplementation() { return resolver_ && supplier_; }
 
+  // Returns true if FillSourceLineInfo, FindWindowsFrameInfo and
+  // FindCFIFrameInfo may be called from several threads at once, which
+  // is the case when the resolver is thread-safe.
+  virtual bool IsThreadSafe();
+
+  // Sets a cache of modules known to have no symbols, which outlives
+  // Reset.  Before asking the supplier for a module's symbols, the cache
+  // is checked, and modules the supplier has no symbols for are added to
+  // it.  Does not take ownership of |cache|, which may be NULL, the
+  // default, and which may be shared with other symbolizers.
+  void set_missing_symbol_cache(MissingSymbolCache* cache) {
+    missing_symbol_cache_ = cache;
+  }
+
   SourceLineResolverInterface* resolver() { return resolver_; }
   SymbolSupplier* supplier() { return supplier_; }
 
@@ -101,6 +158,44 @@ class StackFrameSymbolizer {
   // A list of modules known to have symbols missing. This helps avoid
   // repeated lookups for the missing symbols within one minidump.
   std::set<string> no_symbol_modules_;
+  // Modules known to have symbols missing across minidumps, if set.
+  MissingSymbolCache* missing_symbol_cache_;
+
+ private:
+  // Makes sure the symbols for |module| are loaded, fetching them from
+  // the supplier if this hasn't been tried yet.  Returns kNoError or
+  // kWarningCorruptSymbols if the resolver has the module.
+  SymbolizerResult LoadModuleSymbols(const CodeModule* module,
+                                     const SystemInfo* system_info);
+
+  // The body of each prefetch thread.  |symbolizer| is this object.
+  static void* PrefetchThread(void* symbolizer);
+
+  // Marks code_file as no longer being fetched, and wakes the threads
+  // waiting for it.  If missing is true, the module is also added to
+  // no_symbol_modules_.
+  void FinishFetch(const string &code_file, bool missing);
+
+  // Protects no_symbol_modules_, fetching_modules_ and next_prefetch_.
+  Mutex* mutex_;
+  // Signalled when a module is removed from fetching_modules_.
+  ConditionVariable* fetch_finished_;
+  // Held while calling the supplier, which need not be thread-safe.
+  Mutex* supplier_mutex_;
+  // Modules whose symbols are being fetched and loaded by some thread.
+  std::set<string> fetching_modules_;
+
+  // The modules to prefetch, in order, and the index of the next one to
+  // start on.  Both are only changed while no prefetch thread is running,
+  // apart from next_prefetch_ advancing.
+  std::vector<const CodeModule*> prefetch_modules_;
+  size_t next_prefetch_;
+  const SystemInfo* prefetch_system_info_;
+  std::vector<WorkerThread*> prefetch_threads_;
+
+  // Disallow copy constructor and assignment operator.
+  StackFrameSymbolizer(const StackFrameSymbolizer&);
+  void operator=(const StackFrameSymbolizer&);
 };
 
 }  // namespace google_breakpad
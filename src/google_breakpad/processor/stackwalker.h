@@ -55,14 +55,16 @@ namespace google_breakpad {
 
 class CallStack;
 class DumpContext;
+class InstructionAddressOracle;
 class StackFrameSymbolizer;
+class SymbolizationMemo;
 
 using std::set;
 using std::vector;
 
 class Stackwalker {
  public:
-  virtual ~Stackwalker() {}
+  virtual ~Stackwalker();
 
   // Populates the given CallStack by calling GetContextFrame and
   // GetCallerFrame.  The frames are further processed to fill all available
@@ -101,6 +103,20 @@ class Stackwalker {
     max_frames_scanned_ = max_frames_scanned;
   }
 
+  // Makes stack scanning check candidate return addresses with |oracle|,
+  // which may be shared by the stackwalkers for all of a minidump's
+  // threads.  Does not take ownership of |oracle|.  Without one, the
+  // stackwalker builds its own the first time it scans.
+  void set_instruction_address_oracle(InstructionAddressOracle* oracle);
+
+  // Makes the stackwalker look up frames' symbols and caller frame
+  // information through |memo|, which may be shared by the stackwalkers
+  // for all of a minidump's threads.  Does not take ownership of |memo|.
+  // Without one, the default, each lookup goes to frame_symbolizer_.
+  void set_symbolization_memo(SymbolizationMemo* memo) {
+    symbolization_memo_ = memo;
+  }
+
  protected:
   // system_info identifies the operating system, NULL or empty if unknown.
   // memory identifies a MemoryRegion that provides the stack memory
@@ -124,8 +140,24 @@ class Stackwalker {
   // * This address is within a loaded module for which we have symbols,
   //   and falls inside a function in that module.
   // Returns false otherwise.
+  // The answer comes from an InstructionAddressOracle, which gives the
+  // same result as looking the address up with frame_symbolizer_.
   bool InstructionAddressSeemsValid(uint64_t address);
 
+  // Returns how many of the |count| words of |word_size| bytes at
+  // |location| can be skipped when scanning the stack for a return
+  // address, because they can be read and lie outside every module.
+  // Returns 0 if memory_ can't hand out its contents with
+  // GetBytesAtAddress, so that each word must be read and checked.
+  uint64_t SkipWordsOutsideModules(uint64_t location, uint64_t count,
+                                   size_t word_size);
+
+  // Return what frame_symbolizer_'s methods of the same names return for
+  // |frame|, answering from the symbolization memo if there is one.  The
+  // caller takes ownership of the result.
+  WindowsFrameInfo* FindWindowsFrameInfo(const StackFrame* frame);
+  CFIFrameInfo* FindCFIFrameInfo(const StackFrame* frame);
+
   // The default number of words to search through on the stack
   // for a return address.
   static const int kRASearchWords;
@@ -149,6 +181,8 @@ class Stackwalker {
   // that looks like a valid instruction pointer. Addresses must
   // 1) be contained in the current stack memory
   // 2) pass the checks in InstructionAddressSeemsValid
+  // Words outside every module are skipped in bulk first; see
+  // SkipWordsOutsideModules.
   //
   // Returns true if a valid-looking instruction pointer was found.
   // When returning true, sets location_found to the address at which
@@ -162,12 +196,22 @@ class Stackwalker {
     for (InstructionType location = location_start;
          location <= location_start + searchwords * sizeof(InstructionType);
          location += sizeof(InstructionType)) {
+      // Skip the words that lie outside every module, which can't be
+      // return addresses, many at a time.
+      uint64_t remaining =
+          (location_start + searchwords * sizeof(InstructionType) -
+           location) / sizeof(InstructionType) + 1;
+      uint64_t skipped = SkipWordsOutsideModules(location, remaining,
+                                                 sizeof(InstructionType));
+      if (skipped == remaining)
+        break;
+      location += skipped * sizeof(InstructionType);
+
       InstructionType ip;
       if (!memory_->GetMemoryAtAddress(location, &ip))
         break;
 
-      if (modules_ && modules_->GetModuleForAddress(ip) &&
-          InstructionAddressSeemsValid(ip)) {
+      if (InstructionAddressSeemsValid(ip)) {
         *ip_found = ip;
         *location_found = location;
         return true;
@@ -194,6 +238,9 @@ class Stackwalker {
   StackFrameSymbolizer* frame_symbolizer_;
 
  private:
+  // Returns instruction_address_oracle_, creating it if it wasn't set.
+  InstructionAddressOracle* GetInstructionAddressOracle();
+
   // Obtains the context frame, the innermost called procedure in a stack
   // trace.  Returns NULL on failure.  GetContextFrame allocates a new
   // StackFrame (or StackFrame subclass), ownership of which is taken by
@@ -227,6 +274,15 @@ class Stackwalker {
   // disable or limit it is helpful in cases where unwind performance is
   // important.  This defaults to 1024, the same as max_frames_.
   static uint32_t max_frames_scanned_;
+
+  // Checks candidate return addresses for stack scanning.  Set by
+  // set_instruction_address_oracle, or created on first use, in which
+  // case own_instruction_address_oracle_ is true.
+  InstructionAddressOracle* instruction_address_oracle_;
+  bool own_instruction_address_oracle_;
+
+  // Set by set_symbolization_memo, or NULL.
+  SymbolizationMemo* symbolization_memo_;
 };
 
 }  // namespace google_breakpad
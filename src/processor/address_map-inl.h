@@ -40,6 +40,8 @@
 
 #include <assert.h>
 
+#include <algorithm>
+
 #include "processor/logging.h"
 
 namespace google_breakpad {
@@ -47,6 +49,9 @@ namespace google_breakpad {
 template<typename AddressType, typename EntryType>
 bool AddressMap<AddressType, EntryType>::Store(const AddressType &address,
                                                const EntryType &entry) {
+  if (!frozen_.empty())
+    Thaw();
+
   // Ensure that the specified address doesn't conflict with something already
   // in the map.
   if (map_.find(address) != map_.end()) {
@@ -71,6 +76,20 @@ bool AddressMap<AddressType, EntryType>::Retrieve(
   // Decrement the iterator to get there, but not if the upper_bound already
   // points to the beginning of the map - in that case, address is lower than
   // the lowest stored key, so return false.
+  if (!frozen_.empty()) {
+    FrozenConstIterator iterator = std::upper_bound(
+        frozen_.begin(), frozen_.end(), address, FrozenKeyLess());
+    if (iterator == frozen_.begin())
+      return false;
+    --iterator;
+
+    *entry = iterator->second;
+    if (entry_address)
+      *entry_address = iterator->first;
+
+    return true;
+  }
+
   MapConstIterator iterator = map_.upper_bound(address);
   if (iterator == map_.begin())
     return false;
@@ -83,9 +102,69 @@ bool AddressMap<AddressType, EntryType>::Retrieve(
   return true;
 }
 
+template<typename AddressType, typename EntryType>
+bool AddressMap<AddressType, EntryType>::RetrieveAtIndex(
+    int index, EntryType *entry, AddressType *entry_address) const {
+  BPLOG_IF(ERROR, !entry) << "AddressMap::RetrieveAtIndex requires |entry|";
+  assert(entry);
+
+  if (index < 0 || index >= GetCount()) {
+    BPLOG(ERROR) << "Index out of range: " << index << "/" << GetCount();
+    return false;
+  }
+
+  if (!frozen_.empty()) {
+    *entry = frozen_[index].second;
+    if (entry_address)
+      *entry_address = frozen_[index].first;
+    return true;
+  }
+
+  MapConstIterator iterator = map_.begin();
+  for (int this_index = 0; this_index < index; ++this_index)
+    ++iterator;
+
+  *entry = iterator->second;
+  if (entry_address)
+    *entry_address = iterator->first;
+  return true;
+}
+
+template<typename AddressType, typename EntryType>
+int AddressMap<AddressType, EntryType>::GetCount() const {
+  return map_.size() + frozen_.size();
+}
+
 template<typename AddressType, typename EntryType>
 void AddressMap<AddressType, EntryType>::Clear() {
   map_.clear();
+  FrozenEntries().swap(frozen_);
+}
+
+template<typename AddressType, typename EntryType>
+void AddressMap<AddressType, EntryType>::Freeze() {
+  if (map_.empty())
+    return;
+
+  FrozenEntries frozen(map_.begin(), map_.end());
+  frozen_.swap(frozen);
+  map_.clear();
+}
+
+template<typename AddressType, typename EntryType>
+void AddressMap<AddressType, EntryType>::Thaw() {
+  map_.insert(frozen_.begin(), frozen_.end());
+  FrozenEntries().swap(frozen_);
+}
+
+template<typename AddressType, typename EntryType>
+const typename AddressMap<AddressType, EntryType>::AddressToEntryMap &
+AddressMap<AddressType, EntryType>::Entries(AddressToEntryMap *storage) const {
+  if (frozen_.empty())
+    return map_;
+  storage->clear();
+  storage->insert(frozen_.begin(), frozen_.end());
+  return *storage;
 }
 
 }  // namespace google_breakpad
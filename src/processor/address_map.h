@@ -39,6 +39,8 @@
 #define PROCESSOR_ADDRESS_MAP_H__
 
 #include <map>
+#include <utility>
+#include <vector>
 
 namespace google_breakpad {
 
@@ -48,7 +50,7 @@ template<class, class> class AddressMapSerializer;
 template<typename AddressType, typename EntryType>
 class AddressMap {
  public:
-  AddressMap() : map_() {}
+  AddressMap() : map_(), frozen_() {}
 
   // Inserts an entry into the map.  Returns false without storing the entry
   // if an entry is already stored in the map at the same address as specified
@@ -63,10 +65,25 @@ class AddressMap {
   bool Retrieve(const AddressType &address,
                 EntryType *entry, AddressType *entry_address) const;
 
+  // Treating the entries as a list ordered by address, retrieves the
+  // entry at |index|.  Returns false if index is out of range.  Like
+  // RangeMap::RetrieveRangeAtIndex, this is only fast for a frozen map.
+  bool RetrieveAtIndex(int index, EntryType *entry,
+                       AddressType *entry_address) const;
+
+  // Returns the number of entries stored in the map.
+  int GetCount() const;
+
   // Empties the address map, restoring it to the same state as when it was
   // initially created.
   void Clear();
 
+  // Moves the entries into a sorted array, which takes a fraction of the
+  // memory of the tree they are kept in while the map is populated, and
+  // is faster to search.  Storing another entry into a frozen map moves
+  // the entries back into a tree first.
+  void Freeze();
+
  private:
   friend class AddressMapSerializer<AddressType, EntryType>;
   friend class ModuleComparer;
@@ -75,9 +92,35 @@ class AddressMap {
   typedef std::map<AddressType, EntryType> AddressToEntryMap;
   typedef typename AddressToEntryMap::const_iterator MapConstIterator;
   typedef typename AddressToEntryMap::value_type MapValue;
+  typedef std::pair<AddressType, EntryType> FrozenValue;
+  typedef std::vector<FrozenValue> FrozenEntries;
+  typedef typename FrozenEntries::const_iterator FrozenConstIterator;
+
+  // Orders frozen entries by their addresses.
+  struct FrozenKeyLess {
+    bool operator()(const FrozenValue &value,
+                    const AddressType &address) const {
+      return value.first < address;
+    }
+    bool operator()(const AddressType &address,
+                    const FrozenValue &value) const {
+      return address < value.first;
+    }
+  };
+
+  // Moves the entries of a frozen map back into map_.
+  void Thaw();
+
+  // Returns the entries keyed by their addresses: map_ itself, or if the
+  // map is frozen, a copy of the entries built in |storage|.
+  const AddressToEntryMap &Entries(AddressToEntryMap *storage) const;
 
   // Maps the address of each entry to an EntryType.
   AddressToEntryMap map_;
+
+  // The entries of a frozen map, ordered by address.  At most one of map_
+  // and frozen_ is non-empty.
+  FrozenEntries frozen_;
 };
 
 }  // namespace google_breakpad
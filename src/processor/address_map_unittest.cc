@@ -73,7 +73,9 @@ int CountedObject::count_;
 typedef int AddressType;
 typedef AddressMap< AddressType, linked_ptr<CountedObject> > TestMap;
 
-static bool DoAddressMapTest() {
+// If |freeze| is true, the map is frozen partway through storing entries,
+// and again before the entries are checked.
+static bool DoAddressMapTest(bool freeze) {
   ASSERT_EQ(CountedObject::count(), 0);
 
   TestMap test_map;
@@ -114,6 +116,12 @@ static bool DoAddressMapTest() {
   ASSERT_TRUE(test_map.Store(5,
       linked_ptr<CountedObject>(new CountedObject(2))));
   ASSERT_EQ(CountedObject::count(), 2);
+  if (freeze) {
+    test_map.Freeze();
+    ASSERT_TRUE(test_map.Retrieve(9, &entry, &address));
+    ASSERT_EQ(entry->id(), 2);
+    ASSERT_EQ(address, 5);
+  }
   ASSERT_TRUE(test_map.Store(20,
       linked_ptr<CountedObject>(new CountedObject(3))));
   ASSERT_TRUE(test_map.Store(15,
@@ -124,6 +132,8 @@ static bool DoAddressMapTest() {
       linked_ptr<CountedObject>(new CountedObject(6))));
   ASSERT_TRUE(test_map.Store(14,
       linked_ptr<CountedObject>(new CountedObject(7))));
+  if (freeze)
+    test_map.Freeze();
 
   // Nothing was stored with a key under 5.  Don't use ASSERT inside loops
   // because it won't show exactly which key/entry/address failed.
@@ -171,6 +181,17 @@ static bool DoAddressMapTest() {
     }
   }
 
+  // Walking the entries by index visits them in address order.
+  ASSERT_EQ(test_map.GetCount(), 6);
+  AddressType previous_address = 0;
+  for (int index = 0; index < test_map.GetCount(); ++index) {
+    ASSERT_TRUE(test_map.RetrieveAtIndex(index, &entry, &address));
+    ASSERT_TRUE(index == 0 || address > previous_address);
+    ASSERT_EQ(entry->id(), id_verify[address]);
+    previous_address = address;
+  }
+  ASSERT_FALSE(test_map.RetrieveAtIndex(6, &entry, &address));
+
   // The stored objects should still be in the map.
   ASSERT_EQ(CountedObject::count(), 6);
 
@@ -178,12 +199,17 @@ static bool DoAddressMapTest() {
 }
 
 static bool RunTests() {
-  if (!DoAddressMapTest())
+  if (!DoAddressMapTest(false))
     return false;
 
   // Leak check.
   ASSERT_EQ(CountedObject::count(), 0);
 
+  if (!DoAddressMapTest(true))
+    return false;
+
+  ASSERT_EQ(CountedObject::count(), 0);
+
   return true;
 }
 
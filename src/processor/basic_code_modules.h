@@ -41,11 +41,12 @@
 #ifndef PROCESSOR_BASIC_CODE_MODULES_H__
 #define PROCESSOR_BASIC_CODE_MODULES_H__
 
+#include <vector>
+
 #include "google_breakpad/processor/code_modules.h"
 
 namespace google_breakpad {
 
-template<typename T> class linked_ptr;
 template<typename AddressType, typename EntryType> class RangeMap;
 
 class BasicCodeModules : public CodeModules {
@@ -70,12 +71,21 @@ class BasicCodeModules : public CodeModules {
  protected:
   BasicCodeModules();
 
+  // Adds module to the map, taking ownership of it.  If its address range
+  // conflicts with a module already stored, module is deleted and false
+  // is returned.
+  bool StoreModule(const CodeModule *module);
+
   // The base address of the main module.
   uint64_t main_address_;
 
   // The map used to contain each CodeModule, keyed by each CodeModule's
-  // address range.
-  RangeMap<uint64_t, linked_ptr<const CodeModule> > *map_;
+  // address range.  The map holds plain pointers, so that lookups don't
+  // modify any shared state and may be made from several threads at once.
+  RangeMap<uint64_t, const CodeModule*> *map_;
+
+  // The CodeModules stored in map_, owned by this object.
+  std::vector<const CodeModule*> modules_;
 
  private:
   // Disallow copy constructor and assignment operator.
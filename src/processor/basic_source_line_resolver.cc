@@ -38,6 +38,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 
+#include <algorithm>
 #include <limits>
 #include <map>
 #include <utility>
@@ -45,9 +46,10 @@
 
 #include "google_breakpad/processor/basic_source_line_resolver.h"
 #include "processor/basic_source_line_resolver_types.h"
+#include "processor/compressed_symbol_file.h"
 #include "processor/module_factory.h"
-
-#include "processor/tokenize.h"
+#include "processor/symbol_file_index.h"
+#include "processor/symbol_scanner.h"
 
 using std::map;
 using std::vector;
@@ -57,15 +59,52 @@ namespace google_breakpad {
 
 #ifdef _WIN32
 #define strtok_r strtok_s
-#define strtoull _strtoui64
 #endif
 
 static const char *kWhitespace = " \r\n";
 static const int kMaxErrorsPrinted = 5;
 static const int kMaxErrorsBeforeBailing = 100;
 
+// The memory a map node takes beyond the value it holds: the tree links,
+// and the linked_ptr most of the module's values are held by.
+static const size_t kMapNodeOverhead = 6 * sizeof(void*);
+
 BasicSourceLineResolver::BasicSourceLineResolver() :
-    SourceLineResolverBase(new BasicModuleFactory) { }
+    SourceLineResolverBase(new BasicModuleFactory),
+    use_symbol_file_indexes_(false) { }
+
+bool BasicSourceLineResolver::LoadModule(const CodeModule *module,
+                                         const string &map_file) {
+  if (!use_symbol_file_indexes_ || !module ||
+      IsCompressedSymbolFile(map_file)) {
+    return SourceLineResolverBase::LoadModule(module, map_file);
+  }
+
+  string index_file = map_file + kSymbolFileIndexSuffix;
+  struct stat buf;
+  if (stat(index_file.c_str(), &buf) != 0)
+    return SourceLineResolverBase::LoadModule(module, map_file);
+
+  scoped_ptr<SymbolFileIndex> index(new SymbolFileIndex);
+  string global_records;
+  if (!index->Read(index_file) || !index->Matches(map_file) ||
+      !index->ReadGlobalRecords(map_file, &global_records)) {
+    BPLOG(ERROR) << "Ignoring symbol file index " << index_file;
+    return SourceLineResolverBase::LoadModule(module, map_file);
+  }
+
+  BPLOG(INFO) << "Loading symbols for module " << module->code_file()
+              << " from " << map_file << " using " << index_file;
+  if (!LoadModuleUsingMapBuffer(module, global_records))
+    return false;
+
+  ModuleMap::iterator it = modules_->find(module->code_file());
+  if (it != modules_->end()) {
+    static_cast<Module*>(it->second)->SetSymbolFileIndex(map_file,
+                                                         index.release());
+  }
+  return true;
+}
 
 // static
 void BasicSourceLineResolver::Module::LogParseError(
@@ -84,10 +123,8 @@ void BasicSourceLineResolver::Module::LogParseError(
 bool BasicSourceLineResolver::Module::LoadMapFromMemory(
     char *memory_buffer,
     size_t memory_buffer_size) {
-  linked_ptr<Function> cur_func;
   int line_number = 0;
   int num_errors = 0;
-  char *save_ptr;
 
   // If the length is 0, we can still pretend we have a symbol file. This is
   // for scenarios that want to test symbol lookup, but don't necessarily care
@@ -109,11 +146,12 @@ bool BasicSourceLineResolver::Module::LoadMapFromMemory(
          memory_buffer[last_null_terminator - 1] == '\0') {
     last_null_terminator--;
   }
-  for (size_t i = 0; i < last_null_terminator; i++) {
-    if (memory_buffer[i] == '\0') {
-      memory_buffer[i] = '_';
-      has_null_terminator_in_the_middle = true;
-    }
+  char *null_terminator = memory_buffer;
+  while ((null_terminator = static_cast<char*>(
+              memchr(null_terminator, '\0',
+                     memory_buffer + last_null_terminator - null_terminator)))) {
+    *null_terminator++ = '_';
+    has_null_terminator_in_the_middle = true;
   }
   if (has_null_terminator_in_the_middle) {
     LogParseError(
@@ -122,36 +160,79 @@ bool BasicSourceLineResolver::Module::LoadMapFromMemory(
        &num_errors);
   }
 
-  char *buffer;
-  buffer = strtok_r(memory_buffer, "\r\n", &save_ptr);
+  ParseRecords(memory_buffer, &line_number, &num_errors);
+  is_corrupt_ = num_errors > 0;
+
+  // The maps are only read from now on, so compact them.
+  functions_.Freeze();
+  public_symbols_.Freeze();
+  for (int i = 0; i < WindowsFrameInfo::STACK_INFO_LAST; ++i)
+    windows_frame_info_[i].Freeze();
+  cfi_initial_rules_.Freeze();
+  return true;
+}
+
+void BasicSourceLineResolver::Module::ParseRecords(char *records,
+                                                   int *line_number,
+                                                   int *num_errors) {
+  linked_ptr<Function> cur_func;
+  // The lines of cur_func, until they are encoded into its LineTable.
+  RangeMap<MemAddr, Line> cur_lines;
+  // Records are numbered only if the caller knows where they start.
+  int current_line = line_number ? *line_number : 0;
+  // False if cur_func was rejected, and its lines can be dropped.
+  bool cur_func_stored = false;
+  bool cfi_init_rejected = false;
+
+  SymbolRecordScanner scanner(records);
+  char *buffer = scanner.Next();
 
   while (buffer != NULL) {
-    ++line_number;
+    if (line_number)
+      ++current_line;
+    if (strncmp(buffer, "STACK CFI ", 10) != 0)
+      cfi_init_rejected = false;
 
     if (strncmp(buffer, "FILE ", 5) == 0) {
       if (!ParseFile(buffer)) {
-        LogParseError("ParseFile on buffer failed", line_number, &num_errors);
+        LogParseError("ParseFile on buffer failed", current_line, num_errors);
       }
     } else if (strncmp(buffer, "STACK ", 6) == 0) {
-      if (!ParseStackInfo(buffer)) {
-        LogParseError("ParseStackInfo failed", line_number, &num_errors);
+      if (!ParseStackInfo(buffer, &cfi_init_rejected)) {
+        LogParseError("ParseStackInfo failed", current_line, num_errors);
       }
     } else if (strncmp(buffer, "FUNC ", 5) == 0) {
+      // The previous function has all of its lines now.
+      if (cur_func.get())
+        EncodeLines(cur_func.get(), &cur_lines);
       cur_func.reset(ParseFunction(buffer));
+      cur_func_stored = false;
       if (!cur_func.get()) {
-        LogParseError("ParseFunction failed", line_number, &num_errors);
+        LogParseError("ParseFunction failed", current_line, num_errors);
       } else {
         // StoreRange will fail if the function has an invalid address or size.
         // We'll silently ignore this, the function and any corresponding lines
         // will be destroyed when cur_func is released.
-        functions_.StoreRange(cur_func->address, cur_func->size, cur_func);
+        cur_func_stored = functions_.StoreRange(cur_func->address,
+                                                cur_func->size, cur_func);
+        if (cur_func_stored) {
+          memory_usage_ += sizeof(Function) + cur_func->name.size() +
+                           kMapNodeOverhead;
+        }
+        if (cur_func_stored && lazy_line_parsing_) {
+          cur_func->line_data_offset = line_data_.size();
+          cur_func->lines_parsed = false;
+          unparsed_functions_.push_back(cur_func.get());
+        }
       }
     } else if (strncmp(buffer, "PUBLIC ", 7) == 0) {
       // Clear cur_func: public symbols don't contain line number information.
+      if (cur_func.get())
+        EncodeLines(cur_func.get(), &cur_lines);
       cur_func.reset();
 
       if (!ParsePublicSymbol(buffer)) {
-        LogParseError("ParsePublicSymbol failed", line_number, &num_errors);
+        LogParseError("ParsePublicSymbol failed", current_line, num_errors);
       }
     } else if (strncmp(buffer, "MODULE ", 7) == 0) {
       // Ignore these.  They're not of any use to BasicSourceLineResolver,
@@ -167,28 +248,48 @@ bool BasicSourceLineResolver::Module::LoadMapFromMemory(
     } else {
       if (!cur_func.get()) {
         LogParseError("Found source line data without a function",
-                       line_number, &num_errors);
-      } else {
-        Line *line = ParseLine(buffer);
-        if (!line) {
-          LogParseError("ParseLine failed", line_number, &num_errors);
-        } else {
-          cur_func->lines.StoreRange(line->address, line->size,
-                                     linked_ptr<Line>(line));
+                       current_line, num_errors);
+      } else if (!cur_func->lines_parsed) {
+        // Keep the record for ParseFunctionLines.
+        size_t length = strlen(buffer);
+        line_data_.append(buffer, length);
+        line_data_ += '\n';
+        cur_func->line_data_size += length + 1;
+        memory_usage_ += length + 1;
+      } else if (!lazy_line_parsing_) {
+        Line line;
+        if (!ParseLine(buffer, &line)) {
+          LogParseError("ParseLine failed", current_line, num_errors);
+        } else if (cur_func_stored) {
+          cur_lines.StoreRange(line.address, line.size, line);
         }
       }
     }
-    if (num_errors > kMaxErrorsBeforeBailing) {
+    if (*num_errors > kMaxErrorsBeforeBailing) {
       break;
     }
-    buffer = strtok_r(NULL, "\r\n", &save_ptr);
+    buffer = scanner.Next();
   }
-  is_corrupt_ = num_errors > 0;
-  return true;
+  if (cur_func.get())
+    EncodeLines(cur_func.get(), &cur_lines);
+  if (line_number)
+    *line_number = current_line;
+}
+
+void BasicSourceLineResolver::Module::SetSymbolFileIndex(
+    const string &symbol_file, SymbolFileIndex *index) {
+  symbol_file_ = symbol_file;
+  index_.reset(index);
+  loaded_functions_.assign(index->functions().size(), false);
+  loaded_cfi_.assign(index->cfi().size(), false);
+  memory_usage_ += (index->functions().size() + index->cfi().size()) *
+                   sizeof(SymbolFileIndex::Entry);
 }
 
 void BasicSourceLineResolver::Module::LookupAddress(StackFrame *frame) const {
   MemAddr address = frame->instruction - frame->module->base_address();
+  if (index_.get())
+    LoadIndexedFunction(address);
 
   // First, look for a FUNC record that covers address. Use
   // RetrieveNearestRange instead of RetrieveRange so that, if there
@@ -204,30 +305,62 @@ void BasicSourceLineResolver::Module::LookupAddress(StackFrame *frame) const {
   if (functions_.RetrieveNearestRange(address, &func,
                                       &function_base, &function_size) &&
       address >= function_base && address - function_base < function_size) {
-    frame->function_name = func->name;
+    frame->function_name = func->name.str();
     frame->function_base = frame->module->base_address() + function_base;
 
-    linked_ptr<Line> line;
-    MemAddr line_base;
-    if (func->lines.RetrieveRange(address, &line, &line_base, NULL)) {
-      FileMap::const_iterator it = files_.find(line->source_file_id);
+    if (!func->lines_parsed)
+      ParseFunctionLines(func.get());
+
+    Line line;
+    if (func->lines.Retrieve(address, &line)) {
+      FileMap::const_iterator it = files_.find(line.source_file_id);
       if (it != files_.end()) {
-        frame->source_file_name = files_.find(line->source_file_id)->second;
+        frame->source_file_name = it->second.str();
       }
-      frame->source_line = line->line;
-      frame->source_line_base = frame->module->base_address() + line_base;
+      frame->source_line = line.line;
+      frame->source_line_base = frame->module->base_address() + line.address;
     }
   } else if (public_symbols_.Retrieve(address,
                                       &public_symbol, &public_address) &&
              (!func.get() || public_address > function_base)) {
-    frame->function_name = public_symbol->name;
+    frame->function_name = public_symbol->name.str();
     frame->function_base = frame->module->base_address() + public_address;
   }
 }
 
+bool BasicSourceLineResolver::Module::GetFunctionTable(
+    FunctionTable *table) const {
+  if (index_.get())
+    return false;
+
+  // LookupAddress names an address after the function covering it, or
+  // else after the closest PUBLIC symbol below it, as long as no function
+  // lies between the two.
+  int function_count = functions_.GetCount();
+  table->functions.resize(function_count);
+  for (int i = 0; i < function_count; ++i) {
+    linked_ptr<Function> func;
+    FunctionTable::Function &entry = table->functions[i];
+    functions_.RetrieveRangeAtIndex(i, &func, &entry.base, &entry.size);
+    entry.has_name = !func->name.empty();
+  }
+
+  int public_count = public_symbols_.GetCount();
+  table->public_symbols.resize(public_count);
+  for (int i = 0; i < public_count; ++i) {
+    linked_ptr<PublicSymbol> public_symbol;
+    FunctionTable::PublicSymbol &entry = table->public_symbols[i];
+    public_symbols_.RetrieveAtIndex(i, &public_symbol, &entry.address);
+    entry.has_name = !public_symbol->name.empty();
+  }
+  return true;
+}
+
 WindowsFrameInfo *BasicSourceLineResolver::Module::FindWindowsFrameInfo(
     const StackFrame *frame) const {
   MemAddr address = frame->instruction - frame->module->base_address();
+  if (index_.get())
+    LoadIndexedFunction(address);
   scoped_ptr<WindowsFrameInfo> result(new WindowsFrameInfo());
 
   // We only know about WindowsFrameInfo::STACK_INFO_FRAME_DATA and
@@ -277,9 +410,27 @@ WindowsFrameInfo *BasicSourceLineResolver::Module::FindWindowsFrameInfo(
 CFIFrameInfo *BasicSourceLineResolver::Module::FindCFIFrameInfo(
     const StackFrame *frame) const {
   MemAddr address = frame->instruction - frame->module->base_address();
+  if (index_.get())
+    LoadIndexedCFI(address);
   MemAddr initial_base, initial_size;
   string initial_rules;
 
+  // If a previous lookup already built the rule set for this address,
+  // hand out a copy of it.
+  map<MemAddr, CachedCFIFrameInfo>::iterator cached =
+    cfi_frame_info_cache_.upper_bound(address);
+  if (cached != cfi_frame_info_cache_.begin()) {
+    --cached;
+    if (address - cached->first < cached->second.size) {
+      ++cfi_frame_info_cache_hits_;
+      cfi_frame_info_lru_.splice(cfi_frame_info_lru_.begin(),
+                                 cfi_frame_info_lru_,
+                                 cached->second.lru_position);
+      return new CFIFrameInfo(cached->second.rules);
+    }
+  }
+  ++cfi_frame_info_cache_misses_;
+
   // Find the initial rule whose range covers this address. That
   // provides an initial set of register recovery rules. Then, walk
   // forward from the initial rule's starting address to frame's
@@ -299,20 +450,72 @@ CFIFrameInfo *BasicSourceLineResolver::Module::FindCFIFrameInfo(
   map<MemAddr, string>::const_iterator delta =
     cfi_delta_rules_.lower_bound(initial_base);
 
-  // Apply delta rules up to and including the frame's address.
+  // Apply delta rules up to and including the frame's address, keeping
+  // track of the range of addresses the resulting rule set covers: from
+  // the last delta applied up to the next one, or to the end of the
+  // STACK CFI INIT record's range.
+  MemAddr range_base = initial_base;
+  MemAddr range_end = initial_base + initial_size;
   while (delta != cfi_delta_rules_.end() && delta->first <= address) {
     ParseCFIRuleSet(delta->second, rules.get());
+    range_base = delta->first;
     delta++;
   }
+  if (delta != cfi_delta_rules_.end() && delta->first < range_end)
+    range_end = delta->first;
+
+  if (cfi_frame_info_cache_.size() >= kMaxCachedCFIFrameInfo) {
+    cfi_frame_info_cache_.erase(cfi_frame_info_lru_.back());
+    cfi_frame_info_lru_.pop_back();
+  }
+  CachedCFIFrameInfo &entry = cfi_frame_info_cache_[range_base];
+  entry.size = range_end - range_base;
+  entry.rules = *rules;
+  cfi_frame_info_lru_.push_front(range_base);
+  entry.lru_position = cfi_frame_info_lru_.begin();
 
   return rules.release();
 }
 
+void BasicSourceLineResolver::GetCFIFrameInfoCacheStats(
+    uint64_t *hits, uint64_t *misses) const {
+  *hits = 0;
+  *misses = 0;
+  for (ModuleMap::const_iterator it = modules_->begin();
+       it != modules_->end(); ++it) {
+    const Module *module = static_cast<const Module*>(it->second);
+    *hits += module->cfi_frame_info_cache_hits();
+    *misses += module->cfi_frame_info_cache_misses();
+  }
+}
+
+void BasicSourceLineResolver::set_lazy_line_parsing(bool lazy) {
+  static_cast<BasicModuleFactory*>(module_factory_)->set_lazy_line_parsing(
+      lazy);
+}
+
+void BasicSourceLineResolver::GetInternedStringStats(
+    uint64_t *references, uint64_t *strings, uint64_t *referenced_bytes,
+    uint64_t *stored_bytes) const {
+  const InternedStringTable &table =
+      static_cast<BasicModuleFactory*>(module_factory_)->strings();
+  *references = table.reference_count();
+  *strings = table.string_count();
+  *referenced_bytes = table.referenced_bytes();
+  *stored_bytes = table.string_bytes();
+}
+
 bool BasicSourceLineResolver::Module::ParseFile(char *file_line) {
   long index;
   char *filename;
   if (SymbolParseHelper::ParseFile(file_line, &index, &filename)) {
-    files_.insert(make_pair(index, string(filename)));
+    InternedString interned = strings_->Intern(filename, strlen(filename));
+    if (interned.is_null())
+      return false;
+    if (files_.insert(make_pair(index, interned)).second) {
+      memory_usage_ += sizeof(FileMap::value_type) + interned.size() +
+                       kMapNodeOverhead;
+    }
     return true;
   }
   return false;
@@ -326,13 +529,16 @@ BasicSourceLineResolver::Module::ParseFunction(char *function_line) {
   char *name;
   if (SymbolParseHelper::ParseFunction(function_line, &address, &size,
                                        &stack_param_size, &name)) {
-    return new Function(name, address, size, stack_param_size);
+    InternedString interned = strings_->Intern(name, strlen(name));
+    if (interned.is_null())
+      return NULL;
+    return new Function(interned, address, size, stack_param_size);
   }
   return NULL;
 }
 
-BasicSourceLineResolver::Line* BasicSourceLineResolver::Module::ParseLine(
-    char *line_line) {
+bool BasicSourceLineResolver::Module::ParseLine(char *line_line,
+                                               Line *line) {
   uint64_t address;
   uint64_t size;
   long line_number;
@@ -340,9 +546,100 @@ BasicSourceLineResolver::Line* BasicSourceLineResolver::Module::ParseLine(
 
   if (SymbolParseHelper::ParseLine(line_line, &address, &size, &line_number,
                                    &source_file)) {
-    return new Line(address, size, source_file, line_number);
+    *line = Line(address, size, source_file, line_number);
+    return true;
   }
-  return NULL;
+  return false;
+}
+
+void BasicSourceLineResolver::Module::ParseFunctionLines(
+    Function *function) const {
+  if (function->lines_parsed)
+    return;
+  function->lines_parsed = true;
+  if (function->line_data_size == 0)
+    return;
+
+  // ParseLine tokenizes the records in place, so parse a copy of them.
+  vector<char> records(line_data_.begin() + function->line_data_offset,
+                       line_data_.begin() + function->line_data_offset +
+                           function->line_data_size);
+  records.push_back('\0');
+
+  int num_errors = 0;
+  RangeMap<MemAddr, Line> lines;
+  SymbolRecordScanner scanner(&records[0]);
+  char *buffer = scanner.Next();
+  while (buffer != NULL) {
+    Line line;
+    if (!ParseLine(buffer, &line)) {
+      LogParseError("ParseLine failed in function " + function->name.str(),
+                    0, &num_errors);
+    } else {
+      lines.StoreRange(line.address, line.size, line);
+    }
+    buffer = scanner.Next();
+  }
+  EncodeLines(function, &lines);
+}
+
+void BasicSourceLineResolver::Module::EncodeLines(
+    Function *function, RangeMap<MemAddr, Line> *lines) const {
+  function->lines.Encode(lines);
+  memory_usage_ += function->lines.MemoryUsage();
+}
+
+void BasicSourceLineResolver::Module::ParseAllFunctionLines() const {
+  if (index_.get()) {
+    for (size_t i = 0; i < loaded_functions_.size(); ++i) {
+      if (!loaded_functions_[i]) {
+        loaded_functions_[i] = true;
+        LoadIndexedEntry(index_->functions()[i], "FUNC ");
+      }
+    }
+    for (size_t i = 0; i < loaded_cfi_.size(); ++i) {
+      if (!loaded_cfi_[i]) {
+        loaded_cfi_[i] = true;
+        LoadIndexedEntry(index_->cfi()[i], "STACK CFI INIT ");
+      }
+    }
+  }
+  for (size_t i = 0; i < unparsed_functions_.size(); ++i)
+    ParseFunctionLines(unparsed_functions_[i]);
+  unparsed_functions_.clear();
+}
+
+void BasicSourceLineResolver::Module::LoadIndexedFunction(
+    MemAddr address) const {
+  int entry = index_->FindFunction(address);
+  if (entry < 0 || loaded_functions_[entry])
+    return;
+  loaded_functions_[entry] = true;
+  LoadIndexedEntry(index_->functions()[entry], "FUNC ");
+}
+
+void BasicSourceLineResolver::Module::LoadIndexedCFI(MemAddr address) const {
+  int entry = index_->FindCFI(address);
+  if (entry < 0 || loaded_cfi_[entry])
+    return;
+  loaded_cfi_[entry] = true;
+  LoadIndexedEntry(index_->cfi()[entry], "STACK CFI INIT ");
+}
+
+void BasicSourceLineResolver::Module::LoadIndexedEntry(
+    const SymbolFileIndex::Entry &entry, const char *prefix) const {
+  vector<char> records;
+  if (!SymbolFileIndex::ReadSpan(symbol_file_, entry.records, &records))
+    return;
+  if (strncmp(&records[0], prefix, strlen(prefix)) != 0) {
+    BPLOG(ERROR) << "The index of " << symbol_file_ << " doesn't match it";
+    return;
+  }
+
+  // Lookups are const, but parsing records on demand only changes when
+  // they are parsed, not what lookups find.
+  int num_errors = 0;
+  const_cast<Module*>(this)->ParseRecords(&records[0], NULL, &num_errors);
 }
 
 bool BasicSourceLineResolver::Module::ParsePublicSymbol(char *public_line) {
@@ -362,14 +659,22 @@ bool BasicSourceLineResolver::Module::ParsePublicSymbol(char *public_line) {
       return true;
     }
 
-    linked_ptr<PublicSymbol> symbol(new PublicSymbol(name, address,
-                                                     stack_param_size));
-    return public_symbols_.Store(address, symbol);
+    InternedString interned = strings_->Intern(name, strlen(name));
+    if (interned.is_null())
+      return false;
+    linked_ptr<PublicSymbol> symbol(
+        new PublicSymbol(interned, address, stack_param_size));
+    if (!public_symbols_.Store(address, symbol))
+      return false;
+    memory_usage_ += sizeof(PublicSymbol) + interned.size() +
+                     kMapNodeOverhead;
+    return true;
   }
   return false;
 }
 
-bool BasicSourceLineResolver::Module::ParseStackInfo(char *stack_info_line) {
+bool BasicSourceLineResolver::Module::ParseStackInfo(char *stack_info_line,
+                                                     bool *cfi_init_rejected) {
   // Skip "STACK " prefix.
   stack_info_line += 6;
 
@@ -414,11 +719,16 @@ bool BasicSourceLineResolver::Module::ParseStackInfo(char *stack_info_line) {
     // if ContainedRangeMap were modified to allow replacement of
     // already-stored values.
 
-    windows_frame_info_[type].StoreRange(rva, code_size, stack_frame_info);
+    if (windows_frame_info_[type].StoreRange(rva, code_size,
+                                             stack_frame_info)) {
+      memory_usage_ += sizeof(WindowsFrameInfo) +
+                       stack_frame_info->program_string.size() +
+                       kMapNodeOverhead;
+    }
     return true;
   } else if (strcmp(platform, "CFI") == 0) {
     // DWARF CFI stack frame info
-    return ParseCFIFrameInfo(stack_info_line);
+    return ParseCFIFrameInfo(stack_info_line, cfi_init_rejected);
   } else {
     // Something unrecognized.
     return false;
@@ -426,7 +736,7 @@ bool BasicSourceLineResolver::Module::ParseStackInfo(char *stack_info_line) {
 }
 
 bool BasicSourceLineResolver::Module::ParseCFIFrameInfo(
-    char *stack_info_line) {
+    char *stack_info_line, bool *cfi_init_rejected) {
   char *cursor;
 
   // Is this an INIT record or a delta record?
@@ -435,6 +745,8 @@ bool BasicSourceLineResolver::Module::ParseCFIFrameInfo(
     return false;
 
   if (strcmp(init_or_address, "INIT") == 0) {
+    *cfi_init_rejected = false;
+
     // This record has the form "STACK INIT <address> <size> <rules...>".
     char *address_field = strtok_r(NULL, " \r\n", &cursor);
     if (!address_field) return false;
@@ -447,7 +759,12 @@ bool BasicSourceLineResolver::Module::ParseCFIFrameInfo(
 
     MemAddr address = strtoul(address_field, NULL, 16);
     MemAddr size    = strtoul(size_field,    NULL, 16);
-    cfi_initial_rules_.StoreRange(address, size, initial_rules);
+    *cfi_init_rejected =
+        !cfi_initial_rules_.StoreRange(address, size, initial_rules);
+    if (!*cfi_init_rejected) {
+      memory_usage_ += sizeof(string) + strlen(initial_rules) +
+                       kMapNodeOverhead;
+    }
     return true;
   }
 
@@ -455,11 +772,149 @@ bool BasicSourceLineResolver::Module::ParseCFIFrameInfo(
   char *address_field = init_or_address;
   char *delta_rules = strtok_r(NULL, "\r\n", &cursor);
   if (!delta_rules) return false;
+  if (*cfi_init_rejected)
+    return true;
   MemAddr address = strtoul(address_field, NULL, 16);
-  cfi_delta_rules_[address] = delta_rules;
+  string &rules = cfi_delta_rules_[address];
+  if (rules.empty())
+    memory_usage_ += sizeof(string) + kMapNodeOverhead;
+  else
+    memory_usage_ -= rules.size();
+  rules = delta_rules;
+  memory_usage_ += rules.size();
   return true;
 }
 
+// Appends |value| to |data| as a little-endian base-128 varint: seven bits
+// per byte, with the high bit set on every byte but the last.
+static void AppendVarint(uint64_t value, vector<uint8_t> *data) {
+  while (value >= 0x80) {
+    data->push_back(static_cast<uint8_t>(value) | 0x80);
+    value >>= 7;
+  }
+  data->push_back(static_cast<uint8_t>(value));
+}
+
+static uint64_t ReadVarint(const uint8_t **cursor) {
+  const uint8_t *p = *cursor;
+  uint64_t value = *p & 0x7f;
+  int shift = 7;
+  while (*p++ & 0x80) {
+    value |= static_cast<uint64_t>(*p & 0x7f) << shift;
+    shift += 7;
+  }
+  *cursor = p;
+  return value;
+}
+
+// Maps signed differences to unsigned values, so that small negative
+// differences get short varints too: 0, -1, 1, -2, ... become 0, 1, 2, 3.
+static uint64_t ZigZagEncode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+static int64_t ZigZagDecode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void BasicSourceLineResolver::LineTable::Encode(
+    RangeMap<MemAddr, Line> *lines) {
+  // Freezing the map makes RetrieveRangeAtIndex cheap.
+  lines->Freeze();
+  line_count_ = lines->GetCount();
+
+  vector<Block> index;
+  vector<uint8_t> data;
+  index.reserve((line_count_ + kLinesPerBlock - 1) / kLinesPerBlock);
+  Line previous(0, 0, 0, 0);
+  for (int i = 0; i < line_count_; ++i) {
+    Line line(0, 0, 0, 0);
+    if (!lines->RetrieveRangeAtIndex(i, &line, NULL, NULL)) {
+      // The index is always in range, but keep the count consistent with
+      // what was encoded if it somehow isn't.
+      BPLOG(ERROR) << "LineTable::Encode could not retrieve line " << i;
+      line_count_ = i;
+      break;
+    }
+    if (i % kLinesPerBlock == 0) {
+      index.push_back(Block(line.address,
+                            static_cast<uint32_t>(data.size())));
+      previous = Line(line.address, 0, 0, 0);
+    }
+    // The map keeps lines from overlapping, so the gap can't be negative.
+    AppendVarint(line.address - (previous.address + previous.size), &data);
+    AppendVarint(line.size, &data);
+    AppendVarint(ZigZagEncode(static_cast<int64_t>(line.source_file_id) -
+                              previous.source_file_id), &data);
+    AppendVarint(ZigZagEncode(static_cast<int64_t>(line.line) -
+                              previous.line), &data);
+    previous = line;
+  }
+  lines->Clear();
+
+  // Copy the vectors so that they take no more memory than they need.
+  vector<Block>(index).swap(index_);
+  vector<uint8_t>(data).swap(data_);
+}
+
+// static
+void BasicSourceLineResolver::LineTable::DecodeLine(const uint8_t **cursor,
+                                                    const Line &previous,
+                                                    Line *line) {
+  line->address = previous.address + previous.size + ReadVarint(cursor);
+  line->size = ReadVarint(cursor);
+  line->source_file_id = static_cast<int32_t>(
+      previous.source_file_id + ZigZagDecode(ReadVarint(cursor)));
+  line->line = static_cast<int32_t>(
+      previous.line + ZigZagDecode(ReadVarint(cursor)));
+}
+
+bool BasicSourceLineResolver::LineTable::Retrieve(MemAddr address,
+                                                  Line *line) const {
+  // Find the last block that starts at or before |address|.
+  vector<Block>::const_iterator block =
+      std::upper_bound(index_.begin(), index_.end(), address, BlockLess());
+  if (block == index_.begin())
+    return false;
+  --block;
+
+  const uint8_t *cursor = &data_[block->offset];
+  const uint8_t *end = &data_[0] + (block + 1 == index_.end() ?
+                                    data_.size() : (block + 1)->offset);
+  Line previous(block->address, 0, 0, 0);
+  while (cursor < end) {
+    Line current;
+    DecodeLine(&cursor, previous, &current);
+    if (current.address > address)
+      return false;
+    // Compare in an overflow-friendly way.
+    if (address - current.address < current.size) {
+      *line = current;
+      return true;
+    }
+    previous = current;
+  }
+  return false;
+}
+
+void BasicSourceLineResolver::LineTable::GetLines(vector<Line> *lines) const {
+  lines->clear();
+  lines->reserve(line_count_);
+  for (size_t i = 0; i < index_.size(); ++i) {
+    const uint8_t *cursor = &data_[index_[i].offset];
+    const uint8_t *end = &data_[0] + (i + 1 == index_.size() ?
+                                      data_.size() : index_[i + 1].offset);
+    Line previous(index_[i].address, 0, 0, 0);
+    while (cursor < end) {
+      Line current;
+      DecodeLine(&cursor, previous, &current);
+      lines->push_back(current);
+      previous = current;
+    }
+  }
+}
+
 // static
 bool SymbolParseHelper::ParseFile(char *file_line, long *index,
                                   char **filename) {
@@ -467,13 +922,13 @@ bool SymbolParseHelper::ParseFile(char *file_line, long *index,
   assert(strncmp(file_line, "FILE ", 5) == 0);
   file_line += 5;  // skip prefix
 
-  vector<char*> tokens;
-  if (!Tokenize(file_line, kWhitespace, 2, &tokens)) {
+  char *tokens[2];
+  if (!SplitSymbolRecord(file_line, 2, tokens)) {
     return false;
   }
 
   char *after_number;
-  *index = strtol(tokens[0], &after_number, 10);
+  *index = ScanLong(tokens[0], &after_number, 10);
   if (!IsValidAfterNumber(after_number) || *index < 0 ||
       *index == std::numeric_limits<long>::max()) {
     return false;
@@ -495,23 +950,23 @@ bool SymbolParseHelper::ParseFunction(char *function_line, uint64_t *address,
   assert(strncmp(function_line, "FUNC ", 5) == 0);
   function_line += 5;  // skip prefix
 
-  vector<char*> tokens;
-  if (!Tokenize(function_line, kWhitespace, 4, &tokens)) {
+  char *tokens[4];
+  if (!SplitSymbolRecord(function_line, 4, tokens)) {
     return false;
   }
 
   char *after_number;
-  *address = strtoull(tokens[0], &after_number, 16);
+  *address = ScanHexUInt64(tokens[0], &after_number);
   if (!IsValidAfterNumber(after_number) ||
       *address == std::numeric_limits<unsigned long long>::max()) {
     return false;
   }
-  *size = strtoull(tokens[1], &after_number, 16);
+  *size = ScanHexUInt64(tokens[1], &after_number);
   if (!IsValidAfterNumber(after_number) ||
       *size == std::numeric_limits<unsigned long long>::max()) {
     return false;
   }
-  *stack_param_size = strtol(tokens[2], &after_number, 16);
+  *stack_param_size = ScanLong(tokens[2], &after_number, 16);
   if (!IsValidAfterNumber(after_number) ||
       *stack_param_size == std::numeric_limits<long>::max() ||
       *stack_param_size < 0) {
@@ -527,28 +982,28 @@ bool SymbolParseHelper::ParseLine(char *line_line, uint64_t *address,
                                   uint64_t *size, long *line_number,
                                   long *source_file) {
   // <address> <size> <line number> <source file id>
-  vector<char*> tokens;
-  if (!Tokenize(line_line, kWhitespace, 4, &tokens)) {
+  char *tokens[4];
+  if (!SplitSymbolRecord(line_line, 4, tokens)) {
     return false;
   }
 
   char *after_number;
-  *address  = strtoull(tokens[0], &after_number, 16);
+  *address  = ScanHexUInt64(tokens[0], &after_number);
   if (!IsValidAfterNumber(after_number) ||
       *address == std::numeric_limits<unsigned long long>::max()) {
     return false;
   }
-  *size = strtoull(tokens[1], &after_number, 16);
+  *size = ScanHexUInt64(tokens[1], &after_number);
   if (!IsValidAfterNumber(after_number) ||
       *size == std::numeric_limits<unsigned long long>::max()) {
     return false;
   }
-  *line_number = strtol(tokens[2], &after_number, 10);
+  *line_number = ScanLong(tokens[2], &after_number, 10);
   if (!IsValidAfterNumber(after_number) ||
       *line_number == std::numeric_limits<long>::max()) {
     return false;
   }
-  *source_file = strtol(tokens[3], &after_number, 10);
+  *source_file = ScanLong(tokens[3], &after_number, 10);
   if (!IsValidAfterNumber(after_number) || *source_file < 0 ||
       *source_file == std::numeric_limits<long>::max()) {
     return false;
@@ -576,18 +1031,18 @@ bool SymbolParseHelper::ParsePublicSymbol(char *public_line,
   assert(strncmp(public_line, "PUBLIC ", 7) == 0);
   public_line += 7;  // skip prefix
 
-  vector<char*> tokens;
-  if (!Tokenize(public_line, kWhitespace, 3, &tokens)) {
+  char *tokens[3];
+  if (!SplitSymbolRecord(public_line, 3, tokens)) {
     return false;
   }
 
   char *after_number;
-  *address = strtoull(tokens[0], &after_number, 16);
+  *address = ScanHexUInt64(tokens[0], &after_number);
   if (!IsValidAfterNumber(after_number) ||
       *address == std::numeric_limits<unsigned long long>::max()) {
     return false;
   }
-  *stack_param_size = strtol(tokens[1], &after_number, 16);
+  *stack_param_size = ScanLong(tokens[1], &after_number, 16);
   if (!IsValidAfterNumber(after_number) ||
       *stack_param_size == std::numeric_limits<long>::max() ||
       *stack_param_size < 0) {
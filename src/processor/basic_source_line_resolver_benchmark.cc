@@ -0,0 +1,232 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// basic_source_line_resolver_benchmark.cc: Time how long
+// BasicSourceLineResolver takes to load a large symbol file.
+//
+// The symbol file is generated in memory, with FILE, FUNC, LINE, PUBLIC
+// and STACK CFI records in the proportions dump_syms writes them.  After
+// loading, a fixed set of addresses is looked up, and a checksum of the
+// results is printed, so that runs of different builds can be checked
+// against each other.  The record scanner and number parser are also
+// timed on their own against strtok_r and strtoull.
+//
+// Usage: basic_source_line_resolver_benchmark [functions [lines_per_function]]
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <string>
+#include <vector>
+
+#include "common/using_std_string.h"
+#include "google_breakpad/processor/basic_source_line_resolver.h"
+#include "google_breakpad/processor/stack_frame.h"
+#include "processor/basic_code_module.h"
+#include "processor/logging.h"
+#include "processor/symbol_scanner.h"
+
+namespace {
+
+using google_breakpad::BasicCodeModule;
+using google_breakpad::BasicSourceLineResolver;
+using google_breakpad::ScanHexUInt64;
+using google_breakpad::StackFrame;
+using google_breakpad::SymbolRecordScanner;
+
+const uint64_t kModuleBase = 0x400000;
+const int kFiles = 2000;
+const int kLookups = 1000000;
+
+// Each line covers kLineSize bytes, and each function is followed by a
+// gap of the same size.
+const uint64_t kLineSize = 0x10;
+
+double Now() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+void Append(string *text, const char *format, ...) {
+  char buffer[256];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  text->append(buffer);
+}
+
+void MakeSymbolFile(int functions, int lines_per_function, string *text,
+                    uint64_t *module_size) {
+  text->clear();
+  Append(text, "MODULE Linux x86_64 000102030405060708090a0b0c0d0e0f0 "
+         "benchmark\n");
+  for (int i = 0; i < kFiles; ++i)
+    Append(text, "FILE %d /build/src/directory%d/file%d.cc\n", i, i / 20, i);
+
+  uint64_t function_size = kLineSize * lines_per_function;
+  for (int i = 0; i < functions; ++i) {
+    uint64_t address = 2 * function_size * i;
+    Append(text, "FUNC %llx %llx 0 namespace%d::Class%d::Method%d(int, "
+           "char const*)\n", static_cast<unsigned long long>(address),
+           static_cast<unsigned long long>(function_size), i / 1000, i / 10,
+           i);
+    for (int j = 0; j < lines_per_function; ++j) {
+      Append(text, "%llx %llx %d %d\n",
+             static_cast<unsigned long long>(address + kLineSize * j),
+             static_cast<unsigned long long>(kLineSize), 10 + j * 3,
+             (i + j / 8) % kFiles);
+    }
+  }
+  // Some functions also have a public symbol, as with exported functions.
+  for (int i = 0; i < functions; i += 4) {
+    Append(text, "PUBLIC %llx 0 exported_function_%d\n",
+           static_cast<unsigned long long>(2 * function_size * i), i);
+  }
+  for (int i = 0; i < functions; ++i) {
+    uint64_t address = 2 * function_size * i;
+    Append(text, "STACK CFI INIT %llx %llx .cfa: $rsp 8 + .ra: .cfa -8 + ^\n",
+           static_cast<unsigned long long>(address),
+           static_cast<unsigned long long>(function_size));
+    Append(text, "STACK CFI %llx .cfa: $rsp 16 + $rbp: .cfa -16 + ^\n",
+           static_cast<unsigned long long>(address + 1));
+  }
+  *module_size = 2 * function_size * functions;
+}
+
+// Looks up the same pseudo-random addresses in every run, and returns a
+// checksum of the functions and lines found.
+uint64_t LookUpAddresses(BasicSourceLineResolver *resolver,
+                         const BasicCodeModule &module,
+                         uint64_t module_size) {
+  uint64_t checksum = 0;
+  uint64_t state = 0x2545f4914f6cdd1dULL;
+  for (int i = 0; i < kLookups; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    StackFrame frame;
+    frame.instruction = kModuleBase + (state >> 16) % module_size;
+    frame.module = &module;
+    resolver->FillSourceLineInfo(&frame);
+    checksum = checksum * 31 + frame.function_base + frame.source_line +
+               frame.source_file_name.size() + frame.function_name.size();
+  }
+  return checksum;
+}
+
+bool BenchmarkLoad(const string &text, uint64_t module_size, bool lazy) {
+  BasicCodeModule module(kModuleBase, module_size, "benchmark", "",
+                         "benchmark", "000102030405060708090A0B0C0D0E0F0",
+                         "");
+  BasicSourceLineResolver resolver;
+  resolver.set_lazy_line_parsing(lazy);
+
+  double start = Now();
+  if (!resolver.LoadModuleUsingMapBuffer(&module, text)) {
+    fprintf(stderr, "failed to load the symbol file\n");
+    return false;
+  }
+  double load_seconds = Now() - start;
+
+  start = Now();
+  uint64_t checksum = LookUpAddresses(&resolver, module, module_size);
+  double lookup_seconds = Now() - start;
+
+  printf("%-18s load %8.3f s, lookups %6.1f ns each  (checksum %llx)\n",
+         lazy ? "lazy LINE records" : "all records", load_seconds,
+         lookup_seconds * 1e9 / kLookups,
+         static_cast<unsigned long long>(checksum));
+  return true;
+}
+
+// Times splitting |text| into records and decoding the first field of
+// each as hexadecimal, first with the C library and then with the
+// scanner.
+bool BenchmarkScanner(const string &text) {
+  std::vector<char> buffer(text.begin(), text.end());
+  buffer.push_back('\0');
+
+  double start = Now();
+  uint64_t library_checksum = 0;
+  char *save_ptr;
+  for (char *record = strtok_r(&buffer[0], "\r\n", &save_ptr); record;
+       record = strtok_r(NULL, "\r\n", &save_ptr)) {
+    char *end;
+    library_checksum += strtoull(record, &end, 16) + (end - record);
+  }
+  double library_seconds = Now() - start;
+
+  buffer.assign(text.begin(), text.end());
+  buffer.push_back('\0');
+
+  start = Now();
+  uint64_t scanner_checksum = 0;
+  SymbolRecordScanner scanner(&buffer[0]);
+  for (char *record = scanner.Next(); record; record = scanner.Next()) {
+    char *end;
+    scanner_checksum += ScanHexUInt64(record, &end) + (end - record);
+  }
+  double scanner_seconds = Now() - start;
+
+  printf("%-22s %8.3f s\n", "strtok_r + strtoull", library_seconds);
+  printf("%-22s %8.3f s\n", "SymbolRecordScanner", scanner_seconds);
+  return library_checksum == scanner_checksum;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  BPLOG_INIT(&argc, &argv);
+
+  int functions = argc > 1 ? atoi(argv[1]) : 100000;
+  int lines_per_function = argc > 2 ? atoi(argv[2]) : 40;
+  if (functions <= 0 || lines_per_function <= 0) {
+    fprintf(stderr, "usage: %s [functions [lines_per_function]]\n", argv[0]);
+    return 1;
+  }
+
+  string text;
+  uint64_t module_size;
+  MakeSymbolFile(functions, lines_per_function, &text, &module_size);
+  printf("%d functions, %d lines, %.1f MB of symbols\n", functions,
+         functions * lines_per_function, text.size() / 1e6);
+
+  if (!BenchmarkScanner(text)) {
+    fprintf(stderr, "the scanner gave different results\n");
+    return 1;
+  }
+  if (!BenchmarkLoad(text, module_size, false) ||
+      !BenchmarkLoad(text, module_size, true)) {
+    return 1;
+  }
+  return 0;
+}
@@ -37,8 +37,10 @@
 #ifndef PROCESSOR_BASIC_SOURCE_LINE_RESOLVER_TYPES_H__
 #define PROCESSOR_BASIC_SOURCE_LINE_RESOLVER_TYPES_H__
 
+#include <list>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "common/scoped_ptr.h"
 #include "google_breakpad/processor/basic_source_line_resolver.h"
@@ -48,32 +50,145 @@
 #include "processor/range_map-inl.h"
 #include "processor/contained_range_map-inl.h"
 
+#include "processor/interned_string_table.h"
 #include "processor/linked_ptr.h"
+#include "processor/symbol_file_index.h"
 #include "google_breakpad/processor/stack_frame.h"
 #include "processor/cfi_frame_info.h"
 #include "processor/windows_frame_info.h"
 
 namespace google_breakpad {
 
+// A function's source lines, encoded compactly.  Symbol files have many
+// more LINE records than anything else, so they dominate the memory a
+// loaded module takes.  The lines are sorted by address and split into
+// blocks of kLinesPerBlock lines.  Within a block, each line is stored
+// as four variable-length integers: the gap between the end of the
+// previous line and its address, its size, and the differences between
+// its file id and line number and those of the previous line.  That is
+// usually a byte each.  A sparse index holding the first address of each
+// block lets Retrieve find the right block with a binary search, and then
+// it decodes at most kLinesPerBlock lines.
+class BasicSourceLineResolver::LineTable {
+ public:
+  LineTable() : line_count_(0) { }
+
+  // Replaces the contents of the table with the lines in |lines|, and
+  // empties |lines|.  Each line must be stored with its own address and
+  // size as its range.
+  void Encode(RangeMap<MemAddr, Line> *lines);
+
+  // Locates the line that contains |address|.  Returns false if there is
+  // no such line.
+  bool Retrieve(MemAddr address, Line *line) const;
+
+  // Returns the number of lines in the table.
+  int GetCount() const { return line_count_; }
+
+  // Returns the number of bytes the encoded lines take up.
+  size_t MemoryUsage() const {
+    return index_.capacity() * sizeof(Block) + data_.capacity();
+  }
+
+  // Decodes every line, in address order, into |lines|.
+  void GetLines(std::vector<Line> *lines) const;
+
+ private:
+  static const int kLinesPerBlock = 16;
+
+  struct Block {
+    Block(MemAddr block_address, uint32_t block_offset)
+        : address(block_address), offset(block_offset) { }
+
+    // The address of the first line in the block.
+    MemAddr address;
+
+    // The offset of the block's first line in data_.
+    uint32_t offset;
+  };
+
+  // Orders blocks by their first address.
+  struct BlockLess {
+    bool operator()(const MemAddr &address, const Block &block) const {
+      return address < block.address;
+    }
+  };
+
+  // Decodes the line at |*cursor| into |line|, given the line before it
+  // in the same block, and advances |*cursor| past it.
+  static void DecodeLine(const uint8_t **cursor, const Line &previous,
+                         Line *line);
+
+  std::vector<Block> index_;
+  std::vector<uint8_t> data_;
+  int line_count_;
+};
+
 struct
 BasicSourceLineResolver::Function : public SourceLineResolverBase::Function {
-  Function(const string &function_name,
+  Function(const InternedString &function_name,
            MemAddr function_address,
            MemAddr code_size,
-           int set_parameter_size) : Base(function_name,
-                                          function_address,
+           int set_parameter_size) : Base(function_address,
                                           code_size,
                                           set_parameter_size),
-                                     lines() { }
-  RangeMap< MemAddr, linked_ptr<Line> > lines;
+                                     name(function_name),
+                                     lines(),
+                                     line_data_offset(0),
+                                     line_data_size(0),
+                                     lines_parsed(true) { }
+  InternedString name;
+  LineTable lines;
+
+  // When a module parses LINE records lazily, a function's records are
+  // kept as text in the module's line_data_, at [line_data_offset,
+  // line_data_offset + line_data_size), and lines_parsed is false until
+  // they are parsed into |lines|.
+  size_t line_data_offset;
+  size_t line_data_size;
+  bool lines_parsed;
  private:
   typedef SourceLineResolverBase::Function Base;
 };
 
+struct BasicSourceLineResolver::PublicSymbol
+    : public SourceLineResolverBase::PublicSymbol {
+  PublicSymbol(const InternedString &set_name,
+               MemAddr set_address,
+               int set_parameter_size) : Base(set_address,
+                                              set_parameter_size),
+                                         name(set_name) { }
+  InternedString name;
+ private:
+  typedef SourceLineResolverBase::PublicSymbol Base;
+};
+
 
 class BasicSourceLineResolver::Module : public SourceLineResolverBase::Module {
  public:
-  explicit Module(const string &name) : name_(name), is_corrupt_(false) { }
+  explicit Module(const string &name)
+      : name_(name),
+        strings_(new InternedStringTable),
+        owned_strings_(strings_),
+        is_corrupt_(false),
+        lazy_line_parsing_(false),
+        memory_usage_(0),
+        cfi_frame_info_cache_hits_(0),
+        cfi_frame_info_cache_misses_(0) { }
+
+  // If lazy_line_parsing is true, LoadMapFromMemory stores each function's
+  // LINE records as text, and parses them the first time an address in
+  // the function is looked up.  Names are stored in |strings|, which is
+  // shared with other modules and must outlive this one.
+  Module(const string &name, bool lazy_line_parsing,
+         InternedStringTable *strings)
+      : name_(name),
+        strings_(strings),
+        is_corrupt_(false),
+        lazy_line_parsing_(lazy_line_parsing),
+        memory_usage_(0),
+        cfi_frame_info_cache_hits_(0),
+        cfi_frame_info_cache_misses_(0) { }
   virtual ~Module() { }
 
   // Loads a map from the given buffer in char* type.
@@ -88,10 +203,27 @@ class BasicSourceLineResolver::Module : public SourceLineResolverBase::Module {
   // undefined, if the symbol data hasn't been loaded yet.
   virtual bool IsCorrupt() const { return is_corrupt_; }
 
+  // Each record the module keeps is counted as the names or rules it
+  // keeps from it, plus the structure and map node holding them.
+  // Lookups that parse lines or indexed records make this grow.
+  virtual size_t MemoryUsage() const { return memory_usage_; }
+
+  // Makes the module read the FUNC and STACK CFI INIT records listed in
+  // |index|, with the records following them, from |symbol_file| the
+  // first time an address they cover is looked up.  LoadMapFromMemory
+  // should have been given the index's global records.  Takes ownership
+  // of |index|.
+  void SetSymbolFileIndex(const string &symbol_file, SymbolFileIndex *index);
+
   // Looks up the given relative address, and fills the StackFrame struct
   // with the result.
   virtual void LookupAddress(StackFrame *frame) const;
 
+  // Lists the module's FUNC and PUBLIC records.  Returns false for a
+  // module loaded with SetSymbolFileIndex, whose functions are only read
+  // as they are looked up.
+  virtual bool GetFunctionTable(FunctionTable *table) const;
+
   // If Windows stack walking information is available covering ADDRESS,
   // return a WindowsFrameInfo structure describing it. If the information
   // is not available, returns NULL. A NULL return value does not indicate
@@ -105,13 +237,23 @@ class BasicSourceLineResolver::Module : public SourceLineResolverBase::Module {
   // returned CFIFrameInfo object.
   virtual CFIFrameInfo *FindCFIFrameInfo(const StackFrame *frame) const;
 
+  // Returns the number of FindCFIFrameInfo calls answered from the
+  // cache of applied rule sets, and the number that had to parse the
+  // STACK CFI records.
+  uint64_t cfi_frame_info_cache_hits() const {
+    return cfi_frame_info_cache_hits_;
+  }
+  uint64_t cfi_frame_info_cache_misses() const {
+    return cfi_frame_info_cache_misses_;
+  }
+
  private:
   // Friend declarations.
   friend class BasicSourceLineResolver;
   friend class ModuleComparer;
   friend class ModuleSerializer;
 
-  typedef std::map<int, string> FileMap;
+  typedef std::map<int, InternedString> FileMap;
 
   // Logs parse errors.  |*num_errors| is increased every time LogParseError is
   // called.
@@ -120,32 +262,93 @@ class BasicSourceLineResolver::Module : public SourceLineResolverBase::Module {
       int line_number,
       int *num_errors);
 
+  // Parses the null-terminated symbol file records in |records|, counting
+  // errors in |*num_errors|.  If |line_number| is not NULL, it is the
+  // number of the line before |records|, and is advanced past them.
+  // Stops early after too many errors.
+  void ParseRecords(char *records, int *line_number, int *num_errors);
+
   // Parses a file declaration
   bool ParseFile(char *file_line);
 
   // Parses a function declaration, returning a new Function object.
   Function* ParseFunction(char *function_line);
 
-  // Parses a line declaration, returning a new Line object.
-  Line* ParseLine(char *line_line);
+  // Parses a line declaration into |line|.  Returns false if an error
+  // occurs.
+  static bool ParseLine(char *line_line, Line *line);
+
+  // Parses the LINE records that LoadMapFromMemory stored as text for
+  // |function|, if it hasn't been done yet.
+  void ParseFunctionLines(Function *function) const;
+
+  // Encodes |lines| into |function|'s line table, and counts the table
+  // in memory_usage_.
+  void EncodeLines(Function *function, RangeMap<MemAddr, Line> *lines) const;
+
+  // Parses the LINE records of every function, as ModuleSerializer and
+  // ModuleComparer need them all.  When the module has an index, this
+  // first reads every record the index lists.
+  void ParseAllFunctionLines() const;
+
+  // When the module has an index, reads and parses the function, or the
+  // STACK CFI INIT record, that is the last to start at or before
+  // |address|, if that hasn't been done yet.  Lookups need the function
+  // even when it doesn't cover |address|, to bound PUBLIC symbols.
+  void LoadIndexedFunction(MemAddr address) const;
+  void LoadIndexedCFI(MemAddr address) const;
+
+  // Reads and parses the records of |entry|, which should start with
+  // |prefix|.
+  void LoadIndexedEntry(const SymbolFileIndex::Entry &entry,
+                        const char *prefix) const;
 
   // Parses a PUBLIC symbol declaration, storing it in public_symbols_.
   // Returns false if an error occurs.
   bool ParsePublicSymbol(char *public_line);
 
   // Parses a STACK WIN or STACK CFI frame info declaration, storing
-  // it in the appropriate table.
-  bool ParseStackInfo(char *stack_info_line);
+  // it in the appropriate table.  |*cfi_init_rejected| is true if the
+  // record follows a STACK CFI INIT record that couldn't be stored, and
+  // is updated for the next record.
+  bool ParseStackInfo(char *stack_info_line, bool *cfi_init_rejected);
 
-  // Parses a STACK CFI record, storing it in cfi_frame_info_.
-  bool ParseCFIFrameInfo(char *stack_info_line);
+  // Parses a STACK CFI record, storing it in cfi_frame_info_.  Delta
+  // records following a STACK CFI INIT record that overlapped an earlier
+  // one are ignored along with it, just as a FUNC record's LINE records
+  // are.
+  bool ParseCFIFrameInfo(char *stack_info_line, bool *cfi_init_rejected);
 
   string name_;
+
+  // The table holding the names of the module's files, functions and
+  // public symbols, and the table the module created for itself if it
+  // wasn't given one.
+  InternedStringTable *strings_;
+  scoped_ptr<InternedStringTable> owned_strings_;
+
   FileMap files_;
   RangeMap< MemAddr, linked_ptr<Function> > functions_;
   AddressMap< MemAddr, linked_ptr<PublicSymbol> > public_symbols_;
   bool is_corrupt_;
 
+  // In lazy mode, the text of every function's LINE records, one record
+  // per line, and the functions whose records haven't been parsed yet.
+  // A module usually has far more LINE records than any stack walk needs,
+  // and copying them as text is much faster than parsing and encoding
+  // them all.
+  bool lazy_line_parsing_;
+  string line_data_;
+  mutable std::vector<Function*> unparsed_functions_;
+
+  // For a module loaded with SetSymbolFileIndex, the symbol file, its
+  // index, and which of the index's functions and CFI entries have been
+  // parsed.
+  string symbol_file_;
+  scoped_ptr<SymbolFileIndex> index_;
+  mutable std::vector<bool> loaded_functions_;
+  mutable std::vector<bool> loaded_cfi_;
+
   // Each element in the array is a ContainedRangeMap for a type
   // listed in WindowsFrameInfoTypes. These are split by type because
   // there may be overlaps between maps of different types, but some
@@ -170,6 +373,30 @@ class BasicSourceLineResolver::Module : public SourceLineResolverBase::Module {
   // this map, or the end of the range as given by the cfi_initial_rules_
   // entry (which FindCFIFrameInfo looks up first).
   std::map<MemAddr, string> cfi_delta_rules_;
+
+  // Rule sets that FindCFIFrameInfo has already built by parsing a STACK
+  // CFI INIT record and applying its deltas. The same rule set applies to
+  // every address from one delta rule to the next, so each entry covers
+  // the address range [key, key + size). Stack walks tend to revisit the
+  // same few functions over and over, so a small cache avoids reparsing
+  // the same strings; the least recently used entry is evicted once the
+  // cache holds kMaxCachedCFIFrameInfo rule sets.
+  struct CachedCFIFrameInfo {
+    MemAddr size;
+    CFIFrameInfo rules;
+    std::list<MemAddr>::iterator lru_position;
+  };
+  static const size_t kMaxCachedCFIFrameInfo = 256;
+  mutable std::map<MemAddr, CachedCFIFrameInfo> cfi_frame_info_cache_;
+
+  // Keys of cfi_frame_info_cache_, most recently used first.
+  mutable std::list<MemAddr> cfi_frame_info_lru_;
+
+  // What MemoryUsage returns.
+  mutable size_t memory_usage_;
+
+  mutable uint64_t cfi_frame_info_cache_hits_;
+  mutable uint64_t cfi_frame_info_cache_misses_;
 };
 
 }  // namespace google_breakpad
@@ -30,10 +30,13 @@
 #include <assert.h>
 #include <stdio.h>
 
+#include <map>
 #include <string>
+#include <vector>
 
 #include "breakpad_googletest_includes.h"
 #include "common/scoped_ptr.h"
+#include "common/tests/auto_tempdir.h"
 #include "common/using_std_string.h"
 #include "google_breakpad/processor/basic_source_line_resolver.h"
 #include "google_breakpad/processor/code_module.h"
@@ -41,11 +44,13 @@
 #include "google_breakpad/processor/memory_region.h"
 #include "processor/linked_ptr.h"
 #include "processor/logging.h"
+#include "processor/symbol_file_index.h"
 #include "processor/windows_frame_info.h"
 #include "processor/cfi_frame_info.h"
 
 namespace {
 
+using google_breakpad::AutoTempDir;
 using google_breakpad::BasicSourceLineResolver;
 using google_breakpad::CFIFrameInfo;
 using google_breakpad::CodeModule;
@@ -54,7 +59,9 @@ using google_breakpad::StackFrame;
 using google_breakpad::WindowsFrameInfo;
 using google_breakpad::linked_ptr;
 using google_breakpad::scoped_ptr;
+using google_breakpad::SymbolFileIndex;
 using google_breakpad::SymbolParseHelper;
+using google_breakpad::kSymbolFileIndexSuffix;
 
 class TestCodeModule : public CodeModule {
  public:
@@ -410,6 +417,490 @@ TEST_F(TestBasicSourceLineResolver, TestUnload)
   ASSERT_TRUE(resolver.HasModule(&module1));
 }
 
+TEST_F(TestBasicSourceLineResolver, TestModuleCache)
+{
+  TestCodeModule module1("module1");
+  TestCodeModule module2("module2");
+  TestCodeModule module3("module3");
+
+  // Without a budget, modules are never unloaded.
+  ASSERT_EQ(0U, resolver.module_cache_budget());
+  ASSERT_TRUE(resolver.LoadModule(&module1, testdata_dir + "/module1.out"));
+  size_t module1_size = resolver.module_cache_usage();
+  ASSERT_TRUE(resolver.LoadModule(&module2, testdata_dir + "/module2.out"));
+  size_t module2_size = resolver.module_cache_usage() - module1_size;
+  ASSERT_TRUE(resolver.LoadModule(&module3,
+                                  testdata_dir + "/module3_bad.out"));
+  size_t module3_size =
+      resolver.module_cache_usage() - module1_size - module2_size;
+  ASSERT_GT(module1_size, module2_size);
+  ASSERT_GT(module2_size, module3_size);
+
+  // Make module1 the most recently used, then shrink the budget so that
+  // only two of the modules fit: module2 is the least recently used.
+  ASSERT_TRUE(resolver.HasModule(&module1));
+  resolver.set_module_cache_budget(module1_size + module3_size);
+  ASSERT_TRUE(resolver.HasModule(&module1));
+  ASSERT_FALSE(resolver.HasModule(&module2));
+  ASSERT_TRUE(resolver.HasModule(&module3));
+  ASSERT_EQ(module1_size + module3_size, resolver.module_cache_usage());
+
+  // Loading module2 again pushes out module1, the least recently used
+  // module now, but never the module just loaded.
+  ASSERT_TRUE(resolver.LoadModule(&module2, testdata_dir + "/module2.out"));
+  ASSERT_FALSE(resolver.HasModule(&module1));
+  ASSERT_TRUE(resolver.HasModule(&module2));
+  ASSERT_TRUE(resolver.HasModule(&module3));
+
+  // Pinned modules stay, even before they are loaded.
+  resolver.PinModule(&module1);
+  resolver.PinModule(&module1);
+  ASSERT_TRUE(resolver.LoadModule(&module1, testdata_dir + "/module1.out"));
+  ASSERT_FALSE(resolver.HasModule(&module2));
+  ASSERT_TRUE(resolver.HasModule(&module3));
+  resolver.set_module_cache_budget(1);
+  ASSERT_TRUE(resolver.HasModule(&module1));
+  ASSERT_FALSE(resolver.HasModule(&module3));
+  ASSERT_EQ(module1_size, resolver.module_cache_usage());
+  resolver.UnpinModule(&module1);
+  resolver.set_module_cache_budget(1);
+  ASSERT_TRUE(resolver.HasModule(&module1));
+  resolver.UnpinModule(&module1);
+  resolver.set_module_cache_budget(1);
+  ASSERT_FALSE(resolver.HasModule(&module1));
+  ASSERT_EQ(0U, resolver.module_cache_usage());
+
+  // Explicit unloads don't count as evictions.
+  resolver.set_module_cache_budget(0);
+  ASSERT_TRUE(resolver.LoadModule(&module2, testdata_dir + "/module2.out"));
+  resolver.UnloadModule(&module2);
+  ASSERT_EQ(0U, resolver.module_cache_usage());
+
+  uint64_t hits, misses, evictions;
+  resolver.GetModuleCacheStats(&hits, &misses, &evictions);
+  EXPECT_EQ(8U, hits);
+  EXPECT_EQ(5U, misses);
+  EXPECT_EQ(5U, evictions);
+}
+
+TEST_F(TestBasicSourceLineResolver, TestCFIFrameInfoCache)
+{
+  TestCodeModule module1("module1");
+  ASSERT_TRUE(resolver.LoadModule(&module1, testdata_dir + "/module1.out"));
+
+  // Compute the rule set for every address module1 has STACK CFI records
+  // for (3d40..3dee) with a fresh resolver, so that nothing is cached.
+  StackFrame frame;
+  frame.module = &module1;
+  std::map<uint64_t, string> expected;
+  for (uint64_t address = 0x3d40; address < 0x3def; ++address) {
+    BasicSourceLineResolver fresh_resolver;
+    ASSERT_TRUE(fresh_resolver.LoadModule(&module1,
+                                          testdata_dir + "/module1.out"));
+    frame.instruction = address;
+    scoped_ptr<CFIFrameInfo> cfi_frame_info(
+        fresh_resolver.FindCFIFrameInfo(&frame));
+    ASSERT_TRUE(cfi_frame_info.get());
+    expected[address] = cfi_frame_info->Serialize();
+  }
+
+  // Look the addresses up in descending, then ascending order; every
+  // answer must match, whether or not it came from the cache.
+  for (int pass = 0; pass < 2; ++pass) {
+    for (uint64_t i = 0; i < 0xaf; ++i) {
+      uint64_t address = pass == 0 ? 0x3dee - i : 0x3d40 + i;
+      frame.instruction = address;
+      scoped_ptr<CFIFrameInfo> cfi_frame_info(
+          resolver.FindCFIFrameInfo(&frame));
+      ASSERT_TRUE(cfi_frame_info.get());
+      EXPECT_EQ(expected[address], cfi_frame_info->Serialize())
+          << "address " << std::hex << address;
+    }
+  }
+
+  // module1 has one STACK CFI INIT record and five deltas, so only six
+  // distinct rule sets should have been built.
+  uint64_t hits, misses;
+  resolver.GetCFIFrameInfoCacheStats(&hits, &misses);
+  EXPECT_EQ(6U, misses);
+  EXPECT_EQ(2U * 0xaf - 6, hits);
+
+  // Addresses without CFI are not cached, and count as misses.
+  frame.instruction = 0x3d3f;
+  scoped_ptr<CFIFrameInfo> cfi_frame_info(resolver.FindCFIFrameInfo(&frame));
+  ASSERT_FALSE(cfi_frame_info.get());
+  cfi_frame_info.reset(resolver.FindCFIFrameInfo(&frame));
+  ASSERT_FALSE(cfi_frame_info.get());
+  resolver.GetCFIFrameInfoCacheStats(&hits, &misses);
+  EXPECT_EQ(8U, misses);
+
+  // Unloading the module discards its cache along with its statistics.
+  resolver.UnloadModule(&module1);
+  resolver.GetCFIFrameInfoCacheStats(&hits, &misses);
+  EXPECT_EQ(0U, hits);
+  EXPECT_EQ(0U, misses);
+}
+
+TEST_F(TestBasicSourceLineResolver, TestLazyLineParsing)
+{
+  TestCodeModule module1("module1");
+  TestCodeModule module2("module2");
+  BasicSourceLineResolver lazy_resolver;
+  lazy_resolver.set_lazy_line_parsing(true);
+  ASSERT_TRUE(resolver.LoadModule(&module1, testdata_dir + "/module1.out"));
+  ASSERT_TRUE(resolver.LoadModule(&module2, testdata_dir + "/module2.out"));
+  ASSERT_TRUE(lazy_resolver.LoadModule(&module1,
+                                       testdata_dir + "/module1.out"));
+  ASSERT_TRUE(lazy_resolver.LoadModule(&module2,
+                                       testdata_dir + "/module2.out"));
+  ASSERT_FALSE(lazy_resolver.IsModuleCorrupt(&module1));
+  ASSERT_FALSE(lazy_resolver.IsModuleCorrupt(&module2));
+
+  // Every address must resolve to the same function and source line
+  // whether the LINE records were parsed at load time or on demand.
+  // Look each address up twice, so that both the first lookup in a
+  // function and the following ones are covered.
+  const TestCodeModule *modules[] = { &module1, &module2 };
+  for (size_t i = 0; i < sizeof(modules) / sizeof(modules[0]); ++i) {
+    for (int pass = 0; pass < 2; ++pass) {
+      for (uint64_t address = 0; address < 0xa100; address += 2) {
+        StackFrame expected;
+        expected.instruction = address;
+        expected.module = modules[i];
+        resolver.FillSourceLineInfo(&expected);
+        StackFrame frame;
+        frame.instruction = address;
+        frame.module = modules[i];
+        lazy_resolver.FillSourceLineInfo(&frame);
+        ASSERT_EQ(expected.function_name, frame.function_name)
+            << "address " << std::hex << address;
+        ASSERT_EQ(expected.function_base, frame.function_base);
+        ASSERT_EQ(expected.source_file_name, frame.source_file_name);
+        ASSERT_EQ(expected.source_line, frame.source_line);
+        ASSERT_EQ(expected.source_line_base, frame.source_line_base);
+      }
+    }
+  }
+
+  // Turning lazy parsing off applies to the modules loaded afterwards.
+  lazy_resolver.set_lazy_line_parsing(false);
+  lazy_resolver.UnloadModule(&module1);
+  ASSERT_TRUE(lazy_resolver.LoadModule(&module1,
+                                       testdata_dir + "/module1.out"));
+  StackFrame frame;
+  frame.instruction = 0x1004;
+  frame.module = &module1;
+  lazy_resolver.FillSourceLineInfo(&frame);
+  ASSERT_EQ("Function1_1", frame.function_name);
+  ASSERT_EQ("file1_1.cc", frame.source_file_name);
+  ASSERT_EQ(45, frame.source_line);
+}
+
+// Modules loaded by the same resolver share their names.
+TEST_F(TestBasicSourceLineResolver, TestInternedStrings)
+{
+  uint64_t references, strings, referenced_bytes, stored_bytes;
+  resolver.GetInternedStringStats(&references, &strings, &referenced_bytes,
+                                  &stored_bytes);
+  EXPECT_EQ(0U, references);
+  EXPECT_EQ(0U, strings);
+
+  TestCodeModule module1("module1");
+  ASSERT_TRUE(resolver.LoadModule(&module1, testdata_dir + "/module1.out"));
+  uint64_t module1_references, module1_strings, module1_referenced_bytes,
+      module1_stored_bytes;
+  resolver.GetInternedStringStats(&module1_references, &module1_strings,
+                                  &module1_referenced_bytes,
+                                  &module1_stored_bytes);
+  EXPECT_LT(0U, module1_strings);
+  EXPECT_LE(module1_strings, module1_references);
+
+  // A second copy of the same symbols adds references, but no strings.
+  TestCodeModule copy("module1_copy");
+  ASSERT_TRUE(resolver.LoadModule(&copy, testdata_dir + "/module1.out"));
+  resolver.GetInternedStringStats(&references, &strings, &referenced_bytes,
+                                  &stored_bytes);
+  EXPECT_EQ(2 * module1_references, references);
+  EXPECT_EQ(module1_strings, strings);
+  EXPECT_EQ(2 * module1_referenced_bytes, referenced_bytes);
+  EXPECT_EQ(module1_stored_bytes, stored_bytes);
+
+  StackFrame frame;
+  frame.instruction = 0x1004;
+  frame.module = &copy;
+  resolver.FillSourceLineInfo(&frame);
+  EXPECT_EQ("Function1_1", frame.function_name);
+  EXPECT_EQ("file1_1.cc", frame.source_file_name);
+
+  // Unloading both releases every name.
+  resolver.UnloadModule(&module1);
+  resolver.GetInternedStringStats(&references, &strings, &referenced_bytes,
+                                  &stored_bytes);
+  EXPECT_EQ(module1_references, references);
+  resolver.UnloadModule(&copy);
+  resolver.GetInternedStringStats(&references, &strings, &referenced_bytes,
+                                  &stored_bytes);
+  EXPECT_EQ(0U, references);
+  EXPECT_EQ(0U, strings);
+  EXPECT_EQ(0U, stored_bytes);
+}
+
+// Functions with many lines have their lines split across several blocks
+// of the compact line table.  Check every address of such a function
+// against the records it was loaded from, with the records out of order,
+// gaps between lines, lines that overlap earlier ones and so are dropped,
+// and line numbers and file ids that jump around.
+TEST_F(TestBasicSourceLineResolver, TestLargeLineTable)
+{
+  const uint64_t kFunctionBase = 0x1000;
+  const uint64_t kFunctionSize = 0x2000;
+  const int kRecords = 300;
+  const int32_t kLineNumbers[] = { 1, 0x7fff0000, 0, 7, 6, 100000 };
+  const int32_t kFileIds[] = { 0, 1, 2, 1, 0, 99999 };
+
+  // The source line each address of the function should resolve to, or
+  // -1 if no line covers it.  Like RangeMap, the table keeps the first of
+  // two overlapping records.
+  std::vector<int> owner(kFunctionSize, -1);
+  std::vector<uint64_t> bases(kRecords);
+  string symbols = "FILE 0 file0.cc\nFILE 1 file1.cc\nFILE 2 file2.cc\n"
+                   "FUNC 1000 2000 0 BigFunction\n";
+  uint64_t state = 12345;
+  for (int i = 0; i < kRecords; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    uint64_t base = (state >> 20) % (kFunctionSize - 0x40);
+    uint64_t size = 1 + (state >> 50) % 0x30;
+    bases[i] = base;
+    bool overlaps = false;
+    for (uint64_t offset = base; offset < base + size; ++offset)
+      overlaps = overlaps || owner[offset] >= 0;
+    if (!overlaps) {
+      for (uint64_t offset = base; offset < base + size; ++offset)
+        owner[offset] = i;
+    }
+    char record[100];
+    snprintf(record, sizeof(record), "%llx %llx %d %d\n",
+             static_cast<unsigned long long>(kFunctionBase + base),
+             static_cast<unsigned long long>(size), kLineNumbers[i % 6] + i,
+             kFileIds[i % 6]);
+    symbols += record;
+  }
+
+  TestCodeModule module("module");
+  ASSERT_TRUE(resolver.LoadModuleUsingMapBuffer(&module, symbols));
+  for (uint64_t offset = 0; offset < kFunctionSize; ++offset) {
+    StackFrame frame;
+    frame.instruction = kFunctionBase + offset;
+    frame.module = &module;
+    resolver.FillSourceLineInfo(&frame);
+    ASSERT_EQ("BigFunction", frame.function_name);
+    int i = owner[offset];
+    if (i < 0) {
+      ASSERT_EQ(0, frame.source_line) << "offset " << std::hex << offset;
+      ASSERT_EQ("", frame.source_file_name);
+      continue;
+    }
+    ASSERT_EQ(kLineNumbers[i % 6] + i, frame.source_line)
+        << "offset " << std::hex << offset;
+    ASSERT_EQ(kFunctionBase + bases[i], frame.source_line_base);
+    if (kFileIds[i % 6] < 3) {
+      char file_name[20];
+      snprintf(file_name, sizeof(file_name), "file%d.cc", kFileIds[i % 6]);
+      ASSERT_EQ(file_name, frame.source_file_name);
+    } else {
+      ASSERT_EQ("", frame.source_file_name);
+    }
+  }
+}
+
+// Copies the symbol file at |from| to |to|, and writes an index for the
+// copy next to it.
+static void CopyAndIndex(const string &from, const string &to) {
+  FILE *f = fopen(from.c_str(), "rb");
+  ASSERT_TRUE(f);
+  string contents;
+  char buffer[4096];
+  size_t size;
+  while ((size = fread(buffer, 1, sizeof(buffer), f)) > 0)
+    contents.append(buffer, size);
+  fclose(f);
+
+  f = fopen(to.c_str(), "wb");
+  ASSERT_TRUE(f);
+  ASSERT_EQ(contents.size(), fwrite(contents.data(), 1, contents.size(), f));
+  fclose(f);
+
+  uint64_t mtime;
+  ASSERT_TRUE(SymbolFileIndex::GetModificationTime(to, &mtime));
+  SymbolFileIndex index;
+  index.Build(contents.data(), contents.size(), mtime);
+  ASSERT_TRUE(index.Write(to + kSymbolFileIndexSuffix));
+}
+
+// Checks that |indexed_resolver| gives the same answer as |resolver|, which
+// loaded the whole symbol file, for every other address in |module| from
+// |end| down.  Going down through the addresses makes lookups land past
+// functions whose records haven't been read yet.
+static void ExpectSameLookups(BasicSourceLineResolver *resolver,
+                              BasicSourceLineResolver *indexed_resolver,
+                              const CodeModule *module, uint64_t end) {
+  for (uint64_t address = end; address > 0; address -= 2) {
+    StackFrame expected;
+    expected.instruction = address;
+    expected.module = module;
+    resolver->FillSourceLineInfo(&expected);
+    StackFrame frame;
+    frame.instruction = address;
+    frame.module = module;
+    indexed_resolver->FillSourceLineInfo(&frame);
+    ASSERT_EQ(expected.function_name, frame.function_name)
+        << "address " << std::hex << address;
+    ASSERT_EQ(expected.function_base, frame.function_base);
+    ASSERT_EQ(expected.source_file_name, frame.source_file_name);
+    ASSERT_EQ(expected.source_line, frame.source_line);
+    ASSERT_EQ(expected.source_line_base, frame.source_line_base);
+
+    scoped_ptr<WindowsFrameInfo> expected_windows(
+        resolver->FindWindowsFrameInfo(&expected));
+    scoped_ptr<WindowsFrameInfo> windows(
+        indexed_resolver->FindWindowsFrameInfo(&frame));
+    ASSERT_EQ(expected_windows.get() != NULL, windows.get() != NULL)
+        << "address " << std::hex << address;
+    if (windows.get()) {
+      ASSERT_EQ(expected_windows->type_, windows->type_);
+      ASSERT_EQ(expected_windows->valid, windows->valid);
+      ASSERT_EQ(expected_windows->parameter_size, windows->parameter_size);
+      ASSERT_EQ(expected_windows->program_string, windows->program_string);
+    }
+
+    scoped_ptr<CFIFrameInfo> expected_cfi(
+        resolver->FindCFIFrameInfo(&expected));
+    scoped_ptr<CFIFrameInfo> cfi(indexed_resolver->FindCFIFrameInfo(&frame));
+    ASSERT_EQ(expected_cfi.get() != NULL, cfi.get() != NULL)
+        << "address " << std::hex << address;
+    if (cfi.get()) {
+      ASSERT_EQ(expected_cfi->Serialize(), cfi->Serialize())
+          << "address " << std::hex << address;
+    }
+  }
+}
+
+TEST_F(TestBasicSourceLineResolver, TestSymbolFileIndex)
+{
+  AutoTempDir temp_dir;
+  TestCodeModule module1("module1");
+  TestCodeModule module2("module2");
+  const string path1 = temp_dir.path() + "/module1.out";
+  const string path2 = temp_dir.path() + "/module2.out";
+  CopyAndIndex(testdata_dir + "/module1.out", path1);
+  CopyAndIndex(testdata_dir + "/module2.out", path2);
+
+  ASSERT_TRUE(resolver.LoadModule(&module1, path1));
+  ASSERT_TRUE(resolver.LoadModule(&module2, path2));
+  BasicSourceLineResolver indexed_resolver;
+  indexed_resolver.set_use_symbol_file_indexes(true);
+  ASSERT_TRUE(indexed_resolver.LoadModule(&module1, path1));
+  ASSERT_TRUE(indexed_resolver.LoadModule(&module2, path2));
+  ASSERT_FALSE(indexed_resolver.IsModuleCorrupt(&module1));
+  ASSERT_FALSE(indexed_resolver.IsModuleCorrupt(&module2));
+
+  // Only the global records were read when the modules were loaded.
+  EXPECT_LT(indexed_resolver.module_cache_usage(),
+            resolver.module_cache_usage());
+
+  ExpectSameLookups(&resolver, &indexed_resolver, &module1, 0xa100);
+  ExpectSameLookups(&resolver, &indexed_resolver, &module2, 0xa100);
+
+  // An index that doesn't match its symbol file is ignored.
+  FILE *f = fopen(path1.c_str(), "ab");
+  ASSERT_TRUE(f);
+  fputs("FUNC b000 10 0 AddedFunction\n", f);
+  fclose(f);
+  BasicSourceLineResolver stale_resolver;
+  stale_resolver.set_use_symbol_file_indexes(true);
+  ASSERT_TRUE(stale_resolver.LoadModule(&module1, path1));
+  StackFrame frame;
+  frame.instruction = 0xb004;
+  frame.module = &module1;
+  stale_resolver.FillSourceLineInfo(&frame);
+  EXPECT_EQ("AddedFunction", frame.function_name);
+  frame.instruction = 0x1004;
+  stale_resolver.FillSourceLineInfo(&frame);
+  EXPECT_EQ("Function1_1", frame.function_name);
+  EXPECT_EQ(45, frame.source_line);
+}
+
+TEST_F(TestBasicSourceLineResolver, TestSymbolFileIndexOverlaps)
+{
+  // Identical code folding gives several functions the same address, and
+  // some symbol files nest one function's range inside another's.  The
+  // first record covering an address wins, along with the records that
+  // follow it, however the file is loaded.
+  const char kSymbols[] =
+      "MODULE Linux x86 000000000000000000000000000000000 overlaps\n"
+      "FILE 1 file1.cc\n"
+      "FUNC 1000 20 0 First\n"
+      "1000 20 10 1\n"
+      "FUNC 1000 20 0 Folded\n"
+      "1000 20 20 1\n"
+      "FUNC 2000 1000 0 Outer\n"
+      "2000 1000 30 1\n"
+      "FUNC 2400 20 0 Inner\n"
+      "2400 20 40 1\n"
+      "FUNC 1800 1000 0 Straddling\n"
+      "1800 1000 50 1\n"
+      "PUBLIC 1c00 0 Public\n"
+      "STACK CFI INIT 1000 20 .cfa: $esp 4 + .ra: .cfa 4 - ^\n"
+      "STACK CFI 1004 .cfa: $esp 8 +\n"
+      "STACK CFI INIT 1000 20 .cfa: $esp 12 + .ra: .cfa 4 - ^\n"
+      "STACK CFI 1008 .cfa: $esp 16 +\n"
+      "STACK CFI INIT 2000 1000 .cfa: $esp 4 + .ra: .cfa 4 - ^\n"
+      "STACK CFI 2010 .cfa: $esp 8 +\n"
+      "STACK CFI INIT 2400 20 .cfa: $esp 20 + .ra: .cfa 4 - ^\n"
+      "STACK CFI 2404 .cfa: $esp 24 +\n";
+  AutoTempDir temp_dir;
+  const string source = temp_dir.path() + "/source.sym";
+  const string path = temp_dir.path() + "/overlaps.sym";
+  FILE *f = fopen(source.c_str(), "wb");
+  ASSERT_TRUE(f);
+  fputs(kSymbols, f);
+  fclose(f);
+  CopyAndIndex(source, path);
+
+  TestCodeModule module("overlaps");
+  ASSERT_TRUE(resolver.LoadModule(&module, path));
+  BasicSourceLineResolver indexed_resolver;
+  indexed_resolver.set_use_symbol_file_indexes(true);
+  ASSERT_TRUE(indexed_resolver.LoadModule(&module, path));
+  ExpectSameLookups(&resolver, &indexed_resolver, &module, 0x3100);
+
+  const struct {
+    uint64_t address;
+    const char *function_name;
+    int source_line;
+    const char *cfi;
+  } kExpected[] = {
+    { 0x1010, "First", 10, ".cfa: $esp 8 + .ra: .cfa 4 - ^" },
+    { 0x1c00, "Public", 0, "" },
+    { 0x2100, "Outer", 30, ".cfa: $esp 8 + .ra: .cfa 4 - ^" },
+    { 0x2410, "Outer", 30, ".cfa: $esp 8 + .ra: .cfa 4 - ^" },
+  };
+  for (size_t i = 0; i < sizeof(kExpected) / sizeof(kExpected[0]); ++i) {
+    BasicSourceLineResolver *resolvers[] = { &resolver, &indexed_resolver };
+    for (size_t j = 0; j < sizeof(resolvers) / sizeof(resolvers[0]); ++j) {
+      StackFrame frame;
+      frame.instruction = kExpected[i].address;
+      frame.module = &module;
+      resolvers[j]->FillSourceLineInfo(&frame);
+      EXPECT_EQ(kExpected[i].function_name, frame.function_name)
+          << "address " << std::hex << kExpected[i].address;
+      EXPECT_EQ(kExpected[i].source_line, frame.source_line);
+      scoped_ptr<CFIFrameInfo> cfi(resolvers[j]->FindCFIFrameInfo(&frame));
+      EXPECT_EQ(kExpected[i].cfi, cfi.get() ? cfi->Serialize() : "");
+    }
+  }
+}
+
 // Test parsing of valid FILE lines.  The format is:
 // FILE <id> <filename>
 TEST(SymbolParseHelper, ParseFileValid) {
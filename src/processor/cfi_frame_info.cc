@@ -34,12 +34,16 @@
 
 #include "processor/cfi_frame_info.h"
 
+#include <assert.h>
 #include <string.h>
 
 #include <sstream>
+#include <vector>
 
 #include "common/scoped_ptr.h"
+#include "processor/logging.h"
 #include "processor/postfix_evaluator-inl.h"
+#include "processor/thread_primitives.h"
 
 namespace google_breakpad {
 
@@ -47,13 +51,263 @@ namespace google_breakpad {
 #define strtok_r strtok_s
 #endif
 
+using std::vector;
+
+// A CFIFrameInfo's rules, as compiled for one ValueType and one set of
+// register names.  Compiled rules are never changed, so that threads
+// can share them.
+template<typename V>
+struct CFIFrameInfo::CompiledRules {
+  // One compiled expression.
+  struct Rule {
+    typename PostfixEvaluator<V>::Program program;
+
+    // For each identifier slot of program, the number of the register
+    // the identifier names, or -1 if it names none.
+    vector<int> registers;
+
+    // The number of the register whose value the rule recovers, or -1.
+    int target;
+  };
+
+  CompiledRules(const Rules &rules, const RegisterNames &register_names);
+
+  // Return true if these rules were compiled for NAMES.
+  bool CompiledFor(const RegisterNames &names) const {
+    return RegisterNames(names_.empty() ? NULL : &names_[0],
+                         names_.size()).SameAs(names);
+  }
+
+  // Evaluate RULE using EVALUATOR, taking register values from REGISTERS,
+  // except that if CFA is non-NULL, it holds the value of the .cfa
+  // pseudo-register, numbered CFA_INDEX.
+  static bool Evaluate(const Rule &rule,
+                       const RegisterFile<V> &registers,
+                       size_t cfa_index, const V *cfa,
+                       PostfixEvaluator<V> *evaluator,
+                       V *value);
+
+  // The names of the registers the rules were compiled for.
+  vector<const char *> names_;
+
+  Rule cfa_rule_;
+  Rule ra_rule_;
+  vector<Rule> register_rules_;
+
+ private:
+  void Compile(const string &expression, const RegisterNames &names,
+               int target, Rule *rule);
+};
+
+// The rules themselves, which CFIFrameInfo objects share.  Only a
+// CFIFrameInfo holding the sole reference may change them.
+struct CFIFrameInfo::Rules {
+  Rules() : references(1), compiled32(NULL), compiled64(NULL) { }
+  ~Rules() { ForgetCompiled(); }
+
+  void AddReference() {
+    AtomicIncrement(&references);
+  }
+
+  // Drop a reference, deleting the rules if it was the last.
+  void RemoveReference() {
+    if (AtomicDecrement(&references) == 0)
+      delete this;
+  }
+
+  bool shared() const {
+    return AtomicLoad(&references) > 1;
+  }
+
+  // Delete any compiled forms of the rules, which are about to change.
+  void ForgetCompiled() {
+    delete compiled32;
+    compiled32 = NULL;
+    delete compiled64;
+    compiled64 = NULL;
+  }
+
+  // Return the location of the rules compiled for the type of the
+  // (unused) argument.
+  CompiledRules<uint32_t> **compiled(uint32_t *) { return &compiled32; }
+  CompiledRules<uint64_t> **compiled(uint64_t *) { return &compiled64; }
+
+  int references;
+
+  // In this type, a "postfix expression" is an expression of the sort
+  // interpreted by google_breakpad::PostfixEvaluator.
+
+  // A postfix expression for computing the current frame's CFA (call
+  // frame address). The CFA is a reference address for the frame that
+  // remains unchanged throughout the frame's lifetime. You should
+  // evaluate this expression with a dictionary initially populated
+  // with the values of the current frame's known registers.
+  string cfa_rule;
+
+  // The following expressions should be evaluated with a dictionary
+  // initially populated with the values of the current frame's known
+  // registers, and with ".cfa" set to the result of evaluating the
+  // cfa_rule expression, above.
+
+  // A postfix expression for computing the current frame's return
+  // address.
+  string ra_rule;
+
+  // For a register named REG, register_rules[REG] is a postfix
+  // expression which leaves the value of REG in the calling frame on the
+  // top of the stack.
+  map<string, string> register_rules;
+
+  // The rules compiled for 32-bit and 64-bit values, or NULL.  The first
+  // walker to use the rules with register names compiles them and sets
+  // these; later walkers using the same names read them.
+  CompiledRules<uint32_t> *compiled32;
+  CompiledRules<uint64_t> *compiled64;
+
+ private:
+  Rules(const Rules &);
+  void operator=(const Rules &);
+};
+
+template<typename V>
+CFIFrameInfo::CompiledRules<V>::CompiledRules(
+    const Rules &rules, const RegisterNames &register_names)
+    : names_(register_names.names_,
+             register_names.names_ + register_names.count_),
+      register_rules_(rules.register_rules.size()) {
+  Compile(rules.cfa_rule, register_names, -1, &cfa_rule_);
+  Compile(rules.ra_rule, register_names, -1, &ra_rule_);
+  size_t i = 0;
+  for (map<string, string>::const_iterator it = rules.register_rules.begin();
+       it != rules.register_rules.end(); ++it, ++i) {
+    Compile(it->second, register_names, register_names.Find(it->first),
+            &register_rules_[i]);
+  }
+}
+
+template<typename V>
+void CFIFrameInfo::CompiledRules<V>::Compile(const string &expression,
+                                             const RegisterNames &names,
+                                             int target, Rule *rule) {
+  PostfixEvaluator<V>::Compile(expression, &rule->program);
+  rule->registers.resize(rule->program.identifier_count());
+  for (size_t slot = 0; slot < rule->registers.size(); ++slot)
+    rule->registers[slot] = names.Find(rule->program.identifier(slot));
+  rule->target = target;
+}
+
+// static
+template<typename V>
+bool CFIFrameInfo::CompiledRules<V>::Evaluate(const Rule &rule,
+                                              const RegisterFile<V> &registers,
+                                              size_t cfa_index, const V *cfa,
+                                              PostfixEvaluator<V> *evaluator,
+                                              V *value) {
+  // Identifiers that name no register are distinct slots too, but no
+  // rule can be evaluated with those anyway.
+  if (rule.registers.size() > kMaxRegisters) {
+    BPLOG(ERROR) << "Too many identifiers in CFI rule: " <<
+                    rule.program.expression();
+    return false;
+  }
+  const V *values[kMaxRegisters];
+  for (size_t slot = 0; slot < rule.registers.size(); ++slot) {
+    int index = rule.registers[slot];
+    if (index < 0)
+      values[slot] = NULL;
+    else if (cfa && static_cast<size_t>(index) == cfa_index)
+      values[slot] = cfa;
+    else
+      values[slot] = registers.Find(index);
+  }
+  return evaluator->EvaluateForValue(rule.program, values, value);
+}
+
+const size_t CFIFrameInfo::kMaxRegisters;
+
+CFIFrameInfo::RegisterNames::RegisterNames(const char *const *names,
+                                           size_t count)
+    : names_(names), count_(count) {
+  assert(count + 2 <= kMaxRegisters);
+}
+
+int CFIFrameInfo::RegisterNames::Find(const string &name) const {
+  if (name == ".cfa")
+    return static_cast<int>(cfa_index());
+  if (name == ".ra")
+    return static_cast<int>(ra_index());
+  for (size_t i = 0; i < count_; ++i) {
+    if (name == names_[i])
+      return static_cast<int>(i);
+  }
+  return -1;
+}
+
+bool CFIFrameInfo::RegisterNames::SameAs(const RegisterNames &other) const {
+  if (count_ != other.count_)
+    return false;
+  for (size_t i = 0; i < count_; ++i) {
+    if (names_[i] != other.names_[i] && strcmp(names_[i], other.names_[i]))
+      return false;
+  }
+  return true;
+}
+
+CFIFrameInfo::CFIFrameInfo(const CFIFrameInfo &that) : rules_(that.rules_) {
+  if (rules_)
+    rules_->AddReference();
+}
+
+CFIFrameInfo &CFIFrameInfo::operator=(const CFIFrameInfo &that) {
+  if (that.rules_)
+    that.rules_->AddReference();
+  if (rules_)
+    rules_->RemoveReference();
+  rules_ = that.rules_;
+  return *this;
+}
+
+CFIFrameInfo::~CFIFrameInfo() {
+  if (rules_)
+    rules_->RemoveReference();
+}
+
+CFIFrameInfo::Rules *CFIFrameInfo::MutableRules() {
+  if (!rules_) {
+    rules_ = new Rules();
+  } else if (rules_->shared()) {
+    Rules *copy = new Rules();
+    copy->cfa_rule = rules_->cfa_rule;
+    copy->ra_rule = rules_->ra_rule;
+    copy->register_rules = rules_->register_rules;
+    rules_->RemoveReference();
+    rules_ = copy;
+  } else {
+    rules_->ForgetCompiled();
+  }
+  return rules_;
+}
+
+void CFIFrameInfo::SetCFARule(const string &expression) {
+  MutableRules()->cfa_rule = expression;
+}
+
+void CFIFrameInfo::SetRARule(const string &expression) {
+  MutableRules()->ra_rule = expression;
+}
+
+void CFIFrameInfo::SetRegisterRule(const string &register_name,
+                                   const string &expression) {
+  MutableRules()->register_rules[register_name] = expression;
+}
+
 template<typename V>
 bool CFIFrameInfo::FindCallerRegs(const RegisterValueMap<V> &registers,
                                   const MemoryRegion &memory,
                                   RegisterValueMap<V> *caller_registers) const {
   // If there are not rules for both .ra and .cfa in effect at this address,
   // don't use this CFI data for stack walking.
-  if (cfa_rule_.empty() || ra_rule_.empty())
+  if (!rules_ || rules_->cfa_rule.empty() || rules_->ra_rule.empty())
     return false;
 
   RegisterValueMap<V> working;
@@ -64,19 +318,20 @@ bool CFIFrameInfo::FindCallerRegs(const RegisterValueMap<V> &registers,
   // First, compute the CFA.
   V cfa;
   working = registers;
-  if (!evaluator.EvaluateForValue(cfa_rule_, &cfa))
+  if (!evaluator.EvaluateForValue(rules_->cfa_rule, &cfa))
     return false;
 
   // Then, compute the return address.
   V ra;
   working = registers;
   working[".cfa"] = cfa;
-  if (!evaluator.EvaluateForValue(ra_rule_, &ra))
+  if (!evaluator.EvaluateForValue(rules_->ra_rule, &ra))
     return false;
 
-  // Now, compute values for all the registers register_rules_ mentions.
-  for (RuleMap::const_iterator it = register_rules_.begin();
-       it != register_rules_.end(); it++) {
+  // Now, compute values for all the registers register_rules mentions.
+  for (map<string, string>::const_iterator it =
+           rules_->register_rules.begin();
+       it != rules_->register_rules.end(); it++) {
     V value;
     working = registers;
     working[".cfa"] = cfa;
@@ -101,19 +356,105 @@ template bool CFIFrameInfo::FindCallerRegs<uint64_t>(
     const MemoryRegion &memory,
     RegisterValueMap<uint64_t> *caller_registers) const;
 
+template<typename V>
+const CFIFrameInfo::CompiledRules<V> *CFIFrameInfo::GetCompiledRules(
+    const RegisterNames &names,
+    scoped_ptr<CompiledRules<V> > *owned) const {
+  CompiledRules<V> **location = rules_->compiled(static_cast<V *>(NULL));
+  CompiledRules<V> *compiled = AtomicLoad(location);
+  if (compiled && compiled->CompiledFor(names))
+    return compiled;
+
+  owned->reset(new CompiledRules<V>(*rules_, names));
+
+  // Keep the compiled rules for the next walker, unless rules compiled
+  // for other names are there already, or another thread has just
+  // compiled them too.
+  if (!compiled &&
+      AtomicCompareExchange(location, static_cast<CompiledRules<V> *>(NULL),
+                            owned->get())) {
+    return owned->release();
+  }
+  return owned->get();
+}
+
+template<typename V>
+bool CFIFrameInfo::FindCallerRegs(const RegisterNames &names,
+                                  const RegisterFile<V> &registers,
+                                  const MemoryRegion &memory,
+                                  RegisterFile<V> *caller_registers) const {
+  // If there are not rules for both .ra and .cfa in effect at this address,
+  // don't use this CFI data for stack walking.
+  if (!rules_ || rules_->cfa_rule.empty() || rules_->ra_rule.empty())
+    return false;
+
+  scoped_ptr<CompiledRules<V> > owned;
+  const CompiledRules<V> *compiled = GetCompiledRules(names, &owned);
+  PostfixEvaluator<V> evaluator(NULL, &memory);
+  size_t cfa_index = names.cfa_index();
+
+  caller_registers->Clear();
+
+  // First, compute the CFA.
+  V cfa;
+  if (!CompiledRules<V>::Evaluate(compiled->cfa_rule_, registers, cfa_index,
+                                  NULL, &evaluator, &cfa)) {
+    return false;
+  }
+
+  // Then, compute the return address.
+  V ra;
+  if (!CompiledRules<V>::Evaluate(compiled->ra_rule_, registers, cfa_index,
+                                  &cfa, &evaluator, &ra)) {
+    return false;
+  }
+
+  // Now, compute values for all the registers the rules mention.
+  for (size_t i = 0; i < compiled->register_rules_.size(); ++i) {
+    const typename CompiledRules<V>::Rule &rule = compiled->register_rules_[i];
+    V value;
+    if (!CompiledRules<V>::Evaluate(rule, registers, cfa_index, &cfa,
+                                    &evaluator, &value)) {
+      return false;
+    }
+    if (rule.target >= 0)
+      caller_registers->Set(rule.target, value);
+  }
+
+  caller_registers->Set(names.ra_index(), ra);
+  caller_registers->Set(cfa_index, cfa);
+
+  return true;
+}
+
+// Explicit instantiations for 32-bit and 64-bit architectures.
+template bool CFIFrameInfo::FindCallerRegs<uint32_t>(
+    const RegisterNames &names,
+    const RegisterFile<uint32_t> &registers,
+    const MemoryRegion &memory,
+    RegisterFile<uint32_t> *caller_registers) const;
+template bool CFIFrameInfo::FindCallerRegs<uint64_t>(
+    const RegisterNames &names,
+    const RegisterFile<uint64_t> &registers,
+    const MemoryRegion &memory,
+    RegisterFile<uint64_t> *caller_registers) const;
+
 string CFIFrameInfo::Serialize() const {
   std::ostringstream stream;
+  if (!rules_)
+    return stream.str();
 
-  if (!cfa_rule_.empty()) {
-    stream << ".cfa: " << cfa_rule_;
+  if (!rules_->cfa_rule.empty()) {
+    stream << ".cfa: " << rules_->cfa_rule;
   }
-  if (!ra_rule_.empty()) {
+  if (!rules_->ra_rule.empty()) {
     if (static_cast<std::streamoff>(stream.tellp()) != 0)
       stream << " ";
-    stream << ".ra: " << ra_rule_;
+    stream << ".ra: " << rules_->ra_rule;
   }
-  for (RuleMap::const_iterator iter = register_rules_.begin();
-       iter != register_rules_.end();
+  for (map<string, string>::const_iterator iter =
+           rules_->register_rules.begin();
+       iter != rules_->register_rules.end();
        ++iter) {
     if (static_cast<std::streamoff>(stream.tellp()) != 0)
       stream << " ";
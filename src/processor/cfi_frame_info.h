@@ -40,7 +40,9 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
+#include "common/scoped_ptr.h"
 #include "common/using_std_string.h"
 #include "google_breakpad/common/breakpad_types.h"
 
@@ -63,20 +65,96 @@ class MemoryRegion;
 // address. Then, use the FindCallerRegs member function to apply the
 // rules to the callee frame's register values, yielding the caller
 // frame's register values.
+//
+// Copies of a CFIFrameInfo share their rules, so copying one is cheap,
+// and so is handing the same rules out repeatedly from a cache. Rules
+// that have been evaluated against a RegisterFile keep their compiled
+// form, which the copies share too. Distinct CFIFrameInfo objects may
+// be used on different threads even when they share rules.
 class CFIFrameInfo {
  public:
   // A map from register names onto values.
   template<typename ValueType> class RegisterValueMap: 
     public map<string, ValueType> { };
 
+  // The most registers a RegisterFile can hold, counting the .cfa and
+  // .ra pseudo-registers. This is enough for ARM64's 33 registers.
+  static const size_t kMaxRegisters = 64;
+
+  // The names of an architecture's registers, as they appear in STACK
+  // CFI rules, for numbering them. Register I is named NAMES[I], for I
+  // less than COUNT; the pseudo-registers .cfa and .ra are numbered
+  // COUNT and COUNT + 1. The walkers number their registers in the order
+  // of their context structures, which for most architectures is also
+  // the order of their DWARF register numbers.
+  //
+  // RegisterNames doesn't copy NAMES, which must outlive it.
+  class RegisterNames {
+   public:
+    RegisterNames(const char *const *names, size_t count);
+
+    // The number of real registers.
+    size_t count() const { return count_; }
+
+    // The numbers of the .cfa and .ra pseudo-registers.
+    size_t cfa_index() const { return count_; }
+    size_t ra_index() const { return count_ + 1; }
+
+    // Return the number of the register or pseudo-register named NAME,
+    // or -1 if there is none.
+    int Find(const string &name) const;
+
+    // Return true if OTHER gives the same names to the same numbers.
+    // Names from the same static table compare equal quickly.
+    bool SameAs(const RegisterNames &other) const;
+
+   private:
+    friend class CFIFrameInfo;
+    const char *const *names_;
+    size_t count_;
+  };
+
+  // A fixed-size set of register values indexed by the numbers a
+  // RegisterNames gives them, recording which registers have values.
+  // Unlike RegisterValueMap, filling and reading one involves no
+  // strings or allocation.
+  template<typename ValueType> class RegisterFile {
+   public:
+    RegisterFile() : valid_(0) { }
+
+    // Forget all register values.
+    void Clear() { valid_ = 0; }
+
+    // Set the value of register INDEX.
+    void Set(size_t index, ValueType value) {
+      values_[index] = value;
+      valid_ |= static_cast<uint64_t>(1) << index;
+    }
+
+    // Return a pointer to the value of register INDEX, or NULL if it has
+    // no value.
+    const ValueType *Find(size_t index) const {
+      if (index >= kMaxRegisters || !(valid_ >> index & 1))
+        return NULL;
+      return &values_[index];
+    }
+
+   private:
+    ValueType values_[kMaxRegisters];
+    uint64_t valid_;
+  };
+
+  CFIFrameInfo() : rules_(NULL) { }
+  CFIFrameInfo(const CFIFrameInfo &that);
+  CFIFrameInfo &operator=(const CFIFrameInfo &that);
+  ~CFIFrameInfo();
+
   // Set the expression for computing a call frame address, return
   // address, or register's value. At least the CFA rule and the RA
   // rule must be set before calling FindCallerRegs.
-  void SetCFARule(const string &expression) { cfa_rule_ = expression; }
-  void SetRARule(const string &expression)  { ra_rule_ = expression; }
-  void SetRegisterRule(const string &register_name, const string &expression) {
-    register_rules_[register_name] = expression;
-  }
+  void SetCFARule(const string &expression);
+  void SetRARule(const string &expression);
+  void SetRegisterRule(const string &register_name, const string &expression);
 
   // Compute the values of the calling frame's registers, according to
   // this rule set. Use ValueType in expression evaluation; this
@@ -100,38 +178,43 @@ class CFIFrameInfo {
                       const MemoryRegion &memory,
                       RegisterValueMap<ValueType> *caller_registers) const;
 
+  // Like the above, but with the registers numbered by NAMES. The first
+  // time rules are used with a given ValueType and register names, each
+  // name they mention is resolved to a register number, and each
+  // expression is compiled; after that, finding the caller's registers
+  // involves no string handling or map lookups. Rules for registers
+  // NAMES doesn't include are evaluated, but their values are dropped.
+  //
+  // CALLER_REGISTERS holds the caller's .ra and .cfa values under
+  // NAMES.ra_index() and NAMES.cfa_index().
+  template<typename ValueType>
+  bool FindCallerRegs(const RegisterNames &names,
+                      const RegisterFile<ValueType> &registers,
+                      const MemoryRegion &memory,
+                      RegisterFile<ValueType> *caller_registers) const;
+
   // Serialize the rules in this object into a string in the format
   // of STACK CFI records.
   string Serialize() const;
 
  private:
+  struct Rules;
+  template<typename ValueType> struct CompiledRules;
 
-  // A map from register names onto evaluation rules. 
-  typedef map<string, string> RuleMap;
+  // Return a Rules that this object doesn't share with any other, for
+  // changing.
+  Rules *MutableRules();
 
-  // In this type, a "postfix expression" is an expression of the sort
-  // interpreted by google_breakpad::PostfixEvaluator.
-
-  // A postfix expression for computing the current frame's CFA (call
-  // frame address). The CFA is a reference address for the frame that
-  // remains unchanged throughout the frame's lifetime. You should
-  // evaluate this expression with a dictionary initially populated
-  // with the values of the current frame's known registers.
-  string cfa_rule_;
-
-  // The following expressions should be evaluated with a dictionary
-  // initially populated with the values of the current frame's known
-  // registers, and with ".cfa" set to the result of evaluating the
-  // cfa_rule expression, above.
-
-  // A postfix expression for computing the current frame's return
-  // address. 
-  string ra_rule_;
+  // Return the rules compiled for ValueType and NAMES. If they had to be
+  // compiled and couldn't be kept with the rules, *OWNED holds them.
+  template<typename ValueType>
+  const CompiledRules<ValueType> *GetCompiledRules(
+      const RegisterNames &names,
+      scoped_ptr<CompiledRules<ValueType> > *owned) const;
 
-  // For a register named REG, rules[REG] is a postfix expression
-  // which leaves the value of REG in the calling frame on the top of
-  // the stack. You should evaluate this expression
-  RuleMap register_rules_;
+  // The rules, possibly shared with other CFIFrameInfo objects, or NULL
+  // if none have been set.
+  Rules *rules_;
 };
 
 // A parser for STACK CFI-style rule sets.
@@ -239,9 +322,9 @@ class SimpleCFIWalker {
   // Create a simple CFI-based frame walker, given a description of the
   // architecture's register set. REGISTER_MAP is an array of
   // RegisterSet structures; MAP_SIZE is the number of elements in the
-  // array.
-  SimpleCFIWalker(const RegisterSet *register_map, size_t map_size)
-      : register_map_(register_map), map_size_(map_size) { }
+  // array. The walker numbers the registers in the order REGISTER_MAP
+  // lists them.
+  SimpleCFIWalker(const RegisterSet *register_map, size_t map_size);
 
   // Compute the calling frame's raw context given the callee's raw
   // context.
@@ -266,6 +349,13 @@ class SimpleCFIWalker {
  private:
   const RegisterSet *register_map_;
   size_t map_size_;
+
+  // The names of the registers in register_map_, in order.
+  std::vector<const char *> register_names_;
+
+  // For each register in register_map_, the number of the register or
+  // pseudo-register its alternate name refers to, or -1.
+  std::vector<int> alternate_indexes_;
 };
 
 }  // namespace google_breakpad
@@ -290,6 +290,178 @@ TEST_F(Scope, SeparateTempsRA) {
                                              &caller_registers));
 }
 
+// Handy definitions for tests of the integer-indexed FindCallerRegs.
+struct IndexedCFIFixture: public CFIFixture {
+  IndexedCFIFixture() : names(kNames, kNameCount) { }
+
+  static const char *const kNames[];
+  static const size_t kNameCount = 5;
+  CFIFrameInfo::RegisterNames names;
+  CFIFrameInfo::RegisterFile<uint64_t> callee_file, caller_file;
+};
+
+const char *const IndexedCFIFixture::kNames[kNameCount] = {
+  "$r0", "$r1", "$r2", "register1", "uncopyrightables"
+};
+
+class Indexed: public IndexedCFIFixture, public Test { };
+
+TEST_F(Indexed, Names) {
+  EXPECT_EQ(5U, names.count());
+  EXPECT_EQ(5U, names.cfa_index());
+  EXPECT_EQ(6U, names.ra_index());
+  EXPECT_EQ(0, names.Find("$r0"));
+  EXPECT_EQ(4, names.Find("uncopyrightables"));
+  EXPECT_EQ(5, names.Find(".cfa"));
+  EXPECT_EQ(6, names.Find(".ra"));
+  EXPECT_EQ(-1, names.Find("$r3"));
+
+  const char *const copied[] = {
+    "$r0", "$r1", "$r2", "register1", "uncopyrightables"
+  };
+  EXPECT_TRUE(names.SameAs(names));
+  EXPECT_TRUE(names.SameAs(CFIFrameInfo::RegisterNames(copied, 5)));
+  EXPECT_FALSE(names.SameAs(CFIFrameInfo::RegisterNames(copied, 4)));
+  EXPECT_FALSE(names.SameAs(CFIFrameInfo::RegisterNames(copied + 1, 4)));
+}
+
+// FindCallerRegs should fail if no .cfa or .ra rule is provided.
+TEST_F(Indexed, NoCFAOrRA) {
+  ExpectNoMemoryReferences();
+
+  ASSERT_FALSE(cfi.FindCallerRegs<uint64_t>(names, callee_file, memory,
+                                             &caller_file));
+  cfi.SetRARule("0");
+  ASSERT_FALSE(cfi.FindCallerRegs<uint64_t>(names, callee_file, memory,
+                                             &caller_file));
+  cfi.SetCFARule("0");
+  ASSERT_TRUE(cfi.FindCallerRegs<uint64_t>(names, callee_file, memory,
+                                            &caller_file));
+}
+
+// The indexed and map-based FindCallerRegs should agree, and rules for
+// registers missing from the table should be dropped.
+TEST_F(Indexed, SetManyRules) {
+  ExpectNoMemoryReferences();
+
+  cfi.SetCFARule("$temp1 68737028 = $temp2 61072337 = $temp1 $temp2 -");
+  cfi.SetRARule(".cfa 99804755 +");
+  cfi.SetRegisterRule("register1", ".cfa 54370437 *");
+  cfi.SetRegisterRule("vodkathumbscrewingly", "24076308 .cfa +");
+  cfi.SetRegisterRule("uncopyrightables", "92642917 .cfa /");
+  ASSERT_TRUE(cfi.FindCallerRegs<uint64_t>(registers, memory,
+                                            &caller_registers));
+  ASSERT_TRUE(cfi.FindCallerRegs<uint64_t>(names, callee_file, memory,
+                                            &caller_file));
+  ASSERT_EQ(5U, caller_registers.size());
+  ASSERT_TRUE(caller_file.Find(names.cfa_index()));
+  EXPECT_EQ(caller_registers[".cfa"], *caller_file.Find(names.cfa_index()));
+  ASSERT_TRUE(caller_file.Find(names.ra_index()));
+  EXPECT_EQ(caller_registers[".ra"], *caller_file.Find(names.ra_index()));
+  ASSERT_TRUE(caller_file.Find(3));
+  EXPECT_EQ(416732599139967ULL, *caller_file.Find(3));
+  ASSERT_TRUE(caller_file.Find(4));
+  EXPECT_EQ(12U, *caller_file.Find(4));
+  EXPECT_FALSE(caller_file.Find(0));
+  EXPECT_FALSE(caller_file.Find(1));
+  EXPECT_FALSE(caller_file.Find(2));
+}
+
+// Rules can see the current frame's registers and the caller's .cfa,
+// and assignments to registers last only for one rule.
+TEST_F(Indexed, Scope) {
+  ExpectNoMemoryReferences();
+
+  callee_file.Set(1, 0x6ed3582c4bedb9adULL);
+  callee_file.Set(2, 0xd27d9e742b8df6d0ULL);
+  cfi.SetCFARule("$r1 1 +");
+  cfi.SetRARule(".cfa $r2 +");
+  cfi.SetRegisterRule("$r1", "$r1 42175211 = $r2");
+  cfi.SetRegisterRule("$r2", "$r2 21357221 = $r1");
+  ASSERT_TRUE(cfi.FindCallerRegs<uint64_t>(names, callee_file, memory,
+                                            &caller_file));
+  EXPECT_EQ(0x6ed3582c4bedb9aeULL, *caller_file.Find(names.cfa_index()));
+  EXPECT_EQ(0x6ed3582c4bedb9aeULL + 0xd27d9e742b8df6d0ULL,
+            *caller_file.Find(names.ra_index()));
+  EXPECT_EQ(0xd27d9e742b8df6d0ULL, *caller_file.Find(1));
+  EXPECT_EQ(0x6ed3582c4bedb9adULL, *caller_file.Find(2));
+
+  // The .cfa rule can't see .cfa or .ra, and no rule can see .ra.
+  cfi.SetCFARule(".cfa");
+  ASSERT_FALSE(cfi.FindCallerRegs<uint64_t>(names, callee_file, memory,
+                                             &caller_file));
+  cfi.SetCFARule("0");
+  cfi.SetRARule(".ra");
+  ASSERT_FALSE(cfi.FindCallerRegs<uint64_t>(names, callee_file, memory,
+                                             &caller_file));
+  cfi.SetRARule("0");
+  cfi.SetRegisterRule("$r0", ".ra");
+  ASSERT_FALSE(cfi.FindCallerRegs<uint64_t>(names, callee_file, memory,
+                                             &caller_file));
+
+  // A rule that uses a register without a value fails, even if the
+  // register is missing from the table.
+  cfi.SetRegisterRule("$r0", "$r0");
+  ASSERT_FALSE(cfi.FindCallerRegs<uint64_t>(names, callee_file, memory,
+                                             &caller_file));
+  cfi.SetRegisterRule("$r0", "$r9");
+  ASSERT_FALSE(cfi.FindCallerRegs<uint64_t>(names, callee_file, memory,
+                                             &caller_file));
+  cfi.SetRegisterRule("$r0", "$r1");
+  ASSERT_TRUE(cfi.FindCallerRegs<uint64_t>(names, callee_file, memory,
+                                            &caller_file));
+}
+
+// Copies share rules until one of them is changed.
+TEST_F(Indexed, Copies) {
+  ExpectNoMemoryReferences();
+
+  cfi.SetCFARule("2828089117179001");
+  cfi.SetRARule(".cfa 1 +");
+  ASSERT_TRUE(cfi.FindCallerRegs<uint64_t>(names, callee_file, memory,
+                                            &caller_file));
+
+  CFIFrameInfo copy(cfi);
+  CFIFrameInfo assigned;
+  assigned = cfi;
+  copy.SetRegisterRule("$r0", ".cfa");
+  assigned.SetCFARule("7");
+  EXPECT_EQ(".cfa: 2828089117179001 .ra: .cfa 1 +", cfi.Serialize());
+  EXPECT_EQ(".cfa: 2828089117179001 .ra: .cfa 1 + $r0: .cfa",
+            copy.Serialize());
+  EXPECT_EQ(".cfa: 7 .ra: .cfa 1 +", assigned.Serialize());
+
+  for (int i = 0; i < 2; i++) {
+    ASSERT_TRUE(cfi.FindCallerRegs<uint64_t>(names, callee_file, memory,
+                                              &caller_file));
+    EXPECT_EQ(2828089117179002ULL, *caller_file.Find(names.ra_index()));
+    EXPECT_FALSE(caller_file.Find(0));
+
+    ASSERT_TRUE(copy.FindCallerRegs<uint64_t>(names, callee_file, memory,
+                                               &caller_file));
+    EXPECT_EQ(2828089117179001ULL, *caller_file.Find(0));
+
+    ASSERT_TRUE(assigned.FindCallerRegs<uint64_t>(names, callee_file, memory,
+                                                   &caller_file));
+    EXPECT_EQ(8U, *caller_file.Find(names.ra_index()));
+  }
+
+  // Rules evaluated with a different table are resolved again.
+  CFIFrameInfo::RegisterNames short_names(kNames + 1, 2);
+  CFIFrameInfo::RegisterFile<uint64_t> short_file;
+  ASSERT_TRUE(copy.FindCallerRegs<uint64_t>(short_names, callee_file, memory,
+                                             &short_file));
+  EXPECT_EQ(2828089117179002ULL, *short_file.Find(short_names.ra_index()));
+  EXPECT_FALSE(short_file.Find(0));
+  EXPECT_FALSE(short_file.Find(1));
+
+  // 32-bit values have their own resolved rules.
+  CFIFrameInfo::RegisterFile<uint32_t> callee32, caller32;
+  ASSERT_TRUE(assigned.FindCallerRegs<uint32_t>(names, callee32, memory,
+                                                 &caller32));
+  EXPECT_EQ(8U, *caller32.Find(names.ra_index()));
+}
+
 class MockCFIRuleParserHandler: public CFIRuleParser::Handler {
  public:
   MOCK_METHOD1(CFARule, void(const string &));
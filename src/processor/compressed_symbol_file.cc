@@ -0,0 +1,247 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// compressed_symbol_file.cc: Reads gzip- or zlib-compressed symbol files.
+//
+// See compressed_symbol_file.h for documentation.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "processor/compressed_symbol_file.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <algorithm>
+
+#include "common/scoped_ptr.h"
+#include "processor/logging.h"
+
+namespace google_breakpad {
+
+const char kCompressedSymbolFileSuffix[] = ".gz";
+
+bool IsCompressedSymbolFile(const string &file_name) {
+  size_t suffix_length = strlen(kCompressedSymbolFileSuffix);
+  return file_name.size() > suffix_length &&
+         file_name.compare(file_name.size() - suffix_length, suffix_length,
+                           kCompressedSymbolFileSuffix) == 0;
+}
+
+#ifdef HAVE_ZLIB
+
+bool CanReadCompressedSymbolFiles() {
+  return true;
+}
+
+namespace {
+
+// The amount of compressed data read at a time.
+const size_t kInputChunkSize = 64 * 1024;
+
+// inflateInit2's windowBits for the largest window, with automatic
+// detection of gzip and zlib headers.
+const int kAutoDetectWindowBits = 15 + 32;
+
+// Returns a guess at the decompressed size of the file, which is
+// |file_size| bytes long and open as |file|.  A gzip file ends with the
+// size of its data modulo 2^32, which is exact for a single member of
+// less than 4GB.  A zlib stream ends with a checksum instead, so for it,
+// or when the trailer is implausible, guess a typical compression ratio
+// for text.
+size_t EstimateDecompressedSize(FILE *file, size_t file_size) {
+  size_t estimate = file_size * 4;
+  unsigned char magic[2];
+  unsigned char trailer[4];
+  if (file_size >= 18 &&
+      fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+      magic[0] == 0x1f && magic[1] == 0x8b &&
+      fseek(file, -4, SEEK_END) == 0 &&
+      fread(trailer, 1, sizeof(trailer), file) == sizeof(trailer)) {
+    uint32_t size = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) |
+                    (static_cast<uint32_t>(trailer[3]) << 24);
+    // A compression ratio over 1032:1 is impossible with deflate, so a
+    // trailer claiming one isn't a gzip size.
+    if (size >= file_size / 2 && size / 1032 <= file_size)
+      estimate = size;
+  }
+  rewind(file);
+  return estimate;
+}
+
+// Closes the file when it goes out of scope.
+class AutoFileCloser {
+ public:
+  explicit AutoFileCloser(FILE *file) : file_(file) { }
+  ~AutoFileCloser() { fclose(file_); }
+
+ private:
+  FILE *file_;
+};
+
+// Ends the inflate stream when it goes out of scope.
+class AutoInflateEnd {
+ public:
+  explicit AutoInflateEnd(z_stream *stream) : stream_(stream) { }
+  ~AutoInflateEnd() { inflateEnd(stream_); }
+
+ private:
+  z_stream *stream_;
+};
+
+}  // namespace
+
+bool ReadCompressedSymbolFile(const string &file_name,
+                              char **symbol_data,
+                              size_t *symbol_data_size) {
+  if (symbol_data == NULL || symbol_data_size == NULL) {
+    BPLOG(ERROR) << "Could not Read file into Null memory pointer";
+    return false;
+  }
+
+  FILE *file = fopen(file_name.c_str(), "rb");
+  if (!file) {
+    string error_string;
+    int error_code = ErrnoString(&error_string);
+    BPLOG(ERROR) << "Could not open " << file_name <<
+        ", error " << error_code << ": " << error_string;
+    return false;
+  }
+  AutoFileCloser closer(file);
+
+  struct stat buf;
+  if (fstat(fileno(file), &buf) == -1) {
+    string error_string;
+    int error_code = ErrnoString(&error_string);
+    BPLOG(ERROR) << "Could not stat " << file_name <<
+        ", error " << error_code << ": " << error_string;
+    return false;
+  }
+
+  BPLOG(INFO) << "Decompressing " << file_name;
+
+  // Leave room for the null terminator.
+  size_t capacity = EstimateDecompressedSize(file, buf.st_size) + 1;
+  scoped_array<char> output(new char[capacity]);
+  size_t output_size = 0;
+
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (inflateInit2(&stream, kAutoDetectWindowBits) != Z_OK) {
+    BPLOG(ERROR) << "Could not initialize zlib for " << file_name;
+    return false;
+  }
+  AutoInflateEnd inflate_end(&stream);
+
+  scoped_array<unsigned char> input(new unsigned char[kInputChunkSize]);
+  bool stream_ended = false;
+  for (;;) {
+    if (stream.avail_in == 0) {
+      size_t input_size = fread(input.get(), 1, kInputChunkSize, file);
+      if (ferror(file)) {
+        string error_string;
+        int error_code = ErrnoString(&error_string);
+        BPLOG(ERROR) << "Could not read " << file_name <<
+            ", error " << error_code << ": " << error_string;
+        return false;
+      }
+      if (input_size == 0)
+        break;
+      stream.next_in = input.get();
+      stream.avail_in = static_cast<uInt>(input_size);
+    }
+
+    // Another gzip member follows the one that just ended.
+    if (stream_ended) {
+      if (inflateReset(&stream) != Z_OK)
+        return false;
+      stream_ended = false;
+    }
+
+    // Grow the buffer when it is full, keeping room for the terminator.
+    if (output_size + 1 == capacity) {
+      size_t new_capacity = capacity * 2;
+      char *grown = new char[new_capacity];
+      memcpy(grown, output.get(), output_size);
+      output.reset(grown);
+      capacity = new_capacity;
+    }
+
+    size_t available = std::min(capacity - 1 - output_size,
+                                static_cast<size_t>(UINT_MAX));
+    stream.next_out = reinterpret_cast<Bytef*>(output.get() + output_size);
+    stream.avail_out = static_cast<uInt>(available);
+    int result = inflate(&stream, Z_NO_FLUSH);
+    output_size += available - stream.avail_out;
+    if (result == Z_STREAM_END) {
+      stream_ended = true;
+    } else if (result != Z_OK && result != Z_BUF_ERROR) {
+      BPLOG(ERROR) << "Could not decompress " << file_name << ", error " <<
+          result << ": " << (stream.msg ? stream.msg : "");
+      return false;
+    }
+  }
+
+  if (!stream_ended) {
+    BPLOG(ERROR) << "Compressed data in " << file_name << " is truncated";
+    return false;
+  }
+
+  output[output_size] = '\0';
+  *symbol_data = output.release();
+  *symbol_data_size = output_size + 1;
+  return true;
+}
+
+#else  // HAVE_ZLIB
+
+bool CanReadCompressedSymbolFiles() {
+  return false;
+}
+
+bool ReadCompressedSymbolFile(const string &file_name,
+                              char **symbol_data,
+                              size_t *symbol_data_size) {
+  BPLOG(ERROR) << "Could not read " << file_name <<
+      ": built without zlib";
+  return false;
+}
+
+#endif  // HAVE_ZLIB
+
+}  // namespace google_breakpad
@@ -0,0 +1,73 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// compressed_symbol_file.h: Reads gzip- or zlib-compressed symbol files.
+//
+// Text symbol files compress well, so symbol stores may keep them
+// compressed, as foo.sym.gz next to or instead of foo.sym.  The data is
+// decompressed as it is read, straight into the buffer the resolver
+// parses, so neither the whole compressed file nor a second copy of the
+// text is ever held in memory.
+
+#ifndef PROCESSOR_COMPRESSED_SYMBOL_FILE_H__
+#define PROCESSOR_COMPRESSED_SYMBOL_FILE_H__
+
+#include <stddef.h>
+
+#include <string>
+
+#include "common/using_std_string.h"
+
+namespace google_breakpad {
+
+// The suffix of compressed symbol files.
+extern const char kCompressedSymbolFileSuffix[];
+
+// Returns true if |file_name| ends in kCompressedSymbolFileSuffix.
+bool IsCompressedSymbolFile(const string &file_name);
+
+// Returns true if this build can decompress symbol files.  Breakpad reads
+// them with zlib; a build without it treats compressed files as missing.
+bool CanReadCompressedSymbolFiles();
+
+// Decompresses the gzip or zlib data in |file_name| into a buffer
+// allocated with new[], followed by a null terminator.  Gzip files made of
+// several members, as concatenating .gz files gives, are read in full.
+// On success, sets |*symbol_data| to the buffer, which the caller must
+// delete[], and |*symbol_data_size| to the size of the data, including
+// the null terminator.  Returns false if the file can't be read or isn't
+// valid compressed data.
+bool ReadCompressedSymbolFile(const string &file_name,
+                              char **symbol_data,
+                              size_t *symbol_data_size);
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_COMPRESSED_SYMBOL_FILE_H__
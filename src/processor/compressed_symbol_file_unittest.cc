@@ -0,0 +1,212 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// compressed_symbol_file_unittest.cc: Unit tests for reading compressed
+// symbol files.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <string>
+#include <vector>
+
+#include "breakpad_googletest_includes.h"
+#include "common/tests/auto_tempdir.h"
+#include "common/using_std_string.h"
+#include "processor/compressed_symbol_file.h"
+
+namespace {
+
+using google_breakpad::AutoTempDir;
+using google_breakpad::CanReadCompressedSymbolFiles;
+using google_breakpad::IsCompressedSymbolFile;
+using google_breakpad::ReadCompressedSymbolFile;
+
+#ifdef HAVE_ZLIB
+
+// Returns |text| compressed in gzip format.
+string Gzip(const string &text) {
+  z_stream stream = z_stream();
+  // 16 selects a gzip header and trailer.
+  EXPECT_EQ(Z_OK, deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED,
+                               15 + 16, 8, Z_DEFAULT_STRATEGY));
+  std::vector<Bytef> output(deflateBound(&stream, text.size()));
+  stream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(text.data()));
+  stream.avail_in = text.size();
+  stream.next_out = &output[0];
+  stream.avail_out = output.size();
+  EXPECT_EQ(Z_STREAM_END, deflate(&stream, Z_FINISH));
+  output.resize(stream.total_out);
+  deflateEnd(&stream);
+  return string(output.begin(), output.end());
+}
+
+// Returns |text| compressed in zlib format.
+string Zlib(const string &text) {
+  uLongf size = compressBound(text.size());
+  std::vector<Bytef> output(size);
+  EXPECT_EQ(Z_OK, compress(&output[0], &size,
+                           reinterpret_cast<const Bytef*>(text.data()),
+                           text.size()));
+  return string(reinterpret_cast<char*>(&output[0]), size);
+}
+
+#endif  // HAVE_ZLIB
+
+class CompressedSymbolFileTest : public ::testing::Test {
+ public:
+  void SetUp() {
+    path_ = temp_dir_.path() + "/test.sym.gz";
+  }
+
+  void WriteFile(const string &contents) {
+    FILE *file = fopen(path_.c_str(), "wb");
+    ASSERT_TRUE(file);
+    ASSERT_EQ(contents.size(),
+              fwrite(contents.data(), 1, contents.size(), file));
+    fclose(file);
+  }
+
+  // Reads path_, and checks that it holds |expected|.
+  void ExpectContents(const string &expected) {
+    char *data = NULL;
+    size_t size = 0;
+    ASSERT_TRUE(ReadCompressedSymbolFile(path_, &data, &size));
+    ASSERT_EQ(expected.size() + 1, size);
+    EXPECT_EQ('\0', data[expected.size()]);
+    EXPECT_TRUE(expected == string(data, expected.size()));
+    delete [] data;
+  }
+
+  bool Read() {
+    char *data = NULL;
+    size_t size = 0;
+    bool result = ReadCompressedSymbolFile(path_, &data, &size);
+    delete [] data;
+    return result;
+  }
+
+  AutoTempDir temp_dir_;
+  string path_;
+};
+
+const char kSymbols[] =
+    "MODULE Linux x86 000000000000000000000000000000000 test\n"
+    "FILE 1 file1.cc\n"
+    "FUNC 1000 10 0 Function1\n"
+    "1000 10 44 1\n"
+    "PUBLIC 2000 0 Public2\n";
+
+TEST_F(CompressedSymbolFileTest, IsCompressedSymbolFile) {
+  EXPECT_TRUE(IsCompressedSymbolFile("test.sym.gz"));
+  EXPECT_TRUE(IsCompressedSymbolFile("/path/to/test.gz"));
+  EXPECT_FALSE(IsCompressedSymbolFile("test.sym"));
+  EXPECT_FALSE(IsCompressedSymbolFile("test.gz.sym"));
+  EXPECT_FALSE(IsCompressedSymbolFile(".gz"));
+}
+
+#ifdef HAVE_ZLIB
+
+TEST_F(CompressedSymbolFileTest, Gzip) {
+  WriteFile(Gzip(kSymbols));
+  ExpectContents(kSymbols);
+}
+
+TEST_F(CompressedSymbolFileTest, Zlib) {
+  WriteFile(Zlib(kSymbols));
+  ExpectContents(kSymbols);
+}
+
+TEST_F(CompressedSymbolFileTest, Empty) {
+  WriteFile(Gzip(""));
+  ExpectContents("");
+}
+
+// Concatenated gzip files decompress to the concatenated data.
+TEST_F(CompressedSymbolFileTest, SeveralMembers) {
+  WriteFile(Gzip("MODULE Linux x86 0 test\n") + Gzip("FILE 1 a.cc\n") +
+            Gzip(""));
+  ExpectContents("MODULE Linux x86 0 test\nFILE 1 a.cc\n");
+}
+
+// Data that compresses far better than text usually does needs the
+// buffer to grow, as a zlib stream has no size to go by.
+TEST_F(CompressedSymbolFileTest, Large) {
+  string text;
+  for (int i = 0; i < 200000; ++i) {
+    char line[32];
+    snprintf(line, sizeof(line), "%x 4 %d 1\n", 0x1000 + i * 4, i % 100);
+    text += line;
+  }
+  text += string(1 << 20, ' ');
+  WriteFile(Zlib(text));
+  ExpectContents(text);
+  WriteFile(Gzip(text));
+  ExpectContents(text);
+}
+
+TEST_F(CompressedSymbolFileTest, Errors) {
+  // No file.
+  EXPECT_FALSE(Read());
+
+  // Not compressed.
+  WriteFile(kSymbols);
+  EXPECT_FALSE(Read());
+
+  // Truncated.
+  string compressed = Gzip(kSymbols);
+  WriteFile(compressed.substr(0, compressed.size() / 2));
+  EXPECT_FALSE(Read());
+
+  // Corrupted.
+  compressed[compressed.size() / 2] ^= 0x55;
+  WriteFile(compressed);
+  EXPECT_FALSE(Read());
+}
+
+#else  // HAVE_ZLIB
+
+TEST_F(CompressedSymbolFileTest, NoZlib) {
+  EXPECT_FALSE(CanReadCompressedSymbolFiles());
+  WriteFile(kSymbols);
+  EXPECT_FALSE(Read());
+}
+
+#endif  // HAVE_ZLIB
+
+}  // namespace
@@ -0,0 +1,501 @@
+// Copyright (c) 2016 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// concurrent_source_line_resolver.cc: Implementation of
+// ConcurrentSourceLineResolver.
+//
+// See concurrent_source_line_resolver.h for documentation.
+
+#include "google_breakpad/processor/concurrent_source_line_resolver.h"
+
+#include <string.h>
+
+#include "common/scoped_ptr.h"
+#include "google_breakpad/processor/basic_source_line_resolver.h"
+#include "google_breakpad/processor/fast_source_line_resolver.h"
+#include "google_breakpad/processor/source_line_resolver_base.h"
+#include "google_breakpad/processor/stack_frame.h"
+#include "processor/basic_source_line_resolver_types.h"
+#include "processor/fast_source_line_resolver_types.h"
+#include "processor/logging.h"
+#include "processor/module_factory.h"
+#include "processor/module_serializer.h"
+#include "processor/thread_primitives.h"
+
+namespace google_breakpad {
+
+struct ConcurrentSourceLineResolver::SharedModule {
+  SharedModule() : module(NULL), data(NULL), references(0) { }
+  ~SharedModule() {
+    delete module;
+    delete [] data;
+  }
+
+  FastSourceLineResolver::Module *module;
+
+  // The serialized symbol data module points into.
+  char *data;
+
+  // The number of nodes that refer to this module.  Changed atomically.
+  int references;
+};
+
+// A treap: a binary search tree ordered by code file, that is also a
+// heap ordered by a hash of the code file.  The hash makes the tree's
+// shape depend only on which modules it holds, so it is balanced on
+// average, whatever order modules are loaded and unloaded in.
+//
+// Nodes never change once built.  Adding or removing a module builds new
+// nodes for the path to it, and shares every other node with the tree it
+// started from, so nodes are reference counted by their parents and by
+// the snapshots whose root they are.
+struct ConcurrentSourceLineResolver::Node {
+  // Takes over the caller's references to |left| and |right|.
+  // |priority| must be Hash(code_file).
+  Node(const string &code_file, uint32_t priority, SharedModule *module,
+       const Node *left, const Node *right)
+      : code_file(code_file),
+        priority(priority),
+        module(module),
+        left(left),
+        right(right),
+        references(1) {
+    AtomicIncrement(&module->references);
+  }
+
+  // A copy of |node| with different children.
+  Node(const Node &node, const Node *left, const Node *right)
+      : code_file(node.code_file),
+        priority(node.priority),
+        module(node.module),
+        left(left),
+        right(right),
+        references(1) {
+    AtomicIncrement(&module->references);
+  }
+
+  ~Node() {
+    Release(left);
+    Release(right);
+    if (AtomicDecrement(&module->references) == 0)
+      delete module;
+  }
+
+  // The FNV-1a hash of |code_file|.
+  static uint32_t Hash(const string &code_file) {
+    uint32_t hash = 2166136261U;
+    for (size_t i = 0; i < code_file.size(); ++i) {
+      hash ^= static_cast<unsigned char>(code_file[i]);
+      hash *= 16777619U;
+    }
+    return hash;
+  }
+
+  // Adds a reference to |node|, which may be NULL, and returns it.
+  static const Node *Reference(const Node *node) {
+    if (node)
+      AtomicIncrement(&node->references);
+    return node;
+  }
+
+  // Drops a reference to |node|, which may be NULL, deleting it if that
+  // was the last.
+  static void Release(const Node *node) {
+    if (node && AtomicDecrement(&node->references) == 0)
+      delete node;
+  }
+
+  // Returns the module for |code_file| in the tree |root|, or NULL.
+  static const SharedModule *Find(const Node *root, const string &code_file) {
+    while (root) {
+      if (code_file < root->code_file)
+        root = root->left;
+      else if (root->code_file < code_file)
+        root = root->right;
+      else
+        return root->module;
+    }
+    return NULL;
+  }
+
+  // The functions below leave their arguments alone, and return new
+  // references to the trees they build.
+
+  // Sets |*left| and |*right| to the parts of |root| before and after
+  // |code_file|, which |root| must not contain.
+  static void Split(const Node *root, const string &code_file,
+                    const Node **left, const Node **right) {
+    if (!root) {
+      *left = *right = NULL;
+    } else if (root->code_file < code_file) {
+      const Node *right_left;
+      Split(root->right, code_file, &right_left, right);
+      *left = new Node(*root, Reference(root->left), right_left);
+    } else {
+      const Node *left_right;
+      Split(root->left, code_file, left, &left_right);
+      *right = new Node(*root, left_right, Reference(root->right));
+    }
+  }
+
+  // Returns the tree holding |left| and |right|.  Everything in |left|
+  // must come before everything in |right|.
+  static const Node *Merge(const Node *left, const Node *right) {
+    if (!left)
+      return Reference(right);
+    if (!right)
+      return Reference(left);
+    if (left->priority > right->priority)
+      return new Node(*left, Reference(left->left), Merge(left->right, right));
+    return new Node(*right, Merge(left, right->left), Reference(right->right));
+  }
+
+  // Returns |root| with |module| added for |code_file|, which |root| must
+  // not contain.  |priority| must be Hash(code_file).
+  static const Node *Insert(const Node *root, const string &code_file,
+                            uint32_t priority, SharedModule *module) {
+    if (!root || priority > root->priority) {
+      const Node *left, *right;
+      Split(root, code_file, &left, &right);
+      return new Node(code_file, priority, module, left, right);
+    }
+    if (code_file < root->code_file) {
+      return new Node(*root, Insert(root->left, code_file, priority, module),
+                      Reference(root->right));
+    }
+    return new Node(*root, Reference(root->left),
+                    Insert(root->right, code_file, priority, module));
+  }
+
+  // Returns |root| without the module for |code_file|.
+  static const Node *Erase(const Node *root, const string &code_file) {
+    if (!root)
+      return NULL;
+    if (code_file < root->code_file) {
+      return new Node(*root, Erase(root->left, code_file),
+                      Reference(root->right));
+    }
+    if (root->code_file < code_file) {
+      return new Node(*root, Reference(root->left),
+                      Erase(root->right, code_file));
+    }
+    return Merge(root->left, root->right);
+  }
+
+  const string code_file;
+  const uint32_t priority;
+  SharedModule *const module;
+  const Node *const left;
+  const Node *const right;
+
+  // Changed atomically.
+  mutable int references;
+
+ private:
+  // Disallow unwanted copy ctor and assignment operator
+  Node(const Node&);
+  void operator=(const Node&);
+};
+
+struct ConcurrentSourceLineResolver::Snapshot {
+  // Takes over the caller's reference to |root|.
+  explicit Snapshot(const Node *root) : root(root), references(1) { }
+  ~Snapshot() { Node::Release(root); }
+
+  const Node *const root;
+
+  // One for the resolver while this is the current snapshot, and one for
+  // each lookup reading it.  Changed atomically.
+  int references;
+};
+
+class ConcurrentSourceLineResolver::AutoReader {
+ public:
+  explicit AutoReader(ConcurrentSourceLineResolver *resolver) {
+    // Announce the read before looking at snapshot_.  PublishSnapshot
+    // replaces snapshot_ before it waits for the announced reads, so
+    // either it waits for this one to reference the old snapshot, or
+    // this one finds the new snapshot.
+    int *acquiring =
+        &resolver->acquiring_[AtomicLoad(&resolver->epoch_) & 1];
+    AtomicIncrement(acquiring);
+    snapshot_ = AtomicLoad(&resolver->snapshot_);
+    AtomicIncrement(&snapshot_->references);
+    AtomicDecrement(acquiring);
+  }
+  ~AutoReader() { ReleaseSnapshot(snapshot_); }
+
+  // Returns the module for |code_file| in the snapshot, or NULL.
+  const SharedModule *FindModule(const string &code_file) const {
+    return Node::Find(snapshot_->root, code_file);
+  }
+
+ private:
+  Snapshot *snapshot_;
+};
+
+ConcurrentSourceLineResolver::ConcurrentSourceLineResolver()
+    : mutex_(new Mutex()),
+      load_finished_(new ConditionVariable()),
+      snapshot_(new Snapshot(NULL)),
+      epoch_(0),
+      loading_() {
+  acquiring_[0] = acquiring_[1] = 0;
+}
+
+ConcurrentSourceLineResolver::~ConcurrentSourceLineResolver() {
+  ReleaseSnapshot(snapshot_);
+  delete load_finished_;
+  delete mutex_;
+}
+
+bool ConcurrentSourceLineResolver::LoadModule(const CodeModule *module,
+                                              const string &map_file) {
+  if (!module)
+    return false;
+
+  if (HasModule(module))
+    return true;
+
+  BPLOG(INFO) << "Loading symbols for module " << module->code_file()
+              << " from " << map_file;
+
+  char *memory_buffer;
+  size_t memory_buffer_size;
+  if (!SourceLineResolverBase::ReadSymbolFile(map_file, &memory_buffer,
+                                              &memory_buffer_size)) {
+    return false;
+  }
+
+  bool load_result = LoadModuleUsingMemoryBuffer(module, memory_buffer,
+                                                 memory_buffer_size);
+  delete [] memory_buffer;
+  return load_result;
+}
+
+bool ConcurrentSourceLineResolver::LoadModuleUsingMapBuffer(
+    const CodeModule *module, const string &map_buffer) {
+  if (!module)
+    return false;
+
+  if (HasModule(module))
+    return true;
+
+  size_t memory_buffer_size = map_buffer.size() + 1;
+  char *memory_buffer = new char[memory_buffer_size];
+
+  // Can't use strcpy, as the data may contain '\0's before the end.
+  memcpy(memory_buffer, map_buffer.c_str(), map_buffer.size());
+  memory_buffer[map_buffer.size()] = '\0';
+
+  bool load_result = LoadModuleUsingMemoryBuffer(module, memory_buffer,
+                                                 memory_buffer_size);
+  delete [] memory_buffer;
+  return load_result;
+}
+
+bool ConcurrentSourceLineResolver::LoadModuleUsingMemoryBuffer(
+    const CodeModule *module,
+    char *memory_buffer,
+    size_t memory_buffer_size) {
+  if (!module)
+    return false;
+
+  const string code_file = module->code_file();
+
+  // If another thread is loading this module, wait for it to finish, and
+  // load the module here only if that failed.
+  mutex_->Acquire();
+  while (loading_.find(code_file) != loading_.end())
+    load_finished_->Wait(mutex_);
+  if (Node::Find(snapshot_->root, code_file)) {
+    mutex_->Release();
+    return true;
+  }
+  loading_.insert(code_file);
+  mutex_->Release();
+
+  // Parse the symbol data without holding the lock, so that other modules
+  // can be loaded meanwhile.
+  BPLOG(INFO) << "Loading symbols for module " << code_file
+              << " from memory buffer";
+  SharedModule *shared_module = CreateModule(code_file, memory_buffer,
+                                             memory_buffer_size);
+
+  mutex_->Acquire();
+  if (shared_module) {
+    PublishSnapshot(Node::Insert(snapshot_->root, code_file,
+                                 Node::Hash(code_file), shared_module));
+  }
+  loading_.erase(code_file);
+  load_finished_->Broadcast();
+  mutex_->Release();
+
+  return shared_module != NULL;
+}
+
+bool ConcurrentSourceLineResolver::ShouldDeleteMemoryBufferAfterLoadModule() {
+  return true;
+}
+
+void ConcurrentSourceLineResolver::UnloadModule(const CodeModule *module) {
+  if (!module)
+    return;
+
+  mutex_->Acquire();
+  if (Node::Find(snapshot_->root, module->code_file()))
+    PublishSnapshot(Node::Erase(snapshot_->root, module->code_file()));
+  mutex_->Release();
+}
+
+bool ConcurrentSourceLineResolver::HasModule(const CodeModule *module) {
+  if (!module)
+    return false;
+
+  AutoReader reader(this);
+  return reader.FindModule(module->code_file()) != NULL;
+}
+
+bool ConcurrentSourceLineResolver::IsModuleCorrupt(const CodeModule *module) {
+  if (!module)
+    return false;
+
+  AutoReader reader(this);
+  const SharedModule *shared_module =
+      reader.FindModule(module->code_file());
+  return shared_module && shared_module->module->IsCorrupt();
+}
+
+void ConcurrentSourceLineResolver::FillSourceLineInfo(StackFrame *frame) {
+  if (!frame->module)
+    return;
+
+  AutoReader reader(this);
+  const SharedModule *shared_module =
+      reader.FindModule(frame->module->code_file());
+  if (shared_module)
+    shared_module->module->LookupAddress(frame);
+}
+
+WindowsFrameInfo *ConcurrentSourceLineResolver::FindWindowsFrameInfo(
+    const StackFrame *frame) {
+  if (!frame->module)
+    return NULL;
+
+  AutoReader reader(this);
+  const SharedModule *shared_module =
+      reader.FindModule(frame->module->code_file());
+  return shared_module ? shared_module->module->FindWindowsFrameInfo(frame)
+                       : NULL;
+}
+
+CFIFrameInfo *ConcurrentSourceLineResolver::FindCFIFrameInfo(
+    const StackFrame *frame) {
+  if (!frame->module)
+    return NULL;
+
+  AutoReader reader(this);
+  const SharedModule *shared_module =
+      reader.FindModule(frame->module->code_file());
+  return shared_module ? shared_module->module->FindCFIFrameInfo(frame)
+                       : NULL;
+}
+
+// static
+ConcurrentSourceLineResolver::SharedModule *
+ConcurrentSourceLineResolver::CreateModule(const string &code_file,
+                                           char *memory_buffer,
+                                           size_t memory_buffer_size) {
+  scoped_ptr<SharedModule> shared_module(new SharedModule);
+
+  if (FastSourceLineResolver::HasSymbolFileHeader(memory_buffer,
+                                                  memory_buffer_size)) {
+    // Serialized data: check it, and keep a copy.
+    if (!FastSourceLineResolver::CheckSymbolFileHeader(memory_buffer,
+                                                       memory_buffer_size)) {
+      BPLOG(ERROR) << "Invalid serialized symbol data for module "
+                   << code_file;
+      return NULL;
+    }
+    shared_module->data = new char[memory_buffer_size];
+    memcpy(shared_module->data, memory_buffer, memory_buffer_size);
+  } else {
+    // Text format symbol data: parse it, and serialize the result.
+    BasicModuleFactory basic_factory;
+    scoped_ptr<BasicSourceLineResolver::Module> basic_module(
+        basic_factory.CreateModule(code_file));
+    if (!basic_module->LoadMapFromMemory(memory_buffer, memory_buffer_size)) {
+      BPLOG(ERROR) << "Too many error while parsing symbol data for module "
+                   << code_file;
+    }
+    ModuleSerializer serializer;
+    unsigned int size;
+    shared_module->data = serializer.Serialize(*basic_module, &size);
+    memory_buffer_size = size;
+    if (!shared_module->data) {
+      BPLOG(ERROR) << "Could not serialize symbol data for module "
+                   << code_file;
+      return NULL;
+    }
+  }
+
+  FastModuleFactory fast_factory;
+  shared_module->module = fast_factory.CreateModule(code_file);
+  if (!shared_module->module->LoadMapFromMemory(shared_module->data,
+                                                memory_buffer_size)) {
+    BPLOG(ERROR) << "Could not load serialized symbol data for module "
+                 << code_file;
+    return NULL;
+  }
+  return shared_module.release();
+}
+
+// static
+void ConcurrentSourceLineResolver::ReleaseSnapshot(Snapshot *snapshot) {
+  if (AtomicDecrement(&snapshot->references) == 0)
+    delete snapshot;
+}
+
+void ConcurrentSourceLineResolver::PublishSnapshot(const Node *root) {
+  Snapshot *old_snapshot = snapshot_;
+  AtomicStore(&snapshot_, new Snapshot(root));
+
+  // A lookup may have read the old snapshot without referencing it yet.
+  // Wait for the lookups announced in each half of acquiring_ in turn,
+  // switching new lookups to the other half first so that the wait ends.
+  // Lookups announced after that can only find the new snapshot.
+  for (int i = 0; i < 2; ++i) {
+    int half = AtomicFetchAdd(&epoch_, 1) & 1;
+    while (AtomicLoad(&acquiring_[half]) != 0)
+      YieldThread();
+  }
+  ReleaseSnapshot(old_snapshot);
+}
+
+}  // namespace google_breakpad
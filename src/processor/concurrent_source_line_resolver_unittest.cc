@@ -0,0 +1,328 @@
+// Copyright (c) 2016 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// concurrent_source_line_resolver_unittest.cc: Unit tests for
+// ConcurrentSourceLineResolver.
+
+#include <pthread.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "breakpad_googletest_includes.h"
+#include "common/scoped_ptr.h"
+#include "common/tests/auto_tempdir.h"
+#include "common/using_std_string.h"
+#include "google_breakpad/processor/basic_source_line_resolver.h"
+#include "google_breakpad/processor/code_module.h"
+#include "google_breakpad/processor/concurrent_source_line_resolver.h"
+#include "google_breakpad/processor/stack_frame.h"
+#include "processor/cfi_frame_info.h"
+#include "processor/module_serializer.h"
+#include "processor/windows_frame_info.h"
+
+namespace {
+
+using google_breakpad::AutoTempDir;
+using google_breakpad::BasicSourceLineResolver;
+using google_breakpad::CFIFrameInfo;
+using google_breakpad::CodeModule;
+using google_breakpad::ConcurrentSourceLineResolver;
+using google_breakpad::ModuleSerializer;
+using google_breakpad::SourceLineResolverInterface;
+using google_breakpad::StackFrame;
+using google_breakpad::WindowsFrameInfo;
+using google_breakpad::scoped_ptr;
+using std::vector;
+
+class TestCodeModule : public CodeModule {
+ public:
+  explicit TestCodeModule(string code_file) : code_file_(code_file) {}
+  virtual ~TestCodeModule() {}
+
+  virtual uint64_t base_address() const { return 0; }
+  virtual uint64_t size() const { return 0xb000; }
+  virtual string code_file() const { return code_file_; }
+  virtual string code_identifier() const { return ""; }
+  virtual string debug_file() const { return ""; }
+  virtual string debug_identifier() const { return ""; }
+  virtual string version() const { return ""; }
+  virtual const CodeModule* Copy() const {
+    return new TestCodeModule(code_file_);
+  }
+
+ private:
+  string code_file_;
+};
+
+// Everything a resolver reports about one address: the source line
+// information, the Windows frame info and the CFI rules, each as a
+// string.  The latter two are empty if the resolver has none.
+vector<string> Describe(SourceLineResolverInterface *resolver,
+                        const CodeModule *module, uint64_t address) {
+  StackFrame frame;
+  frame.instruction = address;
+  frame.module = module;
+  resolver->FillSourceLineInfo(&frame);
+
+  vector<string> parts(3);
+  char description[256];
+  snprintf(description, sizeof(description), "%s %llx %s %d %llx",
+           frame.function_name.c_str(),
+           static_cast<unsigned long long>(frame.function_base),
+           frame.source_file_name.c_str(), frame.source_line,
+           static_cast<unsigned long long>(frame.source_line_base));
+  parts[0] = description;
+
+  scoped_ptr<WindowsFrameInfo> windows_frame_info(
+      resolver->FindWindowsFrameInfo(&frame));
+  if (windows_frame_info.get()) {
+    snprintf(description, sizeof(description), "%d %x %x %x %x %s",
+             windows_frame_info->type_,
+             windows_frame_info->prolog_size,
+             windows_frame_info->parameter_size,
+             windows_frame_info->local_size,
+             windows_frame_info->max_stack_size,
+             windows_frame_info->program_string.c_str());
+    parts[1] = description;
+  }
+
+  scoped_ptr<CFIFrameInfo> cfi_frame_info(resolver->FindCFIFrameInfo(&frame));
+  if (cfi_frame_info.get())
+    parts[2] = cfi_frame_info->Serialize();
+
+  return parts;
+}
+
+class TestConcurrentSourceLineResolver : public ::testing::Test {
+ public:
+  void SetUp() {
+    testdata_dir = string(getenv("srcdir") ? getenv("srcdir") : ".") +
+                   "/src/processor/testdata";
+  }
+
+  string symbol_file(int number) {
+    char file_name[32];
+    snprintf(file_name, sizeof(file_name), "/module%d.out", number);
+    return testdata_dir + file_name;
+  }
+
+  ConcurrentSourceLineResolver resolver;
+  string testdata_dir;
+};
+
+// The concurrent resolver must answer every lookup just like the basic
+// resolver does.
+TEST_F(TestConcurrentSourceLineResolver, TestMatchesBasicResolver) {
+  BasicSourceLineResolver basic_resolver;
+  TestCodeModule module1("module1");
+  TestCodeModule module2("module2");
+  ASSERT_TRUE(basic_resolver.LoadModule(&module1, symbol_file(1)));
+  ASSERT_TRUE(basic_resolver.LoadModule(&module2, symbol_file(2)));
+  ASSERT_TRUE(resolver.LoadModule(&module1, symbol_file(1)));
+  ASSERT_TRUE(resolver.LoadModule(&module2, symbol_file(2)));
+  ASSERT_TRUE(resolver.HasModule(&module1));
+  ASSERT_FALSE(resolver.IsModuleCorrupt(&module1));
+
+  for (uint64_t address = 0; address < 0x5000; address += 3) {
+    ASSERT_EQ(Describe(&basic_resolver, &module1, address),
+              Describe(&resolver, &module1, address));
+    ASSERT_EQ(Describe(&basic_resolver, &module2, address),
+              Describe(&resolver, &module2, address));
+  }
+
+  // Loading a module twice is harmless.
+  ASSERT_TRUE(resolver.LoadModule(&module1, symbol_file(1)));
+
+  resolver.UnloadModule(&module1);
+  ASSERT_FALSE(resolver.HasModule(&module1));
+  ASSERT_TRUE(resolver.HasModule(&module2));
+  StackFrame frame;
+  frame.instruction = 0x1000;
+  frame.module = &module1;
+  resolver.FillSourceLineInfo(&frame);
+  ASSERT_TRUE(frame.function_name.empty());
+}
+
+TEST_F(TestConcurrentSourceLineResolver, TestLoadSerializedData) {
+  AutoTempDir temp_dir;
+  string fast_file = temp_dir.path() + "/module1.fast";
+  ModuleSerializer serializer;
+  ASSERT_TRUE(serializer.ConvertSymbolFile(symbol_file(1), fast_file));
+
+  TestCodeModule module1("module1");
+  ASSERT_TRUE(resolver.LoadModule(&module1, fast_file));
+  StackFrame frame;
+  frame.instruction = 0x1000;
+  frame.module = &module1;
+  resolver.FillSourceLineInfo(&frame);
+  ASSERT_EQ("Function1_1", frame.function_name);
+  ASSERT_EQ("file1_1.cc", frame.source_file_name);
+  ASSERT_EQ(44, frame.source_line);
+}
+
+TEST_F(TestConcurrentSourceLineResolver, TestCorruptModule) {
+  TestCodeModule module3("module3");
+  ASSERT_TRUE(resolver.LoadModule(&module3, testdata_dir + "/module3_bad.out"));
+  ASSERT_TRUE(resolver.HasModule(&module3));
+  ASSERT_TRUE(resolver.IsModuleCorrupt(&module3));
+
+  TestCodeModule module5("module5");
+  ASSERT_FALSE(resolver.LoadModule(&module5,
+                                   testdata_dir + "/invalid-filename"));
+  ASSERT_FALSE(resolver.HasModule(&module5));
+}
+
+// Loads and unloads many modules in a scrambled order, checking that each
+// snapshot holds exactly the modules it should.
+TEST_F(TestConcurrentSourceLineResolver, TestManyModules) {
+  const int kModuleCount = 200;
+  vector<TestCodeModule*> modules;
+  for (int i = 0; i < kModuleCount; ++i) {
+    char code_file[32];
+    snprintf(code_file, sizeof(code_file), "module%d", i);
+    modules.push_back(new TestCodeModule(code_file));
+  }
+
+  // 73 and kModuleCount are coprime, so this visits every module once.
+  vector<bool> loaded(kModuleCount);
+  for (int step = 0; step < 2 * kModuleCount; ++step) {
+    int i = step * 73 % kModuleCount;
+    if (step < kModuleCount) {
+      char symbols[64];
+      snprintf(symbols, sizeof(symbols), "FUNC 1000 10 0 Function%d\n", i);
+      ASSERT_TRUE(resolver.LoadModuleUsingMapBuffer(modules[i], symbols));
+      loaded[i] = true;
+    } else if (i % 3 == 0) {
+      resolver.UnloadModule(modules[i]);
+      loaded[i] = false;
+    }
+
+    if ((step + 1) % 25 == 0) {
+      for (int j = 0; j < kModuleCount; ++j) {
+        ASSERT_EQ(loaded[j], resolver.HasModule(modules[j])) << step;
+        StackFrame frame;
+        frame.instruction = 0x1000;
+        frame.module = modules[j];
+        resolver.FillSourceLineInfo(&frame);
+        char function_name[32];
+        snprintf(function_name, sizeof(function_name), "Function%d", j);
+        ASSERT_EQ(loaded[j] ? function_name : "", frame.function_name);
+      }
+    }
+  }
+
+  for (int i = 0; i < kModuleCount; ++i)
+    delete modules[i];
+}
+
+struct ThreadContext {
+  TestConcurrentSourceLineResolver *test;
+  const vector<vector<string> > *expected;
+
+  // What lookups report when module1 is not loaded.
+  const vector<string> *unloaded;
+
+  // True if this thread unloads module1 after each round, and if other
+  // threads may do so.
+  bool unload;
+  bool others_unload;
+
+  bool failed;
+};
+
+// Loads module1 and checks lookups against |expected|, optionally
+// unloading the module again after each round.
+void *LookupThread(void *argument) {
+  ThreadContext *context = static_cast<ThreadContext*>(argument);
+  ConcurrentSourceLineResolver *resolver = &context->test->resolver;
+  TestCodeModule module1("module1");
+  for (int round = 0; round < 20; ++round) {
+    if (!resolver->LoadModule(&module1, context->test->symbol_file(1))) {
+      context->failed = true;
+      return NULL;
+    }
+    for (size_t i = 0; i < context->expected->size(); ++i) {
+      vector<string> parts = Describe(resolver, &module1, i * 5);
+      // A concurrent unload may make the module disappear between any two
+      // lookups, but must never produce a wrong answer.
+      for (size_t part = 0; part < parts.size(); ++part) {
+        if (parts[part] != (*context->expected)[i][part] &&
+            (!context->others_unload ||
+             parts[part] != (*context->unloaded)[part])) {
+          context->failed = true;
+          return NULL;
+        }
+      }
+    }
+    if (context->unload)
+      resolver->UnloadModule(&module1);
+  }
+  return NULL;
+}
+
+TEST_F(TestConcurrentSourceLineResolver, TestConcurrentUse) {
+  BasicSourceLineResolver basic_resolver;
+  TestCodeModule module1("module1");
+  vector<string> unloaded = Describe(&basic_resolver, &module1, 0x1000);
+  ASSERT_TRUE(basic_resolver.LoadModule(&module1, symbol_file(1)));
+  vector<vector<string> > expected;
+  for (uint64_t address = 0; address < 0x4000; address += 5)
+    expected.push_back(Describe(&basic_resolver, &module1, address));
+
+  const int kThreadCount = 8;
+  for (int pass = 0; pass < 2; ++pass) {
+    // The first pass has every thread race to load the same module; in
+    // the second, half of the threads also keep unloading it.
+    ThreadContext contexts[kThreadCount];
+    pthread_t threads[kThreadCount];
+    for (int i = 0; i < kThreadCount; ++i) {
+      contexts[i].test = this;
+      contexts[i].expected = &expected;
+      contexts[i].unloaded = &unloaded;
+      contexts[i].unload = pass == 1 && i % 2 == 0;
+      contexts[i].others_unload = pass == 1;
+      contexts[i].failed = false;
+      ASSERT_EQ(0, pthread_create(&threads[i], NULL, LookupThread,
+                                  &contexts[i]));
+    }
+    for (int i = 0; i < kThreadCount; ++i) {
+      pthread_join(threads[i], NULL);
+      EXPECT_FALSE(contexts[i].failed) << "pass " << pass << " thread " << i;
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -40,6 +40,8 @@
 
 #include <assert.h>
 
+#include <algorithm>
+
 #include "processor/logging.h"
 
 
@@ -69,6 +71,8 @@ bool ContainedRangeMap<AddressType, EntryType>::StoreRange(
     return false;
   }
 
+  if (frozen_map_)
+    Thaw();
   if (!map_)
     map_ = new AddressToRangeMap();
 
@@ -154,6 +158,18 @@ bool ContainedRangeMap<AddressType, EntryType>::RetrieveRange(
                              "|entry|";
   assert(entry);
 
+  if (frozen_map_) {
+    FrozenConstIterator iterator = std::lower_bound(
+        frozen_map_->begin(), frozen_map_->end(), address, FrozenKeyLess());
+    if (iterator == frozen_map_->end() || address < iterator->second->base_)
+      return false;
+
+    if (!iterator->second->RetrieveRange(address, entry))
+      *entry = iterator->second->entry_;
+
+    return true;
+  }
+
   // If nothing was ever stored, then there's nothing to retrieve.
   if (!map_)
     return false;
@@ -188,6 +204,52 @@ void ContainedRangeMap<AddressType, EntryType>::Clear() {
     delete map_;
     map_ = NULL;
   }
+
+  if (frozen_map_) {
+    FrozenConstIterator end = frozen_map_->end();
+    for (FrozenConstIterator child = frozen_map_->begin(); child != end;
+         ++child)
+      delete child->second;
+
+    delete frozen_map_;
+    frozen_map_ = NULL;
+  }
+}
+
+
+template<typename AddressType, typename EntryType>
+void ContainedRangeMap<AddressType, EntryType>::Freeze() {
+  // A frozen range's descendants can't have changed since it was frozen.
+  if (frozen_map_ || !map_)
+    return;
+
+  frozen_map_ = new FrozenChildren(map_->begin(), map_->end());
+  delete map_;
+  map_ = NULL;
+
+  FrozenConstIterator end = frozen_map_->end();
+  for (FrozenConstIterator child = frozen_map_->begin(); child != end; ++child)
+    child->second->Freeze();
+}
+
+
+template<typename AddressType, typename EntryType>
+void ContainedRangeMap<AddressType, EntryType>::Thaw() {
+  map_ = new AddressToRangeMap(frozen_map_->begin(), frozen_map_->end());
+  delete frozen_map_;
+  frozen_map_ = NULL;
+}
+
+
+template<typename AddressType, typename EntryType>
+const typename ContainedRangeMap<AddressType, EntryType>::AddressToRangeMap *
+ContainedRangeMap<AddressType, EntryType>::Children(
+    AddressToRangeMap *storage) const {
+  if (!frozen_map_)
+    return map_;
+  storage->clear();
+  storage->insert(frozen_map_->begin(), frozen_map_->end());
+  return storage;
 }
 
 
@@ -62,6 +62,8 @@
 
 
 #include <map>
+#include <utility>
+#include <vector>
 
 
 namespace google_breakpad {
@@ -75,7 +77,7 @@ class ContainedRangeMap {
   // The default constructor creates a ContainedRangeMap with no geometry
   // and no entry, and as such is only suitable for the root node of a
   // ContainedRangeMap tree.
-  ContainedRangeMap() : base_(), entry_(), map_(NULL) {}
+  ContainedRangeMap() : base_(), entry_(), map_(NULL), frozen_map_(NULL) {}
 
   ~ContainedRangeMap();
 
@@ -104,6 +106,12 @@ class ContainedRangeMap {
   // empty state when called on the root node.
   void Clear();
 
+  // Moves the children of every range into sorted arrays, which take a
+  // fraction of the memory of the trees they are kept in while the map is
+  // populated, and are faster to search.  Storing another range moves the
+  // children of the ranges it is stored under back into trees first.
+  void Freeze();
+
  private:
   friend class ContainedRangeMapSerializer<AddressType, EntryType>;
   friend class ModuleComparer;
@@ -114,13 +122,39 @@ class ContainedRangeMap {
   typedef typename AddressToRangeMap::const_iterator MapConstIterator;
   typedef typename AddressToRangeMap::iterator MapIterator;
   typedef typename AddressToRangeMap::value_type MapValue;
+  typedef std::pair<AddressType, ContainedRangeMap *> FrozenValue;
+  typedef std::vector<FrozenValue> FrozenChildren;
+  typedef typename FrozenChildren::const_iterator FrozenConstIterator;
+
+  // Orders frozen child ranges by their high addresses.
+  struct FrozenKeyLess {
+    bool operator()(const FrozenValue &value,
+                    const AddressType &address) const {
+      return value.first < address;
+    }
+    bool operator()(const AddressType &address,
+                    const FrozenValue &value) const {
+      return address < value.first;
+    }
+  };
 
   // Creates a new ContainedRangeMap with the specified base address, entry,
   // and initial child map, which may be NULL.  This is only used internally
   // by ContainedRangeMap when it creates a new child.
   ContainedRangeMap(const AddressType &base, const EntryType &entry,
                     AddressToRangeMap *map)
-      : base_(base), entry_(entry), map_(map) {}
+      : base_(base), entry_(entry), map_(map), frozen_map_(NULL) {}
+
+  // Moves the children of a frozen range back into map_.  Only this
+  // range is thawed; its descendants stay frozen until something is
+  // stored into them.
+  void Thaw();
+
+  // Returns the children of this range keyed by their high addresses, or
+  // NULL if it has none: map_ itself, or if the range is frozen, a copy
+  // built in |storage|.  This lets the serializer and ModuleComparer walk
+  // the map in either state.
+  const AddressToRangeMap *Children(AddressToRangeMap *storage) const;
 
   // The base address of this range.  The high address does not need to
   // be stored, because it is used as the key to an object in its parent's
@@ -141,6 +175,10 @@ class ContainedRangeMap {
   // address.  This is a pointer to avoid allocating map structures for
   // leaf nodes, where they are not needed.
   AddressToRangeMap *map_;
+
+  // The child ranges of a frozen range, ordered by their high addresses.
+  // At most one of map_ and frozen_map_ is non-NULL.
+  FrozenChildren *frozen_map_;
 };
 
 
@@ -84,6 +84,10 @@ static bool RunTests() {
   ASSERT_TRUE (crm.StoreRange(68,  1, 24));
   ASSERT_TRUE (crm.StoreRange(61,  1, 25));
   ASSERT_TRUE (crm.StoreRange(61,  8, 26));
+
+  // Freeze the map partway through.  The following stores must obey the
+  // same rules, whether they go into a frozen range or not.
+  crm.Freeze();
   ASSERT_FALSE(crm.StoreRange(59,  9, 27));
   ASSERT_FALSE(crm.StoreRange(59, 10, 28));
   ASSERT_FALSE(crm.StoreRange(59, 11, 29));
@@ -247,6 +251,21 @@ static bool RunTests() {
 
 #ifdef GENERATE_TEST_DATA
   printf("  };\n");
+#else  // GENERATE_TEST_DATA
+  // A frozen map must give the same answers.
+  crm.Freeze();
+  for (unsigned int address = 0; address < test_high; ++address) {
+    int value;
+    if (!crm.RetrieveRange(address, &value))
+      value = 0;
+
+    if (value != test_data[address]) {
+      fprintf(stderr, "FAIL: frozen retrieve %d expected %d observed %d "
+              "@ %s:%d\n",
+              address, test_data[address], value, __FILE__, __LINE__);
+      return false;
+    }
+  }
 #endif  // GENERATE_TEST_DATA
 
   return true;
@@ -40,12 +40,17 @@
 #include "google_breakpad/processor/fast_source_line_resolver.h"
 #include "processor/fast_source_line_resolver_types.h"
 
+#include <string.h>
+
 #include <map>
 #include <string>
 #include <utility>
 
 #include "common/scoped_ptr.h"
 #include "common/using_std_string.h"
+#include "google_breakpad/processor/code_module.h"
+#include "processor/compressed_symbol_file.h"
+#include "processor/logging.h"
 #include "processor/module_factory.h"
 #include "processor/simple_serializer-inl.h"
 
@@ -57,10 +62,150 @@ namespace google_breakpad {
 FastSourceLineResolver::FastSourceLineResolver()
   : SourceLineResolverBase(new FastModuleFactory) { }
 
+FastSourceLineResolver::~FastSourceLineResolver() {
+  MappedFileMap::iterator iter = mapped_files_.begin();
+  for (; iter != mapped_files_.end(); ++iter) {
+    UnmapSymbolFile(iter->second.first, iter->second.second);
+  }
+}
+
 bool FastSourceLineResolver::ShouldDeleteMemoryBufferAfterLoadModule() {
   return false;
 }
 
+bool FastSourceLineResolver::LoadModule(const CodeModule *module,
+                                        const string &map_file) {
+  if (module == NULL)
+    return false;
+
+  // Make sure we don't already have a module with the given name.
+  if (HasModule(module)) {
+    BPLOG(INFO) << "Symbols for module " << module->code_file()
+                << " already loaded";
+    return false;
+  }
+
+  BPLOG(INFO) << "Loading symbols for module " << module->code_file()
+              << " from " << map_file;
+
+  // Compressed files can't be mapped, so decompress them into memory.
+  if (IsCompressedSymbolFile(map_file))
+    return SourceLineResolverBase::LoadModule(module, map_file);
+
+  char *mapping;
+  size_t mapping_size;
+  if (!MapSymbolFile(map_file, &mapping, &mapping_size))
+    return false;
+
+  if (!LoadModuleUsingMemoryBuffer(module, mapping, mapping_size)) {
+    UnmapSymbolFile(mapping, mapping_size);
+    return false;
+  }
+
+  // The mapping has to stay alive as long as the module.
+  mapped_files_.insert(make_pair(module->code_file(),
+                                 make_pair(mapping, mapping_size)));
+  OwnModuleData(module->code_file());
+  return true;
+}
+
+bool FastSourceLineResolver::LoadModuleUsingMemoryBuffer(
+    const CodeModule *module,
+    char *memory_buffer,
+    size_t memory_buffer_size) {
+  if (!module)
+    return false;
+
+  if (HasSymbolFileHeader(memory_buffer, memory_buffer_size) &&
+      !CheckSymbolFileHeader(memory_buffer, memory_buffer_size)) {
+    BPLOG(ERROR) << "Invalid serialized symbol data for module "
+                 << module->code_file();
+    return false;
+  }
+
+  return SourceLineResolverBase::LoadModuleUsingMemoryBuffer(
+      module, memory_buffer, memory_buffer_size);
+}
+
+void FastSourceLineResolver::RemoveModule(const string &code_file) {
+  SourceLineResolverBase::RemoveModule(code_file);
+
+  MappedFileMap::iterator iter = mapped_files_.find(code_file);
+  if (iter != mapped_files_.end()) {
+    UnmapSymbolFile(iter->second.first, iter->second.second);
+    mapped_files_.erase(iter);
+  }
+}
+
+// static
+bool FastSourceLineResolver::HasSymbolFileHeader(const char *buffer,
+                                                 size_t buffer_size) {
+  if (!buffer || buffer_size < sizeof(SymbolFileHeader))
+    return false;
+  uint32_t magic;
+  memcpy(&magic, buffer, sizeof(magic));
+  return magic == SymbolFileHeader::kMagic;
+}
+
+// static
+bool FastSourceLineResolver::CheckSymbolFileHeader(const char *buffer,
+                                                   size_t buffer_size) {
+  SymbolFileHeader header;
+  memcpy(&header, buffer, sizeof(header));
+
+  if (header.byte_order_mark != SymbolFileHeader::kByteOrderMark) {
+    BPLOG(ERROR) << "Serialized symbol data has foreign byte order";
+    return false;
+  }
+
+  if (header.version != SymbolFileHeader::kVersion) {
+    BPLOG(ERROR) << "Serialized symbol data has version " << header.version
+                 << ", expected " << SymbolFileHeader::kVersion;
+    return false;
+  }
+
+  if (header.data_size > buffer_size - sizeof(header)) {
+    BPLOG(ERROR) << "Serialized symbol data is truncated: " << header.data_size
+                 << " bytes expected, " << buffer_size - sizeof(header)
+                 << " available";
+    return false;
+  }
+
+  uint32_t checksum = ComputeChecksum(buffer + sizeof(header),
+                                      header.data_size);
+  if (checksum != header.checksum) {
+    BPLOG(ERROR) << "Serialized symbol data checksum mismatch: " << HexString(
+        checksum) << " vs " << HexString(header.checksum);
+    return false;
+  }
+
+  return true;
+}
+
+// static
+uint32_t FastSourceLineResolver::ComputeChecksum(const char *data,
+                                                 size_t size) {
+  // Adler-32 as defined in RFC 1950.  kMaxBlock is the largest number of bytes
+  // that can be summed before the 32-bit sums have to be reduced.
+  static const uint32_t kModulus = 65521;
+  static const size_t kMaxBlock = 5552;
+
+  const unsigned char *bytes = reinterpret_cast<const unsigned char*>(data);
+  uint32_t a = 1;
+  uint32_t b = 0;
+  while (size > 0) {
+    size_t block = size < kMaxBlock ? size : kMaxBlock;
+    size -= block;
+    while (block--) {
+      a += *bytes++;
+      b += a;
+    }
+    a %= kModulus;
+    b %= kModulus;
+  }
+  return (b << 16) | a;
+}
+
 void FastSourceLineResolver::Module::LookupAddress(StackFrame *frame) const {
   MemAddr address = frame->instruction - frame->module->base_address();
 
@@ -148,9 +293,15 @@ bool FastSourceLineResolver::Module::LoadMapFromMemory(
     char *memory_buffer,
     size_t memory_buffer_size) {
   if (!memory_buffer) return false;
+  memory_buffer_size_ = memory_buffer_size;
 
-  // Read the "is_corrupt" flag.
+  // Skip the header of serialized data stored on disk.  The header has been
+  // checked already by FastSourceLineResolver::LoadModuleUsingMemoryBuffer.
   const char *mem_buffer = memory_buffer;
+  if (HasSymbolFileHeader(mem_buffer, memory_buffer_size))
+    mem_buffer += sizeof(SymbolFileHeader);
+
+  // Read the "is_corrupt" flag.
   mem_buffer = SimpleSerializer<bool>::Read(mem_buffer, &is_corrupt_);
 
   const uint32_t *map_sizes = reinterpret_cast<const uint32_t*>(mem_buffer);
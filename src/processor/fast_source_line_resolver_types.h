@@ -90,6 +90,7 @@ public SourceLineResolverBase::Function {
         raw + name_size + 2 * sizeof(MemAddr) + sizeof(int32_t));
   }
 
+  string name;
   StaticRangeMap<MemAddr, Line> lines;
 };
 
@@ -108,11 +109,34 @@ public SourceLineResolverBase::PublicSymbol {
     parameter_size = *(reinterpret_cast<const int32_t*>(
         raw + name_size + sizeof(MemAddr)));
   }
+
+  string name;
+};
+
+// Serialized symbol data written to disk by ModuleSerializer::SerializeToFile
+// starts with this header.  All fields use the byte order of the machine that
+// wrote the file, like the serialized data itself; byte_order_mark lets the
+// reader reject files written on a machine of different endianness.
+// The header is 8-byte aligned so that the serialized data following it keeps
+// the alignment of the buffer it is mapped or read into.
+struct FastSourceLineResolver::SymbolFileHeader {
+  static const uint32_t kMagic = 0x46535042;  // "BPSF" in little-endian.
+  static const uint32_t kByteOrderMark = 0x01020304;
+  // Increment whenever the layout of the serialized Module changes.
+  static const uint32_t kVersion = 1;
+
+  uint32_t magic;
+  uint32_t byte_order_mark;
+  uint32_t version;
+  // Adler-32 checksum of the data_size bytes following the header.
+  uint32_t checksum;
+  uint64_t data_size;
 };
 
 class FastSourceLineResolver::Module: public SourceLineResolverBase::Module {
  public:
-  explicit Module(const string &name) : name_(name), is_corrupt_(false) { }
+  explicit Module(const string &name)
+      : name_(name), is_corrupt_(false), memory_buffer_size_(0) { }
   virtual ~Module() { }
 
   // Looks up the given relative address, and fills the StackFrame struct
@@ -127,6 +151,12 @@ class FastSourceLineResolver::Module: public SourceLineResolverBase::Module {
   // undefined, if the symbol data hasn't been loaded yet.
   virtual bool IsCorrupt() const { return is_corrupt_; }
 
+  // The module's maps are views of the serialized data, so that is what
+  // it takes up.
+  virtual size_t MemoryUsage() const {
+    return sizeof(*this) + memory_buffer_size_;
+  }
+
   // If Windows stack walking information is available covering ADDRESS,
   // return a WindowsFrameInfo structure describing it. If the information
   // is not available, returns NULL. A NULL return value does not indicate
@@ -178,6 +208,9 @@ class FastSourceLineResolver::Module: public SourceLineResolverBase::Module {
   // this map, or the end of the range as given by the cfi_initial_rules_
   // entry (which FindCFIFrameInfo looks up first).
   StaticMap<MemAddr, char> cfi_delta_rules_;
+
+  // The size of the serialized data the maps point into.
+  size_t memory_buffer_size_;
 };
 
 }  // namespace google_breakpad
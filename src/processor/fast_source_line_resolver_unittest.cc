@@ -40,20 +40,25 @@
 #include <assert.h>
 #include <stdio.h>
 
+#include <map>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "breakpad_googletest_includes.h"
+#include "common/tests/auto_tempdir.h"
 #include "common/using_std_string.h"
 #include "google_breakpad/processor/code_module.h"
 #include "google_breakpad/processor/stack_frame.h"
 #include "google_breakpad/processor/memory_region.h"
+#include "google_breakpad/processor/symbol_supplier.h"
 #include "processor/logging.h"
 #include "processor/module_serializer.h"
 #include "processor/module_comparer.h"
 
 namespace {
 
+using google_breakpad::AutoTempDir;
 using google_breakpad::SourceLineResolverBase;
 using google_breakpad::BasicSourceLineResolver;
 using google_breakpad::FastSourceLineResolver;
@@ -63,6 +68,8 @@ using google_breakpad::CFIFrameInfo;
 using google_breakpad::CodeModule;
 using google_breakpad::MemoryRegion;
 using google_breakpad::StackFrame;
+using google_breakpad::SymbolSupplier;
+using google_breakpad::SystemInfo;
 using google_breakpad::WindowsFrameInfo;
 using google_breakpad::linked_ptr;
 using google_breakpad::scoped_ptr;
@@ -170,6 +177,66 @@ static void ClearSourceLineInfo(StackFrame *frame) {
   frame->source_line = 0;
 }
 
+// A symbol supplier that hands out serialized symbol data read ahead of
+// time, and records which modules' data was freed.
+class TestSymbolSupplier : public SymbolSupplier {
+ public:
+  ~TestSymbolSupplier() {
+    for (std::map<string, char*>::iterator it = buffers_.begin();
+         it != buffers_.end(); ++it) {
+      delete [] it->second;
+    }
+  }
+
+  bool AddSymbolFile(const string &code_file, const string &symbol_file,
+                     size_t *size) {
+    char *buffer;
+    if (!SourceLineResolverBase::ReadSymbolFile(symbol_file, &buffer, size))
+      return false;
+    buffers_[code_file] = buffer;
+    sizes_[code_file] = *size;
+    return true;
+  }
+
+  virtual SymbolResult GetSymbolFile(const CodeModule *module,
+                                     const SystemInfo *system_info,
+                                     string *symbol_file) {
+    return NOT_FOUND;
+  }
+  virtual SymbolResult GetSymbolFile(const CodeModule *module,
+                                     const SystemInfo *system_info,
+                                     string *symbol_file,
+                                     string *symbol_data) {
+    return NOT_FOUND;
+  }
+  virtual SymbolResult GetCStringSymbolData(const CodeModule *module,
+                                            const SystemInfo *system_info,
+                                            string *symbol_file,
+                                            char **symbol_data,
+                                            size_t *symbol_data_size) {
+    std::map<string, char*>::iterator it = buffers_.find(module->code_file());
+    if (it == buffers_.end())
+      return NOT_FOUND;
+    *symbol_data = it->second;
+    *symbol_data_size = sizes_[module->code_file()];
+    return FOUND;
+  }
+  virtual void FreeSymbolData(const CodeModule *module) {
+    std::map<string, char*>::iterator it = buffers_.find(module->code_file());
+    if (it != buffers_.end()) {
+      delete [] it->second;
+      buffers_.erase(it);
+    }
+    freed.push_back(module->code_file());
+  }
+
+  std::vector<string> freed;
+
+ private:
+  std::map<string, char*> buffers_;
+  std::map<string, size_t> sizes_;
+};
+
 class TestFastSourceLineResolver : public ::testing::Test {
  public:
   void SetUp() {
@@ -463,6 +530,140 @@ TEST_F(TestFastSourceLineResolver, TestUnload) {
   ASSERT_TRUE(fast_resolver.HasModule(&module1));
 }
 
+TEST_F(TestFastSourceLineResolver, TestLoadSerializedFile) {
+  AutoTempDir temp_dir;
+  string fast_file = temp_dir.path() + "/module1.fast";
+  ASSERT_TRUE(serializer.ConvertSymbolFile(symbol_file(1), fast_file));
+
+  TestCodeModule module1("module1");
+  ASSERT_TRUE(fast_resolver.LoadModule(&module1, fast_file));
+  ASSERT_TRUE(fast_resolver.HasModule(&module1));
+  ASSERT_FALSE(fast_resolver.IsModuleCorrupt(&module1));
+  ASSERT_FALSE(fast_resolver.LoadModule(&module1, fast_file));
+
+  StackFrame frame;
+  frame.instruction = 0x1000;
+  frame.module = &module1;
+  fast_resolver.FillSourceLineInfo(&frame);
+  ASSERT_EQ(frame.function_name, "Function1_1");
+  ASSERT_EQ(frame.function_base, 0x1000U);
+  ASSERT_EQ(frame.source_file_name, "file1_1.cc");
+  ASSERT_EQ(frame.source_line, 44);
+  ASSERT_EQ(frame.source_line_base, 0x1000U);
+
+  // Data with a header can also be loaded from memory.
+  char *symbol_data;
+  size_t symbol_data_size;
+  ASSERT_TRUE(SourceLineResolverBase::ReadSymbolFile(
+      fast_file, &symbol_data, &symbol_data_size));
+  string symbol_data_string(symbol_data, symbol_data_size);
+  delete [] symbol_data;
+  TestCodeModule module1_copy("module1_copy");
+  ASSERT_TRUE(fast_resolver.LoadModuleUsingMapBuffer(&module1_copy,
+                                                     symbol_data_string));
+  ASSERT_TRUE(fast_resolver.HasModule(&module1_copy));
+
+  fast_resolver.UnloadModule(&module1);
+  ASSERT_FALSE(fast_resolver.HasModule(&module1));
+  ASSERT_TRUE(fast_resolver.LoadModule(&module1, fast_file));
+  ASSERT_TRUE(fast_resolver.HasModule(&module1));
+}
+
+TEST_F(TestFastSourceLineResolver, TestModuleCacheFreesSymbolData) {
+  AutoTempDir temp_dir;
+  string fast_file1 = temp_dir.path() + "/module1.fast";
+  string fast_file2 = temp_dir.path() + "/module2.fast";
+  ASSERT_TRUE(serializer.ConvertSymbolFile(symbol_file(1), fast_file1));
+  ASSERT_TRUE(serializer.ConvertSymbolFile(symbol_file(2), fast_file2));
+
+  TestCodeModule module1("module1");
+  TestCodeModule module2("module2");
+  TestSymbolSupplier supplier;
+  fast_resolver.set_symbol_supplier(&supplier);
+
+  // The fast resolver keeps the supplier's buffer, but only counts the
+  // module's own size against the budget.
+  char *symbol_data;
+  size_t symbol_data_size;
+  string symbol_file;
+  ASSERT_TRUE(supplier.AddSymbolFile("module1", fast_file1,
+                                     &symbol_data_size));
+  ASSERT_EQ(SymbolSupplier::FOUND,
+            supplier.GetCStringSymbolData(&module1, NULL, &symbol_file,
+                                          &symbol_data, &symbol_data_size));
+  ASSERT_TRUE(fast_resolver.LoadModuleUsingMemoryBuffer(&module1,
+                                                        symbol_data,
+                                                        symbol_data_size));
+  ASSERT_GT(fast_resolver.module_cache_usage(), symbol_data_size);
+  ASSERT_TRUE(supplier.freed.empty());
+
+  // Evicting module1 hands its buffer back to the supplier.
+  size_t module1_size = fast_resolver.module_cache_usage();
+  ASSERT_TRUE(fast_resolver.LoadModule(&module2, fast_file2));
+  fast_resolver.set_module_cache_budget(fast_resolver.module_cache_usage() -
+                                        module1_size);
+  ASSERT_FALSE(fast_resolver.HasModule(&module1));
+  ASSERT_TRUE(fast_resolver.HasModule(&module2));
+  ASSERT_EQ(1U, supplier.freed.size());
+  ASSERT_EQ("module1", supplier.freed[0]);
+
+  // module2's data came from its file, not the supplier.
+  ASSERT_TRUE(supplier.AddSymbolFile("module1", fast_file1,
+                                     &symbol_data_size));
+  ASSERT_EQ(SymbolSupplier::FOUND,
+            supplier.GetCStringSymbolData(&module1, NULL, &symbol_file,
+                                          &symbol_data, &symbol_data_size));
+  ASSERT_TRUE(fast_resolver.LoadModuleUsingMemoryBuffer(&module1,
+                                                        symbol_data,
+                                                        symbol_data_size));
+  ASSERT_FALSE(fast_resolver.HasModule(&module2));
+  ASSERT_EQ(1U, supplier.freed.size());
+
+  // Explicit unloads leave the buffer to whoever loaded the module.
+  fast_resolver.UnloadModule(&module1);
+  ASSERT_EQ(1U, supplier.freed.size());
+}
+
+TEST_F(TestFastSourceLineResolver, TestInvalidSerializedFiles) {
+  AutoTempDir temp_dir;
+  string fast_file = temp_dir.path() + "/module1.fast";
+  ASSERT_TRUE(serializer.ConvertSymbolFile(symbol_file(1), fast_file));
+
+  char *symbol_data;
+  size_t symbol_data_size;
+  ASSERT_TRUE(SourceLineResolverBase::ReadSymbolFile(
+      fast_file, &symbol_data, &symbol_data_size));
+  // ReadSymbolFile appends a null terminator that isn't part of the file.
+  const string good_data(symbol_data, symbol_data_size - 1);
+  delete [] symbol_data;
+
+  TestCodeModule module1("module1");
+
+  // Flip a bit in the serialized data: the checksum no longer matches.
+  string bad_data = good_data;
+  bad_data[bad_data.size() - 2] ^= 1;
+  ASSERT_FALSE(fast_resolver.LoadModuleUsingMapBuffer(&module1, bad_data));
+  ASSERT_FALSE(fast_resolver.HasModule(&module1));
+
+  // Bump the format version in the header.
+  bad_data = good_data;
+  bad_data[8] += 1;
+  ASSERT_FALSE(fast_resolver.LoadModuleUsingMapBuffer(&module1, bad_data));
+  ASSERT_FALSE(fast_resolver.HasModule(&module1));
+
+  // Truncate the file.
+  bad_data = good_data.substr(0, good_data.size() / 2);
+  FILE *f = fopen(fast_file.c_str(), "wb");
+  ASSERT_TRUE(f);
+  ASSERT_EQ(bad_data.size(), fwrite(bad_data.data(), 1, bad_data.size(), f));
+  fclose(f);
+  ASSERT_FALSE(fast_resolver.LoadModule(&module1, fast_file));
+  ASSERT_FALSE(fast_resolver.HasModule(&module1));
+
+  ASSERT_TRUE(fast_resolver.LoadModuleUsingMapBuffer(&module1, good_data));
+  ASSERT_TRUE(fast_resolver.HasModule(&module1));
+}
+
 TEST_F(TestFastSourceLineResolver, CompareModule) {
   char *symbol_data;
   size_t symbol_data_size;
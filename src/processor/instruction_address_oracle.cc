@@ -0,0 +1,287 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// instruction_address_oracle.cc: Tells whether addresses found while
+// scanning a stack could be return addresses.
+//
+// See instruction_address_oracle.h for documentation.
+
+#include "processor/instruction_address_oracle.h"
+
+#include <algorithm>
+
+#include "google_breakpad/processor/code_module.h"
+#include "google_breakpad/processor/code_modules.h"
+#include "google_breakpad/processor/stack_frame.h"
+#include "google_breakpad/processor/stack_frame_symbolizer.h"
+#include "processor/logging.h"
+
+namespace google_breakpad {
+
+struct InstructionAddressOracle::ModuleRangeLess {
+  bool operator()(const ModuleRange &range, uint64_t address) const {
+    return range.base < address;
+  }
+  bool operator()(uint64_t address, const ModuleRange &range) const {
+    return address < range.base;
+  }
+  bool operator()(const ModuleRange &a, const ModuleRange &b) const {
+    return a.base < b.base;
+  }
+};
+
+namespace {
+
+struct FunctionBaseLess {
+  typedef SourceLineResolverInterface::FunctionTable::Function Function;
+  bool operator()(uint64_t address, const Function &function) const {
+    return address < function.base;
+  }
+};
+
+struct PublicSymbolAddressLess {
+  typedef SourceLineResolverInterface::FunctionTable::PublicSymbol
+      PublicSymbol;
+  bool operator()(uint64_t address, const PublicSymbol &symbol) const {
+    return address < symbol.address;
+  }
+};
+
+}  // namespace
+
+InstructionAddressOracle::InstructionAddressOracle(
+    const CodeModules *modules,
+    const SystemInfo *system_info,
+    StackFrameSymbolizer *frame_symbolizer)
+    : modules_(modules),
+      system_info_(system_info),
+      frame_symbolizer_(frame_symbolizer),
+      has_implementation_(frame_symbolizer->HasImplementation()),
+      use_module_ranges_(true),
+      lowest_address_(0),
+      highest_address_(0),
+      has_address_bounds_(false) {
+  unsigned int count = modules_ ? modules_->module_count() : 0;
+  module_ranges_.reserve(count);
+  for (unsigned int i = 0; i < count; ++i) {
+    const CodeModule *module = modules_->GetModuleAtSequence(i);
+    if (!module)
+      continue;
+    ModuleRange range;
+    range.base = module->base_address();
+    range.size = module->size();
+    range.module = module;
+    range.state = kModuleUnknown;
+    module_ranges_.push_back(range);
+  }
+  std::sort(module_ranges_.begin(), module_ranges_.end(), ModuleRangeLess());
+
+  for (size_t i = 0; i < module_ranges_.size(); ++i) {
+    const ModuleRange &range = module_ranges_[i];
+    if (range.size == 0)
+      continue;
+    uint64_t last = range.base + range.size - 1;
+    if (last < range.base)
+      last = ~static_cast<uint64_t>(0);
+    if (!has_address_bounds_ || range.base < lowest_address_)
+      lowest_address_ = range.base;
+    if (!has_address_bounds_ || last > highest_address_)
+      highest_address_ = last;
+    has_address_bounds_ = true;
+  }
+
+  // The table must find the same module as modules_->GetModuleForAddress.
+  for (size_t i = 0; i < module_ranges_.size(); ++i) {
+    const ModuleRange &range = module_ranges_[i];
+    uint64_t last = range.base + range.size - 1;
+    if (range.size == 0 || last < range.base ||
+        (i + 1 < module_ranges_.size() &&
+         module_ranges_[i + 1].base <= last) ||
+        modules_->GetModuleForAddress(range.base) != range.module) {
+      BPLOG(INFO) << "Module ranges are inconsistent, checking return "
+                     "addresses with full symbol lookups";
+      use_module_ranges_ = false;
+      module_ranges_.clear();
+      break;
+    }
+  }
+}
+
+InstructionAddressOracle::~InstructionAddressOracle() {
+}
+
+bool InstructionAddressOracle::InstructionAddressSeemsValid(
+    uint64_t address) {
+  if (!use_module_ranges_)
+    return SymbolizedAddressSeemsValid(address);
+
+  ModuleRange *range = FindModuleRange(address);
+  if (!range) {
+    // not inside any loaded module
+    return false;
+  }
+
+  if (!has_implementation_) {
+    // No valid implementation to symbolize stack frame, but the address is
+    // within a known module.
+    return true;
+  }
+
+  int state = AtomicLoad(&range->state);
+  if (state == kModuleUnknown)
+    state = LoadModule(range);
+
+  switch (state) {
+    case kModuleWithTable:
+      return TableHasName(range->functions, address - range->base);
+    case kModuleWithoutTable:
+      return SymbolizedAddressSeemsValid(address);
+    default:
+      // The module has no symbols, or loading them was interrupted, but
+      // the address is within a known module.
+      return true;
+  }
+}
+
+bool InstructionAddressOracle::SymbolizedAddressSeemsValid(uint64_t address) {
+  StackFrame frame;
+  frame.instruction = address;
+  StackFrameSymbolizer::SymbolizerResult symbolizer_result =
+      frame_symbolizer_->FillSourceLineInfo(modules_, system_info_, &frame);
+
+  if (!frame.module) {
+    // not inside any loaded module
+    return false;
+  }
+
+  if (!frame_symbolizer_->HasImplementation()) {
+    // No valid implementation to symbolize stack frame, but the address is
+    // within a known module.
+    return true;
+  }
+
+  if (symbolizer_result != StackFrameSymbolizer::kNoError &&
+      symbolizer_result != StackFrameSymbolizer::kWarningCorruptSymbols) {
+    // Some error occurred during symbolization, but the address is within a
+    // known module
+    return true;
+  }
+
+  return !frame.function_name.empty();
+}
+
+bool InstructionAddressOracle::GetAddressBounds(uint64_t *lowest,
+                                                uint64_t *highest) const {
+  if (!has_address_bounds_)
+    return false;
+  *lowest = lowest_address_;
+  *highest = highest_address_;
+  return true;
+}
+
+InstructionAddressOracle::ModuleRange *
+InstructionAddressOracle::FindModuleRange(uint64_t address) {
+  std::vector<ModuleRange>::iterator range =
+      std::upper_bound(module_ranges_.begin(), module_ranges_.end(), address,
+                       ModuleRangeLess());
+  if (range == module_ranges_.begin())
+    return NULL;
+  --range;
+  if (address - range->base >= range->size)
+    return NULL;
+  return &*range;
+}
+
+int InstructionAddressOracle::LoadModule(ModuleRange *range) {
+  // Build the table without holding the lock, so that loading one
+  // module's symbols doesn't hold up threads scanning other modules.  If
+  // two threads race to build the same table, the first one to finish
+  // publishes it.
+  FunctionTable functions;
+  bool has_table = false;
+  StackFrameSymbolizer::SymbolizerResult result =
+      frame_symbolizer_->GetFunctionTable(range->module, system_info_,
+                                          &functions, &has_table);
+  int state;
+  if (result == StackFrameSymbolizer::kInterrupt) {
+    // Ask again next time, as FillSourceLineInfo would.
+    return kModuleUnknown;
+  } else if (result != StackFrameSymbolizer::kNoError &&
+             result != StackFrameSymbolizer::kWarningCorruptSymbols) {
+    state = kModuleWithoutSymbols;
+  } else if (has_table) {
+    state = kModuleWithTable;
+  } else {
+    state = kModuleWithoutTable;
+  }
+
+  mutex_.Acquire();
+  int current = AtomicLoad(&range->state);
+  if (current == kModuleUnknown) {
+    if (state == kModuleWithTable) {
+      range->functions.functions.swap(functions.functions);
+      range->functions.public_symbols.swap(functions.public_symbols);
+    }
+    AtomicStore(&range->state, state);
+    current = state;
+  }
+  mutex_.Release();
+  return current;
+}
+
+// static
+bool InstructionAddressOracle::TableHasName(const FunctionTable &table,
+                                            uint64_t address) {
+  // The function with the highest base at or below address.
+  std::vector<FunctionTable::Function>::const_iterator function =
+      std::upper_bound(table.functions.begin(), table.functions.end(),
+                       address, FunctionBaseLess());
+  bool has_function = function != table.functions.begin();
+  if (has_function) {
+    --function;
+    if (address - function->base < function->size)
+      return function->has_name;
+  }
+
+  // Failing that, the public symbol at or below address, if no function
+  // lies between the two.
+  std::vector<FunctionTable::PublicSymbol>::const_iterator symbol =
+      std::upper_bound(table.public_symbols.begin(),
+                       table.public_symbols.end(), address,
+                       PublicSymbolAddressLess());
+  if (symbol == table.public_symbols.begin())
+    return false;
+  --symbol;
+  if (has_function && symbol->address <= function->base)
+    return false;
+  return symbol->has_name;
+}
+
+}  // namespace google_breakpad
@@ -0,0 +1,157 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// instruction_address_oracle.h: Tells whether addresses found while
+// scanning a stack could be return addresses.
+//
+// When a stackwalker has no better way to find a frame's caller, it scans
+// the stack for a word that could be a return address: one that lies in
+// a module, and, if the module has symbols, in one of its functions.
+// Checking each candidate with StackFrameSymbolizer::FillSourceLineInfo
+// means a full symbol lookup for every word scanned.  An
+// InstructionAddressOracle gives the same answers from two tables: a
+// flat, sorted table of the modules' address ranges, built once, and for
+// each module that has symbols, a sorted table of its functions and
+// public symbols, obtained from the resolver the first time an address in
+// the module is checked.  A candidate then costs a binary search in each.
+//
+// Modules whose resolver can't list their functions are checked with
+// FillSourceLineInfo, as are all addresses when the modules' ranges don't
+// make a consistent table.
+//
+// One oracle serves all the stacks of a minidump, and it may be used by
+// several threads at once if its StackFrameSymbolizer is thread-safe.
+
+#ifndef PROCESSOR_INSTRUCTION_ADDRESS_ORACLE_H__
+#define PROCESSOR_INSTRUCTION_ADDRESS_ORACLE_H__
+
+#include <vector>
+
+#include "google_breakpad/common/breakpad_types.h"
+#include "google_breakpad/processor/source_line_resolver_interface.h"
+#include "processor/thread_primitives.h"
+
+namespace google_breakpad {
+
+class CodeModule;
+class CodeModules;
+class StackFrameSymbolizer;
+struct SystemInfo;
+
+class InstructionAddressOracle {
+ public:
+  // |modules| may be NULL, in which case no address seems valid.  Does
+  // not take ownership of its arguments, which must outlive the oracle.
+  InstructionAddressOracle(const CodeModules *modules,
+                           const SystemInfo *system_info,
+                           StackFrameSymbolizer *frame_symbolizer);
+  ~InstructionAddressOracle();
+
+  // Returns true if |address| could be a return address; see
+  // Stackwalker::InstructionAddressSeemsValid.  Loads the symbols for the
+  // address's module if they aren't loaded yet.
+  bool InstructionAddressSeemsValid(uint64_t address);
+
+  // Returns the answer FillSourceLineInfo gives, without using the
+  // tables.
+  bool SymbolizedAddressSeemsValid(uint64_t address);
+
+  // Sets |lowest| and |highest| to the lowest and highest addresses in
+  // any module, and returns true.  No address outside them seems valid.
+  // Returns false if there are no modules, so that no address does.
+  bool GetAddressBounds(uint64_t *lowest, uint64_t *highest) const;
+
+ private:
+  typedef SourceLineResolverInterface::FunctionTable FunctionTable;
+
+  // What is known about a module's functions.
+  enum ModuleState {
+    // Its symbols haven't been looked for yet, or loading them was
+    // interrupted.
+    kModuleUnknown,
+    // It has no symbols, so every address in it seems valid.
+    kModuleWithoutSymbols,
+    // Its function table is in |functions|.
+    kModuleWithTable,
+    // Its resolver can't list its functions.
+    kModuleWithoutTable
+  };
+
+  struct ModuleRange {
+    uint64_t base;
+    uint64_t size;
+    const CodeModule *module;
+    // A ModuleState, read and written atomically once the oracle is in
+    // use.  |functions| doesn't change once this is kModuleWithTable.
+    int state;
+    FunctionTable functions;
+  };
+
+  // Orders module ranges by base address.
+  struct ModuleRangeLess;
+
+  // Returns the range containing |address|, or NULL.
+  ModuleRange *FindModuleRange(uint64_t address);
+
+  // Obtains the symbols and function table for |range|, returning its new
+  // state.
+  int LoadModule(ModuleRange *range);
+
+  // Returns true if the resolver would find a function name for the
+  // module-relative |address| in |table|.
+  static bool TableHasName(const FunctionTable &table, uint64_t address);
+
+  const CodeModules *modules_;
+  const SystemInfo *system_info_;
+  StackFrameSymbolizer *frame_symbolizer_;
+  bool has_implementation_;
+
+  // The modules, sorted by base address.  If their ranges overlap,
+  // use_module_ranges_ is false, and every address is checked with
+  // SymbolizedAddressSeemsValid instead.
+  std::vector<ModuleRange> module_ranges_;
+  bool use_module_ranges_;
+
+  // The bounds returned by GetAddressBounds, and whether there are any.
+  uint64_t lowest_address_;
+  uint64_t highest_address_;
+  bool has_address_bounds_;
+
+  // Guards publishing module states.
+  Mutex mutex_;
+
+  // Disallow copy constructor and assignment operator.
+  InstructionAddressOracle(const InstructionAddressOracle&);
+  void operator=(const InstructionAddressOracle&);
+};
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_INSTRUCTION_ADDRESS_ORACLE_H__
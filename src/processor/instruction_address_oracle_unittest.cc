@@ -0,0 +1,209 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// instruction_address_oracle_unittest.cc: Unit tests for
+// InstructionAddressOracle.  Each answer is checked against a full symbol
+// lookup, the way Stackwalker::InstructionAddressSeemsValid used to check
+// every address.
+
+#include <string>
+
+#include "breakpad_googletest_includes.h"
+#include "common/using_std_string.h"
+#include "google_breakpad/processor/basic_source_line_resolver.h"
+#include "google_breakpad/processor/stack_frame.h"
+#include "google_breakpad/processor/stack_frame_symbolizer.h"
+#include "google_breakpad/processor/system_info.h"
+#include "processor/instruction_address_oracle.h"
+#include "processor/stackwalker_unittest_utils.h"
+
+namespace {
+
+using google_breakpad::BasicSourceLineResolver;
+using google_breakpad::InstructionAddressOracle;
+using google_breakpad::StackFrame;
+using google_breakpad::StackFrameSymbolizer;
+using google_breakpad::SystemInfo;
+using testing::_;
+using testing::AnyNumber;
+using testing::DoAll;
+using testing::Return;
+using testing::SetArgumentPointee;
+
+// Functions with gaps between them, and public symbols below them, in
+// the gaps, within functions, and above them.
+const char kSymbols[] =
+    "MODULE Linux x86 000102030405060708090a0b0c0d0e0f0 module1\n"
+    "FILE 1 file.cc\n"
+    "FUNC 1000 100 0 first_function\n"
+    "1000 100 10 1\n"
+    "FUNC 1200 100 0 second_function\n"
+    "FUNC 1300 80 0 adjacent_function\n"
+    "FUNC 2000 40 0 third_function\n"
+    "FUNC 3000 20 0 last_function\n"
+    "PUBLIC 800 0 public_below_functions\n"
+    "PUBLIC 1100 0 public_in_gap\n"
+    "PUBLIC 1240 0 public_in_function\n"
+    "PUBLIC 2040 0 public_after_function\n"
+    "PUBLIC 2080 0 public_in_gap_2\n"
+    "PUBLIC 3800 0 public_above_functions\n";
+
+// The answer Stackwalker::InstructionAddressSeemsValid gave before it
+// used an oracle.
+bool SymbolizedAddressSeemsValid(StackFrameSymbolizer *frame_symbolizer,
+                                 const MockCodeModules *modules,
+                                 const SystemInfo *system_info,
+                                 uint64_t address) {
+  StackFrame frame;
+  frame.instruction = address;
+  StackFrameSymbolizer::SymbolizerResult result =
+      frame_symbolizer->FillSourceLineInfo(modules, system_info, &frame);
+  if (!frame.module)
+    return false;
+  if (!frame_symbolizer->HasImplementation())
+    return true;
+  if (result != StackFrameSymbolizer::kNoError &&
+      result != StackFrameSymbolizer::kWarningCorruptSymbols)
+    return true;
+  return !frame.function_name.empty();
+}
+
+class InstructionAddressOracleTest : public testing::Test {
+ public:
+  InstructionAddressOracleTest()
+      : module1(0x10000, 0x8000, "module1", "version1"),
+        module2(0x20000, 0x1000, "module2", "version2"),
+        module3(0x28000, 0x1000, "module3", "version3") {
+    system_info.os = "Linux";
+    system_info.os_short = "linux";
+    system_info.cpu = "x86";
+
+    // Only module1 has symbols.
+    EXPECT_CALL(supplier, GetCStringSymbolData(_, _, _, _, _))
+      .WillRepeatedly(Return(MockSymbolSupplier::NOT_FOUND));
+    EXPECT_CALL(supplier, FreeSymbolData(_)).Times(AnyNumber());
+    size_t buffer_size;
+    char *buffer = supplier.CopySymbolDataAndOwnTheCopy(kSymbols,
+                                                        &buffer_size);
+    EXPECT_CALL(supplier, GetCStringSymbolData(&module1, _, _, _, _))
+      .WillRepeatedly(DoAll(SetArgumentPointee<3>(buffer),
+                            SetArgumentPointee<4>(buffer_size),
+                            Return(MockSymbolSupplier::FOUND)));
+  }
+
+  // Checks every address from |start| up to |end| with the oracle and
+  // with a full lookup, returning the number of valid addresses.
+  int CheckAddresses(InstructionAddressOracle *oracle,
+                     StackFrameSymbolizer *frame_symbolizer,
+                     uint64_t start, uint64_t end) {
+    int valid = 0;
+    for (uint64_t address = start; address < end; ++address) {
+      bool expected = SymbolizedAddressSeemsValid(frame_symbolizer, &modules,
+                                                  &system_info, address);
+      EXPECT_EQ(expected, oracle->InstructionAddressSeemsValid(address))
+          << "address 0x" << std::hex << address;
+      if (expected)
+        ++valid;
+    }
+    return valid;
+  }
+
+  SystemInfo system_info;
+  MockCodeModule module1;
+  MockCodeModule module2;
+  MockCodeModule module3;
+  MockCodeModules modules;
+  MockSymbolSupplier supplier;
+  BasicSourceLineResolver resolver;
+};
+
+TEST_F(InstructionAddressOracleTest, MatchesSymbolLookups) {
+  // Add the modules out of order; the oracle sorts them.
+  modules.Add(&module2);
+  modules.Add(&module1);
+  modules.Add(&module3);
+  StackFrameSymbolizer frame_symbolizer(&supplier, &resolver);
+  InstructionAddressOracle oracle(&modules, &system_info, &frame_symbolizer);
+
+  // Ask the oracle first, so that it is the one that loads the symbols.
+  EXPECT_TRUE(oracle.InstructionAddressSeemsValid(0x11000));
+  EXPECT_TRUE(resolver.HasModule(&module1));
+  EXPECT_FALSE(oracle.InstructionAddressSeemsValid(0x10000));
+  EXPECT_TRUE(oracle.InstructionAddressSeemsValid(0x11100));
+  EXPECT_TRUE(oracle.InstructionAddressSeemsValid(0x11250));
+  // Above adjacent_function, whose base is above public_in_function.
+  EXPECT_FALSE(oracle.InstructionAddressSeemsValid(0x11800));
+  EXPECT_TRUE(oracle.InstructionAddressSeemsValid(0x12050));
+  EXPECT_TRUE(oracle.InstructionAddressSeemsValid(0x13900));
+
+  EXPECT_LT(0, CheckAddresses(&oracle, &frame_symbolizer, 0xf000, 0x14000));
+  // The ends of module1, and the modules without symbols around the gap
+  // between them.
+  CheckAddresses(&oracle, &frame_symbolizer, 0x17f00, 0x18100);
+  EXPECT_EQ(0x2000,
+            CheckAddresses(&oracle, &frame_symbolizer, 0x1ff00, 0x29100));
+  EXPECT_FALSE(oracle.InstructionAddressSeemsValid(0));
+  EXPECT_FALSE(oracle.InstructionAddressSeemsValid(~0ULL));
+}
+
+TEST_F(InstructionAddressOracleTest, WithoutImplementation) {
+  modules.Add(&module1);
+  modules.Add(&module2);
+  StackFrameSymbolizer frame_symbolizer(NULL, NULL);
+  InstructionAddressOracle oracle(&modules, &system_info, &frame_symbolizer);
+  EXPECT_EQ(0x1000, CheckAddresses(&oracle, &frame_symbolizer,
+                                   0x1ff00, 0x21100));
+  EXPECT_TRUE(oracle.InstructionAddressSeemsValid(0x10000));
+  EXPECT_FALSE(oracle.InstructionAddressSeemsValid(0x18000));
+}
+
+TEST_F(InstructionAddressOracleTest, WithoutModules) {
+  StackFrameSymbolizer frame_symbolizer(&supplier, &resolver);
+  InstructionAddressOracle empty_oracle(&modules, &system_info,
+                                        &frame_symbolizer);
+  EXPECT_FALSE(empty_oracle.InstructionAddressSeemsValid(0x11000));
+  InstructionAddressOracle null_oracle(NULL, &system_info,
+                                       &frame_symbolizer);
+  EXPECT_FALSE(null_oracle.InstructionAddressSeemsValid(0x11000));
+}
+
+// Overlapping modules can't be put in the oracle's table, so it falls
+// back to full lookups, which find whichever module the CodeModules do.
+TEST_F(InstructionAddressOracleTest, OverlappingModules) {
+  MockCodeModule overlapping(0x17000, 0x2000, "overlapping", "version");
+  modules.Add(&module1);
+  modules.Add(&overlapping);
+  StackFrameSymbolizer frame_symbolizer(&supplier, &resolver);
+  InstructionAddressOracle oracle(&modules, &system_info, &frame_symbolizer);
+  CheckAddresses(&oracle, &frame_symbolizer, 0x10f00, 0x11400);
+  CheckAddresses(&oracle, &frame_symbolizer, 0x17f00, 0x19100);
+}
+
+}  // namespace
@@ -0,0 +1,201 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// interned_string_table.cc: A table of shared, reference-counted strings.
+//
+// See interned_string_table.h for documentation.
+
+#include "processor/interned_string_table.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace google_breakpad {
+
+static const size_t kInitialSlots = 256;
+
+InternedStringTable::InternedStringTable()
+    : slots_(kInitialSlots),
+      string_count_(0),
+      reference_count_(0),
+      string_bytes_(0),
+      referenced_bytes_(0) {
+}
+
+InternedStringTable::~InternedStringTable() {
+  // Leave the strings that are still referenced to their references.
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    if (slots_[i])
+      slots_[i]->table = NULL;
+  }
+}
+
+// static
+uint32_t InternedStringTable::Hash(const char *text, size_t length) {
+  // 32-bit FNV-1a.
+  uint32_t hash = 2166136261U;
+  for (size_t i = 0; i < length; ++i) {
+    hash ^= static_cast<unsigned char>(text[i]);
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+size_t InternedStringTable::FindSlot(const char *text, size_t length,
+                                     uint32_t hash) const {
+  size_t mask = slots_.size() - 1;
+  for (size_t slot = hash & mask; ; slot = (slot + 1) & mask) {
+    const Entry *entry = slots_[slot];
+    if (!entry ||
+        (entry->hash == hash && entry->length == length &&
+         memcmp(entry->text, text, length) == 0)) {
+      return slot;
+    }
+  }
+}
+
+void InternedStringTable::Grow() {
+  std::vector<Entry*> old_slots(slots_.size() * 2);
+  old_slots.swap(slots_);
+  size_t mask = slots_.size() - 1;
+  for (size_t i = 0; i < old_slots.size(); ++i) {
+    Entry *entry = old_slots[i];
+    if (!entry)
+      continue;
+    size_t slot = entry->hash & mask;
+    while (slots_[slot])
+      slot = (slot + 1) & mask;
+    slots_[slot] = entry;
+  }
+}
+
+InternedString InternedStringTable::Intern(const char *text, size_t length) {
+  uint32_t hash = Hash(text, length);
+  size_t slot = FindSlot(text, length, hash);
+  Entry *entry = slots_[slot];
+  if (!entry) {
+    entry = static_cast<Entry*>(malloc(offsetof(Entry, text) + length + 1));
+    if (!entry)
+      return InternedString();
+    entry->table = this;
+    entry->references = 0;
+    entry->hash = hash;
+    entry->length = static_cast<uint32_t>(length);
+    memcpy(entry->text, text, length);
+    entry->text[length] = '\0';
+    slots_[slot] = entry;
+    ++string_count_;
+    string_bytes_ += length;
+    if (string_count_ * 2 > slots_.size())
+      Grow();
+  }
+  return InternedString(entry);
+}
+
+InternedString InternedStringTable::Intern(const string &text) {
+  return Intern(text.data(), text.size());
+}
+
+void InternedStringTable::AddReference(Entry *entry) {
+  ++reference_count_;
+  referenced_bytes_ += entry->length;
+}
+
+void InternedStringTable::RemoveReference(Entry *entry) {
+  --reference_count_;
+  referenced_bytes_ -= entry->length;
+  if (entry->references == 0)
+    Remove(entry);
+}
+
+void InternedStringTable::Remove(Entry *entry) {
+  size_t mask = slots_.size() - 1;
+  size_t slot = entry->hash & mask;
+  while (slots_[slot] != entry)
+    slot = (slot + 1) & mask;
+
+  // Move back any entries that were placed after the removed one because
+  // their own slots were taken, so that lookups don't stop at the hole.
+  size_t hole = slot;
+  for (slot = (slot + 1) & mask; slots_[slot]; slot = (slot + 1) & mask) {
+    size_t home = slots_[slot]->hash & mask;
+    // Keep the entry where it is if its home slot lies cyclically in
+    // (hole, slot].
+    bool keep = hole <= slot ? (hole < home && home <= slot)
+                             : (hole < home || home <= slot);
+    if (!keep) {
+      slots_[hole] = slots_[slot];
+      hole = slot;
+    }
+  }
+  slots_[hole] = NULL;
+
+  --string_count_;
+  string_bytes_ -= entry->length;
+}
+
+InternedString::InternedString(InternedStringTable::Entry *entry)
+    : entry_(entry) {
+  ++entry_->references;
+  if (entry_->table)
+    entry_->table->AddReference(entry_);
+}
+
+InternedString::InternedString(const InternedString &that)
+    : entry_(that.entry_) {
+  if (entry_) {
+    ++entry_->references;
+    if (entry_->table)
+      entry_->table->AddReference(entry_);
+  }
+}
+
+InternedString &InternedString::operator=(const InternedString &that) {
+  // Copy first, in case |that| holds the last reference to the string
+  // this one refers to.
+  InternedString copy(that);
+  InternedStringTable::Entry *entry = entry_;
+  entry_ = copy.entry_;
+  copy.entry_ = entry;
+  return *this;
+}
+
+InternedString::~InternedString() {
+  if (!entry_)
+    return;
+  assert(entry_->references > 0);
+  --entry_->references;
+  if (entry_->table)
+    entry_->table->RemoveReference(entry_);
+  if (entry_->references == 0)
+    free(entry_);
+}
+
+}  // namespace google_breakpad
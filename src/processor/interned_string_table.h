@@ -0,0 +1,165 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// interned_string_table.h: A table of shared, reference-counted strings.
+//
+// BasicSourceLineResolver stores the name of every function, public
+// symbol and source file in the symbol files it loads.  When several
+// versions of the same library are loaded, most of those names are the
+// same in each.  An InternedStringTable keeps a single copy of each
+// distinct string, and hands out InternedString references to it.  The
+// copy is freed when its last reference is destroyed.
+//
+// Neither class is thread-safe.
+
+#ifndef PROCESSOR_INTERNED_STRING_TABLE_H__
+#define PROCESSOR_INTERNED_STRING_TABLE_H__
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "common/using_std_string.h"
+#include "google_breakpad/common/breakpad_types.h"
+
+namespace google_breakpad {
+
+class InternedString;
+
+class InternedStringTable {
+ public:
+  InternedStringTable();
+
+  // Strings that are still referenced when the table is destroyed stay
+  // valid; each is freed along with its last reference.
+  ~InternedStringTable();
+
+  // Returns a reference to the table's copy of the |length| bytes at
+  // |text|, adding a copy if there isn't one yet.  Returns a null
+  // InternedString if there is no memory for the copy.
+  InternedString Intern(const char *text, size_t length);
+  InternedString Intern(const string &text);
+
+  // The number of distinct strings in the table, and the number of
+  // InternedString references to them.
+  uint64_t string_count() const { return string_count_; }
+  uint64_t reference_count() const { return reference_count_; }
+
+  // The total length of the distinct strings, and the total length of
+  // the strings referred to, counting each reference separately.  The
+  // second divided by the first is how much memory sharing saves.
+  uint64_t string_bytes() const { return string_bytes_; }
+  uint64_t referenced_bytes() const { return referenced_bytes_; }
+
+ private:
+  friend class InternedString;
+
+  // Each string is allocated together with its header.
+  struct Entry {
+    // The table holding the string, or NULL once it has been destroyed.
+    InternedStringTable *table;
+    uint32_t references;
+    uint32_t hash;
+    uint32_t length;
+    char text[1];
+  };
+
+  static uint32_t Hash(const char *text, size_t length);
+
+  // Returns the index of the slot holding the string, or of the empty
+  // slot where it belongs.
+  size_t FindSlot(const char *text, size_t length, uint32_t hash) const;
+
+  // Doubles the number of slots.
+  void Grow();
+
+  // Called when |entry| gains or loses a reference.
+  void AddReference(Entry *entry);
+  void RemoveReference(Entry *entry);
+
+  // Removes |entry|, which has no references left, from the table.
+  void Remove(Entry *entry);
+
+  // An open-addressing hash table with linear probing.  The number of
+  // slots is a power of two, and at most half of them are used.
+  std::vector<Entry*> slots_;
+
+  uint64_t string_count_;
+  uint64_t reference_count_;
+  uint64_t string_bytes_;
+  uint64_t referenced_bytes_;
+
+  // Disallow copy constructor and assignment operator.
+  InternedStringTable(const InternedStringTable&);
+  void operator=(const InternedStringTable&);
+};
+
+// A reference to a string in an InternedStringTable.  It takes the space
+// of a single pointer.  Copying it adds a reference to the same string.
+class InternedString {
+ public:
+  InternedString() : entry_(NULL) { }
+  InternedString(const InternedString &that);
+  InternedString &operator=(const InternedString &that);
+  ~InternedString();
+
+  // True for an InternedString that doesn't refer to a string in a table,
+  // because it was default-constructed or InternedStringTable::Intern
+  // failed.
+  bool is_null() const { return entry_ == NULL; }
+
+  // The string, which is null-terminated.  A null InternedString is
+  // empty.
+  const char *c_str() const { return entry_ ? entry_->text : ""; }
+  size_t size() const { return entry_ ? entry_->length : 0; }
+  bool empty() const { return size() == 0; }
+  string str() const { return string(c_str(), size()); }
+
+  // Two InternedStrings from the same table are equal exactly when they
+  // refer to the same copy.
+  bool operator==(const InternedString &that) const {
+    return entry_ == that.entry_;
+  }
+  bool operator!=(const InternedString &that) const {
+    return entry_ != that.entry_;
+  }
+
+ private:
+  friend class InternedStringTable;
+
+  // Takes a new reference to |entry|.
+  explicit InternedString(InternedStringTable::Entry *entry);
+
+  InternedStringTable::Entry *entry_;
+};
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_INTERNED_STRING_TABLE_H__
@@ -0,0 +1,174 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// interned_string_table_unittest.cc: Unit tests for InternedStringTable.
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "breakpad_googletest_includes.h"
+#include "common/scoped_ptr.h"
+#include "common/using_std_string.h"
+#include "processor/interned_string_table.h"
+
+namespace {
+
+using google_breakpad::InternedString;
+using google_breakpad::InternedStringTable;
+using google_breakpad::scoped_ptr;
+
+TEST(InternedStringTableTest, Empty) {
+  InternedString empty;
+  EXPECT_STREQ("", empty.c_str());
+  EXPECT_EQ(0U, empty.size());
+  EXPECT_TRUE(empty.empty());
+  EXPECT_TRUE(empty.is_null());
+
+  InternedStringTable table;
+  EXPECT_EQ(0U, table.string_count());
+  EXPECT_EQ(0U, table.reference_count());
+
+  InternedString interned = table.Intern("", 0);
+  EXPECT_TRUE(interned.empty());
+  EXPECT_FALSE(interned.is_null());
+  EXPECT_EQ(1U, table.string_count());
+}
+
+TEST(InternedStringTableTest, SharesEqualStrings) {
+  InternedStringTable table;
+  InternedString a = table.Intern("function");
+  InternedString b = table.Intern(string("function"));
+  InternedString c = table.Intern("function(int)", 8);
+  InternedString d = table.Intern("file.cc");
+
+  EXPECT_EQ("function", a.str());
+  EXPECT_EQ("file.cc", d.str());
+  EXPECT_TRUE(a == b);
+  EXPECT_TRUE(a == c);
+  EXPECT_TRUE(a != d);
+  EXPECT_EQ(a.c_str(), b.c_str());
+
+  EXPECT_EQ(2U, table.string_count());
+  EXPECT_EQ(4U, table.reference_count());
+  EXPECT_EQ(15U, table.string_bytes());
+  EXPECT_EQ(31U, table.referenced_bytes());
+}
+
+TEST(InternedStringTableTest, StringsWithNulls) {
+  InternedStringTable table;
+  InternedString a = table.Intern(string("a\0b", 3));
+  InternedString b = table.Intern(string("a\0c", 3));
+  EXPECT_TRUE(a != b);
+  EXPECT_EQ(3U, a.size());
+  EXPECT_EQ(string("a\0b", 3), a.str());
+}
+
+TEST(InternedStringTableTest, ReferenceCounting) {
+  InternedStringTable table;
+  {
+    InternedString a = table.Intern("name");
+    {
+      InternedString copy(a);
+      InternedString assigned;
+      assigned = a;
+      EXPECT_EQ(3U, table.reference_count());
+      EXPECT_EQ(1U, table.string_count());
+
+      // Assigning a string to itself keeps the reference.
+      assigned = assigned;
+      EXPECT_EQ(3U, table.reference_count());
+      EXPECT_EQ("name", assigned.str());
+    }
+    EXPECT_EQ(1U, table.reference_count());
+
+    // Reassigning drops the reference to the old string, freeing it when
+    // it was the last.
+    a = table.Intern("other");
+    EXPECT_EQ(1U, table.reference_count());
+    EXPECT_EQ(1U, table.string_count());
+    EXPECT_EQ(5U, table.string_bytes());
+  }
+  EXPECT_EQ(0U, table.reference_count());
+  EXPECT_EQ(0U, table.string_count());
+  EXPECT_EQ(0U, table.string_bytes());
+  EXPECT_EQ(0U, table.referenced_bytes());
+
+  // A freed string can be added again.
+  InternedString again = table.Intern("name");
+  EXPECT_EQ("name", again.str());
+  EXPECT_EQ(1U, table.string_count());
+}
+
+TEST(InternedStringTableTest, OutlivesTable) {
+  scoped_ptr<InternedStringTable> table(new InternedStringTable);
+  InternedString a = table->Intern("survivor");
+  InternedString b = a;
+  table.reset();
+  EXPECT_EQ("survivor", a.str());
+  InternedString c = b;
+  EXPECT_TRUE(a == c);
+}
+
+// Add and remove enough strings to make the table grow several times,
+// and to move entries around as others are removed.
+TEST(InternedStringTableTest, ManyStrings) {
+  const int kStrings = 20000;
+  InternedStringTable table;
+  std::vector<InternedString> strings;
+  for (int i = 0; i < kStrings; ++i) {
+    char name[32];
+    snprintf(name, sizeof(name), "string%d", i);
+    strings.push_back(table.Intern(name));
+  }
+  EXPECT_EQ(static_cast<uint64_t>(kStrings), table.string_count());
+
+  // Drop every third string.
+  for (int i = 0; i < kStrings; i += 3)
+    strings[i] = InternedString();
+
+  for (int i = 0; i < kStrings; ++i) {
+    char name[32];
+    snprintf(name, sizeof(name), "string%d", i);
+    InternedString interned = table.Intern(name);
+    EXPECT_EQ(name, interned.str());
+    if (i % 3 != 0) {
+      EXPECT_TRUE(interned == strings[i]) << name;
+    }
+  }
+  EXPECT_EQ(static_cast<uint64_t>(kStrings - (kStrings + 2) / 3),
+            table.string_count());
+
+  strings.clear();
+  EXPECT_EQ(0U, table.string_count());
+  EXPECT_EQ(0U, table.reference_count());
+}
+
+}  // namespace
@@ -118,12 +118,15 @@ char *StdMapSerializer<Key, Value>::Serialize(
 template<typename Address, typename Entry>
 size_t RangeMapSerializer<Address, Entry>::SizeOf(
     const RangeMap<Address, Entry> &m) const {
+  typename RangeMap<Address, Entry>::AddressToRangeMap storage;
+  const std::map<Address, Range> &map = m.Ranges(&storage);
+
   size_t size = 0;
-  size_t header_size = (1 + m.map_.size()) * sizeof(uint32_t);
+  size_t header_size = (1 + map.size()) * sizeof(uint32_t);
   size += header_size;
 
   typename std::map<Address, Range>::const_iterator iter;
-  for (iter = m.map_.begin(); iter != m.map_.end(); ++iter) {
+  for (iter = map.begin(); iter != map.end(); ++iter) {
     // Size of key (high address).
     size += address_serializer_.SizeOf(iter->first);
     // Size of base (low address).
@@ -142,21 +145,23 @@ char *RangeMapSerializer<Address, Entry>::Write(
     return NULL;
   }
   char *start_address = dest;
+  typename RangeMap<Address, Entry>::AddressToRangeMap storage;
+  const std::map<Address, Range> &map = m.Ranges(&storage);
 
   // Write header:
   // Number of nodes.
-  dest = SimpleSerializer<uint32_t>::Write(m.map_.size(), dest);
+  dest = SimpleSerializer<uint32_t>::Write(map.size(), dest);
   // Nodes offsets.
   uint32_t *offsets = reinterpret_cast<uint32_t*>(dest);
-  dest += sizeof(uint32_t) * m.map_.size();
+  dest += sizeof(uint32_t) * map.size();
 
   char *key_address = dest;
-  dest += sizeof(Address) * m.map_.size();
+  dest += sizeof(Address) * map.size();
 
   // Traverse map.
   typename std::map<Address, Range>::const_iterator iter;
   int index = 0;
-  for (iter = m.map_.begin(); iter != m.map_.end(); ++iter, ++index) {
+  for (iter = map.begin(); iter != map.end(); ++iter, ++index) {
     offsets[index] = static_cast<uint32_t>(dest - start_address);
     key_address = address_serializer_.Write(iter->first, key_address);
     dest = address_serializer_.Write(iter->second.base(), dest);
@@ -196,10 +201,12 @@ size_t ContainedRangeMapSerializer<AddrType, EntryType>::SizeOf(
   size += header_size;
   // In case m.map_ == NULL, we treat it as an empty map:
   size += sizeof(uint32_t);
-  if (m->map_) {
-    size += m->map_->size() * sizeof(uint32_t);
+  Map storage;
+  const Map *map = m->Children(&storage);
+  if (map) {
+    size += map->size() * sizeof(uint32_t);
     typename Map::const_iterator iter;
-    for (iter = m->map_->begin(); iter != m->map_->end(); ++iter) {
+    for (iter = map->begin(); iter != map->end(); ++iter) {
       size += addr_serializer_.SizeOf(iter->first);
       // Recursive calculation of size:
       size += SizeOf(iter->second);
@@ -222,20 +229,22 @@ char *ContainedRangeMapSerializer<AddrType, EntryType>::Write(
 
   // Write map<<AddrType, ContainedRangeMap*>:
   char *map_address = dest;
-  if (m->map_ == NULL) {
+  Map storage;
+  const Map *map = m->Children(&storage);
+  if (map == NULL) {
     dest = SimpleSerializer<uint32_t>::Write(0, dest);
   } else {
-    dest = SimpleSerializer<uint32_t>::Write(m->map_->size(), dest);
+    dest = SimpleSerializer<uint32_t>::Write(map->size(), dest);
     uint32_t *offsets = reinterpret_cast<uint32_t*>(dest);
-    dest += sizeof(uint32_t) * m->map_->size();
+    dest += sizeof(uint32_t) * map->size();
 
     char *key_address = dest;
-    dest += sizeof(AddrType) * m->map_->size();
+    dest += sizeof(AddrType) * map->size();
 
     // Traverse map.
     typename Map::const_iterator iter;
     int index = 0;
-    for (iter = m->map_->begin(); iter != m->map_->end(); ++iter, ++index) {
+    for (iter = map->begin(); iter != map->end(); ++iter, ++index) {
       offsets[index] = static_cast<uint32_t>(dest - map_address);
       key_address = addr_serializer_.Write(iter->first, key_address);
       // Recursively write.
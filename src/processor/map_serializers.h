@@ -80,14 +80,16 @@ class AddressMapSerializer {
  public:
   // Calculate the memory size of serialized data.
   size_t SizeOf(const AddressMap<Addr, Entry> &m) const {
-    return std_map_serializer_.SizeOf(m.map_);
+    Map storage;
+    return std_map_serializer_.SizeOf(m.Entries(&storage));
   }
 
   // Write the serialized data to specified memory location.  Return the "end"
   // of data, i.e., return the address after the final byte of data.
   // NOTE: caller has to allocate enough memory before invoke Write() method.
   char* Write(const AddressMap<Addr, Entry> &m, char *dest) const {
-    return std_map_serializer_.Write(m.map_, dest);
+    Map storage;
+    return std_map_serializer_.Write(m.Entries(&storage), dest);
   }
 
   // Serializes an AddressMap object into a chunk of memory data.
@@ -95,10 +97,14 @@ class AddressMapSerializer {
   // to the size of serialized data, i.e., SizeOf(m).
   // Caller has the ownership of memory allocated as "new char[]".
   char* Serialize(const AddressMap<Addr, Entry> &m, unsigned int *size) const {
-    return std_map_serializer_.Serialize(m.map_, size);
+    Map storage;
+    return std_map_serializer_.Serialize(m.Entries(&storage), size);
   }
 
  private:
+  // The map type AddressMap::Entries returns.
+  typedef std::map<Addr, Entry> Map;
+
   // AddressMapSerializer is a simple wrapper of StdMapSerializer, just as
   // AddressMap is a simple wrapper of std::map.
   StdMapSerializer<Addr, Entry> std_map_serializer_;
@@ -44,7 +44,6 @@
 #include "google_breakpad/common/minidump_cpu_arm.h"
 #include "google_breakpad/processor/code_module.h"
 #include "processor/basic_code_module.h"
-#include "processor/linked_ptr.h"
 #include "processor/logging.h"
 #include "processor/range_map-inl.h"
 
@@ -85,11 +84,7 @@ namespace google_breakpad {
 //
 
 void MicrodumpModules::Add(const CodeModule* module) {
-  linked_ptr<const CodeModule> module_ptr(module);
-  if (!map_->StoreRange(module->base_address(), module->size(), module_ptr)) {
-    BPLOG(ERROR) << "Module " << module->code_file() <<
-                    " could not be stored";
-  }
+  StoreModule(module);
 }
 
 
@@ -146,6 +141,18 @@ bool MicrodumpMemoryRegion::GetMemoryAtAddress(uint64_t address,
   return GetMemoryLittleEndian(address, value);
 }
 
+const uint8_t* MicrodumpMemoryRegion::GetBytesAtAddress(
+    uint64_t address, uint64_t* available) const {
+  const uint16_t kOne = 1;
+  if (*reinterpret_cast<const uint8_t*>(&kOne) != 1 ||
+      address < base_address_ ||
+      address - base_address_ >= contents_.size()) {
+    return NULL;
+  }
+  *available = contents_.size() - (address - base_address_);
+  return &contents_[address - base_address_];
+}
+
 template<typename ValueType>
 bool MicrodumpMemoryRegion::GetMemoryLittleEndian(uint64_t address,
                                                   ValueType* value) const {
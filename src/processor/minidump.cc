@@ -36,6 +36,7 @@
 #include "google_breakpad/processor/minidump.h"
 
 #include <assert.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <stddef.h>
 #include <stdio.h>
@@ -43,11 +44,18 @@
 #include <time.h>
 
 #ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
 #include <io.h>
+#include <windows.h>
 #define PRIx64 "llx"
 #define PRIx32 "lx"
 #define snprintf _snprintf
 #else  // _WIN32
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #endif  // _WIN32
 
@@ -64,6 +72,7 @@
 #include "processor/basic_code_module.h"
 #include "processor/basic_code_modules.h"
 #include "processor/logging.h"
+#include "processor/thread_primitives.h"
 
 namespace google_breakpad {
 
@@ -73,6 +82,77 @@ using std::ifstream;
 using std::numeric_limits;
 using std::vector;
 
+// A recursive mutex.
+class MinidumpLock {
+ public:
+  MinidumpLock() {
+#ifdef _WIN32
+    InitializeCriticalSection(&section_);
+#else  // _WIN32
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&mutex_, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+#endif  // _WIN32
+  }
+
+  ~MinidumpLock() {
+#ifdef _WIN32
+    DeleteCriticalSection(&section_);
+#else  // _WIN32
+    pthread_mutex_destroy(&mutex_);
+#endif  // _WIN32
+  }
+
+  void Acquire() {
+#ifdef _WIN32
+    EnterCriticalSection(&section_);
+#else  // _WIN32
+    pthread_mutex_lock(&mutex_);
+#endif  // _WIN32
+  }
+
+  void Release() {
+#ifdef _WIN32
+    LeaveCriticalSection(&section_);
+#else  // _WIN32
+    pthread_mutex_unlock(&mutex_);
+#endif  // _WIN32
+  }
+
+ private:
+#ifdef _WIN32
+  CRITICAL_SECTION section_;
+#else  // _WIN32
+  pthread_mutex_t mutex_;
+#endif  // _WIN32
+
+  // Disallow copy constructor and assignment operator.
+  MinidumpLock(const MinidumpLock&);
+  void operator=(const MinidumpLock&);
+};
+
+// Holds a Minidump's lock while it is in scope.  Everything that reads a
+// minidump on first use holds it, since that reading uses the file
+// position shared by ReadBytes and SeekSet.
+class AutoMinidumpLock {
+ public:
+  explicit AutoMinidumpLock(Minidump* minidump) : minidump_(minidump) {
+    minidump_->lock_->Acquire();
+  }
+  ~AutoMinidumpLock() {
+    minidump_->lock_->Release();
+  }
+
+ private:
+  Minidump* minidump_;
+
+  // Disallow copy constructor and assignment operator.
+  AutoMinidumpLock(const AutoMinidumpLock&);
+  void operator=(const AutoMinidumpLock&);
+};
+
 // Returns true iff |context_size| matches exactly one of the sizes of the
 // various MDRawContext* types.
 // TODO(blundell): This function can be removed once
@@ -1191,6 +1271,7 @@ uint32_t MinidumpMemoryRegion::max_bytes_ = 1024 * 1024;  // 1MB
 MinidumpMemoryRegion::MinidumpMemoryRegion(Minidump* minidump)
     : MinidumpObject(minidump),
       descriptor_(NULL),
+      rva_(0),
       memory_(NULL) {
 }
 
@@ -1201,7 +1282,14 @@ MinidumpMemoryRegion::~MinidumpMemoryRegion() {
 
 
 void MinidumpMemoryRegion::SetDescriptor(MDMemoryDescriptor* descriptor) {
+  SetDescriptor(descriptor, descriptor ? descriptor->memory.rva : 0);
+}
+
+
+void MinidumpMemoryRegion::SetDescriptor(MDMemoryDescriptor* descriptor,
+                                         uint64_t rva) {
   descriptor_ = descriptor;
+  rva_ = rva;
   valid_ = descriptor &&
            descriptor_->memory.data_size <=
                numeric_limits<uint64_t>::max() -
@@ -1215,33 +1303,47 @@ const uint8_t* MinidumpMemoryRegion::GetMemory() const {
     return NULL;
   }
 
-  if (!memory_) {
-    if (descriptor_->memory.data_size == 0) {
-      BPLOG(ERROR) << "MinidumpMemoryRegion is empty";
-      return NULL;
-    }
+  vector<uint8_t>* memory = AtomicLoad(&memory_);
+  if (memory) {
+    return &(*memory)[0];
+  }
 
-    if (!minidump_->SeekSet(descriptor_->memory.rva)) {
-      BPLOG(ERROR) << "MinidumpMemoryRegion could not seek to memory region";
-      return NULL;
-    }
+  if (descriptor_->memory.data_size == 0) {
+    BPLOG(ERROR) << "MinidumpMemoryRegion is empty";
+    return NULL;
+  }
 
-    if (descriptor_->memory.data_size > max_bytes_) {
-      BPLOG(ERROR) << "MinidumpMemoryRegion size " <<
-                      descriptor_->memory.data_size << " exceeds maximum " <<
-                      max_bytes_;
-      return NULL;
+  if (descriptor_->memory.data_size > max_bytes_) {
+    BPLOG(ERROR) << "MinidumpMemoryRegion size " <<
+                    descriptor_->memory.data_size << " exceeds maximum " <<
+                    max_bytes_;
+    return NULL;
+  }
+
+  if (minidump_->is_mapped()) {
+    // Use the memory where it lies in the mapped file.
+    const uint8_t* mapped = minidump_->GetMappedBytes(
+        rva_, descriptor_->memory.data_size);
+    if (!mapped) {
+      BPLOG(ERROR) << "MinidumpMemoryRegion is outside the minidump file";
     }
+    return mapped;
+  }
 
-    scoped_ptr< vector<uint8_t> > memory(
+  // Another thread may be reading the same region.  Let it finish, and
+  // use its copy.
+  AutoMinidumpLock lock(minidump_);
+  if (!memory_) {
+    scoped_ptr< vector<uint8_t> > new_memory(
         new vector<uint8_t>(descriptor_->memory.data_size));
 
-    if (!minidump_->ReadBytes(&(*memory)[0], descriptor_->memory.data_size)) {
+    if (!minidump_->ReadBytesAt(rva_, &(*new_memory)[0],
+                                descriptor_->memory.data_size)) {
       BPLOG(ERROR) << "MinidumpMemoryRegion could not read memory region";
       return NULL;
     }
 
-    memory_ = memory.release();
+    AtomicStore(&memory_, new_memory.release());
   }
 
   return &(*memory_)[0];
@@ -1300,16 +1402,25 @@ bool MinidumpMemoryRegion::GetMemoryAtAddressInternal(uint64_t address,
     return false;
   }
 
-  const uint8_t* memory = GetMemory();
-  if (!memory) {
-    // GetMemory already logged a perfectly good message.
-    return false;
-  }
+  uint64_t offset = address - descriptor_->start_of_memory_range;
+  if (descriptor_->memory.data_size > max_bytes_ && !AtomicLoad(&memory_)) {
+    // The region is too large to cache, so read just this value.
+    if (!minidump_->ReadBytesAt(rva_ + offset, value, sizeof(T))) {
+      BPLOG(ERROR) << "MinidumpMemoryRegion could not read memory at " <<
+                      HexString(address);
+      return false;
+    }
+  } else {
+    const uint8_t* memory = GetMemory();
+    if (!memory) {
+      // GetMemory already logged a perfectly good message.
+      return false;
+    }
 
-  // If the CPU requires memory accesses to be aligned, this can crash.
-  // x86 and ppc are able to cope, though.
-  *value = *reinterpret_cast<const T*>(
-      &memory[address - descriptor_->start_of_memory_range]);
+    // If the CPU requires memory accesses to be aligned, this can crash.
+    // x86 and ppc are able to cope, though.
+    *value = *reinterpret_cast<const T*>(&memory[offset]);
+  }
 
   if (minidump_->swap())
     Swap(value);
@@ -1318,6 +1429,27 @@ bool MinidumpMemoryRegion::GetMemoryAtAddressInternal(uint64_t address,
 }
 
 
+const uint8_t* MinidumpMemoryRegion::GetBytesAtAddress(
+    uint64_t address, uint64_t* available) const {
+  if (!valid_ || minidump_->swap() ||
+      address < descriptor_->start_of_memory_range ||
+      address - descriptor_->start_of_memory_range >=
+          descriptor_->memory.data_size ||
+      (descriptor_->memory.data_size > max_bytes_ &&
+       !AtomicLoad(&memory_))) {
+    return NULL;
+  }
+
+  const uint8_t* memory = GetMemory();
+  if (!memory)
+    return NULL;
+
+  uint64_t offset = address - descriptor_->start_of_memory_range;
+  *available = descriptor_->memory.data_size - offset;
+  return memory + offset;
+}
+
+
 bool MinidumpMemoryRegion::GetMemoryAtAddress(uint64_t  address,
                                               uint8_t*  value) const {
   return GetMemoryAtAddressInternal(address, value);
@@ -1450,6 +1582,12 @@ MinidumpContext* MinidumpThread::GetContext() {
     return NULL;
   }
 
+  MinidumpContext* cached_context = AtomicLoad(&context_);
+  if (cached_context) {
+    return cached_context;
+  }
+
+  AutoMinidumpLock lock(minidump_);
   if (!context_) {
     if (!minidump_->SeekSet(thread_.thread_context.rva)) {
       BPLOG(ERROR) << "MinidumpThread cannot seek to context";
@@ -1463,7 +1601,7 @@ MinidumpContext* MinidumpThread::GetContext() {
       return NULL;
     }
 
-    context_ = context.release();
+    AtomicStore(&context_, context.release());
   }
 
   return context_;
@@ -2078,6 +2216,8 @@ const uint8_t* MinidumpModule::GetCVRecord(uint32_t* size) {
     return NULL;
   }
 
+  AutoMinidumpLock lock(minidump_);
+
   if (!cv_record_) {
     // This just guards against 0-sized CodeView records; more specific checks
     // are used when the signature is checked against various structure types.
@@ -2200,6 +2340,8 @@ const MDImageDebugMisc* MinidumpModule::GetMiscRecord(uint32_t* size) {
     return NULL;
   }
 
+  AutoMinidumpLock lock(minidump_);
+
   if (!misc_record_) {
     if (module_.misc_record.data_size == 0) {
       return NULL;
@@ -2881,6 +3023,238 @@ void MinidumpMemoryList::Print() {
 }
 
 
+//
+// MinidumpMemory64List
+//
+
+
+uint32_t MinidumpMemory64List::max_regions_ = 1024 * 1024;
+
+
+MinidumpMemory64List::MinidumpMemory64List(Minidump* minidump)
+    : MinidumpStream(minidump),
+      range_map_(new RangeMap<uint64_t, unsigned int>()),
+      descriptors_(NULL),
+      region_descriptors_(NULL),
+      regions_(NULL),
+      region_count_(0),
+      base_rva_(0) {
+}
+
+
+MinidumpMemory64List::~MinidumpMemory64List() {
+  delete range_map_;
+  delete descriptors_;
+  delete region_descriptors_;
+  delete regions_;
+}
+
+
+bool MinidumpMemory64List::Read(uint32_t expected_size) {
+  // Invalidate cached data.
+  delete descriptors_;
+  descriptors_ = NULL;
+  delete region_descriptors_;
+  region_descriptors_ = NULL;
+  delete regions_;
+  regions_ = NULL;
+  range_map_->Clear();
+  region_count_ = 0;
+  base_rva_ = 0;
+
+  valid_ = false;
+
+  if (expected_size < MDRawMemory64List_minsize) {
+    BPLOG(ERROR) << "MinidumpMemory64List header size mismatch, " <<
+                    expected_size << " < " << MDRawMemory64List_minsize;
+    return false;
+  }
+
+  uint64_t region_count;
+  uint64_t base_rva;
+  if (!minidump_->ReadBytes(&region_count, sizeof(region_count)) ||
+      !minidump_->ReadBytes(&base_rva, sizeof(base_rva))) {
+    BPLOG(ERROR) << "MinidumpMemory64List could not read header";
+    return false;
+  }
+
+  if (minidump_->swap()) {
+    Swap(&region_count);
+    Swap(&base_rva);
+  }
+
+  if (region_count > max_regions_) {
+    BPLOG(ERROR) << "MinidumpMemory64List count " << region_count <<
+                    " exceeds maximum " << max_regions_;
+    return false;
+  }
+
+  if (expected_size != MDRawMemory64List_minsize +
+                       region_count * sizeof(MDMemoryDescriptor64)) {
+    BPLOG(ERROR) << "MinidumpMemory64List size mismatch, " << expected_size <<
+                    " != " << MDRawMemory64List_minsize +
+                    region_count * sizeof(MDMemoryDescriptor64);
+    return false;
+  }
+
+  if (region_count != 0) {
+    scoped_ptr<MemoryDescriptors64> descriptors(
+        new MemoryDescriptors64(region_count));
+
+    if (!minidump_->ReadBytes(&(*descriptors)[0],
+                              sizeof(MDMemoryDescriptor64) * region_count)) {
+      BPLOG(ERROR) << "MinidumpMemory64List could not read memory region list";
+      return false;
+    }
+
+    scoped_ptr<MemoryDescriptors> region_descriptors(
+        new MemoryDescriptors(region_count));
+    scoped_ptr<MemoryRegions> regions(
+        new MemoryRegions(region_count, MinidumpMemoryRegion(minidump_)));
+
+    // The memory for each region follows that of the one before it.
+    uint64_t rva = base_rva;
+    for (unsigned int region_index = 0;
+         region_index < region_count;
+         ++region_index) {
+      MDMemoryDescriptor64* descriptor = &(*descriptors)[region_index];
+
+      if (minidump_->swap()) {
+        Swap(&descriptor->start_of_memory_range);
+        Swap(&descriptor->data_size);
+      }
+
+      uint64_t base_address = descriptor->start_of_memory_range;
+      uint64_t region_size = descriptor->data_size;
+
+      // Check for base + size overflow or undersize, and for memory that
+      // runs past the largest possible file offset.
+      if (region_size == 0 ||
+          region_size > numeric_limits<uint64_t>::max() - base_address ||
+          rva > static_cast<uint64_t>(numeric_limits<off_t>::max()) ||
+          region_size > static_cast<uint64_t>(numeric_limits<off_t>::max()) -
+                        rva) {
+        BPLOG(ERROR) << "MinidumpMemory64List has a memory region problem, " <<
+                        " region " << region_index << "/" << region_count <<
+                        ", " << HexString(base_address) << "+" <<
+                        HexString(region_size);
+        return false;
+      }
+
+      if (region_size > numeric_limits<uint32_t>::max()) {
+        // MemoryRegion sizes are 32 bits wide, so leave this region out,
+        // but keep going: the regions after it are still usable.
+        BPLOG(ERROR) << "MinidumpMemory64List region " << region_index <<
+                        "/" << region_count << " is too large, " <<
+                        HexString(base_address) << "+" <<
+                        HexString(region_size);
+      } else {
+        if (!range_map_->StoreRange(base_address, region_size,
+                                    region_index)) {
+          BPLOG(ERROR) << "MinidumpMemory64List could not store memory "
+                          "region " << region_index << "/" << region_count <<
+                          ", " << HexString(base_address) << "+" <<
+                          HexString(region_size);
+          return false;
+        }
+
+        MDMemoryDescriptor* region_descriptor =
+            &(*region_descriptors)[region_index];
+        region_descriptor->start_of_memory_range = base_address;
+        region_descriptor->memory.data_size =
+            static_cast<uint32_t>(region_size);
+        region_descriptor->memory.rva = 0;
+        (*regions)[region_index].SetDescriptor(region_descriptor, rva);
+      }
+
+      rva += region_size;
+    }
+
+    range_map_->Freeze();
+
+    descriptors_ = descriptors.release();
+    region_descriptors_ = region_descriptors.release();
+    regions_ = regions.release();
+  }
+
+  region_count_ = static_cast<uint32_t>(region_count);
+  base_rva_ = base_rva;
+
+  valid_ = true;
+  return true;
+}
+
+
+MinidumpMemoryRegion* MinidumpMemory64List::GetMemoryRegionAtIndex(
+      unsigned int index) {
+  if (!valid_) {
+    BPLOG(ERROR) << "Invalid MinidumpMemory64List for GetMemoryRegionAtIndex";
+    return NULL;
+  }
+
+  if (index >= region_count_) {
+    BPLOG(ERROR) << "MinidumpMemory64List index out of range: " <<
+                    index << "/" << region_count_;
+    return NULL;
+  }
+
+  MinidumpMemoryRegion* region = &(*regions_)[index];
+  return region->valid() ? region : NULL;
+}
+
+
+MinidumpMemoryRegion* MinidumpMemory64List::GetMemoryRegionForAddress(
+    uint64_t address) {
+  if (!valid_) {
+    BPLOG(ERROR) << "Invalid MinidumpMemory64List for "
+                    "GetMemoryRegionForAddress";
+    return NULL;
+  }
+
+  unsigned int region_index;
+  if (!range_map_->RetrieveRange(address, &region_index, NULL, NULL)) {
+    BPLOG(INFO) << "MinidumpMemory64List has no memory region at " <<
+                   HexString(address);
+    return NULL;
+  }
+
+  return GetMemoryRegionAtIndex(region_index);
+}
+
+
+void MinidumpMemory64List::Print() {
+  if (!valid_) {
+    BPLOG(ERROR) << "MinidumpMemory64List cannot print invalid data";
+    return;
+  }
+
+  printf("MinidumpMemory64List\n");
+  printf("  region_count = %d\n", region_count_);
+  printf("  base_rva     = 0x%" PRIx64 "\n", base_rva_);
+  printf("\n");
+
+  for (unsigned int region_index = 0;
+       region_index < region_count_;
+       ++region_index) {
+    MDMemoryDescriptor64* descriptor = &(*descriptors_)[region_index];
+    printf("region[%d]\n", region_index);
+    printf("MDMemoryDescriptor64\n");
+    printf("  start_of_memory_range = 0x%" PRIx64 "\n",
+           descriptor->start_of_memory_range);
+    printf("  data_size             = 0x%" PRIx64 "\n",
+           descriptor->data_size);
+    MinidumpMemoryRegion* region = GetMemoryRegionAtIndex(region_index);
+    if (region) {
+      printf("Memory\n");
+      region->Print();
+    } else {
+      printf("No memory\n");
+    }
+    printf("\n");
+  }
+}
+
+
 //
 // MinidumpException
 //
@@ -2962,6 +3336,12 @@ MinidumpContext* MinidumpException::GetContext() {
     return NULL;
   }
 
+  MinidumpContext* cached_context = AtomicLoad(&context_);
+  if (cached_context) {
+    return cached_context;
+  }
+
+  AutoMinidumpLock lock(minidump_);
   if (!context_) {
     if (!minidump_->SeekSet(exception_.thread_context.rva)) {
       BPLOG(ERROR) << "MinidumpException cannot seek to context";
@@ -2977,7 +3357,7 @@ MinidumpContext* MinidumpException::GetContext() {
       return NULL;
     }
 
-    context_ = context.release();
+    AtomicStore(&context_, context.release());
   }
 
   return context_;
@@ -3988,6 +4368,12 @@ Minidump::Minidump(const string& path)
       stream_map_(new MinidumpStreamMap()),
       path_(path),
       stream_(NULL),
+      fd_(-1),
+      map_file_(false),
+      mapped_data_(NULL),
+      mapped_size_(0),
+      position_(0),
+      lock_(new MinidumpLock()),
       swap_(false),
       valid_(false) {
 }
@@ -3998,24 +4384,39 @@ Minidump::Minidump(istream& stream)
       stream_map_(new MinidumpStreamMap()),
       path_(),
       stream_(&stream),
+      fd_(-1),
+      map_file_(false),
+      mapped_data_(NULL),
+      mapped_size_(0),
+      position_(0),
+      lock_(new MinidumpLock()),
       swap_(false),
       valid_(false) {
 }
 
 Minidump::~Minidump() {
-  if (stream_) {
+  if (stream_ || fd_ != -1 || mapped_data_) {
     BPLOG(INFO) << "Minidump closing minidump";
   }
   if (!path_.empty()) {
     delete stream_;
   }
+#ifndef _WIN32
+  if (fd_ != -1) {
+    close(fd_);
+  }
+  if (mapped_data_) {
+    munmap(const_cast<uint8_t*>(mapped_data_), mapped_size_);
+  }
+#endif  // _WIN32
   delete directory_;
   delete stream_map_;
+  delete lock_;
 }
 
 
 bool Minidump::Open() {
-  if (stream_ != NULL) {
+  if (stream_ != NULL || fd_ != -1 || mapped_data_ != NULL) {
     BPLOG(INFO) << "Minidump reopening minidump " << path_;
 
     // The file is already open.  Seek to the beginning, which is the position
@@ -4023,8 +4424,21 @@ bool Minidump::Open() {
     return SeekSet(0);
   }
 
+  if (map_file_ && MapFile()) {
+    BPLOG(INFO) << "Minidump mapped minidump " << path_;
+    return true;
+  }
+
+#ifdef _WIN32
   stream_ = new ifstream(path_.c_str(), std::ios::in | std::ios::binary);
   if (!stream_ || !stream_->good()) {
+#else  // _WIN32
+  // Open a descriptor rather than an ifstream, so that the file can be
+  // read with pread.
+  fd_ = open(path_.c_str(), O_RDONLY);
+  position_ = 0;
+  if (fd_ == -1) {
+#endif  // _WIN32
     string error_string;
     int error_code = ErrnoString(&error_string);
     BPLOG(ERROR) << "Minidump could not open minidump " << path_ <<
@@ -4036,6 +4450,41 @@ bool Minidump::Open() {
   return true;
 }
 
+bool Minidump::MapFile() {
+#ifdef _WIN32
+  return false;
+#else  // _WIN32
+  int fd = open(path_.c_str(), O_RDONLY);
+  if (fd == -1) {
+    // Let the istream report the error.
+    return false;
+  }
+
+  struct stat sb;
+  void* data = MAP_FAILED;
+  // An empty file can't be mapped, but there is nothing to read anyway.
+  if (fstat(fd, &sb) == 0 && sb.st_size > 0 &&
+      static_cast<uint64_t>(sb.st_size) <= numeric_limits<size_t>::max()) {
+    data = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  if (data == MAP_FAILED) {
+    string error_string;
+    int error_code = ErrnoString(&error_string);
+    BPLOG(INFO) << "Minidump could not map minidump " << path_ <<
+                   ", error " << error_code << ": " << error_string;
+    close(fd);
+    return false;
+  }
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+
+  mapped_data_ = static_cast<const uint8_t*>(data);
+  mapped_size_ = sb.st_size;
+  position_ = 0;
+  return true;
+#endif  // _WIN32
+}
+
 bool Minidump::GetContextCPUFlagsFromSystemInfo(uint32_t *context_cpu_flags) {
   // Initialize output parameters
   *context_cpu_flags = 0;
@@ -4211,6 +4660,7 @@ bool Minidump::Read() {
         case MD_THREAD_LIST_STREAM:
         case MD_MODULE_LIST_STREAM:
         case MD_MEMORY_LIST_STREAM:
+        case MD_MEMORY_64_LIST_STREAM:
         case MD_EXCEPTION_STREAM:
         case MD_SYSTEM_INFO_STREAM:
         case MD_MISC_INFO_STREAM:
@@ -4259,6 +4709,12 @@ MinidumpMemoryList* Minidump::GetMemoryList() {
 }
 
 
+MinidumpMemory64List* Minidump::GetMemory64List() {
+  MinidumpMemory64List* memory64_list;
+  return GetStream(&memory64_list);
+}
+
+
 MinidumpException* Minidump::GetException() {
   MinidumpException* exception;
   return GetStream(&exception);
@@ -4426,6 +4882,14 @@ const MDRawDirectory* Minidump::GetDirectoryEntryAtIndex(unsigned int index)
 bool Minidump::ReadBytes(void* bytes, size_t count) {
   // Can't check valid_ because Read needs to call this method before
   // validity can be determined.
+  if (fd_ != -1 || mapped_data_) {
+    if (!ReadBytesAt(position_, bytes, count)) {
+      return false;
+    }
+    position_ += count;
+    return true;
+  }
+
   if (!stream_) {
     return false;
   }
@@ -4458,6 +4922,17 @@ bool Minidump::ReadBytes(void* bytes, size_t count) {
 bool Minidump::SeekSet(off_t offset) {
   // Can't check valid_ because Read needs to call this method before
   // validity can be determined.
+  if (fd_ != -1 || mapped_data_) {
+    // As with an istream, seeking past the end succeeds, and the next read
+    // fails.
+    if (offset < 0) {
+      BPLOG(ERROR) << "SeekSet: invalid offset " << offset;
+      return false;
+    }
+    position_ = offset;
+    return true;
+  }
+
   if (!stream_) {
     return false;
   }
@@ -4472,10 +4947,14 @@ bool Minidump::SeekSet(off_t offset) {
 }
 
 off_t Minidump::Tell() {
-  if (!valid_ || !stream_) {
+  if (!valid_ || (!stream_ && fd_ == -1 && !mapped_data_)) {
     return (off_t)-1;
   }
 
+  if (fd_ != -1 || mapped_data_) {
+    return position_;
+  }
+
   // Check for conversion data loss
   std::streamoff std_streamoff = stream_->tellg();
   off_t rv = static_cast<off_t>(std_streamoff);
@@ -4488,6 +4967,68 @@ off_t Minidump::Tell() {
 }
 
 
+bool Minidump::ReadBytesAt(off_t offset, void* bytes, size_t count) {
+  if (offset < 0) {
+    BPLOG(ERROR) << "ReadBytesAt: invalid offset " << offset;
+    return false;
+  }
+
+  if (mapped_data_) {
+    const uint8_t* data = GetMappedBytes(offset, count);
+    if (!data) {
+      size_t available = static_cast<uint64_t>(offset) < mapped_size_ ?
+                         mapped_size_ - static_cast<size_t>(offset) : 0;
+      BPLOG(ERROR) << "ReadBytesAt: read " << available << "/" << count;
+      return false;
+    }
+    memcpy(bytes, data, count);
+    return true;
+  }
+
+#ifndef _WIN32
+  if (fd_ != -1) {
+    uint8_t* destination = static_cast<uint8_t*>(bytes);
+    size_t bytes_read = 0;
+    while (bytes_read < count) {
+      ssize_t result = pread(fd_, destination + bytes_read,
+                             count - bytes_read, offset + bytes_read);
+      if (result == -1 && errno == EINTR) {
+        continue;
+      }
+      if (result == -1) {
+        string error_string;
+        int error_code = ErrnoString(&error_string);
+        BPLOG(ERROR) << "ReadBytesAt: error " << error_code << ": " <<
+                        error_string;
+        return false;
+      }
+      if (result == 0) {
+        BPLOG(ERROR) << "ReadBytesAt: read " << bytes_read << "/" << count;
+        return false;
+      }
+      bytes_read += result;
+    }
+    return true;
+  }
+#endif  // _WIN32
+
+  // An istream has a single position, so these reads take turns with each
+  // other and with everything else that uses the position.
+  AutoMinidumpLock lock(this);
+  return SeekSet(offset) && ReadBytes(bytes, count);
+}
+
+
+const uint8_t* Minidump::GetMappedBytes(off_t offset, size_t count) const {
+  if (!mapped_data_ || offset < 0 ||
+      static_cast<uint64_t>(offset) > mapped_size_ ||
+      count > mapped_size_ - static_cast<size_t>(offset)) {
+    return NULL;
+  }
+  return mapped_data_ + offset;
+}
+
+
 string* Minidump::ReadString(off_t offset) {
   if (!valid_) {
     BPLOG(ERROR) << "Invalid Minidump for ReadString";
@@ -4592,6 +5133,9 @@ T* Minidump::GetStream(T** stream) {
     return NULL;
   }
 
+  // Streams are read on first use, so threads take turns.
+  AutoMinidumpLock lock(this);
+
   MinidumpStreamMap::iterator iterator = stream_map_->find(stream_type);
   if (iterator == stream_map_->end()) {
     // This stream type didn't exist in the directory.
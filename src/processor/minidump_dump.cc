@@ -46,6 +46,7 @@ using google_breakpad::MinidumpThreadList;
 using google_breakpad::MinidumpModuleList;
 using google_breakpad::MinidumpMemoryInfoList;
 using google_breakpad::MinidumpMemoryList;
+using google_breakpad::MinidumpMemory64List;
 using google_breakpad::MinidumpException;
 using google_breakpad::MinidumpAssertion;
 using google_breakpad::MinidumpSystemInfo;
@@ -125,6 +126,13 @@ static bool PrintMinidumpDump(const char *minidump_file) {
     memory_list->Print();
   }
 
+  MinidumpMemory64List *memory64_list = minidump.GetMemory64List();
+  if (!memory64_list) {
+    BPLOG(INFO) << "minidump.GetMemory64List() failed";
+  } else {
+    memory64_list->Print();
+  }
+
   MinidumpException *exception = minidump.GetException();
   if (!exception) {
     BPLOG(INFO) << "minidump.GetException() failed";
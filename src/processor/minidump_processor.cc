@@ -31,8 +31,12 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 
+#include <algorithm>
+#include <map>
 #include <string>
+#include <vector>
 
 #include "common/scoped_ptr.h"
 #include "common/using_std_string.h"
@@ -41,17 +45,273 @@
 #include "google_breakpad/processor/process_state.h"
 #include "google_breakpad/processor/exploitability.h"
 #include "google_breakpad/processor/stack_frame_symbolizer.h"
+#include "processor/instruction_address_oracle.h"
+#include "processor/linked_ptr.h"
 #include "processor/logging.h"
 #include "processor/stackwalker_x86.h"
 #include "processor/symbolic_constants_win.h"
+#include "processor/symbolization_memo.h"
+#include "processor/thread_primitives.h"
 
 namespace google_breakpad {
 
+namespace {
+
+// A thread whose stack MinidumpProcessor::Process walks.
+struct ThreadToWalk {
+  ThreadToWalk()
+      : context(NULL), memory(NULL), duplicate_of(-1), stack(NULL),
+        interrupted(false) {}
+
+  // Identifies the thread in log messages.
+  string thread_string;
+  MinidumpContext *context;
+  MinidumpMemoryRegion *memory;
+
+  // The index of an earlier thread with the same context and stack
+  // memory, whose stack this thread shares instead of being walked, or
+  // -1.
+  int duplicate_of;
+
+  // The results of walking the thread's stack.  The module vectors are
+  // only used when walking concurrently; serial walks add modules to the
+  // ProcessState directly.
+  CallStack *stack;
+  vector<const CodeModule*> modules_without_symbols;
+  vector<const CodeModule*> modules_with_corrupt_symbols;
+  bool interrupted;
+};
+
+// Walks the stack of thread, storing it in thread->stack.  Returns false
+// if the walk was interrupted.
+bool WalkThread(const SystemInfo *system_info,
+                const CodeModules *modules,
+                StackFrameSymbolizer *frame_symbolizer,
+                InstructionAddressOracle *address_oracle,
+                SymbolizationMemo *symbolization_memo,
+                ThreadToWalk *thread,
+                vector<const CodeModule*> *modules_without_symbols,
+                vector<const CodeModule*> *modules_with_corrupt_symbols) {
+  scoped_ptr<Stackwalker> stackwalker(
+      Stackwalker::StackwalkerForCPU(system_info,
+                                     thread->context,
+                                     thread->memory,
+                                     modules,
+                                     frame_symbolizer));
+
+  thread->stack = new CallStack();
+  if (!stackwalker.get()) {
+    // Threads with missing CPU contexts will hit this, but
+    // don't abort processing the rest of the dump just for
+    // one bad thread.
+    BPLOG(ERROR) << "No stackwalker for " << thread->thread_string;
+    return true;
+  }
+  stackwalker->set_instruction_address_oracle(address_oracle);
+  stackwalker->set_symbolization_memo(symbolization_memo);
+
+  if (!stackwalker->Walk(thread->stack,
+                         modules_without_symbols,
+                         modules_with_corrupt_symbols)) {
+    BPLOG(INFO) << "Stackwalker interrupt (missing symbols?) at "
+                << thread->thread_string;
+    return false;
+  }
+  return true;
+}
+
+// The threads walked by a pool of StackwalkWorker threads.
+struct StackwalkJob {
+  const SystemInfo *system_info;
+  const CodeModules *modules;
+  StackFrameSymbolizer *frame_symbolizer;
+  InstructionAddressOracle *address_oracle;
+  SymbolizationMemo *symbolization_memo;
+  vector<ThreadToWalk> *threads;
+  // The index of the next thread to walk.  Each worker claims threads
+  // by incrementing it atomically.
+  int next_thread;
+};
+
+void *StackwalkWorker(void *job_pointer) {
+  StackwalkJob *job = static_cast<StackwalkJob*>(job_pointer);
+  for (;;) {
+    size_t index = AtomicFetchAdd(&job->next_thread, 1);
+    if (index >= job->threads->size())
+      return NULL;
+    ThreadToWalk *thread = &(*job->threads)[index];
+    if (thread->duplicate_of >= 0)
+      continue;
+    thread->interrupted = !WalkThread(job->system_info,
+                                      job->modules,
+                                      job->frame_symbolizer,
+                                      job->address_oracle,
+                                      job->symbolization_memo,
+                                      thread,
+                                      &thread->modules_without_symbols,
+                                      &thread->modules_with_corrupt_symbols);
+  }
+}
+
+// Appends the modules in from that are not yet in to, preserving their
+// order.  This matches the order in which Stackwalker::Walk would have
+// added them had the threads been walked one after another.
+void MergeModules(const vector<const CodeModule*> &from,
+                  vector<const CodeModule*> *to) {
+  for (vector<const CodeModule*>::const_iterator iterator = from.begin();
+       iterator != from.end();
+       ++iterator) {
+    if (std::find(to->begin(), to->end(), *iterator) == to->end())
+      to->push_back(*iterator);
+  }
+}
+
+// The parts of a thread that its stack walk depends on.
+struct ThreadFingerprint {
+  uint32_t context_flags;
+  const uint8_t *context;
+  size_t context_size;
+  uint64_t memory_base;
+  const uint8_t *memory;
+  size_t memory_size;
+  uint64_t hash;
+};
+
+// Mixes the |size| bytes at |data| into |hash|.
+uint64_t HashBytes(uint64_t hash, const uint8_t *data, size_t size) {
+  const uint64_t kMultiplier = 0x9e3779b97f4a7c15ULL;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data + i, sizeof(word));
+    hash = (hash ^ word) * kMultiplier;
+    hash ^= hash >> 29;
+  }
+  for (; i < size; ++i)
+    hash = (hash ^ data[i]) * kMultiplier;
+  return hash ^ size;
+}
+
+// Fills in |fingerprint| for |thread|.  Returns false if the thread's
+// context or stack memory can't be read as a whole.
+bool GetThreadFingerprint(const ThreadToWalk &thread,
+                          ThreadFingerprint *fingerprint) {
+  const MinidumpContext *context = thread.context;
+  if (!context)
+    return false;
+  const void *raw_context;
+  switch (context->GetContextCPU()) {
+    case MD_CONTEXT_AMD64:
+      raw_context = context->GetContextAMD64();
+      fingerprint->context_size = sizeof(MDRawContextAMD64);
+      break;
+    case MD_CONTEXT_ARM:
+      raw_context = context->GetContextARM();
+      fingerprint->context_size = sizeof(MDRawContextARM);
+      break;
+    case MD_CONTEXT_ARM64:
+      raw_context = context->GetContextARM64();
+      fingerprint->context_size = sizeof(MDRawContextARM64);
+      break;
+    case MD_CONTEXT_MIPS:
+      raw_context = context->GetContextMIPS();
+      fingerprint->context_size = sizeof(MDRawContextMIPS);
+      break;
+    case MD_CONTEXT_PPC:
+      raw_context = context->GetContextPPC();
+      fingerprint->context_size = sizeof(MDRawContextPPC);
+      break;
+    case MD_CONTEXT_PPC64:
+      raw_context = context->GetContextPPC64();
+      fingerprint->context_size = sizeof(MDRawContextPPC64);
+      break;
+    case MD_CONTEXT_SPARC:
+      raw_context = context->GetContextSPARC();
+      fingerprint->context_size = sizeof(MDRawContextSPARC);
+      break;
+    case MD_CONTEXT_X86:
+      raw_context = context->GetContextX86();
+      fingerprint->context_size = sizeof(MDRawContextX86);
+      break;
+    default:
+      return false;
+  }
+  if (!raw_context)
+    return false;
+  fingerprint->context = static_cast<const uint8_t*>(raw_context);
+  fingerprint->context_flags = context->GetContextFlags();
+
+  fingerprint->memory_base = 0;
+  fingerprint->memory = NULL;
+  fingerprint->memory_size = 0;
+  if (thread.memory) {
+    fingerprint->memory = thread.memory->GetMemory();
+    if (!fingerprint->memory)
+      return false;
+    fingerprint->memory_base = thread.memory->GetBase();
+    fingerprint->memory_size = thread.memory->GetSize();
+  }
+
+  uint64_t hash = HashBytes(fingerprint->context_flags, fingerprint->context,
+                            fingerprint->context_size);
+  fingerprint->hash = HashBytes(hash ^ fingerprint->memory_base,
+                                fingerprint->memory,
+                                fingerprint->memory_size);
+  return true;
+}
+
+bool SameFingerprint(const ThreadFingerprint &a, const ThreadFingerprint &b) {
+  return a.hash == b.hash &&
+         a.context_flags == b.context_flags &&
+         a.context_size == b.context_size &&
+         memcmp(a.context, b.context, a.context_size) == 0 &&
+         a.memory_base == b.memory_base &&
+         a.memory_size == b.memory_size &&
+         (a.memory == b.memory ||
+          memcmp(a.memory, b.memory, a.memory_size) == 0);
+}
+
+// Sets the duplicate_of field of each thread in |threads| whose context
+// and stack memory are the same, byte for byte, as an earlier thread's,
+// and returns the number of such threads.  Walking one of them would
+// only repeat the earlier thread's walk.
+size_t FindDuplicateThreads(vector<ThreadToWalk> *threads) {
+  vector<ThreadFingerprint> fingerprints(threads->size());
+  // The threads with each hash that are not duplicates.
+  std::map<uint64_t, vector<size_t> > threads_by_hash;
+  size_t duplicates = 0;
+  for (size_t i = 0; i < threads->size(); ++i) {
+    ThreadToWalk &thread = (*threads)[i];
+    if (!GetThreadFingerprint(thread, &fingerprints[i]))
+      continue;
+    vector<size_t> &candidates = threads_by_hash[fingerprints[i].hash];
+    for (size_t j = 0; j < candidates.size(); ++j) {
+      if (SameFingerprint(fingerprints[i], fingerprints[candidates[j]])) {
+        thread.duplicate_of = static_cast<int>(candidates[j]);
+        break;
+      }
+    }
+    if (thread.duplicate_of >= 0)
+      ++duplicates;
+    else
+      candidates.push_back(i);
+  }
+  return duplicates;
+}
+
+}  // namespace
+
 MinidumpProcessor::MinidumpProcessor(SymbolSupplier *supplier,
                                      SourceLineResolverInterface *resolver)
     : frame_symbolizer_(new StackFrameSymbolizer(supplier, resolver)),
       own_frame_symbolizer_(true),
-      enable_exploitability_(false) {
+      enable_exploitability_(false),
+      stackwalk_thread_count_(1),
+      symbol_prefetch_thread_count_(0),
+      memoize_symbolization_(true),
+      symbolization_lookups_(0),
+      symbolization_hits_(0),
+      deduplicate_threads_(false) {
 }
 
 MinidumpProcessor::MinidumpProcessor(SymbolSupplier *supplier,
@@ -59,14 +319,26 @@ MinidumpProcessor::MinidumpProcessor(SymbolSupplier *supplier,
                                      bool enable_exploitability)
     : frame_symbolizer_(new StackFrameSymbolizer(supplier, resolver)),
       own_frame_symbolizer_(true),
-      enable_exploitability_(enable_exploitability) {
+      enable_exploitability_(enable_exploitability),
+      stackwalk_thread_count_(1),
+      symbol_prefetch_thread_count_(0),
+      memoize_symbolization_(true),
+      symbolization_lookups_(0),
+      symbolization_hits_(0),
+      deduplicate_threads_(false) {
 }
 
 MinidumpProcessor::MinidumpProcessor(StackFrameSymbolizer *frame_symbolizer,
                                      bool enable_exploitability)
     : frame_symbolizer_(frame_symbolizer),
       own_frame_symbolizer_(false),
-      enable_exploitability_(enable_exploitability) {
+      enable_exploitability_(enable_exploitability),
+      stackwalk_thread_count_(1),
+      symbol_prefetch_thread_count_(0),
+      memoize_symbolization_(true),
+      symbolization_lookups_(0),
+      symbolization_hits_(0),
+      deduplicate_threads_(false) {
   assert(frame_symbolizer_);
 }
 
@@ -132,6 +404,14 @@ ProcessResult MinidumpProcessor::Process(
                 << " memory regions.";
   }
 
+  // Full-memory dumps hold their memory, including the stacks, in a
+  // 64-bit memory list instead.
+  MinidumpMemory64List *memory64_list = dump->GetMemory64List();
+  if (memory64_list) {
+    BPLOG(INFO) << "Found " << memory64_list->region_count()
+                << " 64-bit memory regions.";
+  }
+
   MinidumpThreadList *threads = dump->GetThreadList();
   if (!threads) {
     BPLOG(ERROR) << "Minidump " << dump->path() << " has no thread list";
@@ -149,13 +429,19 @@ ProcessResult MinidumpProcessor::Process(
       (has_requesting_thread   ? "" : "no ") << "requesting thread, and " <<
       (has_process_create_time ? "" : "no ") << "process create time";
 
-  bool interrupted = false;
+  ProcessResult result = PROCESS_OK;
   bool found_requesting_thread = false;
   unsigned int thread_count = threads->thread_count();
+  vector<ThreadToWalk> threads_to_walk;
 
   // Reset frame_symbolizer_ at the beginning of stackwalk for each minidump.
   frame_symbolizer_->Reset();
 
+  // Find the context and stack memory of each thread to walk.  The walks
+  // themselves are done afterwards, possibly concurrently.  If an error
+  // stops this loop, the threads found before it are still walked, so that
+  // process_state holds the same stacks it would have if each thread were
+  // walked as soon as it was found.
   for (unsigned int thread_index = 0;
        thread_index < thread_count;
        ++thread_index) {
@@ -167,13 +453,15 @@ ProcessResult MinidumpProcessor::Process(
     MinidumpThread *thread = threads->GetThreadAtIndex(thread_index);
     if (!thread) {
       BPLOG(ERROR) << "Could not get thread for " << thread_string;
-      return PROCESS_ERROR_GETTING_THREAD;
+      result = PROCESS_ERROR_GETTING_THREAD;
+      break;
     }
 
     uint32_t thread_id;
     if (!thread->GetThreadID(&thread_id)) {
       BPLOG(ERROR) << "Could not get thread ID for " << thread_string;
-      return PROCESS_ERROR_GETTING_THREAD_ID;
+      result = PROCESS_ERROR_GETTING_THREAD_ID;
+      break;
     }
 
     thread_string += " id " + HexString(thread_id);
@@ -193,17 +481,18 @@ ProcessResult MinidumpProcessor::Process(
       if (found_requesting_thread) {
         // There can't be more than one requesting thread.
         BPLOG(ERROR) << "Duplicate requesting thread: " << thread_string;
-        return PROCESS_ERROR_DUPLICATE_REQUESTING_THREADS;
+        result = PROCESS_ERROR_DUPLICATE_REQUESTING_THREADS;
+        break;
       }
 
-      // Use processed_state->threads_.size() instead of thread_index.
+      // Use threads_to_walk.size() instead of thread_index.
       // thread_index points to the thread index in the minidump, which
       // might be greater than the thread index in the threads vector if
       // any of the minidump's threads are skipped and not placed into the
-      // processed threads vector.  The thread vector's current size will
-      // be the index of the current thread when it's pushed into the
+      // processed threads vector.  The number of threads to walk so far
+      // will be the index of the current thread once it's pushed into the
       // vector.
-      process_state->requesting_thread_ = process_state->threads_.size();
+      process_state->requesting_thread_ = threads_to_walk.size();
 
       found_requesting_thread = true;
 
@@ -221,53 +510,185 @@ ProcessResult MinidumpProcessor::Process(
 
     // If the memory region for the stack cannot be read using the RVA stored
     // in the memory descriptor inside MINIDUMP_THREAD, try to locate and use
-    // a memory region (containing the stack) from the minidump memory list.
+    // a memory region (containing the stack) from the minidump memory list,
+    // or failing that, the 64-bit memory list.
     MinidumpMemoryRegion *thread_memory = thread->GetMemory();
-    if (!thread_memory && memory_list) {
+    if (!thread_memory && (memory_list || memory64_list)) {
       uint64_t start_stack_memory_range = thread->GetStartOfStackMemoryRange();
       if (start_stack_memory_range) {
-        thread_memory = memory_list->GetMemoryRegionForAddress(
-           start_stack_memory_range);
+        if (memory_list) {
+          thread_memory = memory_list->GetMemoryRegionForAddress(
+             start_stack_memory_range);
+        }
+        if (!thread_memory && memory64_list) {
+          thread_memory = memory64_list->GetMemoryRegionForAddress(
+             start_stack_memory_range);
+        }
       }
     }
     if (!thread_memory) {
       BPLOG(ERROR) << "No memory region for " << thread_string;
     }
 
-    // Use process_state->modules_ instead of module_list, because the
-    // |modules| argument will be used to populate the |module| fields in
-    // the returned StackFrame objects, which will be placed into the
-    // returned ProcessState object.  module_list's lifetime is only as
-    // long as the Minidump object: it will be deleted when this function
-    // returns.  process_state->modules_ is owned by the ProcessState object
-    // (just like the StackFrame objects), and is much more suitable for this
-    // task.
-    scoped_ptr<Stackwalker> stackwalker(
-        Stackwalker::StackwalkerForCPU(process_state->system_info(),
-                                       context,
-                                       thread_memory,
-                                       process_state->modules_,
-                                       frame_symbolizer_));
-
-    scoped_ptr<CallStack> stack(new CallStack());
-    if (stackwalker.get()) {
-      if (!stackwalker->Walk(stack.get(),
-                             &process_state->modules_without_symbols_,
-                             &process_state->modules_with_corrupt_symbols_)) {
-        BPLOG(INFO) << "Stackwalker interrupt (missing symbols?) at "
-                    << thread_string;
+    threads_to_walk.push_back(ThreadToWalk());
+    threads_to_walk.back().thread_string = thread_string;
+    threads_to_walk.back().context = context;
+    threads_to_walk.back().memory = thread_memory;
+  }
+
+  // Threads whose contexts and stacks are identical, such as idle threads
+  // that were never scheduled, are walked once and share the stack found.
+  size_t duplicate_threads = 0;
+  if (deduplicate_threads_) {
+    duplicate_threads = FindDuplicateThreads(&threads_to_walk);
+    if (duplicate_threads > 0) {
+      BPLOG(INFO) << "Sharing the stacks of " << duplicate_threads << " of "
+                  << threads_to_walk.size() << " threads with identical "
+                  << "threads in " << dump->path();
+    }
+  }
+
+  // Start loading symbols for the modules the stacks are most likely to
+  // need, while the stacks are walked.  Without threads there is nothing
+  // to load them on.
+  int prefetch_thread_count =
+      WorkerThread::IsSupported() ? symbol_prefetch_thread_count_ : 0;
+  if (prefetch_thread_count > 0 && process_state->modules_) {
+    vector<const CodeModule*> first_modules;
+    for (size_t i = 0; i < threads_to_walk.size(); ++i) {
+      uint64_t instruction_pointer;
+      if (threads_to_walk[i].context &&
+          threads_to_walk[i].context->GetInstructionPointer(
+              &instruction_pointer)) {
+        const CodeModule *module =
+            process_state->modules_->GetModuleForAddress(instruction_pointer);
+        if (module)
+          first_modules.push_back(module);
+      }
+    }
+    frame_symbolizer_->StartPrefetch(process_state->modules_,
+                                     process_state->system_info(),
+                                     first_modules,
+                                     prefetch_thread_count);
+  }
+
+  int walker_count = stackwalk_thread_count_;
+  if (walker_count > 1 && !frame_symbolizer_->IsThreadSafe()) {
+    BPLOG(INFO) << "Stack frame symbolizer is not thread-safe, "
+                   "walking threads serially";
+    walker_count = 1;
+  }
+  if (walker_count > 1 && !WorkerThread::IsSupported()) {
+    BPLOG(INFO) << "Threads are not supported on this platform, "
+                   "walking threads serially";
+    walker_count = 1;
+  }
+  if (static_cast<size_t>(walker_count) >
+      threads_to_walk.size() - duplicate_threads) {
+    walker_count = threads_to_walk.size() - duplicate_threads;
+  }
+
+  // Use process_state->modules_ instead of module_list, because the
+  // |modules| argument will be used to populate the |module| fields in
+  // the returned StackFrame objects, which will be placed into the
+  // returned ProcessState object.  module_list's lifetime is only as
+  // long as the Minidump object: it will be deleted when this function
+  // returns.  process_state->modules_ is owned by the ProcessState object
+  // (just like the StackFrame objects), and is much more suitable for this
+  // task.
+  //
+  // All the walkers share one oracle for checking the return addresses
+  // they find by stack scanning, so that each module's function table is
+  // only built once.
+  InstructionAddressOracle address_oracle(process_state->modules_,
+                                          process_state->system_info(),
+                                          frame_symbolizer_);
+  // They also share what they find for each address, as the threads of a
+  // process often have many frames in common.
+  scoped_ptr<SymbolizationMemo> symbolization_memo;
+  if (memoize_symbolization_) {
+    symbolization_memo.reset(
+        new SymbolizationMemo(process_state->modules_,
+                              process_state->system_info(),
+                              frame_symbolizer_));
+  }
+  bool interrupted = false;
+  if (walker_count > 1) {
+    // The walkers read the stacks from the Minidump as they go, which is
+    // safe to do from several threads.
+    StackwalkJob job;
+    job.system_info = process_state->system_info();
+    job.modules = process_state->modules_;
+    job.frame_symbolizer = frame_symbolizer_;
+    job.address_oracle = &address_oracle;
+    job.symbolization_memo = symbolization_memo.get();
+    job.threads = &threads_to_walk;
+    job.next_thread = 0;
+
+    // The calling thread walks stacks too, alongside walker_count - 1
+    // workers.  If a worker can't be started, the others pick up its share.
+    vector<linked_ptr<WorkerThread> > workers;
+    for (int i = 1; i < walker_count; ++i) {
+      linked_ptr<WorkerThread> worker(new WorkerThread());
+      if (!worker->Start(StackwalkWorker, &job)) {
+        BPLOG(ERROR) << "Could not start stackwalk thread " << i;
+        break;
+      }
+      workers.push_back(worker);
+    }
+    StackwalkWorker(&job);
+    for (size_t i = 0; i < workers.size(); ++i)
+      workers[i]->Join();
+
+    for (size_t i = 0; i < threads_to_walk.size(); ++i) {
+      const ThreadToWalk &thread = threads_to_walk[i];
+      MergeModules(thread.modules_without_symbols,
+                   &process_state->modules_without_symbols_);
+      MergeModules(thread.modules_with_corrupt_symbols,
+                   &process_state->modules_with_corrupt_symbols_);
+      if (thread.interrupted)
+        interrupted = true;
+    }
+  } else {
+    for (size_t i = 0; i < threads_to_walk.size(); ++i) {
+      if (threads_to_walk[i].duplicate_of >= 0)
+        continue;
+      if (!WalkThread(process_state->system_info(),
+                      process_state->modules_,
+                      frame_symbolizer_,
+                      &address_oracle,
+                      symbolization_memo.get(),
+                      &threads_to_walk[i],
+                      &process_state->modules_without_symbols_,
+                      &process_state->modules_with_corrupt_symbols_)) {
         interrupted = true;
       }
-    } else {
-      // Threads with missing CPU contexts will hit this, but
-      // don't abort processing the rest of the dump just for
-      // one bad thread.
-      BPLOG(ERROR) << "No stackwalker for " << thread_string;
     }
-    process_state->threads_.push_back(stack.release());
-    process_state->thread_memory_regions_.push_back(thread_memory);
   }
 
+  // Symbols that no stack needed yet are not worth waiting for.
+  frame_symbolizer_->StopPrefetch();
+
+  if (symbolization_memo.get()) {
+    uint64_t lookups, hits;
+    symbolization_memo->GetStats(&lookups, &hits);
+    symbolization_lookups_ += lookups;
+    symbolization_hits_ += hits;
+    BPLOG(INFO) << "Symbolization memo answered " << hits << " of "
+                << lookups << " lookups for " << dump->path();
+  }
+
+  for (size_t i = 0; i < threads_to_walk.size(); ++i) {
+    const ThreadToWalk &thread = threads_to_walk[i];
+    process_state->threads_.push_back(
+        thread.duplicate_of >= 0 ? threads_to_walk[thread.duplicate_of].stack
+                                 : thread.stack);
+    process_state->thread_memory_regions_.push_back(threads_to_walk[i].memory);
+  }
+
+  if (result != PROCESS_OK)
+    return result;
+
   if (interrupted) {
     BPLOG(INFO) << "Processing interrupted for " << dump->path();
     return PROCESS_SYMBOL_SUPPLIER_INTERRUPTED;
@@ -36,24 +36,32 @@
 #include <iostream>
 #include <fstream>
 #include <map>
+#include <set>
 #include <utility>
+#include <vector>
 
 #include "breakpad_googletest_includes.h"
 #include "common/scoped_ptr.h"
+#include "common/tests/auto_tempdir.h"
 #include "common/using_std_string.h"
 #include "google_breakpad/processor/basic_source_line_resolver.h"
 #include "google_breakpad/processor/call_stack.h"
 #include "google_breakpad/processor/code_module.h"
 #include "google_breakpad/processor/code_modules.h"
+#include "google_breakpad/processor/concurrent_source_line_resolver.h"
 #include "google_breakpad/processor/minidump.h"
 #include "google_breakpad/processor/minidump_processor.h"
 #include "google_breakpad/processor/process_state.h"
 #include "google_breakpad/processor/stack_frame.h"
+#include "google_breakpad/processor/stack_frame_symbolizer.h"
 #include "google_breakpad/processor/symbol_supplier.h"
 #include "processor/logging.h"
+#include "processor/missing_symbol_cache.h"
 #include "processor/stackwalker_unittest_utils.h"
+#include "processor/symbol_file_index.h"
 
 using std::map;
+using std::vector;
 
 namespace google_breakpad {
 class MockMinidump : public Minidump {
@@ -72,6 +80,7 @@ class MockMinidump : public Minidump {
   MOCK_METHOD0(GetAssertion, MinidumpAssertion*());
   MOCK_METHOD0(GetModuleList, MinidumpModuleList*());
   MOCK_METHOD0(GetMemoryList, MinidumpMemoryList*());
+  MOCK_METHOD0(GetMemory64List, MinidumpMemory64List*());
 };
 
 class MockMinidumpThreadList : public MinidumpThreadList {
@@ -142,28 +151,41 @@ class TestMinidumpMiscInfo : public MinidumpMiscInfo {
 
 namespace {
 
+using google_breakpad::AutoTempDir;
 using google_breakpad::BasicSourceLineResolver;
 using google_breakpad::CallStack;
 using google_breakpad::CodeModule;
+using google_breakpad::ConcurrentSourceLineResolver;
+using google_breakpad::Minidump;
 using google_breakpad::MinidumpContext;
 using google_breakpad::MinidumpMemoryRegion;
 using google_breakpad::MinidumpMiscInfo;
+using google_breakpad::MinidumpModuleList;
 using google_breakpad::MinidumpProcessor;
 using google_breakpad::MinidumpSystemInfo;
 using google_breakpad::MinidumpThreadList;
 using google_breakpad::MinidumpThread;
+using google_breakpad::MissingSymbolCache;
 using google_breakpad::MockMinidump;
 using google_breakpad::MockMinidumpMemoryList;
 using google_breakpad::MockMinidumpMemoryRegion;
 using google_breakpad::MockMinidumpThread;
 using google_breakpad::MockMinidumpThreadList;
 using google_breakpad::ProcessState;
+using google_breakpad::SourceLineResolverInterface;
+using google_breakpad::scoped_array;
 using google_breakpad::scoped_ptr;
+using google_breakpad::StackFrame;
+using google_breakpad::StackFrameSymbolizer;
+using google_breakpad::SymbolFileIndex;
 using google_breakpad::SymbolSupplier;
 using google_breakpad::SystemInfo;
+using google_breakpad::kSymbolFileIndexSuffix;
 using ::testing::_;
 using ::testing::AnyNumber;
+using ::testing::AtMost;
 using ::testing::DoAll;
+using ::testing::Exactly;
 using ::testing::Mock;
 using ::testing::Ne;
 using ::testing::Property;
@@ -351,6 +373,14 @@ TEST_F(MinidumpProcessorTest, TestCorruptMinidumps) {
             google_breakpad::PROCESS_ERROR_NO_THREAD_LIST);
 }
 
+// Returns the code files of modules, in order.
+static vector<string> CodeFiles(const vector<const CodeModule*> *modules) {
+  vector<string> code_files;
+  for (size_t i = 0; i < modules->size(); ++i)
+    code_files.push_back(modules->at(i)->code_file());
+  return code_files;
+}
+
 // This test case verifies that the symbol supplier is only consulted
 // once per minidump per module.
 TEST_F(MinidumpProcessorTest, TestSymbolSupplierLookupCounts) {
@@ -394,6 +424,155 @@ TEST_F(MinidumpProcessorTest, TestSymbolSupplierLookupCounts) {
             google_breakpad::PROCESS_OK);
 }
 
+// When the resolver uses symbol file indexes, the symbolizer asks the
+// supplier for the symbol file's path and loads the module from it,
+// rather than fetching the file's contents.
+TEST_F(MinidumpProcessorTest, TestIndexedSymbolFileLoadedByPath) {
+  string testdata_dir = string(getenv("srcdir") ? getenv("srcdir") : ".") +
+                        "/src/processor/testdata";
+  FILE *f = fopen((testdata_dir + "/symbols/test_app.pdb/"
+                   "5A9832E5287241C1838ED98914E9B7FF1/test_app.sym").c_str(),
+                  "rb");
+  ASSERT_TRUE(f);
+  string contents;
+  char buffer[4096];
+  size_t size;
+  while ((size = fread(buffer, 1, sizeof(buffer), f)) > 0)
+    contents.append(buffer, size);
+  fclose(f);
+
+  AutoTempDir temp_dir;
+  string symbol_file = temp_dir.path() + "/test_app.sym";
+  f = fopen(symbol_file.c_str(), "wb");
+  ASSERT_TRUE(f);
+  ASSERT_EQ(contents.size(), fwrite(contents.data(), 1, contents.size(), f));
+  fclose(f);
+  uint64_t mtime;
+  ASSERT_TRUE(SymbolFileIndex::GetModificationTime(symbol_file, &mtime));
+  SymbolFileIndex index;
+  index.Build(contents.data(), contents.size(), mtime);
+  ASSERT_TRUE(index.Write(symbol_file + kSymbolFileIndexSuffix));
+
+  MockSymbolSupplier supplier;
+  BasicSourceLineResolver resolver;
+  resolver.set_use_symbol_file_indexes(true);
+  MinidumpProcessor processor(&supplier, &resolver);
+
+  EXPECT_CALL(supplier, GetSymbolFile(
+      Property(&google_breakpad::CodeModule::code_file,
+               "c:\\test_app.exe"),
+      _, _)).WillOnce(DoAll(SetArgumentPointee<2>(symbol_file),
+                            Return(SymbolSupplier::FOUND)));
+  EXPECT_CALL(supplier, GetSymbolFile(
+      Property(&google_breakpad::CodeModule::code_file,
+               Ne("c:\\test_app.exe")),
+      _, _)).WillRepeatedly(Return(SymbolSupplier::NOT_FOUND));
+  EXPECT_CALL(supplier, GetCStringSymbolData(
+      Property(&google_breakpad::CodeModule::code_file,
+               "c:\\test_app.exe"),
+      _, _, _, _)).Times(0);
+  EXPECT_CALL(supplier, GetCStringSymbolData(
+      Property(&google_breakpad::CodeModule::code_file,
+               Ne("c:\\test_app.exe")),
+      _, _, _, _)).WillRepeatedly(Return(SymbolSupplier::NOT_FOUND));
+  EXPECT_CALL(supplier, FreeSymbolData(_)).Times(AnyNumber());
+
+  ProcessState state;
+  ASSERT_EQ(google_breakpad::PROCESS_OK,
+            processor.Process(testdata_dir + "/minidump2.dmp", &state));
+  CallStack *stack = state.threads()->at(0);
+  ASSERT_TRUE(stack);
+  ASSERT_EQ(4U, stack->frames()->size());
+  EXPECT_EQ("`anonymous namespace'::CrashFunction",
+            stack->frames()->at(0)->function_name);
+  EXPECT_EQ("c:\\test_app.cc", stack->frames()->at(0)->source_file_name);
+  EXPECT_EQ(58, stack->frames()->at(0)->source_line);
+}
+
+// With a MissingSymbolCache, modules found to have no symbols in one
+// minidump are not looked up again in the next.
+TEST_F(MinidumpProcessorTest, TestMissingSymbolCacheLookupCounts) {
+  MockSymbolSupplier supplier;
+  BasicSourceLineResolver resolver;
+  MissingSymbolCache cache(3600);
+  StackFrameSymbolizer frame_symbolizer(&supplier, &resolver);
+  frame_symbolizer.set_missing_symbol_cache(&cache);
+  MinidumpProcessor processor(&frame_symbolizer, false);
+
+  string minidump_file = string(getenv("srcdir") ? getenv("srcdir") : ".") +
+                         "/src/processor/testdata/minidump2.dmp";
+  ProcessState state;
+  EXPECT_CALL(supplier, GetCStringSymbolData(
+      Property(&google_breakpad::CodeModule::code_file,
+               "c:\\test_app.exe"),
+      _, _, _, _)).WillOnce(Return(SymbolSupplier::NOT_FOUND));
+  EXPECT_CALL(supplier, GetCStringSymbolData(
+      Property(&google_breakpad::CodeModule::code_file,
+               Ne("c:\\test_app.exe")),
+      _, _, _, _)).WillRepeatedly(Return(SymbolSupplier::NOT_FOUND));
+  EXPECT_CALL(supplier, FreeSymbolData(_)).Times(AnyNumber());
+  ASSERT_EQ(google_breakpad::PROCESS_OK,
+            processor.Process(minidump_file, &state));
+  ASSERT_TRUE(Mock::VerifyAndClearExpectations(&supplier));
+  vector<string> missing = CodeFiles(state.modules_without_symbols());
+  ASSERT_FALSE(missing.empty());
+
+  uint64_t lookups, hits, entries;
+  cache.GetStats(&lookups, &hits, &entries);
+  EXPECT_EQ(missing.size(), lookups);
+  EXPECT_EQ(0U, hits);
+  EXPECT_EQ(missing.size(), entries);
+
+  // The second time, the cache answers for every module, and the
+  // results are the same.
+  EXPECT_CALL(supplier, GetCStringSymbolData(_, _, _, _, _)).Times(0);
+  EXPECT_CALL(supplier, FreeSymbolData(_)).Times(AnyNumber());
+  ASSERT_EQ(google_breakpad::PROCESS_OK,
+            processor.Process(minidump_file, &state));
+  EXPECT_EQ(missing, CodeFiles(state.modules_without_symbols()));
+  cache.GetStats(&lookups, &hits, &entries);
+  EXPECT_EQ(2 * missing.size(), lookups);
+  EXPECT_EQ(missing.size(), hits);
+}
+
+// When symbols are prefetched, the symbol supplier is still consulted at
+// most once per module, and the module the crash is in is always looked
+// up, whether by a prefetch thread or by the stack walk.
+TEST_F(MinidumpProcessorTest, TestSymbolPrefetchLookupCounts) {
+  MockSymbolSupplier supplier;
+  ConcurrentSourceLineResolver resolver;
+  MinidumpProcessor processor(&supplier, &resolver);
+  processor.set_symbol_prefetch_thread_count(4);
+
+  string minidump_file = string(getenv("srcdir") ? getenv("srcdir") : ".") +
+                         "/src/processor/testdata/minidump2.dmp";
+  Minidump dump(minidump_file);
+  ASSERT_TRUE(dump.Read());
+  MinidumpModuleList *module_list = dump.GetModuleList();
+  ASSERT_TRUE(module_list);
+
+  std::set<string> code_files;
+  for (unsigned int i = 0; i < module_list->module_count(); ++i)
+    code_files.insert(module_list->GetModuleAtIndex(i)->code_file());
+  ASSERT_EQ(1U, code_files.count("c:\\test_app.exe"));
+  for (std::set<string>::const_iterator code_file = code_files.begin();
+       code_file != code_files.end(); ++code_file) {
+    EXPECT_CALL(supplier, GetCStringSymbolData(
+        Property(&google_breakpad::CodeModule::code_file, *code_file),
+        _, _, _, _)).
+        Times(*code_file == "c:\\test_app.exe" ? Exactly(1) : AtMost(1)).
+        WillRepeatedly(Return(SymbolSupplier::NOT_FOUND));
+  }
+  EXPECT_CALL(supplier, FreeSymbolData(_)).Times(AnyNumber());
+
+  ProcessState state;
+  ASSERT_EQ(google_breakpad::PROCESS_OK, processor.Process(&dump, &state));
+  ASSERT_EQ(1U, state.threads()->size());
+  ASSERT_FALSE(state.modules_without_symbols()->empty());
+  EXPECT_EQ("c:\\test_app.exe",
+            state.modules_without_symbols()->at(0)->code_file());
+}
+
 TEST_F(MinidumpProcessorTest, TestBasicProcessing) {
   TestSymbolSupplier supplier;
   BasicSourceLineResolver resolver;
@@ -636,6 +815,184 @@ TEST_F(MinidumpProcessorTest, TestThreadMissingContext) {
   ASSERT_EQ(0U, state.threads()->at(0)->frames()->size());
 }
 
+// Processes a minidump built from the threads of minidump2.dmp, each
+// repeated several times, and returns the result in *state.  If
+// stackwalk_thread_count is greater than 1, or symbol_prefetch_thread_count
+// greater than 0, a ConcurrentSourceLineResolver is used, and stacks are
+// walked concurrently or symbols prefetched respectively.  Copies of a
+// thread are walked once unless deduplicate_threads is false.
+static void ProcessRepeatedThreads(int stackwalk_thread_count,
+                                   int symbol_prefetch_thread_count,
+                                   bool deduplicate_threads,
+                                   ProcessState *state) {
+  const unsigned int kRepeatCount = 16;
+  string minidump_file = string(getenv("srcdir") ? getenv("srcdir") : ".") +
+                         "/src/processor/testdata/minidump2.dmp";
+  Minidump real_dump(minidump_file);
+  ASSERT_TRUE(real_dump.Read());
+  MinidumpThreadList *real_threads = real_dump.GetThreadList();
+  ASSERT_TRUE(real_threads);
+  unsigned int real_thread_count = real_threads->thread_count();
+
+  MockMinidump dump;
+  EXPECT_CALL(dump, path()).WillRepeatedly(Return("mock minidump"));
+  EXPECT_CALL(dump, header()).WillRepeatedly(Return(real_dump.header()));
+  EXPECT_CALL(dump, GetSystemInfo()).
+      WillRepeatedly(Return(real_dump.GetSystemInfo()));
+  EXPECT_CALL(dump, GetMiscInfo()).
+      WillRepeatedly(Return(real_dump.GetMiscInfo()));
+  EXPECT_CALL(dump, GetBreakpadInfo()).
+      WillRepeatedly(Return(real_dump.GetBreakpadInfo()));
+  EXPECT_CALL(dump, GetException()).
+      WillRepeatedly(Return(real_dump.GetException()));
+  EXPECT_CALL(dump, GetAssertion()).
+      WillRepeatedly(Return(real_dump.GetAssertion()));
+  EXPECT_CALL(dump, GetModuleList()).
+      WillRepeatedly(Return(real_dump.GetModuleList()));
+  EXPECT_CALL(dump, GetMemoryList()).
+      WillRepeatedly(Return(real_dump.GetMemoryList()));
+
+  // The first copy of each thread keeps its ID, so that the dump thread is
+  // skipped and the requesting thread found; later copies get new IDs.
+  unsigned int thread_count = real_thread_count * kRepeatCount;
+  scoped_array<MockMinidumpThread> threads(
+      new MockMinidumpThread[thread_count]);
+  MockMinidumpThreadList thread_list;
+  EXPECT_CALL(dump, GetThreadList()).WillRepeatedly(Return(&thread_list));
+  EXPECT_CALL(thread_list, thread_count()).
+      WillRepeatedly(Return(thread_count));
+  for (unsigned int i = 0; i < thread_count; ++i) {
+    MinidumpThread *real_thread =
+        real_threads->GetThreadAtIndex(i % real_thread_count);
+    ASSERT_TRUE(real_thread);
+    uint32_t thread_id;
+    ASSERT_TRUE(real_thread->GetThreadID(&thread_id));
+    if (i >= real_thread_count)
+      thread_id = 0x10000 + i;
+
+    EXPECT_CALL(threads[i], GetThreadID(_)).
+        WillRepeatedly(DoAll(SetArgumentPointee<0>(thread_id),
+                             Return(true)));
+    EXPECT_CALL(threads[i], GetContext()).
+        WillRepeatedly(Return(real_thread->GetContext()));
+    EXPECT_CALL(threads[i], GetMemory()).
+        WillRepeatedly(Return(real_thread->GetMemory()));
+    EXPECT_CALL(threads[i], GetStartOfStackMemoryRange()).
+        WillRepeatedly(Return(real_thread->GetStartOfStackMemoryRange()));
+    EXPECT_CALL(thread_list, GetThreadAtIndex(i)).
+        WillRepeatedly(Return(&threads[i]));
+  }
+
+  TestSymbolSupplier supplier;
+  BasicSourceLineResolver basic_resolver;
+  ConcurrentSourceLineResolver concurrent_resolver;
+  SourceLineResolverInterface *resolver = &basic_resolver;
+  if (stackwalk_thread_count > 1 || symbol_prefetch_thread_count > 0)
+    resolver = &concurrent_resolver;
+  MinidumpProcessor processor(&supplier, resolver, true);
+  processor.set_stackwalk_thread_count(stackwalk_thread_count);
+  processor.set_symbol_prefetch_thread_count(symbol_prefetch_thread_count);
+  processor.set_deduplicate_threads(deduplicate_threads);
+  ASSERT_EQ(google_breakpad::PROCESS_OK, processor.Process(&dump, state));
+}
+
+// Checks that actual_state holds the same threads, frames and modules as
+// expected_state.
+static void ExpectSameProcessState(const ProcessState &expected_state,
+                                   const ProcessState &actual_state) {
+  EXPECT_EQ(expected_state.crashed(), actual_state.crashed());
+  EXPECT_EQ(expected_state.crash_reason(), actual_state.crash_reason());
+  EXPECT_EQ(expected_state.requesting_thread(),
+            actual_state.requesting_thread());
+  EXPECT_EQ(expected_state.exploitability(),
+            actual_state.exploitability());
+  EXPECT_EQ(CodeFiles(expected_state.modules_without_symbols()),
+            CodeFiles(actual_state.modules_without_symbols()));
+  EXPECT_EQ(CodeFiles(expected_state.modules_with_corrupt_symbols()),
+            CodeFiles(actual_state.modules_with_corrupt_symbols()));
+  ASSERT_EQ(expected_state.threads()->size(),
+            actual_state.threads()->size());
+  for (size_t i = 0; i < expected_state.threads()->size(); ++i) {
+    const vector<StackFrame*> *expected_frames =
+        expected_state.threads()->at(i)->frames();
+    const vector<StackFrame*> *actual_frames =
+        actual_state.threads()->at(i)->frames();
+    ASSERT_EQ(expected_frames->size(), actual_frames->size());
+    for (size_t j = 0; j < expected_frames->size(); ++j) {
+      const StackFrame *expected_frame = expected_frames->at(j);
+      const StackFrame *actual_frame = actual_frames->at(j);
+      EXPECT_EQ(expected_frame->instruction, actual_frame->instruction);
+      EXPECT_EQ(expected_frame->trust, actual_frame->trust);
+      EXPECT_EQ(expected_frame->function_name, actual_frame->function_name);
+      EXPECT_EQ(expected_frame->source_file_name,
+                actual_frame->source_file_name);
+      EXPECT_EQ(expected_frame->source_line, actual_frame->source_line);
+      ASSERT_EQ(expected_frame->module == NULL,
+                actual_frame->module == NULL);
+      if (expected_frame->module) {
+        EXPECT_EQ(expected_frame->module->code_file(),
+                  actual_frame->module->code_file());
+      }
+    }
+  }
+}
+
+TEST_F(MinidumpProcessorTest, TestConcurrentStackwalkMatchesSerial) {
+  ProcessState serial_state;
+  ProcessRepeatedThreads(1, 0, false, &serial_state);
+  ProcessState concurrent_state;
+  ProcessRepeatedThreads(4, 0, false, &concurrent_state);
+
+  // Only the first copy of the dump thread is skipped.
+  ASSERT_EQ(31U, serial_state.threads()->size());
+  ASSERT_EQ(0, serial_state.requesting_thread());
+  ASSERT_EQ(4U, serial_state.threads()->at(0)->frames()->size());
+  ExpectSameProcessState(serial_state, concurrent_state);
+}
+
+TEST_F(MinidumpProcessorTest, TestSymbolPrefetchMatchesSerial) {
+  ProcessState serial_state;
+  ProcessRepeatedThreads(1, 0, false, &serial_state);
+  ProcessState prefetch_state;
+  ProcessRepeatedThreads(1, 4, false, &prefetch_state);
+  ExpectSameProcessState(serial_state, prefetch_state);
+
+  ProcessState concurrent_prefetch_state;
+  ProcessRepeatedThreads(4, 2, false, &concurrent_prefetch_state);
+  ExpectSameProcessState(serial_state, concurrent_prefetch_state);
+}
+
+TEST_F(MinidumpProcessorTest, TestDeduplicatedThreadsShareStacks) {
+  // Sharing stacks changes what ProcessState::threads holds, so it has to
+  // be asked for.
+  BasicSourceLineResolver resolver;
+  EXPECT_FALSE(MinidumpProcessor(NULL, &resolver).deduplicate_threads());
+
+  ProcessState separate_state;
+  ProcessRepeatedThreads(1, 0, false, &separate_state);
+  ProcessState serial_state;
+  ProcessRepeatedThreads(1, 0, true, &serial_state);
+  ExpectSameProcessState(separate_state, serial_state);
+  ProcessState concurrent_state;
+  ProcessRepeatedThreads(4, 0, true, &concurrent_state);
+  ExpectSameProcessState(separate_state, concurrent_state);
+
+  // minidump2.dmp has two threads: the dump thread, whose first copy is
+  // skipped, and the requesting thread, whose first copy is walked from
+  // the exception context.  Later copies of either are walked once.
+  const vector<CallStack*> *threads = serial_state.threads();
+  ASSERT_EQ(31U, threads->size());
+  EXPECT_NE(threads->at(0), threads->at(1));
+  EXPECT_NE(threads->at(0), threads->at(2));
+  EXPECT_NE(threads->at(1), threads->at(2));
+  for (size_t i = 3; i < threads->size(); ++i)
+    EXPECT_EQ(threads->at(i % 2 ? 1 : 2), threads->at(i)) << "thread " << i;
+
+  const vector<CallStack*> *separate_threads = separate_state.threads();
+  for (size_t i = 1; i < separate_threads->size(); ++i)
+    EXPECT_NE(separate_threads->at(0), separate_threads->at(i));
+}
+
 }  // namespace
 
 int main(int argc, char *argv[]) {
@@ -32,9 +32,15 @@
 //
 // Author: Mark Mentovai
 
+#include <dirent.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
 
+#include <algorithm>
+#include <iostream>
+#include <fstream>
 #include <string>
 #include <vector>
 
@@ -44,7 +50,9 @@
 #include "google_breakpad/processor/minidump.h"
 #include "google_breakpad/processor/minidump_processor.h"
 #include "google_breakpad/processor/process_state.h"
+#include "google_breakpad/processor/stack_frame_symbolizer.h"
 #include "processor/logging.h"
+#include "processor/missing_symbol_cache.h"
 #include "processor/simple_symbol_supplier.h"
 #include "processor/stackwalk_common.h"
 
@@ -54,24 +62,71 @@ namespace {
 using google_breakpad::BasicSourceLineResolver;
 using google_breakpad::Minidump;
 using google_breakpad::MinidumpProcessor;
+using google_breakpad::MissingSymbolCache;
 using google_breakpad::ProcessState;
 using google_breakpad::SimpleSymbolSupplier;
+using google_breakpad::StackFrameSymbolizer;
 using google_breakpad::scoped_ptr;
 
+// Processes |minidump_file| using |minidump_processor|, whose resolver is
+// |resolver|.
+//
+// Returns the value of MinidumpProcessor::Process.  If processing succeeds,
+// prints identifying OS and CPU information from the minidump, crash
+// information if the minidump was produced as a result of a crash, and
+// call stacks for each thread contained in the minidump.  If
+// |group_threads| is true, threads with the same frames are printed
+// together.  All information is printed to stdout.
+bool ProcessMinidump(MinidumpProcessor *minidump_processor,
+                     BasicSourceLineResolver *resolver,
+                     const string &minidump_file,
+                     bool machine_readable,
+                     bool output_stack_contents,
+                     bool group_threads) {
+  // Process the minidump.
+  // Use stack memory where it lies in the file rather than copying it.
+  Minidump dump(minidump_file);
+  dump.set_map_file(true);
+  if (!dump.Read()) {
+     BPLOG(ERROR) << "Minidump " << dump.path() << " could not be read";
+     return false;
+  }
+  ProcessState process_state;
+  if (minidump_processor->Process(&dump, &process_state) !=
+      google_breakpad::PROCESS_OK) {
+    BPLOG(ERROR) << "MinidumpProcessor::Process failed";
+    return false;
+  }
+
+  if (machine_readable) {
+    PrintProcessStateMachineReadable(process_state);
+  } else {
+    if (group_threads) {
+      PrintProcessStateGroupingThreads(process_state, output_stack_contents,
+                                       resolver);
+    } else {
+      PrintProcessState(process_state, output_stack_contents, resolver);
+    }
+  }
+
+  return true;
+}
+
 // Processes |minidump_file| using MinidumpProcessor.  |symbol_path|, if
 // non-empty, is the base directory of a symbol storage area, laid out in
 // the format required by SimpleSymbolSupplier.  If such a storage area
 // is specified, it is made available for use by the MinidumpProcessor.
+// If |use_symbol_file_indexes| is true, symbol files with an index
+// written by sym_to_index are loaded in part (see
+// BasicSourceLineResolver::set_use_symbol_file_indexes).
 //
-// Returns the value of MinidumpProcessor::Process.  If processing succeeds,
-// prints identifying OS and CPU information from the minidump, crash
-// information if the minidump was produced as a result of a crash, and
-// call stacks for each thread contained in the minidump.  All information
-// is printed to stdout.
+// Returns true if processing succeeds; see ProcessMinidump.
 bool PrintMinidumpProcess(const string &minidump_file,
                           const std::vector<string> &symbol_paths,
+                          bool use_symbol_file_indexes,
                           bool machine_readable,
-                          bool output_stack_contents) {
+                          bool output_stack_contents,
+                          bool group_threads) {
   scoped_ptr<SimpleSymbolSupplier> symbol_supplier;
   if (!symbol_paths.empty()) {
     // TODO(mmentovai): check existence of symbol_path if specified?
@@ -79,35 +134,239 @@ bool PrintMinidumpProcess(const string &minidump_file,
   }
 
   BasicSourceLineResolver resolver;
+  resolver.set_use_symbol_file_indexes(use_symbol_file_indexes);
   MinidumpProcessor minidump_processor(symbol_supplier.get(), &resolver);
+  // Identical threads print the same stack, so walk them once.
+  minidump_processor.set_deduplicate_threads(true);
 
-  // Process the minidump.
-  Minidump dump(minidump_file);
-  if (!dump.Read()) {
-     BPLOG(ERROR) << "Minidump " << dump.path() << " could not be read";
-     return false;
+  return ProcessMinidump(&minidump_processor, &resolver, minidump_file,
+                         machine_readable, output_stack_contents,
+                         group_threads);
+}
+
+// Reads the names of the minidumps to process in batch mode into
+// |minidump_files|.  |batch_list| is "-" to read names from stdin, one per
+// line, or the name of a directory, whose regular files are processed in
+// sorted order, or else the name of a file listing minidumps one per line.
+// Blank lines are ignored.  Returns false if |batch_list| can't be read.
+bool ReadBatchList(const string &batch_list,
+                   std::vector<string> *minidump_files) {
+  struct stat batch_list_stat;
+  if (batch_list != "-" &&
+      stat(batch_list.c_str(), &batch_list_stat) == 0 &&
+      S_ISDIR(batch_list_stat.st_mode)) {
+    DIR *directory = opendir(batch_list.c_str());
+    if (!directory) {
+      BPLOG(ERROR) << "Could not open directory " << batch_list;
+      return false;
+    }
+    std::vector<string> names;
+    while (struct dirent *entry = readdir(directory)) {
+      string path = batch_list + "/" + entry->d_name;
+      struct stat path_stat;
+      if (stat(path.c_str(), &path_stat) == 0 && S_ISREG(path_stat.st_mode))
+        names.push_back(path);
+    }
+    closedir(directory);
+    std::sort(names.begin(), names.end());
+    minidump_files->insert(minidump_files->end(), names.begin(), names.end());
+    return true;
   }
-  ProcessState process_state;
-  if (minidump_processor.Process(&dump, &process_state) !=
-      google_breakpad::PROCESS_OK) {
-    BPLOG(ERROR) << "MinidumpProcessor::Process failed";
+
+  std::ifstream list_file;
+  std::istream *list = &std::cin;
+  if (batch_list != "-") {
+    list_file.open(batch_list.c_str());
+    if (!list_file) {
+      BPLOG(ERROR) << "Could not open minidump list " << batch_list;
+      return false;
+    }
+    list = &list_file;
+  }
+  string line;
+  while (std::getline(*list, line)) {
+    if (!line.empty() && line[line.size() - 1] == '\r')
+      line.erase(line.size() - 1);
+    if (!line.empty())
+      minidump_files->push_back(line);
+  }
+  return true;
+}
+
+// Returns the current time in milliseconds.
+double NowInMilliseconds() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+// The outcome of processing one minidump in batch mode.
+struct BatchResult {
+  string minidump_file;
+  bool succeeded;
+  double milliseconds;
+  // The symbol cache hits and misses while processing the minidump: the
+  // number of times the resolver already had, or did not yet have, the
+  // symbols for a module.
+  uint64_t cache_hits;
+  uint64_t cache_misses;
+};
+
+// How long modules found to have no symbols are remembered in batch mode.
+const time_t kMissingSymbolTTLSeconds = 24 * 60 * 60;
+
+// Processes every minidump named by |batch_list| (see ReadBatchList) with
+// a single supplier and resolver, so that symbols loaded for one minidump
+// are reused by the rest.  Modules found to have no symbols are not
+// looked up again for later minidumps.  If |missing_symbol_cache_file| is
+// not empty, those modules are also loaded from and saved to that file,
+// to be skipped by later runs for a day.  If |memoize_symbolization| is
+// false, each minidump's frames are looked up without a symbolization
+// memo, for comparing times with and without it.  |use_symbol_file_indexes|
+// is as for PrintMinidumpProcess.  Each minidump's report is
+// printed between "==== Begin minidump" and "==== End minidump" lines,
+// and a summary of the time taken and symbol cache use follows the last
+// report.
+//
+// Returns true if every minidump was processed successfully.
+bool PrintMinidumpProcessBatch(const string &batch_list,
+                               const std::vector<string> &symbol_paths,
+                               const string &missing_symbol_cache_file,
+                               bool memoize_symbolization,
+                               bool use_symbol_file_indexes,
+                               bool machine_readable,
+                               bool output_stack_contents,
+                               bool group_threads) {
+  std::vector<string> minidump_files;
+  if (!ReadBatchList(batch_list, &minidump_files))
+    return false;
+
+  scoped_ptr<SimpleSymbolSupplier> symbol_supplier;
+  if (!symbol_paths.empty())
+    symbol_supplier.reset(new SimpleSymbolSupplier(symbol_paths));
+
+  MissingSymbolCache missing_symbol_cache(kMissingSymbolTTLSeconds);
+  if (!missing_symbol_cache_file.empty() &&
+      !missing_symbol_cache.Load(missing_symbol_cache_file)) {
     return false;
   }
 
-  if (machine_readable) {
-    PrintProcessStateMachineReadable(process_state);
-  } else {
-    PrintProcessState(process_state, output_stack_contents, &resolver);
+  BasicSourceLineResolver resolver;
+  resolver.set_use_symbol_file_indexes(use_symbol_file_indexes);
+  StackFrameSymbolizer frame_symbolizer(symbol_supplier.get(), &resolver);
+  frame_symbolizer.set_missing_symbol_cache(&missing_symbol_cache);
+  MinidumpProcessor minidump_processor(&frame_symbolizer, false);
+  minidump_processor.set_memoize_symbolization(memoize_symbolization);
+  minidump_processor.set_deduplicate_threads(true);
+
+  std::vector<BatchResult> results;
+  double batch_start = NowInMilliseconds();
+  for (size_t i = 0; i < minidump_files.size(); ++i) {
+    BatchResult result;
+    result.minidump_file = minidump_files[i];
+
+    uint64_t hits_before, misses_before, evictions;
+    resolver.GetModuleCacheStats(&hits_before, &misses_before, &evictions);
+    printf("==== Begin minidump %s ====\n", result.minidump_file.c_str());
+    fflush(stdout);
+    double start = NowInMilliseconds();
+    result.succeeded = ProcessMinidump(&minidump_processor, &resolver,
+                                       result.minidump_file,
+                                       machine_readable,
+                                       output_stack_contents,
+                                       group_threads);
+    fflush(stdout);
+    result.milliseconds = NowInMilliseconds() - start;
+    printf("==== End minidump %s ====\n", result.minidump_file.c_str());
+
+    uint64_t hits_after, misses_after;
+    resolver.GetModuleCacheStats(&hits_after, &misses_after, &evictions);
+    result.cache_hits = hits_after - hits_before;
+    result.cache_misses = misses_after - misses_before;
+    results.push_back(result);
   }
+  double batch_milliseconds = NowInMilliseconds() - batch_start;
 
-  return true;
+  int failures = 0;
+  printf("==== Batch summary ====\n");
+  printf("%12s %10s %10s %-6s %s\n",
+         "time (ms)", "hits", "misses", "status", "minidump");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BatchResult &result = results[i];
+    if (!result.succeeded)
+      ++failures;
+    printf("%12.3f %10llu %10llu %-6s %s\n",
+           result.milliseconds,
+           static_cast<unsigned long long>(result.cache_hits),
+           static_cast<unsigned long long>(result.cache_misses),
+           result.succeeded ? "ok" : "failed",
+           result.minidump_file.c_str());
+  }
+
+  uint64_t hits, misses, evictions;
+  resolver.GetModuleCacheStats(&hits, &misses, &evictions);
+  printf("%d minidumps, %d failed, %.3f ms\n",
+         static_cast<int>(results.size()), failures, batch_milliseconds);
+  printf("Symbol cache: %llu hits, %llu misses, %llu evictions\n",
+         static_cast<unsigned long long>(hits),
+         static_cast<unsigned long long>(misses),
+         static_cast<unsigned long long>(evictions));
+
+  uint64_t lookups, saved_lookups, entries;
+  missing_symbol_cache.GetStats(&lookups, &saved_lookups, &entries);
+  printf("Missing symbols: %llu modules, %llu of %llu lookups saved\n",
+         static_cast<unsigned long long>(entries),
+         static_cast<unsigned long long>(saved_lookups),
+         static_cast<unsigned long long>(lookups));
+
+  if (memoize_symbolization) {
+    uint64_t memo_lookups, memo_hits;
+    minidump_processor.GetSymbolizationMemoStats(&memo_lookups, &memo_hits);
+    printf("Symbolization memo: %llu of %llu lookups answered "
+           "(hit rate %.1f%%)\n",
+           static_cast<unsigned long long>(memo_hits),
+           static_cast<unsigned long long>(memo_lookups),
+           memo_lookups ? 100.0 * memo_hits / memo_lookups : 0.0);
+  }
+
+  uint64_t references, strings, referenced_bytes, stored_bytes;
+  resolver.GetInternedStringStats(&references, &strings, &referenced_bytes,
+                                  &stored_bytes);
+  printf("Symbol names: %llu references to %llu strings, "
+         "%llu of %llu bytes stored (dedup ratio %.2f)\n",
+         static_cast<unsigned long long>(references),
+         static_cast<unsigned long long>(strings),
+         static_cast<unsigned long long>(stored_bytes),
+         static_cast<unsigned long long>(referenced_bytes),
+         stored_bytes ? static_cast<double>(referenced_bytes) / stored_bytes
+                      : 1.0);
+
+  if (!missing_symbol_cache_file.empty() &&
+      !missing_symbol_cache.Save(missing_symbol_cache_file)) {
+    return false;
+  }
+
+  return failures == 0;
 }
 
 void usage(const char *program_name) {
-  fprintf(stderr, "usage: %s [-m|-s] <minidump-file> [symbol-path ...]\n"
+  fprintf(stderr, "usage: %s [-i] [-g] [-m|-s] <minidump-file> "
+          "[symbol-path ...]\n"
+          "       %s -b [-n <cache-file>] [-u] [-i] [-g] [-m|-s] "
+          "<minidump-list> [symbol-path ...]\n"
+          "    -i : Load symbol files with an index written by sym_to_index\n"
+          "         in part, reading only what the stacks need\n"
+          "    -g : Print threads with the same frames together\n"
           "    -m : Output in machine-readable format\n"
-          "    -s : Output stack contents\n",
-          program_name);
+          "    -s : Output stack contents\n"
+          "    -b : Process every minidump in <minidump-list>, which is a\n"
+          "         directory, a file naming one minidump per line, or - to\n"
+          "         read names from stdin, reusing symbols between them\n"
+          "    -n : Remember modules without symbols in <cache-file> for a\n"
+          "         day, so that later batches don't look for them again\n"
+          "    -u : Don't share symbol lookups between the stacks of each\n"
+          "         minidump, to compare processing times\n",
+          program_name, program_name);
 }
 
 }  // namespace
@@ -123,40 +382,78 @@ int main(int argc, char **argv) {
   const char *minidump_file;
   bool machine_readable = false;
   bool output_stack_contents = false;
+  bool group_threads = false;
+  bool batch = false;
+  string missing_symbol_cache_file;
+  bool memoize_symbolization = true;
+  bool use_symbol_file_indexes = false;
   int symbol_path_arg;
 
-  if (strcmp(argv[1], "-m") == 0) {
-    if (argc < 3) {
-      usage(argv[0]);
-      return 1;
+  int argi = 1;
+  if (strcmp(argv[argi], "-b") == 0) {
+    batch = true;
+    ++argi;
+    if (argi < argc && strcmp(argv[argi], "-n") == 0) {
+      if (argi + 1 >= argc) {
+        usage(argv[0]);
+        return 1;
+      }
+      missing_symbol_cache_file = argv[argi + 1];
+      argi += 2;
     }
-
-    machine_readable = true;
-    minidump_file = argv[2];
-    symbol_path_arg = 3;
-  } else if (strcmp(argv[1], "-s") == 0) {
-    if (argc < 3) {
-      usage(argv[0]);
-      return 1;
+    if (argi < argc && strcmp(argv[argi], "-u") == 0) {
+      memoize_symbolization = false;
+      ++argi;
     }
+  }
+
+  if (argi < argc && strcmp(argv[argi], "-i") == 0) {
+    use_symbol_file_indexes = true;
+    ++argi;
+  }
+
+  if (argi < argc && strcmp(argv[argi], "-g") == 0) {
+    group_threads = true;
+    ++argi;
+  }
 
+  if (argi < argc && strcmp(argv[argi], "-m") == 0) {
+    machine_readable = true;
+    ++argi;
+  } else if (argi < argc && strcmp(argv[argi], "-s") == 0) {
     output_stack_contents = true;
-    minidump_file = argv[2];
-    symbol_path_arg = 3;
-  } else {
-    minidump_file = argv[1];
-    symbol_path_arg = 2;
+    ++argi;
   }
 
+  if (argi >= argc) {
+    usage(argv[0]);
+    return 1;
+  }
+  minidump_file = argv[argi];
+  symbol_path_arg = argi + 1;
+
   // extra arguments are symbol paths
   std::vector<string> symbol_paths;
   if (argc > symbol_path_arg) {
-    for (int argi = symbol_path_arg; argi < argc; ++argi)
-      symbol_paths.push_back(argv[argi]);
+    for (int path_arg = symbol_path_arg; path_arg < argc; ++path_arg)
+      symbol_paths.push_back(argv[path_arg]);
+  }
+
+  if (batch) {
+    return PrintMinidumpProcessBatch(minidump_file,
+                                     symbol_paths,
+                                     missing_symbol_cache_file,
+                                     memoize_symbolization,
+                                     use_symbol_file_indexes,
+                                     machine_readable,
+                                     output_stack_contents,
+                                     group_threads) ? 0 : 1;
   }
 
   return PrintMinidumpProcess(minidump_file,
                               symbol_paths,
+                              use_symbol_file_indexes,
                               machine_readable,
-                              output_stack_contents) ? 0 : 1;
+                              output_stack_contents,
+                              group_threads) ? 0 : 1;
 }
@@ -33,11 +33,13 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string>
 #include <vector>
 
 #include "breakpad_googletest_includes.h"
+#include "common/tests/auto_tempdir.h"
 #include "common/using_std_string.h"
 #include "google_breakpad/common/minidump_format.h"
 #include "google_breakpad/processor/minidump.h"
@@ -46,11 +48,13 @@
 
 namespace {
 
+using google_breakpad::AutoTempDir;
 using google_breakpad::Minidump;
 using google_breakpad::MinidumpContext;
 using google_breakpad::MinidumpException;
 using google_breakpad::MinidumpMemoryInfo;
 using google_breakpad::MinidumpMemoryInfoList;
+using google_breakpad::MinidumpMemory64List;
 using google_breakpad::MinidumpMemoryList;
 using google_breakpad::MinidumpMemoryRegion;
 using google_breakpad::MinidumpModule;
@@ -69,6 +73,7 @@ using google_breakpad::SynthMinidump::SystemInfo;
 using google_breakpad::SynthMinidump::Thread;
 using google_breakpad::test_assembler::kBigEndian;
 using google_breakpad::test_assembler::kLittleEndian;
+using google_breakpad::test_assembler::Label;
 using std::ifstream;
 using std::istringstream;
 using std::vector;
@@ -119,6 +124,207 @@ TEST_F(MinidumpTest, TestMinidumpFromStream) {
   //TODO: add more checks here
 }
 
+TEST_F(MinidumpTest, TestMinidumpMapped) {
+  Minidump read_minidump(minidump_file_);
+  ASSERT_TRUE(read_minidump.Read());
+  EXPECT_FALSE(read_minidump.is_mapped());
+
+  Minidump mapped_minidump(minidump_file_);
+  mapped_minidump.set_map_file(true);
+  ASSERT_TRUE(mapped_minidump.Read());
+  EXPECT_TRUE(mapped_minidump.is_mapped());
+  EXPECT_EQ(read_minidump.GetDirectoryEntryCount(),
+            mapped_minidump.GetDirectoryEntryCount());
+
+  MinidumpThreadList* read_threads = read_minidump.GetThreadList();
+  MinidumpThreadList* mapped_threads = mapped_minidump.GetThreadList();
+  ASSERT_TRUE(read_threads != NULL);
+  ASSERT_TRUE(mapped_threads != NULL);
+  ASSERT_EQ(read_threads->thread_count(), mapped_threads->thread_count());
+  for (unsigned int i = 0; i < read_threads->thread_count(); ++i) {
+    MinidumpMemoryRegion* read_stack =
+        read_threads->GetThreadAtIndex(i)->GetMemory();
+    MinidumpMemoryRegion* mapped_stack =
+        mapped_threads->GetThreadAtIndex(i)->GetMemory();
+    ASSERT_TRUE(read_stack != NULL);
+    ASSERT_TRUE(mapped_stack != NULL);
+    ASSERT_EQ(read_stack->GetBase(), mapped_stack->GetBase());
+    ASSERT_EQ(read_stack->GetSize(), mapped_stack->GetSize());
+
+    // The stack is used where it lies in the file.
+    const uint8_t* mapped_bytes = mapped_stack->GetMemory();
+    ASSERT_TRUE(mapped_bytes != NULL);
+    EXPECT_EQ(mapped_minidump.GetMappedBytes(
+                  mapped_threads->GetThreadAtIndex(i)->thread()->stack.memory.rva,
+                  mapped_stack->GetSize()),
+              mapped_bytes);
+    EXPECT_EQ(0, memcmp(read_stack->GetMemory(), mapped_bytes,
+                        read_stack->GetSize()));
+
+    MinidumpContext* read_context =
+        read_threads->GetThreadAtIndex(i)->GetContext();
+    MinidumpContext* mapped_context =
+        mapped_threads->GetThreadAtIndex(i)->GetContext();
+    ASSERT_TRUE(read_context != NULL);
+    ASSERT_TRUE(mapped_context != NULL);
+    EXPECT_EQ(read_context->GetContextCPU(), mapped_context->GetContextCPU());
+    uint64_t read_ip, mapped_ip;
+    ASSERT_TRUE(read_context->GetInstructionPointer(&read_ip));
+    ASSERT_TRUE(mapped_context->GetInstructionPointer(&mapped_ip));
+    EXPECT_EQ(read_ip, mapped_ip);
+  }
+
+  MinidumpModuleList* read_modules = read_minidump.GetModuleList();
+  MinidumpModuleList* mapped_modules = mapped_minidump.GetModuleList();
+  ASSERT_TRUE(read_modules != NULL);
+  ASSERT_TRUE(mapped_modules != NULL);
+  ASSERT_EQ(read_modules->module_count(), mapped_modules->module_count());
+  for (unsigned int i = 0; i < read_modules->module_count(); ++i) {
+    EXPECT_EQ(read_modules->GetModuleAtSequence(i)->code_file(),
+              mapped_modules->GetModuleAtSequence(i)->code_file());
+    EXPECT_EQ(read_modules->GetModuleAtSequence(i)->debug_identifier(),
+              mapped_modules->GetModuleAtSequence(i)->debug_identifier());
+  }
+
+  // Bytes outside the file are not handed out.
+  EXPECT_TRUE(mapped_minidump.GetMappedBytes(0, 0) != NULL);
+  EXPECT_TRUE(read_minidump.GetMappedBytes(0, 1) == NULL);
+  EXPECT_TRUE(mapped_minidump.GetMappedBytes(-1, 1) == NULL);
+  EXPECT_TRUE(mapped_minidump.GetMappedBytes(0, 0x7fffffff) == NULL);
+}
+
+// A mapped byte-swapped dump, and the same dump with a memory descriptor
+// that runs past the end of the file.
+TEST(Dump, MappedBigEndian) {
+  Dump dump(0, kBigEndian);
+  Memory memory(dump, 0x309d68010bd21b2cULL);
+  memory.D32(0x01020304).Append("memory contents");
+  dump.Add(&memory);
+  dump.Finish();
+  string contents;
+  ASSERT_TRUE(dump.GetContents(&contents));
+
+  AutoTempDir temp_dir;
+  string path = temp_dir.path() + "/truncated.dmp";
+  {
+    std::ofstream file(path.c_str(), std::ios::out | std::ios::binary);
+    file.write(contents.data(), contents.size());
+  }
+
+  Minidump minidump(path);
+  minidump.set_map_file(true);
+  ASSERT_TRUE(minidump.Read());
+  ASSERT_TRUE(minidump.is_mapped());
+  ASSERT_TRUE(minidump.swap());
+  MinidumpMemoryList* memory_list = minidump.GetMemoryList();
+  ASSERT_TRUE(memory_list != NULL);
+  MinidumpMemoryRegion* region = memory_list->GetMemoryRegionAtIndex(0);
+  ASSERT_TRUE(region != NULL);
+  uint32_t value;
+  ASSERT_TRUE(region->GetMemoryAtAddress(0x309d68010bd21b2cULL, &value));
+  EXPECT_EQ(0x01020304U, value);
+
+  // Find the memory descriptor, and make its size larger than the file.
+  const char kBase[] = "\x30\x9d\x68\x01\x0b\xd2\x1b\x2c";
+  size_t descriptor = contents.find(string(kBase, 8));
+  ASSERT_NE(string::npos, descriptor);
+  contents.replace(descriptor + 8, 4, string("\x00\x00\x10\x00", 4));
+  {
+    std::ofstream file(path.c_str(), std::ios::out | std::ios::binary);
+    file.write(contents.data(), contents.size());
+  }
+  Minidump truncated(path);
+  truncated.set_map_file(true);
+  ASSERT_TRUE(truncated.Read());
+  ASSERT_TRUE(truncated.is_mapped());
+  memory_list = truncated.GetMemoryList();
+  ASSERT_TRUE(memory_list != NULL);
+  region = memory_list->GetMemoryRegionAtIndex(0);
+  ASSERT_TRUE(region != NULL);
+  EXPECT_TRUE(region->GetMemory() == NULL);
+  EXPECT_FALSE(region->GetMemoryAtAddress(0x309d68010bd21b2cULL, &value));
+}
+
+// Returns a checksum of the threads, contexts, stacks and modules of
+// |minidump|, or 0 if any of them can't be read.
+uint64_t ChecksumMinidump(Minidump* minidump) {
+  uint64_t checksum = 1;
+  MinidumpThreadList* threads = minidump->GetThreadList();
+  MinidumpModuleList* modules = minidump->GetModuleList();
+  if (!threads || !modules)
+    return 0;
+  for (unsigned int i = 0; i < threads->thread_count(); ++i) {
+    MinidumpThread* thread = threads->GetThreadAtIndex(i);
+    MinidumpContext* context = thread->GetContext();
+    MinidumpMemoryRegion* stack = thread->GetMemory();
+    uint64_t instruction_pointer;
+    if (!context || !stack ||
+        !context->GetInstructionPointer(&instruction_pointer)) {
+      return 0;
+    }
+    checksum = checksum * 31 + instruction_pointer;
+    for (uint64_t address = stack->GetBase();
+         address + 4 <= stack->GetBase() + stack->GetSize();
+         address += 4) {
+      uint32_t value;
+      if (!stack->GetMemoryAtAddress(address, &value))
+        return 0;
+      checksum = checksum * 31 + value;
+    }
+  }
+  for (unsigned int i = 0; i < modules->module_count(); ++i) {
+    checksum = checksum * 31 +
+               modules->GetModuleAtIndex(i)->debug_identifier().size();
+  }
+  return checksum;
+}
+
+void* ChecksumMinidumpThread(void* minidump) {
+  return reinterpret_cast<void*>(static_cast<uintptr_t>(
+      ChecksumMinidump(static_cast<Minidump*>(minidump))));
+}
+
+// Several threads read the same streams, contexts and stacks from a
+// Minidump at once, both through pread and through a mapping.
+TEST_F(MinidumpTest, TestConcurrentReaders) {
+  Minidump serial_minidump(minidump_file_);
+  ASSERT_TRUE(serial_minidump.Read());
+  uintptr_t expected =
+      static_cast<uintptr_t>(ChecksumMinidump(&serial_minidump));
+  ASSERT_NE(0U, expected);
+
+  const int kThreads = 8;
+  for (int map_file = 0; map_file < 2; ++map_file) {
+    Minidump minidump(minidump_file_);
+    minidump.set_map_file(map_file);
+    ASSERT_TRUE(minidump.Read());
+    pthread_t threads[kThreads];
+    for (int i = 0; i < kThreads; ++i) {
+      ASSERT_EQ(0, pthread_create(&threads[i], NULL, ChecksumMinidumpThread,
+                                  &minidump));
+    }
+    for (int i = 0; i < kThreads; ++i) {
+      void* checksum;
+      ASSERT_EQ(0, pthread_join(threads[i], &checksum));
+      EXPECT_EQ(expected, reinterpret_cast<uintptr_t>(checksum));
+    }
+  }
+}
+
+TEST_F(MinidumpTest, TestReadBytesAt) {
+  Minidump minidump(minidump_file_);
+  ASSERT_TRUE(minidump.Read());
+  ASSERT_TRUE(minidump.SeekSet(8));
+  uint32_t signature;
+  ASSERT_TRUE(minidump.ReadBytesAt(0, &signature, sizeof(signature)));
+  EXPECT_EQ(uint32_t(MD_HEADER_SIGNATURE), signature);
+  // The file position is left alone.
+  EXPECT_EQ(8, minidump.Tell());
+  EXPECT_FALSE(minidump.ReadBytesAt(-1, &signature, sizeof(signature)));
+  EXPECT_FALSE(minidump.ReadBytesAt(0x7fffffff, &signature,
+                                    sizeof(signature)));
+}
+
 TEST(Dump, ReadBackEmpty) {
   Dump dump(0);
   dump.Finish();
@@ -206,6 +412,77 @@ TEST(Dump, OneMemory) {
   ASSERT_TRUE(memcmp("memory contents", region1_bytes, 15) == 0);
 }
 
+// A 64-bit memory list whose last region is too large to cache, read
+// both through an istream and through a mapping.
+TEST(Dump, Memory64List) {
+  Dump dump(0, kBigEndian);
+  dump.start() = 0;
+  Stream list(dump, MD_MEMORY_64_LIST_STREAM);
+  Label base_rva;
+  list.D64(3).D64(base_rva)
+      .D64(0x3000).D64(16)
+      .D64(0x1000).D64(8)
+      .D64(0x2000).D64(64);
+  dump.Add(&list);
+  dump.Mark(&base_rva);
+  dump.D32(0x01020304).Append(12, 0);
+  dump.D64(0x0102030405060708ULL);
+  dump.Append(40, 0).D32(0xdeadbeef).Append(20, 0);
+  dump.Finish();
+  string contents;
+  ASSERT_TRUE(dump.GetContents(&contents));
+
+  AutoTempDir temp_dir;
+  string path = temp_dir.path() + "/memory64.dmp";
+  {
+    std::ofstream file(path.c_str(), std::ios::out | std::ios::binary);
+    file.write(contents.data(), contents.size());
+  }
+
+  uint32_t max_bytes = MinidumpMemoryRegion::max_bytes();
+  MinidumpMemoryRegion::set_max_bytes(32);
+  for (int map_file = 0; map_file < 2; ++map_file) {
+    Minidump minidump(path);
+    minidump.set_map_file(map_file);
+    ASSERT_TRUE(minidump.Read());
+    ASSERT_EQ(map_file != 0, minidump.is_mapped());
+    ASSERT_TRUE(minidump.GetMemoryList() == NULL);
+    MinidumpMemory64List *memory_list = minidump.GetMemory64List();
+    ASSERT_TRUE(memory_list != NULL);
+    ASSERT_EQ(3U, memory_list->region_count());
+
+    MinidumpMemoryRegion *region =
+        memory_list->GetMemoryRegionForAddress(0x1004);
+    ASSERT_TRUE(region != NULL);
+    EXPECT_EQ(0x1000U, region->GetBase());
+    EXPECT_EQ(8U, region->GetSize());
+    uint64_t value64;
+    ASSERT_TRUE(region->GetMemoryAtAddress(0x1000, &value64));
+    EXPECT_EQ(0x0102030405060708ULL, value64);
+
+    region = memory_list->GetMemoryRegionForAddress(0x300f);
+    ASSERT_TRUE(region != NULL);
+    uint32_t value32;
+    ASSERT_TRUE(region->GetMemoryAtAddress(0x3000, &value32));
+    EXPECT_EQ(0x01020304U, value32);
+    EXPECT_FALSE(region->GetMemoryAtAddress(0x300e, &value32));
+
+    // The largest region is read a value at a time.
+    region = memory_list->GetMemoryRegionForAddress(0x2000);
+    ASSERT_TRUE(region != NULL);
+    EXPECT_EQ(64U, region->GetSize());
+    EXPECT_TRUE(region->GetMemory() == NULL);
+    ASSERT_TRUE(region->GetMemoryAtAddress(0x2028, &value32));
+    EXPECT_EQ(0xdeadbeefU, value32);
+    ASSERT_TRUE(region->GetMemoryAtAddress(0x2000, &value32));
+    EXPECT_EQ(0U, value32);
+
+    EXPECT_TRUE(memory_list->GetMemoryRegionForAddress(0x1008) == NULL);
+    EXPECT_TRUE(memory_list->GetMemoryRegionForAddress(0x2040) == NULL);
+  }
+  MinidumpMemoryRegion::set_max_bytes(max_bytes);
+}
+
 // One thread --- and its requisite entourage.
 TEST(Dump, OneThread) {
   Dump dump(0, kLittleEndian);
@@ -0,0 +1,238 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// missing_symbol_cache.cc: Remembers which modules have no symbols.
+//
+// See missing_symbol_cache.h for documentation.
+
+#include "processor/missing_symbol_cache.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+
+#include "google_breakpad/processor/code_module.h"
+#include "processor/logging.h"
+
+namespace google_breakpad {
+
+MissingSymbolCache::MissingSymbolCache(time_t ttl_seconds)
+    : ttl_seconds_(ttl_seconds),
+      entries_(),
+      lookups_(0),
+      hits_(0) {
+}
+
+MissingSymbolCache::~MissingSymbolCache() {
+}
+
+// static
+MissingSymbolCache::Key MissingSymbolCache::KeyForModule(
+    const CodeModule *module) {
+  return Key(module->debug_file(), module->debug_identifier());
+}
+
+bool MissingSymbolCache::IsExpired(time_t added, time_t now) const {
+  return now - added >= ttl_seconds_;
+}
+
+// static
+bool MissingSymbolCache::IsCacheable(const CodeModule *module) {
+  // Modules without a debug identifier can't be told apart from each
+  // other, so finding no symbols for one says nothing about the rest.
+  return module && !module->debug_identifier().empty();
+}
+
+bool MissingSymbolCache::IsMissing(const CodeModule *module) {
+  if (!IsCacheable(module))
+    return false;
+
+  Key key = KeyForModule(module);
+  time_t now = Now();
+  mutex_.Acquire();
+  ++lookups_;
+  bool missing = false;
+  EntryMap::iterator entry = entries_.find(key);
+  if (entry != entries_.end()) {
+    if (IsExpired(entry->second, now)) {
+      entries_.erase(entry);
+    } else {
+      ++hits_;
+      missing = true;
+    }
+  }
+  mutex_.Release();
+  return missing;
+}
+
+void MissingSymbolCache::AddMissing(const CodeModule *module) {
+  if (!IsCacheable(module))
+    return;
+
+  Key key = KeyForModule(module);
+  time_t now = Now();
+  mutex_.Acquire();
+  entries_[key] = now;
+  mutex_.Release();
+}
+
+void MissingSymbolCache::Clear() {
+  mutex_.Acquire();
+  entries_.clear();
+  mutex_.Release();
+}
+
+// Each entry is a line holding the time it was added, in seconds since
+// the epoch, the debug identifier and the debug file, separated by tabs.
+bool MissingSymbolCache::Load(const string &path) {
+  std::ifstream file(path.c_str());
+  if (!file) {
+    if (errno == ENOENT)
+      return true;
+    BPLOG(ERROR) << "Could not open missing symbol cache " << path;
+    return false;
+  }
+
+  time_t now = Now();
+  int loaded = 0;
+  int malformed = 0;
+  string line;
+  mutex_.Acquire();
+  while (std::getline(file, line)) {
+    string::size_type identifier_start = line.find('\t');
+    string::size_type file_start = identifier_start == string::npos ?
+        string::npos : line.find('\t', identifier_start + 1);
+    char *end;
+    long long added = strtoll(line.c_str(), &end, 10);
+    if (file_start == string::npos ||
+        end != line.c_str() + identifier_start ||
+        file_start == identifier_start + 1) {
+      ++malformed;
+      continue;
+    }
+    if (IsExpired(added, now))
+      continue;
+
+    Key key(line.substr(file_start + 1),
+            line.substr(identifier_start + 1,
+                        file_start - identifier_start - 1));
+    EntryMap::iterator entry = entries_.find(key);
+    if (entry == entries_.end()) {
+      entries_[key] = added;
+    } else if (entry->second < added) {
+      entry->second = added;
+    }
+    ++loaded;
+  }
+  mutex_.Release();
+
+  if (malformed)
+    BPLOG(ERROR) << "Skipped " << malformed << " malformed lines in " << path;
+  BPLOG(INFO) << "Loaded " << loaded << " modules without symbols from "
+              << path;
+  return true;
+}
+
+bool MissingSymbolCache::Save(const string &path) {
+  // Other processes sharing the file may have saved entries since it was
+  // loaded; add them, so that saving over the file doesn't drop them.
+  Load(path);
+
+  // Write a uniquely named temporary file next to the cache and rename it
+  // over the old one, so that other processes never read a partly written
+  // cache, nor write the same temporary file when saving at the same time.
+  string temporary_path = path + ".XXXXXX";
+  int fd = mkstemp(&temporary_path[0]);
+  FILE *file = NULL;
+  if (fd != -1) {
+    // mkstemp creates the file readable only by its owner.
+    fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    file = fdopen(fd, "w");
+    if (!file) {
+      close(fd);
+      remove(temporary_path.c_str());
+    }
+  }
+  if (!file) {
+    BPLOG(ERROR) << "Could not create missing symbol cache "
+                 << temporary_path;
+    return false;
+  }
+
+  time_t now = Now();
+  mutex_.Acquire();
+  for (EntryMap::const_iterator entry = entries_.begin();
+       entry != entries_.end(); ++entry) {
+    const string &debug_file = entry->first.first;
+    const string &debug_identifier = entry->first.second;
+    // Names that would break the line format can't be saved.
+    if (IsExpired(entry->second, now) ||
+        debug_file.find_first_of("\t\r\n") != string::npos ||
+        debug_identifier.find_first_of("\t\r\n") != string::npos) {
+      continue;
+    }
+    fprintf(file, "%lld\t%s\t%s\n", static_cast<long long>(entry->second),
+            debug_identifier.c_str(), debug_file.c_str());
+  }
+  mutex_.Release();
+
+  bool write_failed = ferror(file) != 0;
+  if (fclose(file) != 0 || write_failed) {
+    BPLOG(ERROR) << "Could not write missing symbol cache "
+                 << temporary_path;
+    remove(temporary_path.c_str());
+    return false;
+  }
+  if (rename(temporary_path.c_str(), path.c_str()) != 0) {
+    BPLOG(ERROR) << "Could not rename " << temporary_path << " to " << path;
+    remove(temporary_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+void MissingSymbolCache::GetStats(uint64_t *lookups,
+                                  uint64_t *hits,
+                                  uint64_t *entries) {
+  mutex_.Acquire();
+  if (lookups)
+    *lookups = lookups_;
+  if (hits)
+    *hits = hits_;
+  if (entries)
+    *entries = entries_.size();
+  mutex_.Release();
+}
+
+}  // namespace google_breakpad
@@ -0,0 +1,130 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// missing_symbol_cache.h: Remembers which modules have no symbols.
+//
+// StackFrameSymbolizer remembers the modules it found no symbols for
+// while processing one minidump, and forgets them when it is Reset for
+// the next.  Minidumps from the same fleet tend to contain the same
+// system libraries, which often have no symbols, so each minidump asks
+// the symbol supplier for them again.  A MissingSymbolCache remembers
+// them across minidumps, keyed by debug file and debug identifier, for a
+// limited time, so that newly uploaded symbols are eventually picked up.
+// It can be saved to a file and loaded again by the next process.
+//
+// A MissingSymbolCache may be shared by several StackFrameSymbolizers,
+// and used from several threads.
+
+#ifndef PROCESSOR_MISSING_SYMBOL_CACHE_H__
+#define PROCESSOR_MISSING_SYMBOL_CACHE_H__
+
+#include <time.h>
+
+#include <map>
+#include <string>
+#include <utility>
+
+#include "common/using_std_string.h"
+#include "google_breakpad/common/breakpad_types.h"
+#include "processor/thread_primitives.h"
+
+namespace google_breakpad {
+
+class CodeModule;
+
+class MissingSymbolCache {
+ public:
+  // Modules are remembered as missing symbols for |ttl_seconds| after
+  // they were added.
+  explicit MissingSymbolCache(time_t ttl_seconds);
+  virtual ~MissingSymbolCache();
+
+  // Returns true if |module| was added less than the TTL ago.  Modules
+  // without a debug identifier are never cached, so this returns false
+  // for them without counting a lookup.
+  bool IsMissing(const CodeModule *module);
+
+  // Records that the symbol supplier has no symbols for |module|, unless
+  // |module| has no debug identifier.
+  void AddMissing(const CodeModule *module);
+
+  // Forgets all modules.
+  void Clear();
+
+  // Adds the entries in the file at |path|, written by Save, that have
+  // not expired.  Returns false if the file can't be read; a file that
+  // doesn't exist is treated as empty.
+  bool Load(const string &path);
+
+  // Writes the entries that have not expired to the file at |path|,
+  // after first adding the ones already in it, so that processes sharing
+  // the file keep each other's entries.  Returns false on failure.
+  bool Save(const string &path);
+
+  // Sets |*lookups| to the number of IsMissing calls, |*hits| to the
+  // number that returned true, each saving a symbol supplier lookup, and
+  // |*entries| to the number of modules currently remembered.
+  void GetStats(uint64_t *lookups, uint64_t *hits, uint64_t *entries);
+
+ protected:
+  // Returns the current time.  Tests override this.
+  virtual time_t Now() const { return time(NULL); }
+
+ private:
+  // The debug file and debug identifier of a module.
+  typedef std::pair<string, string> Key;
+
+  // When each module was added.
+  typedef std::map<Key, time_t> EntryMap;
+
+  static Key KeyForModule(const CodeModule *module);
+
+  // Returns true if |module| is not NULL and has a debug identifier.
+  static bool IsCacheable(const CodeModule *module);
+
+  // Returns true if an entry added at |added| has expired by |now|.
+  bool IsExpired(time_t added, time_t now) const;
+
+  const time_t ttl_seconds_;
+
+  // Protects everything below.
+  Mutex mutex_;
+  EntryMap entries_;
+  uint64_t lookups_;
+  uint64_t hits_;
+
+  // Disallow copy constructor and assignment operator.
+  MissingSymbolCache(const MissingSymbolCache&);
+  void operator=(const MissingSymbolCache&);
+};
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_MISSING_SYMBOL_CACHE_H__
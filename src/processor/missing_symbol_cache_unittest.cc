@@ -0,0 +1,221 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// missing_symbol_cache_unittest.cc: Unit tests for MissingSymbolCache.
+
+#include <dirent.h>
+#include <stdio.h>
+
+#include <string>
+
+#include "breakpad_googletest_includes.h"
+#include "common/tests/auto_tempdir.h"
+#include "common/using_std_string.h"
+#include "processor/basic_code_module.h"
+#include "processor/missing_symbol_cache.h"
+
+namespace {
+
+using google_breakpad::AutoTempDir;
+using google_breakpad::BasicCodeModule;
+using google_breakpad::MissingSymbolCache;
+
+const time_t kTTL = 3600;
+
+// A cache whose clock the test sets.
+class TestMissingSymbolCache : public MissingSymbolCache {
+ public:
+  TestMissingSymbolCache() : MissingSymbolCache(kTTL), now_(1000000) { }
+  void Advance(time_t seconds) { now_ += seconds; }
+
+ protected:
+  virtual time_t Now() const { return now_; }
+
+ private:
+  time_t now_;
+};
+
+// A module identified by its debug file and identifier.
+class TestModule : public BasicCodeModule {
+ public:
+  TestModule(const string &debug_file, const string &debug_identifier)
+      : BasicCodeModule(0x10000, 0x1000, "/lib/" + debug_file, "",
+                        debug_file, debug_identifier, "") { }
+};
+
+TEST(MissingSymbolCacheTest, AddAndLookUp) {
+  TestMissingSymbolCache cache;
+  TestModule libc("libc.so", "0123456789ABCDEF0");
+  TestModule other_libc("libc.so", "FEDCBA98765432100");
+  TestModule libm("libm.so", "0123456789ABCDEF0");
+
+  EXPECT_FALSE(cache.IsMissing(&libc));
+  cache.AddMissing(&libc);
+  EXPECT_TRUE(cache.IsMissing(&libc));
+  // Both the debug file and the identifier must match.
+  EXPECT_FALSE(cache.IsMissing(&other_libc));
+  EXPECT_FALSE(cache.IsMissing(&libm));
+  EXPECT_FALSE(cache.IsMissing(NULL));
+
+  uint64_t lookups, hits, entries;
+  cache.GetStats(&lookups, &hits, &entries);
+  EXPECT_EQ(4U, lookups);
+  EXPECT_EQ(1U, hits);
+  EXPECT_EQ(1U, entries);
+
+  cache.Clear();
+  EXPECT_FALSE(cache.IsMissing(&libc));
+}
+
+TEST(MissingSymbolCacheTest, ModulesWithoutIdentifierNotCached) {
+  // Modules without a debug identifier would all share one entry, so
+  // none of them is cached.
+  TestMissingSymbolCache cache;
+  TestModule libc("libc.so", "");
+  TestModule unnamed("", "");
+  cache.AddMissing(&libc);
+  cache.AddMissing(&unnamed);
+  EXPECT_FALSE(cache.IsMissing(&libc));
+  EXPECT_FALSE(cache.IsMissing(&unnamed));
+
+  uint64_t lookups, hits, entries;
+  cache.GetStats(&lookups, &hits, &entries);
+  EXPECT_EQ(0U, lookups);
+  EXPECT_EQ(0U, hits);
+  EXPECT_EQ(0U, entries);
+}
+
+TEST(MissingSymbolCacheTest, Expiry) {
+  TestMissingSymbolCache cache;
+  TestModule libc("libc.so", "0123456789ABCDEF0");
+  cache.AddMissing(&libc);
+  cache.Advance(kTTL - 1);
+  EXPECT_TRUE(cache.IsMissing(&libc));
+  cache.Advance(1);
+  EXPECT_FALSE(cache.IsMissing(&libc));
+
+  uint64_t entries;
+  cache.GetStats(NULL, NULL, &entries);
+  EXPECT_EQ(0U, entries);
+
+  // Adding the module again restarts its TTL.
+  cache.AddMissing(&libc);
+  cache.Advance(kTTL - 1);
+  EXPECT_TRUE(cache.IsMissing(&libc));
+}
+
+TEST(MissingSymbolCacheTest, SaveAndLoad) {
+  AutoTempDir temp_dir;
+  string path = temp_dir.path() + "/missing_symbols";
+  TestModule libc("libc.so", "0123456789ABCDEF0");
+  TestModule spaces("c:\\Program Files\\a b.pdb", "1");
+  TestModule old("old.so", "0123456789ABCDEF0");
+  TestModule no_identifier("anonymous", "");
+
+  TestMissingSymbolCache cache;
+  // Loading a cache that doesn't exist yet succeeds.
+  EXPECT_TRUE(cache.Load(path));
+  cache.AddMissing(&old);
+  cache.Advance(10);
+  cache.AddMissing(&libc);
+  cache.AddMissing(&spaces);
+  cache.AddMissing(&no_identifier);
+  ASSERT_TRUE(cache.Save(path));
+
+  TestMissingSymbolCache loaded;
+  loaded.Advance(kTTL + 5);
+  ASSERT_TRUE(loaded.Load(path));
+  EXPECT_TRUE(loaded.IsMissing(&libc));
+  EXPECT_TRUE(loaded.IsMissing(&spaces));
+  // Modules without a debug identifier are never cached.
+  EXPECT_FALSE(loaded.IsMissing(&no_identifier));
+  // Entries keep the time they were first added.
+  EXPECT_FALSE(loaded.IsMissing(&old));
+  loaded.Advance(10);
+  EXPECT_FALSE(loaded.IsMissing(&libc));
+}
+
+TEST(MissingSymbolCacheTest, SaveKeepsEntriesSavedByOthers) {
+  AutoTempDir temp_dir;
+  string path = temp_dir.path() + "/missing_symbols";
+  TestModule libc("libc.so", "0123456789ABCDEF0");
+  TestModule libm("libm.so", "0123456789ABCDEF0");
+
+  // Two processes sharing the cache, each saving what it found.
+  TestMissingSymbolCache first;
+  TestMissingSymbolCache second;
+  ASSERT_TRUE(first.Load(path));
+  ASSERT_TRUE(second.Load(path));
+  first.AddMissing(&libc);
+  ASSERT_TRUE(first.Save(path));
+  second.AddMissing(&libm);
+  ASSERT_TRUE(second.Save(path));
+
+  TestMissingSymbolCache loaded;
+  ASSERT_TRUE(loaded.Load(path));
+  EXPECT_TRUE(loaded.IsMissing(&libc));
+  EXPECT_TRUE(loaded.IsMissing(&libm));
+
+  // No temporary files are left behind.
+  DIR *dir = opendir(temp_dir.path().c_str());
+  ASSERT_TRUE(dir);
+  int files = 0;
+  while (struct dirent *entry = readdir(dir)) {
+    if (entry->d_name[0] != '.')
+      ++files;
+  }
+  closedir(dir);
+  EXPECT_EQ(1, files);
+}
+
+TEST(MissingSymbolCacheTest, LoadSkipsMalformedLines) {
+  AutoTempDir temp_dir;
+  string path = temp_dir.path() + "/missing_symbols";
+  FILE *file = fopen(path.c_str(), "w");
+  ASSERT_TRUE(file);
+  fprintf(file, "garbage\n"
+                "1000000\tno file\n"
+                "x1000000\t0123456789ABCDEF0\tlibm.so\n"
+                "1000000\t\tlibz.so\n"
+                "1000000\t0123456789ABCDEF0\tlibc.so\n");
+  fclose(file);
+
+  TestMissingSymbolCache cache;
+  ASSERT_TRUE(cache.Load(path));
+  TestModule libc("libc.so", "0123456789ABCDEF0");
+  TestModule libm("libm.so", "0123456789ABCDEF0");
+  EXPECT_TRUE(cache.IsMissing(&libc));
+  EXPECT_FALSE(cache.IsMissing(&libm));
+  uint64_t entries;
+  cache.GetStats(NULL, NULL, &entries);
+  EXPECT_EQ(1U, entries);
+}
+
+}  // namespace
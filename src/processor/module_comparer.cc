@@ -36,6 +36,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include "common/scoped_ptr.h"
 #include "processor/basic_code_module.h"
@@ -86,6 +87,8 @@ bool ModuleComparer::Compare(const string &symbol_data) {
 // Traversal the content of module and do comparison
 bool ModuleComparer::CompareModule(const BasicModule *basic_module,
                                   const FastModule *fast_module) const {
+  basic_module->ParseAllFunctionLines();
+
   // Compare name_.
   ASSERT_TRUE(basic_module->name_ == fast_module->name_);
 
@@ -97,7 +100,7 @@ bool ModuleComparer::CompareModule(const BasicModule *basic_module,
         && iter2 != fast_module->files_.end()) {
       ASSERT_TRUE(iter1->first == iter2.GetKey());
       string tmp(iter2.GetValuePtr());
-      ASSERT_TRUE(iter1->second == tmp);
+      ASSERT_TRUE(iter1->second.str() == tmp);
       ++iter1;
       ++iter2;
     }
@@ -107,11 +110,14 @@ bool ModuleComparer::CompareModule(const BasicModule *basic_module,
 
   // Compare functions_:
   {
+    RangeMap<MemAddr, linked_ptr<BasicFunc> >::AddressToRangeMap storage;
+    const RangeMap<MemAddr, linked_ptr<BasicFunc> >::AddressToRangeMap
+        &functions = basic_module->functions_.Ranges(&storage);
     RangeMap<MemAddr, linked_ptr<BasicFunc> >::MapConstIterator iter1;
     StaticRangeMap<MemAddr, FastFunc>::MapConstIterator iter2;
-    iter1 = basic_module->functions_.map_.begin();
+    iter1 = functions.begin();
     iter2 = fast_module->functions_.map_.begin();
-    while (iter1 != basic_module->functions_.map_.end()
+    while (iter1 != functions.end()
         && iter2 != fast_module->functions_.map_.end()) {
       ASSERT_TRUE(iter1->first == iter2.GetKey());
       ASSERT_TRUE(iter1->second.base() == iter2.GetValuePtr()->base());
@@ -120,17 +126,21 @@ bool ModuleComparer::CompareModule(const BasicModule *basic_module,
       ++iter1;
       ++iter2;
     }
-    ASSERT_TRUE(iter1 == basic_module->functions_.map_.end());
+    ASSERT_TRUE(iter1 == functions.end());
     ASSERT_TRUE(iter2 == fast_module->functions_.map_.end());
   }
 
   // Compare public_symbols_:
   {
+    AddressMap<MemAddr, linked_ptr<BasicPubSymbol> >::AddressToEntryMap
+        storage;
+    const AddressMap<MemAddr, linked_ptr<BasicPubSymbol> >::AddressToEntryMap
+        &public_symbols = basic_module->public_symbols_.Entries(&storage);
     AddressMap<MemAddr, linked_ptr<BasicPubSymbol> >::MapConstIterator iter1;
     StaticAddressMap<MemAddr, FastPubSymbol>::MapConstIterator iter2;
-    iter1 = basic_module->public_symbols_.map_.begin();
+    iter1 = public_symbols.begin();
     iter2 = fast_module->public_symbols_.map_.begin();
-    while (iter1 != basic_module->public_symbols_.map_.end()
+    while (iter1 != public_symbols.end()
           && iter2 != fast_module->public_symbols_.map_.end()) {
       ASSERT_TRUE(iter1->first == iter2.GetKey());
       ASSERT_TRUE(ComparePubSymbol(
@@ -138,7 +148,7 @@ bool ModuleComparer::CompareModule(const BasicModule *basic_module,
       ++iter1;
       ++iter2;
     }
-    ASSERT_TRUE(iter1 == basic_module->public_symbols_.map_.end());
+    ASSERT_TRUE(iter1 == public_symbols.end());
     ASSERT_TRUE(iter2 == fast_module->public_symbols_.map_.end());
   }
 
@@ -150,11 +160,14 @@ bool ModuleComparer::CompareModule(const BasicModule *basic_module,
 
   // Compare cfi_initial_rules_:
   {
+    RangeMap<MemAddr, string>::AddressToRangeMap storage;
+    const RangeMap<MemAddr, string>::AddressToRangeMap &cfi_initial_rules =
+        basic_module->cfi_initial_rules_.Ranges(&storage);
     RangeMap<MemAddr, string>::MapConstIterator iter1;
     StaticRangeMap<MemAddr, char>::MapConstIterator iter2;
-    iter1 = basic_module->cfi_initial_rules_.map_.begin();
+    iter1 = cfi_initial_rules.begin();
     iter2 = fast_module->cfi_initial_rules_.map_.begin();
-    while (iter1 != basic_module->cfi_initial_rules_.map_.end()
+    while (iter1 != cfi_initial_rules.end()
         && iter2 != fast_module->cfi_initial_rules_.map_.end()) {
       ASSERT_TRUE(iter1->first == iter2.GetKey());
       ASSERT_TRUE(iter1->second.base() == iter2.GetValuePtr()->base());
@@ -163,7 +176,7 @@ bool ModuleComparer::CompareModule(const BasicModule *basic_module,
       ++iter1;
       ++iter2;
     }
-    ASSERT_TRUE(iter1 == basic_module->cfi_initial_rules_.map_.end());
+    ASSERT_TRUE(iter1 == cfi_initial_rules.end());
     ASSERT_TRUE(iter2 == fast_module->cfi_initial_rules_.map_.end());
   }
 
@@ -192,25 +205,26 @@ bool ModuleComparer::CompareFunction(const BasicFunc *basic_func,
                                     const FastFunc *fast_func_raw) const {
   FastFunc* fast_func = new FastFunc();
   fast_func->CopyFrom(fast_func_raw);
-  ASSERT_TRUE(basic_func->name == fast_func->name);
+  ASSERT_TRUE(basic_func->name.str() == fast_func->name);
   ASSERT_TRUE(basic_func->address == fast_func->address);
   ASSERT_TRUE(basic_func->size == fast_func->size);
 
   // compare range map of lines:
-  RangeMap<MemAddr, linked_ptr<BasicLine> >::MapConstIterator iter1;
+  std::vector<BasicLine> lines;
+  basic_func->lines.GetLines(&lines);
+  std::vector<BasicLine>::const_iterator iter1;
   StaticRangeMap<MemAddr, FastLine>::MapConstIterator iter2;
-  iter1 = basic_func->lines.map_.begin();
+  iter1 = lines.begin();
   iter2 = fast_func->lines.map_.begin();
-  while (iter1 != basic_func->lines.map_.end()
+  while (iter1 != lines.end()
       && iter2 != fast_func->lines.map_.end()) {
-    ASSERT_TRUE(iter1->first == iter2.GetKey());
-    ASSERT_TRUE(iter1->second.base() == iter2.GetValuePtr()->base());
-    ASSERT_TRUE(CompareLine(iter1->second.entry().get(),
-                            iter2.GetValuePtr()->entryptr()));
+    ASSERT_TRUE(iter1->address + iter1->size - 1 == iter2.GetKey());
+    ASSERT_TRUE(iter1->address == iter2.GetValuePtr()->base());
+    ASSERT_TRUE(CompareLine(&*iter1, iter2.GetValuePtr()->entryptr()));
     ++iter1;
     ++iter2;
   }
-  ASSERT_TRUE(iter1 == basic_func->lines.map_.end());
+  ASSERT_TRUE(iter1 == lines.end());
   ASSERT_TRUE(iter2 == fast_func->lines.map_.end());
 
   delete fast_func;
@@ -235,7 +249,7 @@ bool ModuleComparer::ComparePubSymbol(const BasicPubSymbol* basic_ps,
                                      const FastPubSymbol* fastps_raw) const {
   FastPubSymbol *fast_ps = new FastPubSymbol;
   fast_ps->CopyFrom(fastps_raw);
-  ASSERT_TRUE(basic_ps->name == fast_ps->name);
+  ASSERT_TRUE(basic_ps->name.str() == fast_ps->name);
   ASSERT_TRUE(basic_ps->address == fast_ps->address);
   ASSERT_TRUE(basic_ps->parameter_size == fast_ps->parameter_size);
   delete fast_ps;
@@ -272,16 +286,19 @@ bool ModuleComparer::CompareCRM(
     ASSERT_TRUE(CompareWFI(*(basic_crm->entry_.get()), newwfi));
   }
 
-  if ((!basic_crm->map_ || basic_crm->map_->empty())
+  ContainedRangeMap<MemAddr, linked_ptr<WFI> >::AddressToRangeMap storage;
+  const ContainedRangeMap<MemAddr, linked_ptr<WFI> >::AddressToRangeMap
+      *children = basic_crm->Children(&storage);
+  if ((!children || children->empty())
       || fast_crm->map_.empty()) {
-    ASSERT_TRUE((!basic_crm->map_ || basic_crm->map_->empty())
+    ASSERT_TRUE((!children || children->empty())
                && fast_crm->map_.empty());
   } else {
     ContainedRangeMap<MemAddr, linked_ptr<WFI> >::MapConstIterator iter1;
     StaticContainedRangeMap<MemAddr, char>::MapConstIterator iter2;
-    iter1 = basic_crm->map_->begin();
+    iter1 = children->begin();
     iter2 = fast_crm->map_.begin();
-    while (iter1 != basic_crm->map_->end()
+    while (iter1 != children->end()
         && iter2 != fast_crm->map_.end()) {
       ASSERT_TRUE(iter1->first == iter2.GetKey());
       StaticContainedRangeMap<MemAddr, char> *child =
@@ -292,7 +309,7 @@ bool ModuleComparer::CompareCRM(
       ++iter1;
       ++iter2;
     }
-    ASSERT_TRUE(iter1 == basic_crm->map_->end());
+    ASSERT_TRUE(iter1 == children->end());
     ASSERT_TRUE(iter2 == fast_crm->map_.end());
   }
 
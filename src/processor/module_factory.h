@@ -51,11 +51,25 @@ class ModuleFactory {
 
 class BasicModuleFactory : public ModuleFactory {
  public:
+  BasicModuleFactory() : lazy_line_parsing_(false) { }
   virtual ~BasicModuleFactory() { }
   virtual BasicSourceLineResolver::Module* CreateModule(
       const string &name) const {
-    return new BasicSourceLineResolver::Module(name);
+    return new BasicSourceLineResolver::Module(name, lazy_line_parsing_,
+                                               &strings_);
   }
+
+  // Whether modules created from now on parse LINE records lazily.
+  void set_lazy_line_parsing(bool lazy_line_parsing) {
+    lazy_line_parsing_ = lazy_line_parsing;
+  }
+
+  // The names of every module this factory creates.
+  const InternedStringTable &strings() const { return strings_; }
+
+ private:
+  bool lazy_line_parsing_;
+  mutable InternedStringTable strings_;
 };
 
 class FastModuleFactory : public ModuleFactory {
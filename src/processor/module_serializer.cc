@@ -35,6 +35,12 @@
 
 #include "processor/module_serializer.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <map>
 #include <string>
 
@@ -49,6 +55,10 @@ RangeMapSerializer< MemAddr, linked_ptr<BasicSourceLineResolver::Line> >
 SimpleSerializer<BasicSourceLineResolver::Function>::range_map_serializer_;
 
 size_t ModuleSerializer::SizeOf(const BasicSourceLineResolver::Module &module) {
+  // A module loaded with lazy line parsing must have all of its LINE
+  // records parsed before its line maps can be measured or written.
+  module.ParseAllFunctionLines();
+
   size_t total_size_alloc_ = 0;
 
   // Size of the "is_corrupt" flag.
@@ -82,6 +92,8 @@ size_t ModuleSerializer::SizeOf(const BasicSourceLineResolver::Module &module) {
 
 char *ModuleSerializer::Write(const BasicSourceLineResolver::Module &module,
                               char *dest) {
+  module.ParseAllFunctionLines();
+
   // Write the is_corrupt flag.
   dest = SimpleSerializer<bool>::Write(module.is_corrupt_, dest);
   // Write header.
@@ -130,6 +142,93 @@ char* ModuleSerializer::Serialize(
   return serialized_data;
 }
 
+bool ModuleSerializer::SerializeToFile(
+    const BasicSourceLineResolver::Module &module, const string &file_path) {
+  typedef FastSourceLineResolver::SymbolFileHeader SymbolFileHeader;
+
+  size_t data_size = SizeOf(module);
+  size_t file_size = sizeof(SymbolFileHeader) + data_size;
+  scoped_array<char> file_data(new char[file_size]);
+
+  char *data = file_data.get() + sizeof(SymbolFileHeader);
+  char *end_address = Write(module, data);
+  if (static_cast<size_t>(end_address - data) != data_size) {
+    BPLOG(ERROR) << "size_to_alloc differs from size_written: "
+                 << data_size << " vs " << end_address - data;
+    return false;
+  }
+
+  SymbolFileHeader header;
+  header.magic = SymbolFileHeader::kMagic;
+  header.byte_order_mark = SymbolFileHeader::kByteOrderMark;
+  header.version = SymbolFileHeader::kVersion;
+  header.checksum = FastSourceLineResolver::ComputeChecksum(data, data_size);
+  header.data_size = data_size;
+  memcpy(file_data.get(), &header, sizeof(header));
+
+  // Write a uniquely named temporary file next to |file_path| and rename
+  // it into place, so that processes serializing the same module at once
+  // neither share a temporary file nor leave a partly written one behind.
+  string temp_path = file_path + ".XXXXXX";
+  int fd = mkstemp(&temp_path[0]);
+  FILE *f = NULL;
+  if (fd != -1) {
+    // mkstemp creates the file readable only by its owner.
+    fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    f = fdopen(fd, "wb");
+    if (!f) {
+      close(fd);
+      remove(temp_path.c_str());
+    }
+  }
+  if (!f) {
+    string error_string;
+    int error_code = ErrnoString(&error_string);
+    BPLOG(ERROR) << "Could not create " << temp_path << ", error "
+                 << error_code << ": " << error_string;
+    return false;
+  }
+
+  bool written = fwrite(file_data.get(), 1, file_size, f) == file_size;
+  if (fclose(f) != 0)
+    written = false;
+  if (!written || rename(temp_path.c_str(), file_path.c_str()) != 0) {
+    string error_string;
+    int error_code = ErrnoString(&error_string);
+    BPLOG(ERROR) << "Could not write " << file_path << ", error "
+                 << error_code << ": " << error_string;
+    remove(temp_path.c_str());
+    return false;
+  }
+
+  BPLOG(INFO) << "Wrote " << file_size << " bytes of serialized symbols to "
+              << file_path;
+  return true;
+}
+
+bool ModuleSerializer::ConvertSymbolFile(const string &symbol_file,
+                                         const string &fast_symbol_file) {
+  char *symbol_data;
+  size_t symbol_data_size;
+  if (!SourceLineResolverBase::ReadSymbolFile(symbol_file, &symbol_data,
+                                              &symbol_data_size)) {
+    return false;
+  }
+  scoped_array<char> buffer(symbol_data);
+
+  BasicSourceLineResolver::Module module(symbol_file);
+  if (!module.LoadMapFromMemory(buffer.get(), symbol_data_size))
+    return false;
+  buffer.reset();
+
+  if (module.IsCorrupt()) {
+    BPLOG(ERROR) << "Symbol file " << symbol_file
+                 << " is corrupt, serializing it anyway";
+  }
+
+  return SerializeToFile(module, fast_symbol_file);
+}
+
 bool ModuleSerializer::SerializeModuleAndLoadIntoFastResolver(
     const BasicSourceLineResolver::ModuleMap::const_iterator &iter,
     FastSourceLineResolver *fast_resolver) {
@@ -75,6 +75,18 @@ class ModuleSerializer {
   char* Serialize(const BasicSourceLineResolver::Module &module,
                   unsigned int *size = NULL);
 
+  // Serializes a loaded Module object into the file at file_path, preceded by
+  // a header that FastSourceLineResolver checks when it loads the file with
+  // LoadModule.  The file is written under a temporary name and renamed into
+  // place, so that readers never map a partially written file.
+  bool SerializeToFile(const BasicSourceLineResolver::Module &module,
+                       const string &file_path);
+
+  // Parses the text format symbol file at symbol_file and writes the
+  // serialized module to fast_symbol_file, as SerializeToFile does.
+  bool ConvertSymbolFile(const string &symbol_file,
+                         const string &fast_symbol_file);
+
   // Given the string format symbol_data, produces a chunk of serialized data.
   // Caller takes ownership of the serialized data (on heap), and owner should
   // call delete [] to free the memory after use.
@@ -113,7 +125,7 @@ class ModuleSerializer {
   uint32_t map_sizes_[kNumberMaps_];
 
   // Serializers for each individual map component in Module class.
-  StdMapSerializer<int, string> files_serializer_;
+  StdMapSerializer<int, InternedString> files_serializer_;
   RangeMapSerializer<MemAddr, linked_ptr<Function> > functions_serializer_;
   AddressMapSerializer<MemAddr, linked_ptr<PublicSymbol> > pubsym_serializer_;
   ContainedRangeMapSerializer<MemAddr,
@@ -44,6 +44,7 @@
 #include <stdio.h>
 
 #include <sstream>
+#include <utility>
 
 #include "google_breakpad/processor/memory_region.h"
 #include "processor/logging.h"
@@ -269,20 +270,10 @@ bool PostfixEvaluator<ValueType>::EvaluateForValue(const string &expression,
 }
 
 template<typename ValueType>
-typename PostfixEvaluator<ValueType>::PopResult
-PostfixEvaluator<ValueType>::PopValueOrIdentifier(
-    ValueType *value, string *identifier) {
-  // There needs to be at least one element on the stack to pop.
-  if (!stack_.size())
-    return POP_RESULT_FAIL;
-
-  string token = stack_.back();
-  stack_.pop_back();
-
-  // First, try to treat the value as a literal. Literals may have leading
-  // '-' sign, and the entire remaining string must be parseable as
-  // ValueType. If this isn't possible, it can't be a literal, so treat it
-  // as an identifier instead.
+bool PostfixEvaluator<ValueType>::ParseLiteral(const string &token,
+                                               ValueType *value) {
+  // Literals may have leading '-' sign, and the entire remaining string
+  // must be parseable as ValueType.
   //
   // Some versions of the libstdc++, the GNU standard C++ library, have
   // stream extractors for unsigned integer values that permit a leading
@@ -297,12 +288,31 @@ PostfixEvaluator<ValueType>::PopValueOrIdentifier(
   } else {
     negative = false;
   }
-  if (token_stream >> literal && token_stream.peek() == EOF) {
+  if (!(token_stream >> literal) || token_stream.peek() != EOF)
+    return false;
+
+  *value = negative ? -literal : literal;
+  return true;
+}
+
+template<typename ValueType>
+typename PostfixEvaluator<ValueType>::PopResult
+PostfixEvaluator<ValueType>::PopValueOrIdentifier(
+    ValueType *value, string *identifier) {
+  // There needs to be at least one element on the stack to pop.
+  if (!stack_.size())
+    return POP_RESULT_FAIL;
+
+  string token = stack_.back();
+  stack_.pop_back();
+
+  // First, try to treat the value as a literal. If this isn't possible,
+  // it can't be a literal, so treat it as an identifier instead.
+  ValueType literal = ValueType();
+  if (ParseLiteral(token, &literal)) {
     if (value) {
       *value = literal;
     }
-    if (negative)
-      *value = -*value;
     return POP_RESULT_VALUE;
   } else {
     if (identifier) {
@@ -357,6 +367,297 @@ void PostfixEvaluator<ValueType>::PushValue(const ValueType &value) {
 }
 
 
+template<typename ValueType>
+void PostfixEvaluator<ValueType>::CompileToken(
+    const string &token,
+    map<string, unsigned int> *slots,
+    Program *program) {
+  typename Program::Instruction instruction;
+  instruction.slot = kNoSlot;
+  instruction.value = ValueType();
+
+  if (token == "+") {
+    instruction.opcode = Program::OP_ADD;
+  } else if (token == "-") {
+    instruction.opcode = Program::OP_SUBTRACT;
+  } else if (token == "*") {
+    instruction.opcode = Program::OP_MULTIPLY;
+  } else if (token == "/") {
+    instruction.opcode = Program::OP_DIVIDE_QUOTIENT;
+  } else if (token == "%") {
+    instruction.opcode = Program::OP_DIVIDE_MODULUS;
+  } else if (token == "@") {
+    instruction.opcode = Program::OP_ALIGN;
+  } else if (token == "^") {
+    instruction.opcode = Program::OP_DEREFERENCE;
+  } else if (token == "=") {
+    instruction.opcode = Program::OP_ASSIGN;
+  } else if (ParseLiteral(token, &instruction.value)) {
+    instruction.opcode = Program::OP_PUSH_VALUE;
+  } else {
+    // An identifier.  Give each distinct identifier one slot.
+    instruction.opcode = Program::OP_PUSH_IDENTIFIER;
+    std::pair<map<string, unsigned int>::iterator, bool> inserted =
+        slots->insert(std::make_pair(token, program->identifiers_.size()));
+    if (inserted.second)
+      program->identifiers_.push_back(token);
+    instruction.slot = inserted.first->second;
+  }
+
+  program->code_.push_back(instruction);
+}
+
+template<typename ValueType>
+void PostfixEvaluator<ValueType>::Compile(const string &expression,
+                                          Program *program) {
+  program->code_.clear();
+  program->identifiers_.clear();
+  program->expression_ = expression;
+
+  // Tokenize exactly as EvaluateInternal does, including its handling of
+  // assignment operators smashed up against the next token.
+  map<string, unsigned int> slots;
+  istringstream stream(expression);
+  string token;
+  while (stream >> token) {
+    if (token.size() > 1 && token[0] == '=') {
+      CompileToken("=", &slots, program);
+      CompileToken(token.substr(1), &slots, program);
+    } else {
+      CompileToken(token, &slots, program);
+    }
+  }
+}
+
+template<typename ValueType>
+bool PostfixEvaluator<ValueType>::PopProgramValue(const Program &program,
+                                                  ValueType *value) {
+  if (program_stack_.empty())
+    return false;
+
+  ProgramStackEntry entry = program_stack_.back();
+  program_stack_.pop_back();
+  if (entry.slot == kNoSlot) {
+    *value = entry.value;
+    return true;
+  }
+
+  if (program_values_) {
+    if (!program_assigned_.empty() && program_assigned_[entry.slot]) {
+      *value = program_assigned_values_[entry.slot];
+      return true;
+    }
+    if (!program_values_[entry.slot]) {
+      BPLOG(INFO) << "Identifier " << program.identifiers_[entry.slot] <<
+                     " has no value";
+      return false;
+    }
+    *value = *program_values_[entry.slot];
+    return true;
+  }
+
+  typename DictionaryType::iterator iterator = program_slots_[entry.slot];
+  if (iterator == dictionary_->end()) {
+    BPLOG(INFO) << "Identifier " << program.identifiers_[entry.slot] <<
+                   " not in dictionary";
+    return false;
+  }
+
+  *value = iterator->second;
+  return true;
+}
+
+template<typename ValueType>
+bool PostfixEvaluator<ValueType>::EvaluateProgram(
+    const Program &program,
+    const ValueType *const *values,
+    DictionaryValidityType *assigned) {
+  const string &expression = program.expression_;
+
+  // Resolve every identifier the program uses up front.  Identifiers
+  // not in the dictionary yet are only an error if they are read before
+  // being assigned to.
+  program_values_ = values;
+  program_assigned_.clear();
+  if (!values && !program.identifiers_.empty()) {
+    if (!dictionary_) {
+      BPLOG(ERROR) << "No dictionary to look up identifiers: " << expression;
+      return false;
+    }
+    program_slots_.resize(program.identifiers_.size());
+    for (size_t slot = 0; slot < program.identifiers_.size(); ++slot)
+      program_slots_[slot] = dictionary_->find(program.identifiers_[slot]);
+  }
+
+  for (size_t pc = 0; pc < program.code_.size(); ++pc) {
+    const typename Program::Instruction &instruction = program.code_[pc];
+    ProgramStackEntry entry;
+    switch (instruction.opcode) {
+      case Program::OP_PUSH_VALUE:
+      case Program::OP_PUSH_IDENTIFIER:
+        entry.slot = instruction.slot;
+        entry.value = instruction.value;
+        program_stack_.push_back(entry);
+        break;
+
+      case Program::OP_ADD:
+      case Program::OP_SUBTRACT:
+      case Program::OP_MULTIPLY:
+      case Program::OP_DIVIDE_QUOTIENT:
+      case Program::OP_DIVIDE_MODULUS:
+      case Program::OP_ALIGN: {
+        ValueType operand1 = ValueType();
+        ValueType operand2 = ValueType();
+        if (!PopProgramValue(program, &operand2) ||
+            !PopProgramValue(program, &operand1)) {
+          BPLOG(ERROR) << "Could not PopValues to get two values for binary "
+                          "operation: " << expression;
+          return false;
+        }
+
+        ValueType result = ValueType();
+        switch (instruction.opcode) {
+          case Program::OP_ADD:
+            result = operand1 + operand2;
+            break;
+          case Program::OP_SUBTRACT:
+            result = operand1 - operand2;
+            break;
+          case Program::OP_MULTIPLY:
+            result = operand1 * operand2;
+            break;
+          case Program::OP_DIVIDE_QUOTIENT:
+            result = operand1 / operand2;
+            break;
+          case Program::OP_DIVIDE_MODULUS:
+            result = operand1 % operand2;
+            break;
+          default:  // Program::OP_ALIGN
+            result =
+              operand1 & (static_cast<ValueType>(-1) ^ (operand2 - 1));
+            break;
+        }
+
+        entry.slot = kNoSlot;
+        entry.value = result;
+        program_stack_.push_back(entry);
+        break;
+      }
+
+      case Program::OP_DEREFERENCE: {
+        if (!memory_) {
+          BPLOG(ERROR) << "Attempt to dereference without memory: " <<
+                          expression;
+          return false;
+        }
+
+        ValueType address;
+        if (!PopProgramValue(program, &address)) {
+          BPLOG(ERROR) << "Could not PopValue to get value to derefence: " <<
+                          expression;
+          return false;
+        }
+
+        entry.slot = kNoSlot;
+        if (!memory_->GetMemoryAtAddress(address, &entry.value)) {
+          BPLOG(ERROR) << "Could not dereference memory at address " <<
+                          HexString(address) << ": " << expression;
+          return false;
+        }
+        program_stack_.push_back(entry);
+        break;
+      }
+
+      case Program::OP_ASSIGN: {
+        ValueType value;
+        if (!PopProgramValue(program, &value)) {
+          BPLOG(INFO) << "Could not PopValue to get value to assign: " <<
+                         expression;
+          return false;
+        }
+
+        // Assignment is only meaningful when assigning into a variable.
+        if (program_stack_.empty() || program_stack_.back().slot == kNoSlot) {
+          BPLOG(ERROR) << "PopValueOrIdentifier returned a value, but an "
+                          "identifier is needed to assign " <<
+                          HexString(value) << ": " << expression;
+          return false;
+        }
+        unsigned int slot = program_stack_.back().slot;
+        program_stack_.pop_back();
+        const string &identifier = program.identifiers_[slot];
+        if (identifier[0] != '$') {
+          BPLOG(ERROR) << "Can't assign " << HexString(value) << " to " <<
+                          identifier << ": " << expression;
+          return false;
+        }
+
+        if (values) {
+          if (program_assigned_.empty()) {
+            program_assigned_.resize(program.identifiers_.size(), false);
+            program_assigned_values_.resize(program.identifiers_.size());
+          }
+          program_assigned_[slot] = true;
+          program_assigned_values_[slot] = value;
+        } else if (program_slots_[slot] == dictionary_->end()) {
+          program_slots_[slot] =
+              dictionary_->insert(std::make_pair(identifier, value)).first;
+        } else {
+          program_slots_[slot]->second = value;
+        }
+        if (assigned)
+          (*assigned)[identifier] = true;
+        break;
+      }
+    }
+  }
+
+  return true;
+}
+
+template<typename ValueType>
+bool PostfixEvaluator<ValueType>::Evaluate(const Program &program,
+                                           DictionaryValidityType *assigned) {
+  bool result = EvaluateProgram(program, NULL, assigned);
+
+  // If there's anything left on the stack, it indicates incomplete execution.
+  if (result && !program_stack_.empty()) {
+    BPLOG(ERROR) << "Incomplete execution: " << program.expression_;
+    result = false;
+  }
+
+  program_stack_.clear();
+  return result;
+}
+
+template<typename ValueType>
+bool PostfixEvaluator<ValueType>::EvaluateForValue(const Program &program,
+                                                   ValueType *result) {
+  return EvaluateForValue(program, NULL, result);
+}
+
+template<typename ValueType>
+bool PostfixEvaluator<ValueType>::EvaluateForValue(
+    const Program &program,
+    const ValueType *const *values,
+    ValueType *result) {
+  bool success = EvaluateProgram(program, values, NULL);
+
+  // A successful execution should leave exactly one value on the stack.
+  if (success && program_stack_.size() != 1) {
+    BPLOG(ERROR) << "Expression yielded bad number of results: "
+                 << "'" << program.expression_ << "'";
+    success = false;
+  }
+
+  if (success)
+    success = PopProgramValue(program, result);
+
+  program_stack_.clear();
+  return success;
+}
+
+
 }  // namespace google_breakpad
 
 
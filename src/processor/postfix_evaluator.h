@@ -64,6 +64,19 @@
 // obtained from MSVC frame data debugging information in pdb files as
 // returned by the DIA APIs.
 //
+// An expression that will be evaluated many times may first be compiled
+// into a Program with Compile.  Compiling tokenizes the expression once,
+// parses its literals and gives each distinct identifier a slot, so that
+// evaluating the Program works on a stack of integers and looks each
+// identifier up in the dictionary only once.  Evaluating a Program
+// produces exactly the same results, and the same changes to the
+// dictionary, as evaluating the expression it was compiled from.
+//
+// A Program may also be evaluated without a dictionary, against values
+// the caller keeps in an array, such as a register file: the caller
+// resolves each of the program's identifiers once, and evaluation then
+// involves no strings at all.
+//
 // Author: Mark Mentovai
 
 #ifndef PROCESSOR_POSTFIX_EVALUATOR_H__
@@ -96,7 +109,9 @@ class PostfixEvaluator {
   // will fail in that case unless set_dictionary is used before calling
   // Evaluate.
   PostfixEvaluator(DictionaryType *dictionary, const MemoryRegion *memory)
-      : dictionary_(dictionary), memory_(memory), stack_() {}
+      : dictionary_(dictionary), memory_(memory), stack_(),
+        program_stack_(), program_slots_(), program_values_(NULL),
+        program_assigned_values_(), program_assigned_() {}
 
   // Evaluate the expression, starting with an empty stack. The results of
   // execution will be stored in one (or more) variables in the dictionary.
@@ -113,6 +128,70 @@ class PostfixEvaluator {
   // Otherwise, return false.
   bool EvaluateForValue(const string &expression, ValueType *result);
 
+  // An expression compiled into bytecode.  Programs are built by Compile
+  // and may be evaluated any number of times, by any PostfixEvaluator
+  // with the same ValueType.
+  class Program {
+   public:
+    Program() : code_(), identifiers_(), expression_() {}
+
+    // The expression this program was compiled from.
+    const string &expression() const { return expression_; }
+
+    // The number of distinct identifiers the program uses, and the name
+    // of the identifier in each slot.
+    size_t identifier_count() const { return identifiers_.size(); }
+    const string &identifier(size_t slot) const { return identifiers_[slot]; }
+
+   private:
+    friend class PostfixEvaluator;
+
+    enum Opcode {
+      OP_PUSH_VALUE = 0,  // push |value|
+      OP_PUSH_IDENTIFIER,  // push a reference to identifier |slot|
+      OP_ADD,
+      OP_SUBTRACT,
+      OP_MULTIPLY,
+      OP_DIVIDE_QUOTIENT,
+      OP_DIVIDE_MODULUS,
+      OP_ALIGN,
+      OP_DEREFERENCE,
+      OP_ASSIGN
+    };
+
+    struct Instruction {
+      Opcode opcode;
+      unsigned int slot;
+      ValueType value;
+    };
+
+    vector<Instruction> code_;
+
+    // The name of the identifier in each slot.
+    vector<string> identifiers_;
+
+    string expression_;
+  };
+
+  // Compile |expression| into |program|, replacing its previous contents.
+  // Compiling never fails: any errors in the expression are reported when
+  // the program is evaluated, just as Evaluate would report them.
+  static void Compile(const string &expression, Program *program);
+
+  // Like Evaluate and EvaluateForValue, but run a compiled program.
+  bool Evaluate(const Program &program, DictionaryValidityType *assigned);
+  bool EvaluateForValue(const Program &program, ValueType *result);
+
+  // Like EvaluateForValue, but take the value of the identifier in each
+  // slot of |program| from |values| instead of the dictionary: the
+  // identifier in slot i has the value *values[i], or is unknown if
+  // values[i] is NULL.  |values| must have program.identifier_count()
+  // entries.  A value assigned to a variable replaces its value for the
+  // rest of this evaluation only; |values| itself is not changed.
+  bool EvaluateForValue(const Program &program,
+                        const ValueType *const *values,
+                        ValueType *result);
+
   DictionaryType* dictionary() const { return dictionary_; }
 
   // Reset the dictionary.  PostfixEvaluator does not take ownership.
@@ -126,6 +205,11 @@ class PostfixEvaluator {
     POP_RESULT_IDENTIFIER
   };
 
+  // Parses |token| as a literal value, with an optional leading '-' sign.
+  // Returns false if |token| is not a literal, in which case it names
+  // a constant or variable.
+  static bool ParseLiteral(const string &token, ValueType *value);
+
   // Retrieves the topmost literal value, constant, or variable from the
   // stack.  Returns POP_RESULT_VALUE if the topmost entry is a literal
   // value, and sets |value| accordingly.  Returns POP_RESULT_IDENTIFIER
@@ -158,6 +242,26 @@ class PostfixEvaluator {
                      const string &expression,
                      DictionaryValidityType *assigned);
 
+  // Appends the instruction for |token| to |program|, giving any
+  // identifier a slot in |slots|.
+  static void CompileToken(const string &token,
+                           map<string, unsigned int> *slots,
+                           Program *program);
+
+  // Run |program|, updating *assigned if it is non-zero.  Identifiers
+  // are looked up in |values| if it is non-NULL, as EvaluateForValue
+  // describes, and in the dictionary otherwise.  Return true if execution
+  // completes successfully, leaving the results on program_stack_.
+  bool EvaluateProgram(const Program &program,
+                       const ValueType *const *values,
+                       DictionaryValidityType *assigned);
+
+  // Retrieves the value of the topmost entry on program_stack_, looking
+  // identifiers up through program_values_ if it is non-NULL, and
+  // through program_slots_ otherwise.  Returns false on failure, as
+  // PopValue does.
+  bool PopProgramValue(const Program &program, ValueType *value);
+
   // The dictionary mapping constant and variable identifiers (strings) to
   // values.  Keys beginning with '$' are treated as variable names, and
   // PostfixEvaluator is free to create and modify these keys.  Weak pointer.
@@ -171,6 +275,30 @@ class PostfixEvaluator {
   // are pushed on to it as the expression string is read and as operations
   // yield values; values are popped when used as operands to operators.
   vector<string> stack_;
+
+  // The stack used while running a Program.  An entry holds either a
+  // value, or, if |slot| is not kNoSlot, a reference to an identifier,
+  // which is only looked up when popped, as with stack_.
+  static const unsigned int kNoSlot = static_cast<unsigned int>(-1);
+  struct ProgramStackEntry {
+    unsigned int slot;
+    ValueType value;
+  };
+  vector<ProgramStackEntry> program_stack_;
+
+  // For each identifier slot of the Program being run, its entry in the
+  // dictionary, or dictionary_->end() if the identifier is not there.
+  vector<typename DictionaryType::iterator> program_slots_;
+
+  // The values passed to EvaluateForValue for the Program being run, or
+  // NULL if it is being run against the dictionary.  Weak pointer.
+  const ValueType *const *program_values_;
+
+  // When running against program_values_, the values assigned so far to
+  // each identifier slot, and which slots have been assigned.  Both are
+  // empty until the program assigns something.
+  vector<ValueType> program_assigned_values_;
+  vector<bool> program_assigned_;
 };
 
 }  // namespace google_breakpad
@@ -0,0 +1,207 @@
+// Copyright (c) 2016 Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// postfix_evaluator_benchmark.cc: Compare the time PostfixEvaluator takes
+// to evaluate typical STACK CFI and STACK WIN expressions directly from
+// their strings with the time it takes to run them compiled.
+//
+// Usage: postfix_evaluator_benchmark [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <string>
+
+#include "common/using_std_string.h"
+#include "google_breakpad/common/breakpad_types.h"
+#include "google_breakpad/processor/memory_region.h"
+#include "processor/logging.h"
+#include "processor/postfix_evaluator-inl.h"
+
+namespace {
+
+using google_breakpad::MemoryRegion;
+using google_breakpad::PostfixEvaluator;
+
+typedef PostfixEvaluator<uint64_t> Evaluator;
+
+// Every address holds a value derived from the address itself, so that
+// dereferences always succeed.
+class BenchmarkMemoryRegion : public MemoryRegion {
+ public:
+  virtual uint64_t GetBase() const { return 0; }
+  virtual uint32_t GetSize() const { return 0xffffffff; }
+  virtual bool GetMemoryAtAddress(uint64_t address, uint8_t *value) const {
+    *value = address ^ 0x5a;
+    return true;
+  }
+  virtual bool GetMemoryAtAddress(uint64_t address, uint16_t *value) const {
+    *value = address ^ 0x5a5a;
+    return true;
+  }
+  virtual bool GetMemoryAtAddress(uint64_t address, uint32_t *value) const {
+    *value = address ^ 0x5a5a5a5a;
+    return true;
+  }
+  virtual bool GetMemoryAtAddress(uint64_t address, uint64_t *value) const {
+    *value = address ^ 0x5a5a5a5a5a5a5a5aULL;
+    return true;
+  }
+  virtual void Print() const { }
+};
+
+struct BenchmarkExpression {
+  const char *expression;
+  bool for_value;  // EvaluateForValue if true, Evaluate if false.
+};
+
+const BenchmarkExpression kExpressions[] = {
+  // STACK CFI rules.
+  { "$rsp 16 +", true },
+  { ".cfa 8 - ^", true },
+  { "$rbp 16 +", true },
+  { ".cfa 24 - ^", true },
+  // STACK WIN program strings.
+  { "$T0 $ebp = $eip $T0 4 + ^ = $ebp $T0 ^ = $esp $T0 8 + =", false },
+  { "$T0 .raSearch = $eip $T0 ^ = $esp $T0 4 + = "
+    "$L $T0 .cbSavedRegs - = $P $T0 4 + .cbParams + = "
+    "$ebx $T0 28 - ^ = $esi $L 4 - ^ =", false },
+};
+const size_t kExpressionCount = sizeof(kExpressions) / sizeof(kExpressions[0]);
+
+void ResetDictionary(Evaluator::DictionaryType *dictionary) {
+  dictionary->clear();
+  (*dictionary)["$rsp"] = 0x7fff0000;
+  (*dictionary)["$rbp"] = 0x7fff0040;
+  (*dictionary)[".cfa"] = 0x7fff0010;
+  (*dictionary)["$ebp"] = 0xbfff0010;
+  (*dictionary)["$eip"] = 0x10000000;
+  (*dictionary)["$esp"] = 0xbfff0000;
+  (*dictionary)[".raSearch"] = 0xbfff0020;
+  (*dictionary)[".cbSavedRegs"] = 4;
+  (*dictionary)[".cbParams"] = 4;
+}
+
+double Now() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// Evaluates each expression |iterations| times, and returns the sum of
+// the values produced, so that the two ways of evaluating can be checked
+// against each other.
+uint64_t RunStrings(Evaluator *evaluator, int iterations) {
+  uint64_t sum = 0;
+  for (int i = 0; i < iterations; ++i) {
+    for (size_t e = 0; e < kExpressionCount; ++e) {
+      uint64_t value = 0;
+      if (kExpressions[e].for_value) {
+        if (!evaluator->EvaluateForValue(kExpressions[e].expression, &value))
+          return 0;
+      } else {
+        if (!evaluator->Evaluate(kExpressions[e].expression, NULL))
+          return 0;
+        value = (*evaluator->dictionary())["$eip"];
+      }
+      sum += value;
+    }
+  }
+  return sum;
+}
+
+uint64_t RunPrograms(Evaluator *evaluator,
+                     const Evaluator::Program *programs,
+                     int iterations) {
+  uint64_t sum = 0;
+  for (int i = 0; i < iterations; ++i) {
+    for (size_t e = 0; e < kExpressionCount; ++e) {
+      uint64_t value = 0;
+      if (kExpressions[e].for_value) {
+        if (!evaluator->EvaluateForValue(programs[e], &value))
+          return 0;
+      } else {
+        if (!evaluator->Evaluate(programs[e], NULL))
+          return 0;
+        value = (*evaluator->dictionary())["$eip"];
+      }
+      sum += value;
+    }
+  }
+  return sum;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  BPLOG_INIT(&argc, &argv);
+
+  int iterations = argc > 1 ? atoi(argv[1]) : 100000;
+  if (iterations <= 0) {
+    fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+    return 1;
+  }
+
+  BenchmarkMemoryRegion memory;
+  Evaluator::DictionaryType dictionary;
+  Evaluator evaluator(&dictionary, &memory);
+  double evaluations = static_cast<double>(iterations) * kExpressionCount;
+
+  ResetDictionary(&dictionary);
+  double start = Now();
+  uint64_t string_sum = RunStrings(&evaluator, iterations);
+  double string_seconds = Now() - start;
+
+  ResetDictionary(&dictionary);
+  start = Now();
+  Evaluator::Program programs[kExpressionCount];
+  for (size_t e = 0; e < kExpressionCount; ++e)
+    Evaluator::Compile(kExpressions[e].expression, &programs[e]);
+  double compile_seconds = Now() - start;
+  uint64_t program_sum = RunPrograms(&evaluator, programs, iterations);
+  double program_seconds = Now() - start;
+
+  printf("%d iterations of %d expressions\n",
+         iterations, static_cast<int>(kExpressionCount));
+  printf("strings:  %10.1f ns/evaluation\n",
+         string_seconds * 1e9 / evaluations);
+  printf("compiled: %10.1f ns/evaluation (compiling took %.1f us)\n",
+         program_seconds * 1e9 / evaluations, compile_seconds * 1e6);
+  printf("speedup:  %10.1fx\n",
+         program_seconds > 0 ? string_seconds / program_seconds : 0.0);
+
+  if (string_sum == 0 || string_sum != program_sum) {
+    fprintf(stderr, "results differ: strings 0x%llx, compiled 0x%llx\n",
+            static_cast<unsigned long long>(string_sum),
+            static_cast<unsigned long long>(program_sum));
+    return 1;
+  }
+  return 0;
+}
@@ -120,7 +120,37 @@ struct EvaluateForValueTest {
   unsigned int value;
 };
 
-static bool RunTests() {
+// Evaluate |expression| either directly, or by compiling it first and
+// running the compiled program.
+static bool Evaluate(PostfixEvaluator<unsigned int> *evaluator,
+                     bool compiled,
+                     const string &expression,
+                     PostfixEvaluator<unsigned int>::DictionaryValidityType
+                         *assigned) {
+  if (!compiled)
+    return evaluator->Evaluate(expression, assigned);
+
+  PostfixEvaluator<unsigned int>::Program program;
+  PostfixEvaluator<unsigned int>::Compile(expression, &program);
+  return evaluator->Evaluate(program, assigned);
+}
+
+static bool EvaluateForValue(PostfixEvaluator<unsigned int> *evaluator,
+                             bool compiled,
+                             const string &expression,
+                             unsigned int *result) {
+  if (!compiled)
+    return evaluator->EvaluateForValue(expression, result);
+
+  PostfixEvaluator<unsigned int>::Program program;
+  PostfixEvaluator<unsigned int>::Compile(expression, &program);
+  return evaluator->EvaluateForValue(program, result);
+}
+
+// Run all the tests, evaluating the expressions directly if |compiled| is
+// false, or through compiled programs if it is true.  Both must produce
+// the same results.
+static bool RunTests(bool compiled) {
   // The first test set checks the basic operations and failure modes.
   PostfixEvaluator<unsigned int>::DictionaryType dictionary_0;
   const EvaluateTest evaluate_tests_0[] = {
@@ -245,8 +275,8 @@ static bool RunTests() {
       const EvaluateTest *evaluate_test = &evaluate_tests[evaluate_test_index];
 
       // Do the test.
-      bool result = postfix_evaluator.Evaluate(evaluate_test->expression,
-                                               &assigned);
+      bool result = Evaluate(&postfix_evaluator, compiled,
+                             evaluate_test->expression, &assigned);
       if (result != evaluate_test->evaluable) {
         fprintf(stderr, "FAIL: evaluate set %d/%d, test %d/%d, "
                         "expression \"%s\", expected %s, observed %s\n",
@@ -346,8 +376,8 @@ static bool RunTests() {
   for (int i = 0; i < evaluate_for_value_tests_2_size; i++) {
     const EvaluateForValueTest *test = &evaluate_for_value_tests_2[i];
     unsigned int result;
-    if (postfix_evaluator.EvaluateForValue(test->expression, &result)
-        != test->evaluable) {
+    if (EvaluateForValue(&postfix_evaluator, compiled, test->expression,
+                         &result) != test->evaluable) {
       fprintf(stderr, "FAIL: evaluate for value test %d, "
               "expected evaluation to %s, but it %s\n",
               i, test->evaluable ? "succeed" : "fail",
@@ -393,11 +423,48 @@ static bool RunTests() {
 }
 
 
+// A compiled program can be run repeatedly, and sees the effects of its
+// own earlier runs on the dictionary.
+static bool RunProgramReuseTests() {
+  PostfixEvaluator<unsigned int>::DictionaryType dictionary;
+  dictionary["$esp"] = 0x1000;
+  FakeMemoryRegion fake_memory;
+  PostfixEvaluator<unsigned int> postfix_evaluator(&dictionary, &fake_memory);
+
+  PostfixEvaluator<unsigned int>::Program program;
+  PostfixEvaluator<unsigned int>::Compile("$esp $esp 4 + = $eip $esp ^ =",
+                                          &program);
+  for (unsigned int i = 1; i <= 3; ++i) {
+    if (!postfix_evaluator.Evaluate(program, NULL)) {
+      fprintf(stderr, "FAIL: program reuse, run %d failed\n", i);
+      return false;
+    }
+    if (dictionary["$esp"] != 0x1000 + 4 * i ||
+        dictionary["$eip"] != 0x1000 + 4 * i + 1) {
+      fprintf(stderr, "FAIL: program reuse, run %d: "
+              "$esp == 0x%x, $eip == 0x%x\n",
+              i, dictionary["$esp"], dictionary["$eip"]);
+      return false;
+    }
+  }
+
+  unsigned int value;
+  PostfixEvaluator<unsigned int>::Compile("$esp 8 -", &program);
+  if (!postfix_evaluator.EvaluateForValue(program, &value) ||
+      value != 0x1004) {
+    fprintf(stderr, "FAIL: program reuse, recompiled program\n");
+    return false;
+  }
+
+  return true;
+}
+
+
 }  // namespace
 
 
 int main(int argc, char **argv) {
   BPLOG_INIT(&argc, &argv);
 
-  return RunTests() ? 0 : 1;
+  return RunTests(false) && RunTests(true) && RunProgramReuseTests() ? 0 : 1;
 }
@@ -34,6 +34,9 @@
 // Author: Mark Mentovai
 
 #include "google_breakpad/processor/process_state.h"
+
+#include <set>
+
 #include "google_breakpad/processor/call_stack.h"
 #include "google_breakpad/processor/code_modules.h"
 
@@ -51,8 +54,10 @@ void ProcessState::Clear() {
   crash_address_ = 0;
   assertion_.clear();
   requesting_thread_ = -1;
-  for (vector<CallStack *>::const_iterator iterator = threads_.begin();
-       iterator != threads_.end();
+  // Threads may share a CallStack; delete each one once.
+  std::set<CallStack *> stacks(threads_.begin(), threads_.end());
+  for (std::set<CallStack *>::const_iterator iterator = stacks.begin();
+       iterator != stacks.end();
        ++iterator) {
     delete *iterator;
   }
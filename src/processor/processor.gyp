@@ -30,6 +30,9 @@
   'includes': [
     'processor_tools.gypi',
   ],
+  'target_defaults': {
+    'defines': ['HAVE_ZLIB'],
+  },
   'targets': [
     {
       'target_name': 'processor',
@@ -48,6 +51,9 @@
         'cfi_frame_info-inl.h',
         'cfi_frame_info.cc',
         'cfi_frame_info.h',
+        'compressed_symbol_file.cc',
+        'compressed_symbol_file.h',
+        'concurrent_source_line_resolver.cc',
         'contained_range_map-inl.h',
         'contained_range_map.h',
         'disassembler_x86.cc',
@@ -61,6 +67,10 @@
         'exploitability_win.h',
         'fast_source_line_resolver.cc',
         'fast_source_line_resolver_types.h',
+        'instruction_address_oracle.cc',
+        'instruction_address_oracle.h',
+        'interned_string_table.cc',
+        'interned_string_table.h',
         'linked_ptr.h',
         'logging.cc',
         'logging.h',
@@ -69,6 +79,8 @@
         'microdump_processor.cc',
         'minidump.cc',
         'minidump_processor.cc',
+        'missing_symbol_cache.cc',
+        'missing_symbol_cache.h',
         'module_comparer.cc',
         'module_comparer.h',
         'module_factory.h',
@@ -89,6 +101,8 @@
         'source_line_resolver_base_types.h',
         'stack_frame_cpu.cc',
         'stack_frame_symbolizer.cc',
+        'stack_scanner.cc',
+        'stack_scanner.h',
         'stackwalk_common.cc',
         'stackwalk_common.h',
         'stackwalker.cc',
@@ -121,10 +135,17 @@
         'static_map_iterator.h',
         'static_range_map-inl.h',
         'static_range_map.h',
+        'symbol_file_index.cc',
+        'symbol_file_index.h',
+        'symbol_scanner.cc',
+        'symbol_scanner.h',
         'symbolic_constants_win.cc',
         'symbolic_constants_win.h',
+        'symbolization_memo.cc',
+        'symbolization_memo.h',
         'synth_minidump.cc',
         'synth_minidump.h',
+        'thread_primitives.h',
         'tokenize.cc',
         'tokenize.h',
         'windows_frame_info.h',
@@ -136,6 +157,11 @@
         '../common/common.gyp:common',
         '../third_party/libdisasm/libdisasm.gyp:libdisasm',
       ],
+      'link_settings': {
+        'libraries': [
+          '-lz',
+        ],
+      },
     },
     {
       'target_name': 'processor_unittests',
@@ -145,17 +171,24 @@
         'basic_source_line_resolver_unittest.cc',
         'binarystream_unittest.cc',
         'cfi_frame_info_unittest.cc',
+        'compressed_symbol_file_unittest.cc',
+        'concurrent_source_line_resolver_unittest.cc',
         'contained_range_map_unittest.cc',
         'disassembler_x86_unittest.cc',
         'exploitability_unittest.cc',
         'fast_source_line_resolver_unittest.cc',
+        'instruction_address_oracle_unittest.cc',
+        'interned_string_table_unittest.cc',
         'map_serializers_unittest.cc',
         'microdump_processor_unittest.cc',
         'minidump_processor_unittest.cc',
         'minidump_unittest.cc',
+        'missing_symbol_cache_unittest.cc',
         'pathname_stripper_unittest.cc',
         'postfix_evaluator_unittest.cc',
         'range_map_unittest.cc',
+        'simple_symbol_supplier_unittest.cc',
+        'stack_scanner_unittest.cc',
         'stackwalker_address_list_unittest.cc',
         'stackwalker_amd64_unittest.cc',
         'stackwalker_arm64_unittest.cc',
@@ -167,6 +200,9 @@
         'static_contained_range_map_unittest.cc',
         'static_map_unittest.cc',
         'static_range_map_unittest.cc',
+        'symbol_file_index_unittest.cc',
+        'symbol_scanner_unittest.cc',
+        'symbolization_memo_unittest.cc',
         'synth_minidump_unittest.cc',
         'synth_minidump_unittest_data.h',
       ],
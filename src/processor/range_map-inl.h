@@ -39,6 +39,8 @@
 
 #include <assert.h>
 
+#include <algorithm>
+
 #include "processor/range_map.h"
 #include "processor/logging.h"
 
@@ -63,6 +65,9 @@ bool RangeMap<AddressType, EntryType>::StoreRange(const AddressType &base,
     return false;
   }
 
+  if (!frozen_.empty())
+    Thaw();
+
   // Ensure that this range does not overlap with another one already in the
   // map.
   MapConstIterator iterator_base = map_.lower_bound(base);
@@ -121,6 +126,21 @@ bool RangeMap<AddressType, EntryType>::RetrieveRange(
   BPLOG_IF(ERROR, !entry) << "RangeMap::RetrieveRange requires |entry|";
   assert(entry);
 
+  if (!frozen_.empty()) {
+    FrozenConstIterator iterator = std::lower_bound(
+        frozen_.begin(), frozen_.end(), address, FrozenKeyLess());
+    if (iterator == frozen_.end() || address < iterator->second.base())
+      return false;
+
+    *entry = iterator->second.entry();
+    if (entry_base)
+      *entry_base = iterator->second.base();
+    if (entry_size)
+      *entry_size = iterator->first - iterator->second.base() + 1;
+
+    return true;
+  }
+
   MapConstIterator iterator = map_.lower_bound(address);
   if (iterator == map_.end())
     return false;
@@ -159,6 +179,22 @@ bool RangeMap<AddressType, EntryType>::RetrieveNearestRange(
   // Decrement the iterator to get there, but not if the upper_bound already
   // points to the beginning of the map - in that case, address is lower than
   // the lowest stored key, so return false.
+  if (!frozen_.empty()) {
+    FrozenConstIterator iterator = std::upper_bound(
+        frozen_.begin(), frozen_.end(), address, FrozenKeyLess());
+    if (iterator == frozen_.begin())
+      return false;
+    --iterator;
+
+    *entry = iterator->second.entry();
+    if (entry_base)
+      *entry_base = iterator->second.base();
+    if (entry_size)
+      *entry_size = iterator->first - iterator->second.base() + 1;
+
+    return true;
+  }
+
   MapConstIterator iterator = map_.upper_bound(address);
   if (iterator == map_.begin())
     return false;
@@ -186,6 +222,17 @@ bool RangeMap<AddressType, EntryType>::RetrieveRangeAtIndex(
     return false;
   }
 
+  if (!frozen_.empty()) {
+    const FrozenValue &value = frozen_[index];
+    *entry = value.second.entry();
+    if (entry_base)
+      *entry_base = value.second.base();
+    if (entry_size)
+      *entry_size = value.first - value.second.base() + 1;
+
+    return true;
+  }
+
   // Walk through the map.  Although it's ordered, it's not a vector, so it
   // can't be addressed directly by index.
   MapConstIterator iterator = map_.begin();
@@ -204,13 +251,44 @@ bool RangeMap<AddressType, EntryType>::RetrieveRangeAtIndex(
 
 template<typename AddressType, typename EntryType>
 int RangeMap<AddressType, EntryType>::GetCount() const {
-  return map_.size();
+  return map_.size() + frozen_.size();
 }
 
 
 template<typename AddressType, typename EntryType>
 void RangeMap<AddressType, EntryType>::Clear() {
   map_.clear();
+  FrozenRanges().swap(frozen_);
+}
+
+
+template<typename AddressType, typename EntryType>
+void RangeMap<AddressType, EntryType>::Freeze() {
+  if (map_.empty())
+    return;
+
+  // Build the array at its exact size, so that it wastes no memory.
+  FrozenRanges frozen(map_.begin(), map_.end());
+  frozen_.swap(frozen);
+  map_.clear();
+}
+
+
+template<typename AddressType, typename EntryType>
+void RangeMap<AddressType, EntryType>::Thaw() {
+  map_.insert(frozen_.begin(), frozen_.end());
+  FrozenRanges().swap(frozen_);
+}
+
+
+template<typename AddressType, typename EntryType>
+const typename RangeMap<AddressType, EntryType>::AddressToRangeMap &
+RangeMap<AddressType, EntryType>::Ranges(AddressToRangeMap *storage) const {
+  if (frozen_.empty())
+    return map_;
+  storage->clear();
+  storage->insert(frozen_.begin(), frozen_.end());
+  return *storage;
 }
 
 
@@ -42,6 +42,7 @@
 
 
 #include <map>
+#include <vector>
 
 
 namespace google_breakpad {
@@ -52,7 +53,7 @@ template<class, class> class RangeMapSerializer;
 template<typename AddressType, typename EntryType>
 class RangeMap {
  public:
-  RangeMap() : map_() {}
+  RangeMap() : map_(), frozen_() {}
 
   // Inserts a range into the map.  Returns false for a parameter error,
   // or if the location of the range would conflict with a range already
@@ -94,6 +95,13 @@ class RangeMap {
   // initially created.
   void Clear();
 
+  // Moves the ranges into a sorted array.  A frozen map answers the same
+  // queries as before, but takes a fraction of the memory, and lookups
+  // don't chase pointers.  Call this once a map is fully populated:
+  // storing another range into a frozen map moves the ranges back into
+  // a tree first.
+  void Freeze();
+
  private:
   // Friend declarations.
   friend class ModuleComparer;
@@ -110,19 +118,46 @@ class RangeMap {
    private:
     // The base address of the range.  The high address does not need to
     // be stored, because RangeMap uses it as the key to the map.
-    const AddressType base_;
+    AddressType base_;
 
     // The entry corresponding to a range.
-    const EntryType entry_;
+    EntryType entry_;
   };
 
   // Convenience types.
   typedef std::map<AddressType, Range> AddressToRangeMap;
   typedef typename AddressToRangeMap::const_iterator MapConstIterator;
   typedef typename AddressToRangeMap::value_type MapValue;
+  typedef std::pair<AddressType, Range> FrozenValue;
+  typedef std::vector<FrozenValue> FrozenRanges;
+  typedef typename FrozenRanges::const_iterator FrozenConstIterator;
+
+  // Orders frozen ranges by their high address.
+  struct FrozenKeyLess {
+    bool operator()(const FrozenValue &value,
+                    const AddressType &address) const {
+      return value.first < address;
+    }
+    bool operator()(const AddressType &address,
+                    const FrozenValue &value) const {
+      return address < value.first;
+    }
+  };
+
+  // Moves the ranges of a frozen map back into map_.
+  void Thaw();
+
+  // Returns the ranges keyed by their high addresses: map_ itself, or if
+  // the map is frozen, a copy of the ranges built in |storage|.  This lets
+  // the serializer and ModuleComparer walk the map in either state.
+  const AddressToRangeMap &Ranges(AddressToRangeMap *storage) const;
 
   // Maps the high address of each range to a EntryType.
   AddressToRangeMap map_;
+
+  // The ranges of a frozen map, ordered by their high addresses.  At most
+  // one of map_ and frozen_ is non-empty.
+  FrozenRanges frozen_;
 };
 
 
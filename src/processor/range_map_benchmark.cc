@@ -0,0 +1,269 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// range_map_benchmark.cc: Compare the memory taken by RangeMap, AddressMap
+// and ContainedRangeMap, and the time they take to answer lookups, before
+// and after they are frozen.
+//
+// Usage: range_map_benchmark [entries]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <new>
+#include <vector>
+
+#include "google_breakpad/common/breakpad_types.h"
+#include "processor/address_map-inl.h"
+#include "processor/contained_range_map-inl.h"
+#include "processor/logging.h"
+#include "processor/range_map-inl.h"
+
+namespace {
+
+using google_breakpad::AddressMap;
+using google_breakpad::ContainedRangeMap;
+using google_breakpad::RangeMap;
+
+// The number of bytes currently allocated with operator new.  Each block
+// is prefixed with its size so that operator delete can account for it.
+size_t allocated_bytes = 0;
+
+const size_t kHeaderSize = 16;
+
+// Every entry covers kEntrySize bytes, and is followed by a gap of the same
+// size, like the functions in a module.
+const uint64_t kEntrySize = 0x40;
+const int kLookups = 1000000;
+
+double Now() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// Builds the same pseudo-random list of addresses for every map, about
+// half of them inside an entry.
+void MakeLookupAddresses(int entries, std::vector<uint64_t> *addresses) {
+  addresses->resize(kLookups);
+  uint64_t state = 0x2545f4914f6cdd1dULL;
+  uint64_t limit = 2 * kEntrySize * entries;
+  for (int i = 0; i < kLookups; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    (*addresses)[i] = (state >> 16) % limit;
+  }
+}
+
+void Report(const char *name, size_t bytes, int entries, double seconds,
+            uint64_t checksum) {
+  printf("%-26s %10.1f bytes/entry %8.1f ns/lookup  (checksum %llx)\n",
+         name, static_cast<double>(bytes) / entries,
+         seconds * 1e9 / kLookups,
+         static_cast<unsigned long long>(checksum));
+}
+
+template<typename Map>
+double TimeRangeMap(const Map &map, const std::vector<uint64_t> &addresses,
+                    uint64_t *checksum) {
+  *checksum = 0;
+  double start = Now();
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    uint64_t entry;
+    uint64_t base;
+    if (map.RetrieveRange(addresses[i], &entry, &base, NULL))
+      *checksum += entry ^ base;
+  }
+  return Now() - start;
+}
+
+template<typename Map>
+double TimeAddressMap(const Map &map, const std::vector<uint64_t> &addresses,
+                      uint64_t *checksum) {
+  *checksum = 0;
+  double start = Now();
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    uint64_t entry;
+    uint64_t address;
+    if (map.Retrieve(addresses[i], &entry, &address))
+      *checksum += entry ^ address;
+  }
+  return Now() - start;
+}
+
+template<typename Map>
+double TimeContainedRangeMap(const Map &map,
+                             const std::vector<uint64_t> &addresses,
+                             uint64_t *checksum) {
+  *checksum = 0;
+  double start = Now();
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    uint64_t entry;
+    if (map.RetrieveRange(addresses[i], &entry))
+      *checksum += entry;
+  }
+  return Now() - start;
+}
+
+bool BenchmarkRangeMap(int entries, const std::vector<uint64_t> &addresses) {
+  size_t before = allocated_bytes;
+  RangeMap<uint64_t, uint64_t> map;
+  for (int i = 0; i < entries; ++i)
+    map.StoreRange(2 * kEntrySize * i, kEntrySize, i);
+  size_t tree_bytes = allocated_bytes - before;
+
+  uint64_t tree_checksum;
+  double tree_seconds = TimeRangeMap(map, addresses, &tree_checksum);
+  Report("RangeMap", tree_bytes, entries, tree_seconds, tree_checksum);
+
+  map.Freeze();
+  size_t frozen_bytes = allocated_bytes - before;
+  uint64_t frozen_checksum;
+  double frozen_seconds = TimeRangeMap(map, addresses, &frozen_checksum);
+  Report("RangeMap, frozen", frozen_bytes, entries, frozen_seconds,
+         frozen_checksum);
+
+  return tree_checksum == frozen_checksum;
+}
+
+bool BenchmarkAddressMap(int entries,
+                         const std::vector<uint64_t> &addresses) {
+  size_t before = allocated_bytes;
+  AddressMap<uint64_t, uint64_t> map;
+  for (int i = 0; i < entries; ++i)
+    map.Store(2 * kEntrySize * i, i);
+  size_t tree_bytes = allocated_bytes - before;
+
+  uint64_t tree_checksum;
+  double tree_seconds = TimeAddressMap(map, addresses, &tree_checksum);
+  Report("AddressMap", tree_bytes, entries, tree_seconds, tree_checksum);
+
+  map.Freeze();
+  size_t frozen_bytes = allocated_bytes - before;
+  uint64_t frozen_checksum;
+  double frozen_seconds = TimeAddressMap(map, addresses, &frozen_checksum);
+  Report("AddressMap, frozen", frozen_bytes, entries, frozen_seconds,
+         frozen_checksum);
+
+  return tree_checksum == frozen_checksum;
+}
+
+bool BenchmarkContainedRangeMap(int entries,
+                                const std::vector<uint64_t> &addresses) {
+  // Every fourth entry contains a smaller one, the way STACK WIN records
+  // for a function may contain records for parts of it.
+  size_t before = allocated_bytes;
+  ContainedRangeMap<uint64_t, uint64_t> map;
+  for (int i = 0; i < entries; ++i) {
+    uint64_t base = 2 * kEntrySize * (i / 2 * 2);
+    if (i % 4 == 1)
+      map.StoreRange(base + kEntrySize / 4, kEntrySize / 2, i);
+    else if (i % 2 == 0)
+      map.StoreRange(base, kEntrySize, i);
+    else
+      map.StoreRange(base + 2 * kEntrySize, kEntrySize, i);
+  }
+  size_t tree_bytes = allocated_bytes - before;
+
+  uint64_t tree_checksum;
+  double tree_seconds = TimeContainedRangeMap(map, addresses, &tree_checksum);
+  Report("ContainedRangeMap", tree_bytes, entries, tree_seconds,
+         tree_checksum);
+
+  map.Freeze();
+  size_t frozen_bytes = allocated_bytes - before;
+  uint64_t frozen_checksum;
+  double frozen_seconds = TimeContainedRangeMap(map, addresses,
+                                                &frozen_checksum);
+  Report("ContainedRangeMap, frozen", frozen_bytes, entries, frozen_seconds,
+         frozen_checksum);
+
+  return tree_checksum == frozen_checksum;
+}
+
+}  // namespace
+
+// Count the memory the maps allocate by replacing the global allocation
+// functions.  Their exception specifications changed in C++11.
+#if __cplusplus >= 201103L
+#define BENCHMARK_NEW_THROW
+#define BENCHMARK_DELETE_THROW noexcept
+#else
+#define BENCHMARK_NEW_THROW throw(std::bad_alloc)
+#define BENCHMARK_DELETE_THROW throw()
+#endif
+
+void *operator new(size_t size) BENCHMARK_NEW_THROW {
+  char *block = static_cast<char*>(malloc(size + kHeaderSize));
+  if (!block)
+    throw std::bad_alloc();
+  *reinterpret_cast<size_t*>(block) = size;
+  allocated_bytes += size;
+  return block + kHeaderSize;
+}
+
+void operator delete(void *pointer) BENCHMARK_DELETE_THROW {
+  if (!pointer)
+    return;
+  char *block = static_cast<char*>(pointer) - kHeaderSize;
+  allocated_bytes -= *reinterpret_cast<size_t*>(block);
+  free(block);
+}
+
+#ifdef __cpp_sized_deallocation
+// With sized deallocation, the compiler calls this overload where it
+// knows the size; the recorded size is used either way.
+void operator delete(void *pointer, size_t) BENCHMARK_DELETE_THROW {
+  operator delete(pointer);
+}
+#endif  // __cpp_sized_deallocation
+
+int main(int argc, char **argv) {
+  BPLOG_INIT(&argc, &argv);
+
+  int entries = argc > 1 ? atoi(argv[1]) : 1000000;
+  if (entries <= 0) {
+    fprintf(stderr, "usage: %s [entries]\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<uint64_t> addresses;
+  MakeLookupAddresses(entries, &addresses);
+
+  printf("%d entries, %d lookups; bytes/entry counts heap memory only\n",
+         entries, kLookups);
+  bool ok = BenchmarkRangeMap(entries, addresses) &&
+            BenchmarkAddressMap(entries, addresses) &&
+            BenchmarkContainedRangeMap(entries, addresses);
+  if (!ok) {
+    fprintf(stderr, "frozen maps gave different results\n");
+    return 1;
+  }
+  return 0;
+}
@@ -468,11 +468,15 @@ static bool RunTests() {
         range_test_sets[range_test_set_index].range_test_count;
 
     // Run the StoreRange test, which validates StoreRange and initializes
-    // the RangeMap with data for the RetrieveRange test.
+    // the RangeMap with data for the RetrieveRange test.  Freeze the map
+    // halfway through, so that the remaining ranges are stored into a
+    // frozen map.
     int stored_count = 0;  // The number of ranges successfully stored
     for (unsigned int range_test_index = 0;
          range_test_index < range_test_count;
          ++range_test_index) {
+      if (range_test_index == range_test_count / 2)
+        range_map->Freeze();
       const RangeTest *range_test = &range_tests[range_test_index];
       if (!StoreTest(range_map.get(), range_test))
         return false;
@@ -510,6 +514,27 @@ static bool RunTests() {
         return false;
     }
 
+    if (!RetrieveIndexTest(range_map.get(), range_test_set_index))
+      return false;
+
+    // A frozen map must give the same answers.
+    range_map->Freeze();
+    if (range_map->GetCount() != stored_count) {
+      fprintf(stderr, "FAILED: frozen map's GetCount doesn't match, "
+              "expected %d, observed %d\n",
+              stored_count, range_map->GetCount());
+
+      return false;
+    }
+
+    for (unsigned int range_test_index = 0;
+         range_test_index < range_test_count;
+         ++range_test_index) {
+      const RangeTest *range_test = &range_tests[range_test_index];
+      if (!RetrieveTest(range_map.get(), range_test))
+        return false;
+    }
+
     if (!RetrieveIndexTest(range_map.get(), range_test_set_index))
       return false;
 
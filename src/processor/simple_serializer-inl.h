@@ -28,7 +28,7 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //
 // simple_serializer-inl.h: template specializations for following types:
-// bool, const char *(C-string), string,
+// bool, const char *(C-string), string, InternedString,
 // Line, Function, PublicSymbol, WindowsFrameInfo and their linked pointers.
 //
 // See simple_serializer.h for moredocumentation.
@@ -39,12 +39,14 @@
 #define PROCESSOR_SIMPLE_SERIALIZER_INL_H__
 
 #include <string>
+#include <vector>
 
 #include "processor/simple_serializer.h"
 #include "map_serializers-inl.h"
 
 #include "google_breakpad/processor/basic_source_line_resolver.h"
 #include "processor/basic_source_line_resolver_types.h"
+#include "processor/interned_string_table.h"
 #include "processor/linked_ptr.h"
 #include "processor/windows_frame_info.h"
 
@@ -93,6 +95,18 @@ class SimpleSerializer<const char*> {
   }
 };
 
+// Specializations of SimpleSerializer: InternedString, written like string
+template<>
+class SimpleSerializer<InternedString> {
+ public:
+  static size_t SizeOf(const InternedString &str) { return str.size() + 1; }
+
+  static char *Write(const InternedString &str, char *dest) {
+    strcpy(dest, str.c_str());
+    return dest + SizeOf(str);
+  }
+};
+
 // Specializations of SimpleSerializer: Line
 template<>
 class SimpleSerializer<BasicSourceLineResolver::Line> {
@@ -119,12 +133,12 @@ class SimpleSerializer<BasicSourceLineResolver::PublicSymbol> {
   typedef BasicSourceLineResolver::PublicSymbol PublicSymbol;
  public:
   static size_t SizeOf(const PublicSymbol &pubsymbol) {
-    return SimpleSerializer<string>::SizeOf(pubsymbol.name)
+    return SimpleSerializer<InternedString>::SizeOf(pubsymbol.name)
          + SimpleSerializer<MemAddr>::SizeOf(pubsymbol.address)
          + SimpleSerializer<int32_t>::SizeOf(pubsymbol.parameter_size);
   }
   static char *Write(const PublicSymbol &pubsymbol, char *dest) {
-    dest = SimpleSerializer<string>::Write(pubsymbol.name, dest);
+    dest = SimpleSerializer<InternedString>::Write(pubsymbol.name, dest);
     dest = SimpleSerializer<MemAddr>::Write(pubsymbol.address, dest);
     dest = SimpleSerializer<int32_t>::Write(pubsymbol.parameter_size, dest);
     return dest;
@@ -189,23 +203,40 @@ class SimpleSerializer<BasicSourceLineResolver::Function> {
  public:
   static size_t SizeOf(const Function &func) {
     unsigned int size = 0;
-    size += SimpleSerializer<string>::SizeOf(func.name);
+    size += SimpleSerializer<InternedString>::SizeOf(func.name);
     size += SimpleSerializer<MemAddr>::SizeOf(func.address);
     size += SimpleSerializer<MemAddr>::SizeOf(func.size);
     size += SimpleSerializer<int32_t>::SizeOf(func.parameter_size);
-    size += range_map_serializer_.SizeOf(func.lines);
+    RangeMap< MemAddr, linked_ptr<Line> > lines;
+    GetLineMap(func, &lines);
+    size += range_map_serializer_.SizeOf(lines);
     return size;
   }
 
   static char *Write(const Function &func, char *dest) {
-    dest = SimpleSerializer<string>::Write(func.name, dest);
+    dest = SimpleSerializer<InternedString>::Write(func.name, dest);
     dest = SimpleSerializer<MemAddr>::Write(func.address, dest);
     dest = SimpleSerializer<MemAddr>::Write(func.size, dest);
     dest = SimpleSerializer<int32_t>::Write(func.parameter_size, dest);
-    dest = range_map_serializer_.Write(func.lines, dest);
+    RangeMap< MemAddr, linked_ptr<Line> > lines;
+    GetLineMap(func, &lines);
+    dest = range_map_serializer_.Write(lines, dest);
     return dest;
   }
  private:
+  // Decodes the function's LineTable into the RangeMap the serialized
+  // format is written from.
+  static void GetLineMap(const Function &func,
+                         RangeMap< MemAddr, linked_ptr<Line> > *map) {
+    std::vector<Line> lines;
+    func.lines.GetLines(&lines);
+    for (size_t i = 0; i < lines.size(); ++i) {
+      map->StoreRange(lines[i].address, lines[i].size,
+                      linked_ptr<Line>(new Line(lines[i])));
+    }
+    map->Freeze();
+  }
+
   // This static member is defined in module_serializer.cc.
   static RangeMapSerializer< MemAddr, linked_ptr<Line> > range_map_serializer_;
 };
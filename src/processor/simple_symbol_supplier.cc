@@ -36,9 +36,12 @@
 #include "processor/simple_symbol_supplier.h"
 
 #include <assert.h>
+#include <fcntl.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <algorithm>
 #include <iostream>
@@ -47,6 +50,7 @@
 #include "common/using_std_string.h"
 #include "google_breakpad/processor/code_module.h"
 #include "google_breakpad/processor/system_info.h"
+#include "processor/compressed_symbol_file.h"
 #include "processor/logging.h"
 #include "processor/pathname_stripper.h"
 
@@ -57,6 +61,77 @@ static bool file_exists(const string &file_name) {
   return stat(file_name.c_str(), &sb) == 0;
 }
 
+// Reads the contents of file_name into *data.
+static void read_file(const string &file_name, string *data) {
+  std::ifstream in(file_name.c_str());
+  std::getline(in, *data, string::traits_type::to_char_type(
+                   string::traits_type::eof()));
+  in.close();
+}
+
+// Maps file_name into memory, followed by a null terminator.  Sets *data and
+// *data_size to the null-terminated data, and *mapping_size to the size to
+// pass to munmap.
+static bool map_file(const string &file_name, char **data, size_t *data_size,
+                     size_t *mapping_size) {
+  int fd = open(file_name.c_str(), O_RDONLY);
+  if (fd == -1) {
+    string error_string;
+    int error_code = ErrnoString(&error_string);
+    BPLOG(ERROR) << "Could not open " << file_name <<
+        ", error " << error_code << ": " << error_string;
+    return false;
+  }
+
+  struct stat sb;
+  if (fstat(fd, &sb) == -1) {
+    string error_string;
+    int error_code = ErrnoString(&error_string);
+    BPLOG(ERROR) << "Could not stat " << file_name <<
+        ", error " << error_code << ": " << error_string;
+    close(fd);
+    return false;
+  }
+
+  // Reserve zero-filled memory at least one byte larger than the file, and
+  // map the file over its start.  This guarantees that the data is followed
+  // by a null terminator, even if the file size is a multiple of the page
+  // size.
+  size_t file_size = sb.st_size;
+  size_t page_size = getpagesize();
+  size_t size = (file_size + page_size) / page_size * page_size;
+  void *base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANON, -1, 0);
+  if (base != MAP_FAILED && file_size > 0 &&
+      mmap(base, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED,
+           fd, 0) == MAP_FAILED) {
+    munmap(base, size);
+    base = MAP_FAILED;
+  }
+  if (base == MAP_FAILED) {
+    string error_string;
+    int error_code = ErrnoString(&error_string);
+    BPLOG(ERROR) << "Could not map " << file_name <<
+        ", error " << error_code << ": " << error_string;
+    close(fd);
+    return false;
+  }
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+
+  *data = static_cast<char*>(base);
+  *data_size = file_size + 1;
+  *mapping_size = size;
+  return true;
+}
+
+SimpleSymbolSupplier::~SimpleSymbolSupplier() {
+  for (SymbolDataMap::iterator it = symbol_data_.begin();
+       it != symbol_data_.end(); ++it) {
+    ReleaseSymbolData(it->second);
+  }
+}
+
 SymbolSupplier::SymbolResult SimpleSymbolSupplier::GetSymbolFile(
     const CodeModule *module, const SystemInfo *system_info,
     string *symbol_file) {
@@ -86,11 +161,16 @@ SymbolSupplier::SymbolResult SimpleSymbolSupplier::GetSymbolFile(
 
   SymbolSupplier::SymbolResult s = GetSymbolFile(module, system_info,
                                                  symbol_file);
-  if (s == FOUND) {
-    std::ifstream in(symbol_file->c_str());
-    std::getline(in, *symbol_data, string::traits_type::to_char_type(
-                     string::traits_type::eof()));
-    in.close();
+  if (s == FOUND && IsCompressedSymbolFile(*symbol_file)) {
+    char *data;
+    size_t data_size;
+    if (!ReadCompressedSymbolFile(*symbol_file, &data, &data_size))
+      return INTERRUPT;
+    // Leave out the null terminator.
+    symbol_data->assign(data, data_size - 1);
+    delete [] data;
+  } else if (s == FOUND) {
+    read_file(*symbol_file, symbol_data);
   }
   return s;
 }
@@ -104,22 +184,47 @@ SymbolSupplier::SymbolResult SimpleSymbolSupplier::GetCStringSymbolData(
   assert(symbol_data);
   assert(symbol_data_size);
 
-  string symbol_data_string;
   SymbolSupplier::SymbolResult s =
-      GetSymbolFile(module, system_info, symbol_file, &symbol_data_string);
+      GetSymbolFile(module, system_info, symbol_file);
+  if (s != FOUND)
+    return s;
+
+  // A resolver that keeps the buffer, like FastSourceLineResolver, may
+  // still point into the one given out before, so hand that out again.
+  ModuleKey key = KeyForModule(module);
+  SymbolDataMap::const_iterator existing = symbol_data_.find(key);
+  if (existing != symbol_data_.end()) {
+    *symbol_data = existing->second.data;
+    *symbol_data_size = existing->second.size;
+    return s;
+  }
 
-  if (s == FOUND) {
-    *symbol_data_size = symbol_data_string.size() + 1;
-    *symbol_data = new char[*symbol_data_size];
-    if (*symbol_data == NULL) {
-      BPLOG(ERROR) << "Memory allocation for size " << *symbol_data_size
+  SymbolData data;
+  data.mapping_size = 0;
+  // Compressed files are decompressed straight into the buffer, whether
+  // or not files are mapped.
+  if (IsCompressedSymbolFile(*symbol_file)) {
+    if (!ReadCompressedSymbolFile(*symbol_file, &data.data, &data.size))
+      return INTERRUPT;
+  } else if (map_symbol_files_) {
+    if (!map_file(*symbol_file, &data.data, &data.size, &data.mapping_size))
+      return INTERRUPT;
+  } else {
+    string symbol_data_string;
+    read_file(*symbol_file, &symbol_data_string);
+    data.size = symbol_data_string.size() + 1;
+    data.data = new char[data.size];
+    if (data.data == NULL) {
+      BPLOG(ERROR) << "Memory allocation for size " << data.size
                    << " failed";
       return INTERRUPT;
     }
-    memcpy(*symbol_data, symbol_data_string.c_str(), symbol_data_string.size());
-    (*symbol_data)[symbol_data_string.size()] = '\0';
-    memory_buffers_.insert(make_pair(module->code_file(), *symbol_data));
+    memcpy(data.data, symbol_data_string.c_str(), symbol_data_string.size());
+    data.data[symbol_data_string.size()] = '\0';
   }
+  symbol_data_[key] = data;
+  *symbol_data = data.data;
+  *symbol_data_size = data.size;
   return s;
 }
 
@@ -129,14 +234,28 @@ void SimpleSymbolSupplier::FreeSymbolData(const CodeModule *module) {
     return;
   }
 
-  map<string, char *>::iterator it = memory_buffers_.find(module->code_file());
-  if (it == memory_buffers_.end()) {
+  SymbolDataMap::iterator it = symbol_data_.find(KeyForModule(module));
+  if (it == symbol_data_.end()) {
     BPLOG(INFO) << "Cannot find symbol data buffer for module "
                 << module->code_file();
     return;
   }
-  delete [] it->second;
-  memory_buffers_.erase(it);
+  ReleaseSymbolData(it->second);
+  symbol_data_.erase(it);
+}
+
+// static
+SimpleSymbolSupplier::ModuleKey SimpleSymbolSupplier::KeyForModule(
+    const CodeModule *module) {
+  return ModuleKey(module->code_file(), module->debug_identifier());
+}
+
+// static
+void SimpleSymbolSupplier::ReleaseSymbolData(const SymbolData &symbol_data) {
+  if (symbol_data.mapping_size)
+    munmap(symbol_data.data, symbol_data.mapping_size);
+  else
+    delete [] symbol_data.data;
 }
 
 SymbolSupplier::SymbolResult SimpleSymbolSupplier::GetSymbolFileAtPathFromRoot(
@@ -192,6 +311,13 @@ SymbolSupplier::SymbolResult SimpleSymbolSupplier::GetSymbolFileAtPathFromRoot(
   }
   path.append(".sym");
 
+  // Prefer a compressed copy, which is less to read.
+  string compressed_path = path + kCompressedSymbolFileSuffix;
+  if (CanReadCompressedSymbolFiles() && file_exists(compressed_path)) {
+    *symbol_file = compressed_path;
+    return FOUND;
+  }
+
   if (!file_exists(path)) {
     BPLOG(INFO) << "No symbol file at " << path;
     return NOT_FOUND;
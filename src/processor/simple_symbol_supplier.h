@@ -62,6 +62,10 @@
 // SimpleSymbolServer, provided that the pdb files are transformed to dumped
 // format using a tool such as dump_syms, and given a .sym extension.
 //
+// A symbol file may also be stored compressed with gzip, with a .sym.gz
+// extension.  If both test_app.sym.gz and test_app.sym exist, the
+// compressed file is used.
+//
 // SimpleSymbolSupplier will iterate over all root paths searching for
 // a symbol file existing in that path.
 //
@@ -78,6 +82,7 @@
 
 #include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "common/using_std_string.h"
@@ -94,13 +99,25 @@ class SimpleSymbolSupplier : public SymbolSupplier {
  public:
   // Creates a new SimpleSymbolSupplier, using path as the root path where
   // symbols are stored.
-  explicit SimpleSymbolSupplier(const string &path) : paths_(1, path) {}
+  explicit SimpleSymbolSupplier(const string &path)
+      : paths_(1, path), map_symbol_files_(false) {}
 
   // Creates a new SimpleSymbolSupplier, using paths as a list of root
   // paths where symbols may be stored.
-  explicit SimpleSymbolSupplier(const vector<string> &paths) : paths_(paths) {}
+  explicit SimpleSymbolSupplier(const vector<string> &paths)
+      : paths_(paths), map_symbol_files_(false) {}
+
+  // Frees any symbol data that hasn't been freed with FreeSymbolData.
+  virtual ~SimpleSymbolSupplier();
 
-  virtual ~SimpleSymbolSupplier() {}
+  // If map_symbol_files is true, GetCStringSymbolData maps symbol files
+  // into memory instead of copying them into heap buffers.  The mapping is
+  // private and writable, and followed by a null terminator, so resolvers
+  // that modify the buffer while parsing it can use it like a heap buffer;
+  // only the pages they write to are copied.  FreeSymbolData unmaps it.
+  void set_map_symbol_files(bool map_symbol_files) {
+    map_symbol_files_ = map_symbol_files;
+  }
 
   // Returns the path to the symbol file for the given module.  See the
   // description above.
@@ -113,15 +130,21 @@ class SimpleSymbolSupplier : public SymbolSupplier {
                                      string *symbol_file,
                                      string *symbol_data);
 
-  // Allocates data buffer on heap and writes symbol data into buffer.
-  // Symbol supplier ALWAYS takes ownership of the data buffer.
+  // Allocates data buffer on heap and writes symbol data into buffer, or
+  // maps the symbol file if set_map_symbol_files(true) was called.
+  // Compressed symbol files are always decompressed into a heap buffer.
+  // Symbol supplier ALWAYS takes ownership of the data buffer.  If the
+  // buffer given out for the same code file and debug identifier hasn't
+  // been freed yet, a resolver may still be using it, so it is returned
+  // again rather than replaced.
   virtual SymbolResult GetCStringSymbolData(const CodeModule *module,
                                             const SystemInfo *system_info,
                                             string *symbol_file,
                                             char **symbol_data,
                                             size_t *symbol_data_size);
 
-  // Free the data buffer allocated in the above GetCStringSymbolData();
+  // Free the data buffer allocated or mapped in the above
+  // GetCStringSymbolData();
   virtual void FreeSymbolData(const CodeModule *module);
 
  protected:
@@ -131,8 +154,28 @@ class SimpleSymbolSupplier : public SymbolSupplier {
                                            string *symbol_file);
 
  private:
-  map<string, char *> memory_buffers_;
+  // Symbol data given out by GetCStringSymbolData.
+  struct SymbolData {
+    char *data;
+    size_t size;
+    // The size of the mapping |data| is at the start of, or 0 if |data|
+    // was allocated on the heap.
+    size_t mapping_size;
+  };
+
+  // Buffers are keyed by code file and debug identifier, so that
+  // different versions of a module don't share a buffer.
+  typedef std::pair<string, string> ModuleKey;
+  typedef map<ModuleKey, SymbolData> SymbolDataMap;
+
+  static ModuleKey KeyForModule(const CodeModule *module);
+
+  // Frees or unmaps |symbol_data|.
+  static void ReleaseSymbolData(const SymbolData &symbol_data);
+
+  SymbolDataMap symbol_data_;
   vector<string> paths_;
+  bool map_symbol_files_;
 };
 
 }  // namespace google_breakpad
@@ -0,0 +1,259 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// simple_symbol_supplier_unittest.cc: Unit tests for SimpleSymbolSupplier.
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <string>
+
+#include "breakpad_googletest_includes.h"
+#include "common/tests/auto_tempdir.h"
+#include "common/using_std_string.h"
+#include "google_breakpad/processor/basic_source_line_resolver.h"
+#include "google_breakpad/processor/stack_frame.h"
+#include "processor/basic_code_module.h"
+#include "processor/simple_symbol_supplier.h"
+
+namespace {
+
+using google_breakpad::AutoTempDir;
+using google_breakpad::BasicCodeModule;
+using google_breakpad::BasicSourceLineResolver;
+using google_breakpad::SimpleSymbolSupplier;
+using google_breakpad::StackFrame;
+using google_breakpad::SymbolSupplier;
+
+class SimpleSymbolSupplierTest : public ::testing::Test {
+ public:
+  SimpleSymbolSupplierTest()
+      : symbols_path_(string(getenv("srcdir") ? getenv("srcdir") : ".") +
+                      "/src/processor/testdata/symbols"),
+        libc_(0x7f0000000000ULL, 0x200000, "/lib/libc-2.13.so", "",
+              "libc-2.13.so", "F4F8DFCD5A5FB5A7CE64717E9E6AE3890", "") { }
+
+  // Fetch the symbol data for module from supplier, and copy it to *data.
+  void GetSymbolData(SimpleSymbolSupplier *supplier,
+                     const BasicCodeModule &module,
+                     string *data) {
+    string symbol_file;
+    char *symbol_data = NULL;
+    size_t symbol_data_size = 0;
+    ASSERT_EQ(SymbolSupplier::FOUND,
+              supplier->GetCStringSymbolData(&module, NULL, &symbol_file,
+                                             &symbol_data,
+                                             &symbol_data_size));
+    ASSERT_TRUE(symbol_data);
+    ASSERT_GT(symbol_data_size, 0U);
+    // The data must be null-terminated in both modes.
+    ASSERT_EQ('\0', symbol_data[symbol_data_size - 1]);
+    data->assign(symbol_data, symbol_data_size);
+    supplier->FreeSymbolData(&module);
+  }
+
+  string symbols_path_;
+  BasicCodeModule libc_;
+};
+
+TEST_F(SimpleSymbolSupplierTest, MappedDataMatchesReadData) {
+  SimpleSymbolSupplier read_supplier(symbols_path_);
+  string read_data;
+  GetSymbolData(&read_supplier, libc_, &read_data);
+
+  SimpleSymbolSupplier mapped_supplier(symbols_path_);
+  mapped_supplier.set_map_symbol_files(true);
+  string mapped_data;
+  GetSymbolData(&mapped_supplier, libc_, &mapped_data);
+
+  EXPECT_EQ(read_data, mapped_data);
+
+  // Data can be fetched again after it has been freed.
+  GetSymbolData(&mapped_supplier, libc_, &mapped_data);
+  EXPECT_EQ(read_data, mapped_data);
+}
+
+TEST_F(SimpleSymbolSupplierTest, MappedNotFound) {
+  SimpleSymbolSupplier supplier(symbols_path_);
+  supplier.set_map_symbol_files(true);
+  BasicCodeModule missing(0x1000, 0x1000, "missing.so", "", "missing.so",
+                          "000000000000000000000000000000000", "");
+  string symbol_file;
+  char *symbol_data = NULL;
+  size_t symbol_data_size = 0;
+  EXPECT_EQ(SymbolSupplier::NOT_FOUND,
+            supplier.GetCStringSymbolData(&missing, NULL, &symbol_file,
+                                          &symbol_data, &symbol_data_size));
+}
+
+TEST_F(SimpleSymbolSupplierTest, MappedDataLoadsInResolver) {
+  SimpleSymbolSupplier supplier(symbols_path_);
+  supplier.set_map_symbol_files(true);
+  string symbol_file;
+  char *symbol_data = NULL;
+  size_t symbol_data_size = 0;
+  ASSERT_EQ(SymbolSupplier::FOUND,
+            supplier.GetCStringSymbolData(&libc_, NULL, &symbol_file,
+                                          &symbol_data, &symbol_data_size));
+
+  // BasicSourceLineResolver writes to the buffer while parsing it.
+  BasicSourceLineResolver resolver;
+  ASSERT_TRUE(resolver.LoadModuleUsingMemoryBuffer(&libc_, symbol_data,
+                                                   symbol_data_size));
+  ASSERT_TRUE(resolver.ShouldDeleteMemoryBufferAfterLoadModule());
+  supplier.FreeSymbolData(&libc_);
+
+  StackFrame frame;
+  frame.module = &libc_;
+  frame.instruction = libc_.base_address() + 0x1edb0;
+  resolver.FillSourceLineInfo(&frame);
+  EXPECT_EQ("__libc_start_main", frame.function_name);
+}
+
+TEST_F(SimpleSymbolSupplierTest, RepeatedRequestKeepsBuffer) {
+  // Asking for a module whose buffer hasn't been freed gives out the same
+  // buffer again, leaving it valid for whoever still holds it.
+  SimpleSymbolSupplier supplier(symbols_path_);
+  supplier.set_map_symbol_files(true);
+  string symbol_file;
+  char *first_data = NULL;
+  size_t first_size = 0;
+  ASSERT_EQ(SymbolSupplier::FOUND,
+            supplier.GetCStringSymbolData(&libc_, NULL, &symbol_file,
+                                          &first_data, &first_size));
+  string first_contents(first_data, first_size);
+
+  char *second_data = NULL;
+  size_t second_size = 0;
+  ASSERT_EQ(SymbolSupplier::FOUND,
+            supplier.GetCStringSymbolData(&libc_, NULL, &symbol_file,
+                                          &second_data, &second_size));
+  EXPECT_EQ(first_data, second_data);
+  EXPECT_EQ(first_size, second_size);
+  EXPECT_EQ(first_contents, string(first_data, first_size));
+
+  supplier.FreeSymbolData(&libc_);
+  string data;
+  GetSymbolData(&supplier, libc_, &data);
+  EXPECT_EQ(first_contents, data);
+}
+
+TEST_F(SimpleSymbolSupplierTest, MappedPageSizedFile) {
+  // A symbol file whose size is a multiple of the page size still gets a
+  // null terminator.
+  AutoTempDir temp_dir;
+  string path = temp_dir.path() + "/page.so";
+  ASSERT_EQ(0, mkdir(path.c_str(), 0755));
+  path += "/0123456789ABCDEF0123456789ABCDEF0";
+  ASSERT_EQ(0, mkdir(path.c_str(), 0755));
+  path += "/page.so.sym";
+
+  const string line = "PUBLIC 1000 0 function\n";
+  string contents(getpagesize(), '\n');
+  contents.replace(0, line.size(), line);
+  FILE *f = fopen(path.c_str(), "wb");
+  ASSERT_TRUE(f);
+  ASSERT_EQ(contents.size(), fwrite(contents.data(), 1, contents.size(), f));
+  fclose(f);
+
+  SimpleSymbolSupplier supplier(temp_dir.path());
+  supplier.set_map_symbol_files(true);
+  BasicCodeModule module(0x1000, 0x2000, "page.so", "", "page.so",
+                         "0123456789ABCDEF0123456789ABCDEF0", "");
+  string data;
+  GetSymbolData(&supplier, module, &data);
+  EXPECT_EQ(contents + '\0', data);
+}
+
+#ifdef HAVE_ZLIB
+TEST_F(SimpleSymbolSupplierTest, CompressedFile) {
+  // A compressed symbol file is preferred to an uncompressed one.
+  AutoTempDir temp_dir;
+  string path = temp_dir.path() + "/gz.so";
+  ASSERT_EQ(0, mkdir(path.c_str(), 0755));
+  path += "/0123456789ABCDEF0123456789ABCDEF0";
+  ASSERT_EQ(0, mkdir(path.c_str(), 0755));
+  path += "/gz.so.sym";
+
+  FILE *f = fopen(path.c_str(), "wb");
+  ASSERT_TRUE(f);
+  fputs("PUBLIC 1000 0 uncompressed\n", f);
+  fclose(f);
+
+  const string contents = "PUBLIC 1000 0 compressed\n";
+  gzFile gz = gzopen((path + ".gz").c_str(), "wb");
+  ASSERT_TRUE(gz);
+  ASSERT_EQ(static_cast<int>(contents.size()),
+            gzwrite(gz, contents.data(), contents.size()));
+  gzclose(gz);
+
+  BasicCodeModule module(0x1000, 0x2000, "gz.so", "", "gz.so",
+                         "0123456789ABCDEF0123456789ABCDEF0", "");
+  SimpleSymbolSupplier supplier(temp_dir.path());
+  string data;
+  GetSymbolData(&supplier, module, &data);
+  EXPECT_EQ(contents + '\0', data);
+
+  supplier.set_map_symbol_files(true);
+  GetSymbolData(&supplier, module, &data);
+  EXPECT_EQ(contents + '\0', data);
+
+  string symbol_file;
+  ASSERT_EQ(SymbolSupplier::FOUND,
+            supplier.GetSymbolFile(&module, NULL, &symbol_file, &data));
+  EXPECT_EQ(path + ".gz", symbol_file);
+  EXPECT_EQ(contents, data);
+
+  // The resolver reads the compressed file given its path.
+  BasicSourceLineResolver resolver;
+  ASSERT_TRUE(resolver.LoadModule(&module, symbol_file));
+  StackFrame frame;
+  frame.module = &module;
+  frame.instruction = module.base_address() + 0x1000;
+  resolver.FillSourceLineInfo(&frame);
+  EXPECT_EQ("compressed", frame.function_name);
+}
+#endif  // HAVE_ZLIB
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -34,14 +34,20 @@
 //
 // Author: Siyang Xie (lambxsy@google.com)
 
+#include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <map>
 #include <utility>
 
+#include "common/scoped_ptr.h"
 #include "google_breakpad/processor/source_line_resolver_base.h"
+#include "google_breakpad/processor/symbol_supplier.h"
+#include "processor/compressed_symbol_file.h"
 #include "processor/source_line_resolver_base_types.h"
 #include "processor/module_factory.h"
 
@@ -55,7 +61,13 @@ SourceLineResolverBase::SourceLineResolverBase(
   : modules_(new ModuleMap),
     corrupt_modules_(new ModuleSet),
     memory_buffers_(new MemoryMap),
-    module_factory_(module_factory) {
+    module_factory_(module_factory),
+    symbol_supplier_(NULL),
+    module_cache_budget_(0),
+    module_cache_usage_(0),
+    module_cache_hits_(0),
+    module_cache_misses_(0),
+    module_cache_evictions_(0) {
 }
 
 SourceLineResolverBase::~SourceLineResolverBase() {
@@ -83,6 +95,11 @@ SourceLineResolverBase::~SourceLineResolverBase() {
 
   delete module_factory_;
   module_factory_ = NULL;
+
+  ModuleCacheMap::iterator entry = module_cache_entries_.begin();
+  for (; entry != module_cache_entries_.end(); ++entry) {
+    delete entry->second.supplied_module;
+  }
 }
 
 bool SourceLineResolverBase::ReadSymbolFile(const string &map_file,
@@ -93,6 +110,9 @@ bool SourceLineResolverBase::ReadSymbolFile(const string &map_file,
     return false;
   }
 
+  if (IsCompressedSymbolFile(map_file))
+    return ReadCompressedSymbolFile(map_file, symbol_data, symbol_data_size);
+
   struct stat buf;
   int error_code = stat(map_file.c_str(), &buf);
   if (error_code == -1) {
@@ -148,6 +168,63 @@ bool SourceLineResolverBase::ReadSymbolFile(const string &map_file,
   return true;
 }
 
+bool SourceLineResolverBase::MapSymbolFile(const string &map_file,
+                                           char **symbol_data,
+                                           size_t *symbol_data_size) {
+  if (symbol_data == NULL || symbol_data_size == NULL) {
+    BPLOG(ERROR) << "Could not map file into Null memory pointer";
+    return false;
+  }
+
+  int fd = open(map_file.c_str(), O_RDONLY);
+  if (fd == -1) {
+    string error_string;
+    int error_code = ErrnoString(&error_string);
+    BPLOG(ERROR) << "Could not open " << map_file <<
+        ", error " << error_code << ": " << error_string;
+    return false;
+  }
+
+  struct stat buf;
+  if (fstat(fd, &buf) == -1) {
+    string error_string;
+    int error_code = ErrnoString(&error_string);
+    BPLOG(ERROR) << "Could not stat " << map_file <<
+        ", error " << error_code << ": " << error_string;
+    close(fd);
+    return false;
+  }
+
+  if (buf.st_size == 0) {
+    BPLOG(ERROR) << "Could not map empty file " << map_file;
+    close(fd);
+    return false;
+  }
+
+  BPLOG(INFO) << "Mapping " << map_file;
+
+  void *mapping = mmap(NULL, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    string error_string;
+    int error_code = ErrnoString(&error_string);
+    BPLOG(ERROR) << "Could not map " << map_file <<
+        ", error " << error_code << ": " << error_string;
+    return false;
+  }
+
+  *symbol_data = static_cast<char*>(mapping);
+  *symbol_data_size = buf.st_size;
+  return true;
+}
+
+void SourceLineResolverBase::UnmapSymbolFile(char *symbol_data,
+                                             size_t symbol_data_size) {
+  if (symbol_data)
+    munmap(symbol_data, symbol_data_size);
+}
+
 bool SourceLineResolverBase::LoadModule(const CodeModule *module,
                                         const string &map_file) {
   if (module == NULL)
@@ -176,6 +253,7 @@ bool SourceLineResolverBase::LoadModule(const CodeModule *module,
   if (load_result && !ShouldDeleteMemoryBufferAfterLoadModule()) {
     // memory_buffer has to stay alive as long as the module.
     memory_buffers_->insert(make_pair(module->code_file(), memory_buffer));
+    OwnModuleData(module->code_file());
   } else {
     delete [] memory_buffer;
   }
@@ -212,6 +290,7 @@ bool SourceLineResolverBase::LoadModuleUsingMapBuffer(
   if (load_result && !ShouldDeleteMemoryBufferAfterLoadModule()) {
     // memory_buffer has to stay alive as long as the module.
     memory_buffers_->insert(make_pair(module->code_file(), memory_buffer));
+    OwnModuleData(module->code_file());
   } else {
     delete [] memory_buffer;
   }
@@ -252,6 +331,17 @@ bool SourceLineResolverBase::LoadModuleUsingMemoryBuffer(
   if (basic_module->IsCorrupt()) {
     corrupt_modules_->insert(module->code_file());
   }
+
+  module_lru_.push_front(module->code_file());
+  ModuleCacheEntry &entry = module_cache_entries_[module->code_file()];
+  entry.size = basic_module->MemoryUsage();
+  entry.lru_position = module_lru_.begin();
+  // Until told otherwise, a buffer that outlives the load belongs to
+  // whoever passed it in.
+  entry.supplied_module = ShouldDeleteMemoryBufferAfterLoadModule() ?
+      NULL : module->Copy();
+  module_cache_usage_ += entry.size;
+  EvictModules(module->code_file());
   return true;
 }
 
@@ -263,7 +353,11 @@ void SourceLineResolverBase::UnloadModule(const CodeModule *code_module) {
   if (!code_module)
     return;
 
-  ModuleMap::iterator mod_iter = modules_->find(code_module->code_file());
+  RemoveModule(code_module->code_file());
+}
+
+void SourceLineResolverBase::RemoveModule(const string &code_file) {
+  ModuleMap::iterator mod_iter = modules_->find(code_file);
   if (mod_iter != modules_->end()) {
     Module *symbol_module = mod_iter->second;
     delete symbol_module;
@@ -271,11 +365,19 @@ void SourceLineResolverBase::UnloadModule(const CodeModule *code_module) {
     modules_->erase(mod_iter);
   }
 
+  ModuleCacheMap::iterator entry = module_cache_entries_.find(code_file);
+  if (entry != module_cache_entries_.end()) {
+    module_cache_usage_ -= entry->second.size;
+    module_lru_.erase(entry->second.lru_position);
+    delete entry->second.supplied_module;
+    module_cache_entries_.erase(entry);
+  }
+
   if (ShouldDeleteMemoryBufferAfterLoadModule()) {
     // No-op.  Because we never store any memory buffers.
   } else {
     // There may be a buffer stored locally, we need to find and delete it.
-    MemoryMap::iterator iter = memory_buffers_->find(code_module->code_file());
+    MemoryMap::iterator iter = memory_buffers_->find(code_file);
     if (iter != memory_buffers_->end()) {
       delete [] iter->second;
       memory_buffers_->erase(iter);
@@ -286,7 +388,14 @@ void SourceLineResolverBase::UnloadModule(const CodeModule *code_module) {
 bool SourceLineResolverBase::HasModule(const CodeModule *module) {
   if (!module)
     return false;
-  return modules_->find(module->code_file()) != modules_->end();
+  if (modules_->find(module->code_file()) == modules_->end()) {
+    ++module_cache_misses_;
+    return false;
+  }
+  ++module_cache_hits_;
+  TouchModule(module->code_file());
+  EvictModules(module->code_file());
+  return true;
 }
 
 bool SourceLineResolverBase::IsModuleCorrupt(const CodeModule *module) {
@@ -304,6 +413,16 @@ void SourceLineResolverBase::FillSourceLineInfo(StackFrame *frame) {
   }
 }
 
+bool SourceLineResolverBase::GetFunctionTable(const CodeModule *module,
+                                              FunctionTable *table) {
+  if (!module)
+    return false;
+  ModuleMap::const_iterator it = modules_->find(module->code_file());
+  if (it == modules_->end())
+    return false;
+  return it->second->GetFunctionTable(table);
+}
+
 WindowsFrameInfo *SourceLineResolverBase::FindWindowsFrameInfo(
     const StackFrame *frame) {
   if (frame->module) {
@@ -326,6 +445,93 @@ CFIFrameInfo *SourceLineResolverBase::FindCFIFrameInfo(
   return NULL;
 }
 
+void SourceLineResolverBase::set_module_cache_budget(size_t bytes) {
+  module_cache_budget_ = bytes;
+  EvictModules(string());
+}
+
+void SourceLineResolverBase::PinModule(const CodeModule *module) {
+  if (module)
+    ++pinned_modules_[module->code_file()];
+}
+
+void SourceLineResolverBase::UnpinModule(const CodeModule *module) {
+  if (!module)
+    return;
+  map<string, int, CompareString>::iterator pin =
+      pinned_modules_.find(module->code_file());
+  if (pin == pinned_modules_.end()) {
+    BPLOG(ERROR) << "Module " << module->code_file() << " is not pinned";
+    return;
+  }
+  if (--pin->second == 0)
+    pinned_modules_.erase(pin);
+}
+
+void SourceLineResolverBase::GetModuleCacheStats(uint64_t *hits,
+                                                 uint64_t *misses,
+                                                 uint64_t *evictions) const {
+  *hits = module_cache_hits_;
+  *misses = module_cache_misses_;
+  *evictions = module_cache_evictions_;
+}
+
+void SourceLineResolverBase::OwnModuleData(const string &code_file) {
+  ModuleCacheMap::iterator entry = module_cache_entries_.find(code_file);
+  if (entry != module_cache_entries_.end()) {
+    delete entry->second.supplied_module;
+    entry->second.supplied_module = NULL;
+  }
+}
+
+void SourceLineResolverBase::TouchModule(const string &code_file) {
+  ModuleCacheMap::iterator entry = module_cache_entries_.find(code_file);
+  if (entry == module_cache_entries_.end())
+    return;
+  module_lru_.splice(module_lru_.begin(), module_lru_,
+                     entry->second.lru_position);
+
+  // Lookups may have parsed more of the module since it was last counted.
+  ModuleMap::const_iterator module = modules_->find(code_file);
+  size_t size = module->second->MemoryUsage();
+  module_cache_usage_ += size - entry->second.size;
+  entry->second.size = size;
+}
+
+void SourceLineResolverBase::EvictModules(const string &keep) {
+  if (module_cache_budget_ == 0)
+    return;
+
+  // Walk from the least recently used module towards the most recently
+  // used one, skipping the modules that must stay.
+  std::list<string>::iterator candidate = module_lru_.end();
+  while (module_cache_usage_ > module_cache_budget_ &&
+         candidate != module_lru_.begin()) {
+    --candidate;
+    if (*candidate == keep ||
+        pinned_modules_.find(*candidate) != pinned_modules_.end()) {
+      continue;
+    }
+
+    // RemoveModule erases |candidate| from module_lru_, so step past it
+    // first.
+    string code_file = *candidate;
+    ++candidate;
+    BPLOG(INFO) << "Unloading symbols for module " << code_file
+                << " to stay within the module cache budget";
+
+    // Hand the symbol data back to the supplier once nothing points into
+    // it any more.
+    ModuleCacheEntry &entry = module_cache_entries_[code_file];
+    scoped_ptr<const CodeModule> supplied_module(entry.supplied_module);
+    entry.supplied_module = NULL;
+    RemoveModule(code_file);
+    if (supplied_module.get() && symbol_supplier_)
+      symbol_supplier_->FreeSymbolData(supplied_module.get());
+    ++module_cache_evictions_;
+  }
+}
+
 bool SourceLineResolverBase::CompareString::operator()(
     const string &s1, const string &s2) const {
   return strcmp(s1.c_str(), s2.c_str()) < 0;
@@ -80,16 +80,16 @@ struct SourceLineResolverBase::Line {
   int32_t line;
 };
 
+// The name of a Function or PublicSymbol is kept by the subclasses, as
+// each resolver stores names differently.
 struct SourceLineResolverBase::Function {
   Function() { }
-  Function(const string &function_name,
-           MemAddr function_address,
+  Function(MemAddr function_address,
            MemAddr code_size,
            int set_parameter_size)
-      : name(function_name), address(function_address), size(code_size),
+      : address(function_address), size(code_size),
         parameter_size(set_parameter_size) { }
 
-  string name;
   MemAddr address;
   MemAddr size;
 
@@ -99,14 +99,11 @@ struct SourceLineResolverBase::Function {
 
 struct SourceLineResolverBase::PublicSymbol {
   PublicSymbol() { }
-  PublicSymbol(const string& set_name,
-               MemAddr set_address,
+  PublicSymbol(MemAddr set_address,
                int set_parameter_size)
-      : name(set_name),
-        address(set_address),
+      : address(set_address),
         parameter_size(set_parameter_size) {}
 
-  string name;
   MemAddr address;
 
   // If the public symbol is used as a function entry point, parameter_size
@@ -131,10 +128,23 @@ class SourceLineResolverBase::Module {
   // undefined, if the symbol data hasn't been loaded yet.
   virtual bool IsCorrupt() const = 0;
 
+  // Returns about how many bytes of memory the module takes up, including
+  // any symbol data it points into.  The module cache charges modules
+  // this much against its budget.
+  virtual size_t MemoryUsage() const = 0;
+
   // Looks up the given relative address, and fills the StackFrame struct
   // with the result.
   virtual void LookupAddress(StackFrame *frame) const = 0;
 
+  // Fills |table| with the module's functions and public symbols, and
+  // returns true, if LookupAddress follows the rules described at
+  // SourceLineResolverInterface::FunctionTable.  Returns false if the
+  // module can't list them.
+  virtual bool GetFunctionTable(FunctionTable *table) const {
+    return false;
+  }
+
   // If Windows stack walking information is available covering ADDRESS,
   // return a WindowsFrameInfo structure describing it. If the information
   // is not available, returns NULL. A NULL return value does not indicate
@@ -45,13 +45,30 @@
 #include "google_breakpad/processor/system_info.h"
 #include "processor/linked_ptr.h"
 #include "processor/logging.h"
+#include "processor/missing_symbol_cache.h"
+#include "processor/thread_primitives.h"
 
 namespace google_breakpad {
 
 StackFrameSymbolizer::StackFrameSymbolizer(
     SymbolSupplier* supplier,
     SourceLineResolverInterface* resolver) : supplier_(supplier),
-                                             resolver_(resolver) { }
+                                             resolver_(resolver),
+                                             missing_symbol_cache_(NULL),
+                                             mutex_(new Mutex()),
+                                             fetch_finished_(
+                                                 new ConditionVariable()),
+                                             supplier_mutex_(new Mutex()),
+                                             next_prefetch_(0),
+                                             prefetch_system_info_(NULL) {
+}
+
+StackFrameSymbolizer::~StackFrameSymbolizer() {
+  StopPrefetch();
+  delete supplier_mutex_;
+  delete fetch_finished_;
+  delete mutex_;
+}
 
 StackFrameSymbolizer::SymbolizerResult StackFrameSymbolizer::FillSourceLineInfo(
     const CodeModules* modules,
@@ -65,66 +82,250 @@ StackFrameSymbolizer::SymbolizerResult StackFrameSymbolizer::FillSourceLineInfo(
   frame->module = module;
 
   if (!resolver_) return kError;  // no resolver.
+
+  SymbolizerResult result = LoadModuleSymbols(module, system_info);
+  if (result == kNoError || result == kWarningCorruptSymbols)
+    resolver_->FillSourceLineInfo(frame);
+  return result;
+}
+
+StackFrameSymbolizer::SymbolizerResult StackFrameSymbolizer::GetFunctionTable(
+    const CodeModule* module,
+    const SystemInfo* system_info,
+    SourceLineResolverInterface::FunctionTable* table,
+    bool* has_table) {
+  assert(module);
+  assert(table);
+  assert(has_table);
+  *has_table = false;
+
+  if (!resolver_) return kError;  // no resolver.
+
+  SymbolizerResult result = LoadModuleSymbols(module, system_info);
+  if (result == kNoError || result == kWarningCorruptSymbols)
+    *has_table = resolver_->GetFunctionTable(module, table);
+  return result;
+}
+
+StackFrameSymbolizer::SymbolizerResult StackFrameSymbolizer::LoadModuleSymbols(
+    const CodeModule* module,
+    const SystemInfo* system_info) {
+  mutex_->Acquire();
+  // If another thread is fetching symbols for this module, wait for it to
+  // finish, so that the module is either loaded or known to be missing.
+  while (fetching_modules_.find(module->code_file()) !=
+         fetching_modules_.end()) {
+    fetch_finished_->Wait(mutex_);
+  }
+
   // If module is known to have missing symbol file, return.
   if (no_symbol_modules_.find(module->code_file()) !=
       no_symbol_modules_.end()) {
+    mutex_->Release();
     return kError;
   }
 
-  // If module is already loaded, go ahead to fill source line info and return.
-  if (resolver_->HasModule(frame->module)) {
-    resolver_->FillSourceLineInfo(frame);
-    return resolver_->IsModuleCorrupt(frame->module) ?
+  // If module is already loaded, there is nothing to fetch.
+  if (resolver_->HasModule(module)) {
+    mutex_->Release();
+    return resolver_->IsModuleCorrupt(module) ?
         kWarningCorruptSymbols : kNoError;
   }
 
   // Module needs to fetch symbol file. First check to see if supplier exists.
   if (!supplier_) {
+    mutex_->Release();
     return kError;
   }
 
-  // Start fetching symbol from supplier.
+  // If an earlier minidump found the symbol file missing, don't look for
+  // it again.
+  if (missing_symbol_cache_ && missing_symbol_cache_->IsMissing(module)) {
+    no_symbol_modules_.insert(module->code_file());
+    mutex_->Release();
+    return kError;
+  }
+  fetching_modules_.insert(module->code_file());
+  mutex_->Release();
+
+  // A resolver that reads symbol files in part only needs the path.  If
+  // the supplier has none to give, fetch the data as usual.
   string symbol_file;
+  if (resolver_->ShouldLoadModuleFromSymbolFile()) {
+    supplier_mutex_->Acquire();
+    SymbolSupplier::SymbolResult path_result =
+        supplier_->GetSymbolFile(module, system_info, &symbol_file);
+    supplier_mutex_->Release();
+    if (path_result == SymbolSupplier::FOUND && !symbol_file.empty()) {
+      if (resolver_->LoadModule(module, symbol_file)) {
+        FinishFetch(module->code_file(), false);
+        return resolver_->IsModuleCorrupt(module) ?
+            kWarningCorruptSymbols : kNoError;
+      }
+      BPLOG(ERROR) << "Failed to load symbol file in resolver.";
+      FinishFetch(module->code_file(), true);
+      return kError;
+    }
+  }
+
+  // Start fetching symbol from supplier.
   char* symbol_data = NULL;
   size_t symbol_data_size;
+  supplier_mutex_->Acquire();
   SymbolSupplier::SymbolResult symbol_result = supplier_->GetCStringSymbolData(
       module, system_info, &symbol_file, &symbol_data, &symbol_data_size);
+  supplier_mutex_->Release();
 
   switch (symbol_result) {
     case SymbolSupplier::FOUND: {
       bool load_success = resolver_->LoadModuleUsingMemoryBuffer(
-          frame->module,
+          module,
           symbol_data,
           symbol_data_size);
       if (resolver_->ShouldDeleteMemoryBufferAfterLoadModule()) {
+        supplier_mutex_->Acquire();
         supplier_->FreeSymbolData(module);
+        supplier_mutex_->Release();
       }
 
       if (load_success) {
-        resolver_->FillSourceLineInfo(frame);
-        return resolver_->IsModuleCorrupt(frame->module) ?
+        FinishFetch(module->code_file(), false);
+        return resolver_->IsModuleCorrupt(module) ?
             kWarningCorruptSymbols : kNoError;
       } else {
         BPLOG(ERROR) << "Failed to load symbol file in resolver.";
-        no_symbol_modules_.insert(module->code_file());
+        FinishFetch(module->code_file(), true);
         return kError;
       }
     }
 
     case SymbolSupplier::NOT_FOUND:
-      no_symbol_modules_.insert(module->code_file());
+      if (missing_symbol_cache_)
+        missing_symbol_cache_->AddMissing(module);
+      FinishFetch(module->code_file(), true);
       return kError;
 
     case SymbolSupplier::INTERRUPT:
+      FinishFetch(module->code_file(), false);
       return kInterrupt;
 
     default:
       BPLOG(ERROR) << "Unknown SymbolResult enum: " << symbol_result;
+      FinishFetch(module->code_file(), false);
       return kError;
   }
   return kError;
 }
 
+void StackFrameSymbolizer::Reset() {
+  StopPrefetch();
+  mutex_->Acquire();
+  no_symbol_modules_.clear();
+  mutex_->Release();
+}
+
+void StackFrameSymbolizer::StartPrefetch(
+    const CodeModules* modules,
+    const SystemInfo* system_info,
+    const std::vector<const CodeModule*>& first_modules,
+    int thread_count) {
+  if (!modules || !resolver_ || !supplier_ || thread_count < 1 ||
+      !prefetch_threads_.empty()) {
+    return;
+  }
+  if (!IsThreadSafe()) {
+    BPLOG(INFO) << "Stack frame symbolizer is not thread-safe, "
+                   "not prefetching symbols";
+    return;
+  }
+  if (!WorkerThread::IsSupported()) {
+    BPLOG(INFO) << "Threads are not supported on this platform, "
+                   "not prefetching symbols";
+    return;
+  }
+
+  // Queue each code file once, the first modules ahead of the rest.
+  std::set<string> queued;
+  prefetch_modules_.clear();
+  for (size_t i = 0; i < first_modules.size(); ++i) {
+    if (first_modules[i] &&
+        queued.insert(first_modules[i]->code_file()).second) {
+      prefetch_modules_.push_back(first_modules[i]);
+    }
+  }
+  unsigned int module_count = modules->module_count();
+  for (unsigned int i = 0; i < module_count; ++i) {
+    const CodeModule* module = modules->GetModuleAtIndex(i);
+    if (module && queued.insert(module->code_file()).second)
+      prefetch_modules_.push_back(module);
+  }
+  next_prefetch_ = 0;
+  prefetch_system_info_ = system_info;
+
+  BPLOG(INFO) << "Prefetching symbols for " << prefetch_modules_.size()
+              << " modules on " << thread_count << " threads";
+  for (int i = 0; i < thread_count; ++i) {
+    WorkerThread* thread = new WorkerThread();
+    if (!thread->Start(PrefetchThread, this)) {
+      BPLOG(ERROR) << "Could not start symbol prefetch thread " << i;
+      delete thread;
+      break;
+    }
+    prefetch_threads_.push_back(thread);
+  }
+}
+
+void StackFrameSymbolizer::StopPrefetch() {
+  if (prefetch_threads_.empty())
+    return;
+
+  mutex_->Acquire();
+  next_prefetch_ = prefetch_modules_.size();
+  mutex_->Release();
+
+  for (size_t i = 0; i < prefetch_threads_.size(); ++i) {
+    prefetch_threads_[i]->Join();
+    delete prefetch_threads_[i];
+  }
+  prefetch_threads_.clear();
+  prefetch_modules_.clear();
+  next_prefetch_ = 0;
+  prefetch_system_info_ = NULL;
+}
+
+// static
+void* StackFrameSymbolizer::PrefetchThread(void* symbolizer) {
+  StackFrameSymbolizer* self = static_cast<StackFrameSymbolizer*>(symbolizer);
+  for (;;) {
+    self->mutex_->Acquire();
+    if (self->next_prefetch_ >= self->prefetch_modules_.size()) {
+      self->mutex_->Release();
+      return NULL;
+    }
+    const CodeModule* module = self->prefetch_modules_[self->next_prefetch_++];
+    self->mutex_->Release();
+
+    // Failures are left for the stack walk to report, as it would have
+    // without prefetching: missing symbols are remembered, and an
+    // interrupted fetch is retried when a frame needs the module.
+    self->LoadModuleSymbols(module, self->prefetch_system_info_);
+  }
+}
+
+bool StackFrameSymbolizer::IsThreadSafe() {
+  return !resolver_ || resolver_->IsThreadSafe();
+}
+
+void StackFrameSymbolizer::FinishFetch(const string &code_file,
+                                       bool missing) {
+  mutex_->Acquire();
+  if (missing)
+    no_symbol_modules_.insert(code_file);
+  fetching_modules_.erase(code_file);
+  fetch_finished_->Broadcast();
+  mutex_->Release();
+}
+
 WindowsFrameInfo* StackFrameSymbolizer::FindWindowsFrameInfo(
     const StackFrame* frame) {
   return resolver_ ? resolver_->FindWindowsFrameInfo(frame) : NULL;
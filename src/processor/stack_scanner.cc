@@ -0,0 +1,162 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// stack_scanner.cc: Fast scanning of stack memory.
+//
+// See stack_scanner.h for documentation.
+
+#include "processor/stack_scanner.h"
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace google_breakpad {
+
+namespace {
+
+// A word lies in the range exactly when its offset from the bottom of the
+// range, computed with unsigned wraparound, is at most the range's span.
+// The vector versions compare offsets as signed numbers, so they flip the
+// sign bit of both sides first.
+
+template<typename Word>
+size_t FindWordInRangeFrom(const uint8_t *words, size_t index, size_t count,
+                           Word lowest, Word span) {
+  for (; index < count; ++index) {
+    Word word;
+    memcpy(&word, words + index * sizeof(Word), sizeof(Word));
+    if (static_cast<Word>(word - lowest) <= span)
+      return index;
+  }
+  return count;
+}
+
+}  // namespace
+
+size_t FindWordInRange(const uint8_t *words, size_t count,
+                       uint32_t lowest, uint32_t highest) {
+  if (lowest > highest)
+    return count;
+  const uint32_t span = highest - lowest;
+  size_t index = 0;
+
+#if defined(__AVX2__)
+  const __m256i sign = _mm256_set1_epi32(static_cast<int>(0x80000000U));
+  const __m256i bottom = _mm256_set1_epi32(static_cast<int>(lowest));
+  const __m256i limit = _mm256_set1_epi32(static_cast<int>(span ^ 0x80000000U));
+  for (; index + 8 <= count; index += 8) {
+    __m256i block = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(words + index * 4));
+    __m256i offsets = _mm256_xor_si256(_mm256_sub_epi32(block, bottom), sign);
+    uint32_t outside = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpgt_epi32(offsets, limit)));
+    if (outside != 0xffffffffU)
+      return index + __builtin_ctz(~outside) / 4;
+  }
+#elif defined(__SSE2__)
+  const __m128i sign = _mm_set1_epi32(static_cast<int>(0x80000000U));
+  const __m128i bottom = _mm_set1_epi32(static_cast<int>(lowest));
+  const __m128i limit = _mm_set1_epi32(static_cast<int>(span ^ 0x80000000U));
+  for (; index + 4 <= count; index += 4) {
+    __m128i block = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(words + index * 4));
+    __m128i offsets = _mm_xor_si128(_mm_sub_epi32(block, bottom), sign);
+    uint32_t outside = static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpgt_epi32(offsets, limit)));
+    if (outside != 0xffffU)
+      return index + __builtin_ctz(~outside) / 4;
+  }
+#endif
+
+  return FindWordInRangeFrom(words, index, count, lowest, span);
+}
+
+size_t FindWordInRange(const uint8_t *words, size_t count,
+                       uint64_t lowest, uint64_t highest) {
+  if (lowest > highest)
+    return count;
+  const uint64_t span = highest - lowest;
+  size_t index = 0;
+
+#if defined(__AVX2__)
+  const __m256i sign = _mm256_set1_epi64x(
+      static_cast<long long>(0x8000000000000000ULL));
+  const __m256i bottom = _mm256_set1_epi64x(static_cast<long long>(lowest));
+  const __m256i limit = _mm256_set1_epi64x(
+      static_cast<long long>(span ^ 0x8000000000000000ULL));
+  for (; index + 4 <= count; index += 4) {
+    __m256i block = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(words + index * 8));
+    __m256i offsets = _mm256_xor_si256(_mm256_sub_epi64(block, bottom), sign);
+    uint32_t outside = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpgt_epi64(offsets, limit)));
+    if (outside != 0xffffffffU)
+      return index + __builtin_ctz(~outside) / 8;
+  }
+#elif defined(__SSE2__)
+  // SSE2 has no 64-bit comparison, so build one from 32-bit comparisons
+  // of both halves, with the sign bit of each half flipped: one offset is
+  // greater than the other if its high half is greater, or if the high
+  // halves are equal and its low half is greater.
+  const __m128i sign = _mm_set1_epi32(static_cast<int>(0x80000000U));
+  const __m128i bottom = _mm_set_epi32(static_cast<int>(lowest >> 32),
+                                       static_cast<int>(lowest),
+                                       static_cast<int>(lowest >> 32),
+                                       static_cast<int>(lowest));
+  const __m128i limit = _mm_xor_si128(
+      _mm_set_epi32(static_cast<int>(span >> 32), static_cast<int>(span),
+                    static_cast<int>(span >> 32), static_cast<int>(span)),
+      sign);
+  for (; index + 2 <= count; index += 2) {
+    __m128i block = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(words + index * 8));
+    __m128i offsets = _mm_xor_si128(_mm_sub_epi64(block, bottom), sign);
+    __m128i greater = _mm_cmpgt_epi32(offsets, limit);
+    __m128i equal = _mm_cmpeq_epi32(offsets, limit);
+    __m128i greater_high = _mm_shuffle_epi32(greater, _MM_SHUFFLE(3, 3, 1, 1));
+    __m128i greater_low = _mm_shuffle_epi32(greater, _MM_SHUFFLE(2, 2, 0, 0));
+    __m128i equal_high = _mm_shuffle_epi32(equal, _MM_SHUFFLE(3, 3, 1, 1));
+    __m128i above = _mm_or_si128(greater_high,
+                                 _mm_and_si128(equal_high, greater_low));
+    uint32_t outside = static_cast<uint32_t>(_mm_movemask_epi8(above));
+    if (outside != 0xffffU)
+      return index + __builtin_ctz(~outside) / 8;
+  }
+#endif
+
+  return FindWordInRangeFrom(words, index, count, lowest, span);
+}
+
+}  // namespace google_breakpad
@@ -0,0 +1,60 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// stack_scanner.h: Fast scanning of stack memory.
+//
+// When a stackwalker resorts to scanning the stack for a return address,
+// most of the words it looks at are data, not addresses in any module.
+// FindWordInRange finds the first word that lies within the modules'
+// address range, comparing many words at a time with SSE2 or AVX2 when
+// the compiler targets them, so that only those words need the full
+// check of Stackwalker::InstructionAddressSeemsValid.
+
+#ifndef PROCESSOR_STACK_SCANNER_H__
+#define PROCESSOR_STACK_SCANNER_H__
+
+#include <stddef.h>
+
+#include "google_breakpad/common/breakpad_types.h"
+
+namespace google_breakpad {
+
+// Returns the index of the first of the |count| words at |words| whose
+// value lies between |lowest| and |highest| inclusive, or |count| if there
+// is none.  The words are in the byte order of the running program, and
+// need not be aligned.
+size_t FindWordInRange(const uint8_t *words, size_t count,
+                       uint32_t lowest, uint32_t highest);
+size_t FindWordInRange(const uint8_t *words, size_t count,
+                       uint64_t lowest, uint64_t highest);
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_STACK_SCANNER_H__
@@ -0,0 +1,155 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// stack_scanner_unittest.cc: Unit tests for the stack scanner.  Each
+// result is checked against a word-by-word search.
+
+#include <string.h>
+
+#include <vector>
+
+#include "breakpad_googletest_includes.h"
+#include "processor/stack_scanner.h"
+
+namespace {
+
+using google_breakpad::FindWordInRange;
+
+template<typename Word>
+size_t SlowFindWordInRange(const std::vector<Word> &words, Word lowest,
+                           Word highest) {
+  for (size_t i = 0; i < words.size(); ++i) {
+    if (words[i] >= lowest && words[i] <= highest)
+      return i;
+  }
+  return words.size();
+}
+
+// Checks FindWordInRange against SlowFindWordInRange, placing the words
+// |offset| bytes into the buffer to try different alignments.
+template<typename Word>
+void CheckWords(const std::vector<Word> &words, Word lowest, Word highest) {
+  size_t expected = SlowFindWordInRange(words, lowest, highest);
+  for (size_t offset = 0; offset < 8; ++offset) {
+    std::vector<uint8_t> buffer(offset + words.size() * sizeof(Word) + 1);
+    if (!words.empty())
+      memcpy(&buffer[offset], &words[0], words.size() * sizeof(Word));
+    EXPECT_EQ(expected,
+              FindWordInRange(&buffer[offset], words.size(), lowest, highest))
+        << "offset " << offset << ", " << words.size() << " words";
+  }
+}
+
+// A small deterministic generator, so that failures can be reproduced.
+class Random {
+ public:
+  Random() : state_(0x853c49e6748fea9bULL) { }
+  uint64_t Next() {
+    state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+    return state_;
+  }
+
+ private:
+  uint64_t state_;
+};
+
+TEST(StackScannerTest, Words32) {
+  std::vector<uint32_t> words;
+  CheckWords<uint32_t>(words, 0, 0xffffffffU);
+  words.push_back(0x1000);
+  CheckWords<uint32_t>(words, 0x1000, 0x1000);
+  CheckWords<uint32_t>(words, 0x1001, 0x2000);
+  CheckWords<uint32_t>(words, 0, 0xfff);
+  CheckWords<uint32_t>(words, 0x2000, 0x1000);
+  for (uint32_t i = 0; i < 40; ++i)
+    words.push_back(0x80000000U + i);
+  words.push_back(0xffffffffU);
+  words.push_back(0);
+  CheckWords<uint32_t>(words, 0x80000010U, 0x80000020U);
+  CheckWords<uint32_t>(words, 0x80000027U, 0x80000027U);
+  CheckWords<uint32_t>(words, 0x7fffffffU, 0x7fffffffU);
+  CheckWords<uint32_t>(words, 0xffffffffU, 0xffffffffU);
+  CheckWords<uint32_t>(words, 0, 0);
+  CheckWords<uint32_t>(words, 0, 0xffffffffU);
+}
+
+TEST(StackScannerTest, Words64) {
+  std::vector<uint64_t> words;
+  CheckWords<uint64_t>(words, 0, ~0ULL);
+  words.push_back(0x1000);
+  CheckWords<uint64_t>(words, 0x1000, 0x1000);
+  CheckWords<uint64_t>(words, 0x1001, 0x2000);
+  CheckWords<uint64_t>(words, 0x2000, 0x1000);
+  // Words that differ from the range only in one half.
+  for (uint64_t i = 0; i < 20; ++i) {
+    words.push_back(0x7fffffff00000000ULL + i);
+    words.push_back(0x80000000ffffffffULL - i);
+    words.push_back(0x0000000180000000ULL + i);
+  }
+  words.push_back(~0ULL);
+  words.push_back(0);
+  CheckWords<uint64_t>(words, 0x7fffffff00000010ULL, 0x7fffffff00000020ULL);
+  CheckWords<uint64_t>(words, 0x80000000fffffff0ULL, 0x80000000fffffff8ULL);
+  CheckWords<uint64_t>(words, 0x0000000180000013ULL, 0x0000000180000013ULL);
+  CheckWords<uint64_t>(words, 0x0000000100000000ULL, 0x000000017fffffffULL);
+  CheckWords<uint64_t>(words, ~0ULL, ~0ULL);
+  CheckWords<uint64_t>(words, 0, 0);
+  CheckWords<uint64_t>(words, 0, ~0ULL);
+}
+
+TEST(StackScannerTest, RandomWords) {
+  Random random;
+  for (int i = 0; i < 2000; ++i) {
+    // Ranges and words both drawn near the same base, so that words fall
+    // inside, below and above the range, and on its bounds.
+    uint64_t base = random.Next();
+    unsigned int count = random.Next() % 70;
+    uint64_t lowest = base + random.Next() % 64;
+    uint64_t highest = lowest + random.Next() % 64;
+    std::vector<uint64_t> words64;
+    std::vector<uint32_t> words32;
+    for (unsigned int j = 0; j < count; ++j) {
+      uint64_t word = random.Next() % 4 ? random.Next() :
+                                          base + random.Next() % 160;
+      words64.push_back(word);
+      words32.push_back(static_cast<uint32_t>(word));
+    }
+    CheckWords<uint64_t>(words64, lowest, highest);
+    CheckWords<uint32_t>(words32, static_cast<uint32_t>(lowest),
+                         static_cast<uint32_t>(highest));
+  }
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
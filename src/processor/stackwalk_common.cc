@@ -39,6 +39,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <map>
 #include <string>
 #include <vector>
 
@@ -782,11 +783,45 @@ static void PrintModulesMachineReadable(const CodeModules *modules) {
   }
 }
 
-}  // namespace
+// Returns the groups of threads in |process_state| other than the
+// requesting thread whose stacks have the same frames, each listed in
+// order, and ordered by their first thread.  If |group_threads| is false,
+// each thread is a group of its own.
+static vector<vector<int> > GroupThreads(const ProcessState& process_state,
+                                         bool group_threads) {
+  // Frames are compared by instruction address and by how they were found.
+  typedef std::map<vector<uint64_t>, size_t> GroupMap;
+  GroupMap group_indexes;
+  vector<vector<int> > groups;
+  int thread_count = process_state.threads()->size();
+  for (int thread_index = 0; thread_index < thread_count; ++thread_index) {
+    if (thread_index == process_state.requesting_thread())
+      continue;
+    if (!group_threads) {
+      groups.push_back(vector<int>(1, thread_index));
+      continue;
+    }
+    const vector<StackFrame*>* frames =
+        process_state.threads()->at(thread_index)->frames();
+    vector<uint64_t> key;
+    for (size_t i = 0; i < frames->size(); ++i) {
+      key.push_back(frames->at(i)->instruction);
+      key.push_back(frames->at(i)->trust);
+    }
+    std::pair<GroupMap::iterator, bool> inserted =
+        group_indexes.insert(std::make_pair(key, groups.size()));
+    if (inserted.second)
+      groups.push_back(vector<int>());
+    groups[inserted.first->second].push_back(thread_index);
+  }
+  return groups;
+}
 
-void PrintProcessState(const ProcessState& process_state,
-                       bool output_stack_contents,
-                       SourceLineResolverInterface* resolver) {
+static void PrintProcessStateWithOptions(
+    const ProcessState& process_state,
+    bool output_stack_contents,
+    bool group_threads,
+    SourceLineResolverInterface* resolver) {
   // Print OS and CPU information.
   string cpu = process_state.system_info()->cpu;
   string cpu_info = process_state.system_info()->cpu_info;
@@ -842,18 +877,27 @@ void PrintProcessState(const ProcessState& process_state,
                process_state.modules(), resolver);
   }
 
-  // Print all of the threads in the dump.
-  int thread_count = process_state.threads()->size();
-  for (int thread_index = 0; thread_index < thread_count; ++thread_index) {
-    if (thread_index != requesting_thread) {
-      // Don't print the crash thread again, it was already printed.
-      printf("\n");
+  // Print all of the threads in the dump, except the crash thread, which
+  // was already printed.  A group of threads with the same frames is
+  // printed with the first thread's registers and stack contents.
+  vector<vector<int> > groups = GroupThreads(process_state, group_threads);
+  for (size_t group_index = 0; group_index < groups.size(); ++group_index) {
+    const vector<int> &group = groups[group_index];
+    int thread_index = group[0];
+    printf("\n");
+    if (group.size() == 1) {
       printf("Thread %d\n", thread_index);
-      PrintStack(process_state.threads()->at(thread_index), cpu,
-                 output_stack_contents,
-                 process_state.thread_memory_regions()->at(thread_index),
-                 process_state.modules(), resolver);
+    } else {
+      printf("Threads %d", thread_index);
+      for (size_t i = 1; i < group.size(); ++i)
+        printf(", %d", group[i]);
+      printf(" (%d threads with the same frames)\n",
+             static_cast<int>(group.size()));
     }
+    PrintStack(process_state.threads()->at(thread_index), cpu,
+               output_stack_contents,
+               process_state.thread_memory_regions()->at(thread_index),
+               process_state.modules(), resolver);
   }
 
   PrintModules(process_state.modules(),
@@ -861,6 +905,22 @@ void PrintProcessState(const ProcessState& process_state,
                process_state.modules_with_corrupt_symbols());
 }
 
+}  // namespace
+
+void PrintProcessState(const ProcessState& process_state,
+                       bool output_stack_contents,
+                       SourceLineResolverInterface* resolver) {
+  PrintProcessStateWithOptions(process_state, output_stack_contents, false,
+                               resolver);
+}
+
+void PrintProcessStateGroupingThreads(const ProcessState& process_state,
+                                      bool output_stack_contents,
+                                      SourceLineResolverInterface* resolver) {
+  PrintProcessStateWithOptions(process_state, output_stack_contents, true,
+                               resolver);
+}
+
 void PrintProcessStateMachineReadable(const ProcessState& process_state) {
   // Print OS and CPU information.
   // OS|{OS Name}|{OS Version}
@@ -44,6 +44,13 @@ void PrintProcessState(const ProcessState& process_state,
                        bool output_stack_contents,
                        SourceLineResolverInterface* resolver);
 
+// Like PrintProcessState, but prints threads whose stacks have the same
+// frames together, as one stack preceded by the list of the threads.
+// Such a stack shows the registers of the first thread in the list.
+void PrintProcessStateGroupingThreads(const ProcessState& process_state,
+                                      bool output_stack_contents,
+                                      SourceLineResolverInterface* resolver);
+
 }  // namespace google_breakpad
 
 #endif  // PROCESSOR_STACKWALK_COMMON_H__
@@ -45,8 +45,10 @@
 #include "google_breakpad/processor/stack_frame.h"
 #include "google_breakpad/processor/stack_frame_symbolizer.h"
 #include "google_breakpad/processor/system_info.h"
+#include "processor/instruction_address_oracle.h"
 #include "processor/linked_ptr.h"
 #include "processor/logging.h"
+#include "processor/stack_scanner.h"
 #include "processor/stackwalker_ppc.h"
 #include "processor/stackwalker_ppc64.h"
 #include "processor/stackwalker_sparc.h"
@@ -55,6 +57,7 @@
 #include "processor/stackwalker_arm.h"
 #include "processor/stackwalker_arm64.h"
 #include "processor/stackwalker_mips.h"
+#include "processor/symbolization_memo.h"
 
 namespace google_breakpad {
 
@@ -72,10 +75,26 @@ Stackwalker::Stackwalker(const SystemInfo* system_info,
     : system_info_(system_info),
       memory_(memory),
       modules_(modules),
-      frame_symbolizer_(frame_symbolizer) {
+      frame_symbolizer_(frame_symbolizer),
+      instruction_address_oracle_(NULL),
+      own_instruction_address_oracle_(false),
+      symbolization_memo_(NULL) {
   assert(frame_symbolizer_);
 }
 
+Stackwalker::~Stackwalker() {
+  if (own_instruction_address_oracle_)
+    delete instruction_address_oracle_;
+}
+
+void Stackwalker::set_instruction_address_oracle(
+    InstructionAddressOracle* oracle) {
+  if (own_instruction_address_oracle_)
+    delete instruction_address_oracle_;
+  instruction_address_oracle_ = oracle;
+  own_instruction_address_oracle_ = false;
+}
+
 void InsertSpecialAttentionModule(
     StackFrameSymbolizer::SymbolizerResult symbolizer_result,
     const CodeModule* module,
@@ -134,8 +153,10 @@ bool Stackwalker::Walk(
 
     // Resolve the module information, if a module map was provided.
     StackFrameSymbolizer::SymbolizerResult symbolizer_result =
-        frame_symbolizer_->FillSourceLineInfo(modules_, system_info_,
-                                             frame.get());
+        symbolization_memo_ ?
+            symbolization_memo_->FillSourceLineInfo(frame.get()) :
+            frame_symbolizer_->FillSourceLineInfo(modules_, system_info_,
+                                                 frame.get());
     switch (symbolizer_result) {
       case StackFrameSymbolizer::kInterrupt:
         BPLOG(INFO) << "Stack walk is interrupted.";
@@ -265,31 +286,65 @@ Stackwalker* Stackwalker::StackwalkerForCPU(
   return cpu_stackwalker;
 }
 
-bool Stackwalker::InstructionAddressSeemsValid(uint64_t address) {
-  StackFrame frame;
-  frame.instruction = address;
-  StackFrameSymbolizer::SymbolizerResult symbolizer_result =
-      frame_symbolizer_->FillSourceLineInfo(modules_, system_info_, &frame);
-
-  if (!frame.module) {
-    // not inside any loaded module
-    return false;
+InstructionAddressOracle* Stackwalker::GetInstructionAddressOracle() {
+  if (!instruction_address_oracle_) {
+    instruction_address_oracle_ =
+        new InstructionAddressOracle(modules_, system_info_, frame_symbolizer_);
+    own_instruction_address_oracle_ = true;
   }
+  return instruction_address_oracle_;
+}
 
-  if (!frame_symbolizer_->HasImplementation()) {
-    // No valid implementation to symbolize stack frame, but the address is
-    // within a known module.
-    return true;
-  }
+bool Stackwalker::InstructionAddressSeemsValid(uint64_t address) {
+  return GetInstructionAddressOracle()->InstructionAddressSeemsValid(address);
+}
 
-  if (symbolizer_result != StackFrameSymbolizer::kNoError &&
-      symbolizer_result != StackFrameSymbolizer::kWarningCorruptSymbols) {
-    // Some error occurred during symbolization, but the address is within a
-    // known module
-    return true;
-  }
+WindowsFrameInfo* Stackwalker::FindWindowsFrameInfo(const StackFrame* frame) {
+  return symbolization_memo_ ?
+      symbolization_memo_->FindWindowsFrameInfo(frame) :
+      frame_symbolizer_->FindWindowsFrameInfo(frame);
+}
 
-  return !frame.function_name.empty();
+CFIFrameInfo* Stackwalker::FindCFIFrameInfo(const StackFrame* frame) {
+  return symbolization_memo_ ?
+      symbolization_memo_->FindCFIFrameInfo(frame) :
+      frame_symbolizer_->FindCFIFrameInfo(frame);
+}
+
+uint64_t Stackwalker::SkipWordsOutsideModules(uint64_t location,
+                                              uint64_t count,
+                                              size_t word_size) {
+  assert(word_size == sizeof(uint32_t) || word_size == sizeof(uint64_t));
+  uint64_t available;
+  const uint8_t* bytes = memory_->GetBytesAtAddress(location, &available);
+  if (!bytes)
+    return 0;
+  if (count > available / word_size)
+    count = available / word_size;
+  // A 32-bit scan wraps around at the top of the address space instead of
+  // reading on.
+  if (word_size == sizeof(uint32_t) && location <= 0xffffffffU &&
+      count > (0x100000000ULL - location) / word_size) {
+    count = (0x100000000ULL - location) / word_size;
+  }
+  // Don't hand more words than fit in a size_t to the scanner.
+  if (count > static_cast<size_t>(-1) / word_size)
+    count = static_cast<size_t>(-1) / word_size;
+
+  uint64_t lowest, highest;
+  if (!GetInstructionAddressOracle()->GetAddressBounds(&lowest, &highest))
+    return count;
+
+  if (word_size == sizeof(uint32_t)) {
+    if (lowest > 0xffffffffU)
+      return count;
+    if (highest > 0xffffffffU)
+      highest = 0xffffffffU;
+    return FindWordInRange(bytes, static_cast<size_t>(count),
+                           static_cast<uint32_t>(lowest),
+                           static_cast<uint32_t>(highest));
+  }
+  return FindWordInRange(bytes, static_cast<size_t>(count), lowest, highest);
 }
 
 }  // namespace google_breakpad
@@ -255,8 +255,7 @@ StackFrame* StackwalkerAMD64::GetCallerFrame(const CallStack* stack,
   scoped_ptr<StackFrameAMD64> new_frame;
 
   // If we have DWARF CFI information, use it.
-  scoped_ptr<CFIFrameInfo> cfi_frame_info(
-      frame_symbolizer_->FindCFIFrameInfo(last_frame));
+  scoped_ptr<CFIFrameInfo> cfi_frame_info(FindCFIFrameInfo(last_frame));
   if (cfi_frame_info.get())
     new_frame.reset(GetCallerByCFIFrameInfo(frames, cfi_frame_info.get()));
 
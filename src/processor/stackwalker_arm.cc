@@ -81,36 +81,39 @@ StackFrameARM* StackwalkerARM::GetCallerByCFIFrameInfo(
     CFIFrameInfo* cfi_frame_info) {
   StackFrameARM* last_frame = static_cast<StackFrameARM*>(frames.back());
 
-  static const char* register_names[] = {
+  // The registers, numbered as in context.iregs. r0 through r15 have
+  // their DWARF numbers.
+  static const char* const register_names[] = {
     "r0",  "r1",  "r2",  "r3",  "r4",  "r5",  "r6",  "r7",
     "r8",  "r9",  "r10", "r11", "r12", "sp",  "lr",  "pc",
     "f0",  "f1",  "f2",  "f3",  "f4",  "f5",  "f6",  "f7",
-    "fps", "cpsr",
-    NULL
+    "fps", "cpsr"
   };
+  static const int register_count =
+      sizeof(register_names) / sizeof(register_names[0]);
+  CFIFrameInfo::RegisterNames names(register_names, register_count);
 
-  // Populate a dictionary with the valid register values in last_frame.
-  CFIFrameInfo::RegisterValueMap<uint32_t> callee_registers;
-  for (int i = 0; register_names[i]; i++)
+  // Populate a register file with the valid register values in last_frame.
+  CFIFrameInfo::RegisterFile<uint32_t> callee_registers;
+  for (int i = 0; i < register_count; i++)
     if (last_frame->context_validity & StackFrameARM::RegisterValidFlag(i))
-      callee_registers[register_names[i]] = last_frame->context.iregs[i];
+      callee_registers.Set(i, last_frame->context.iregs[i]);
 
   // Use the STACK CFI data to recover the caller's register values.
-  CFIFrameInfo::RegisterValueMap<uint32_t> caller_registers;
-  if (!cfi_frame_info->FindCallerRegs(callee_registers, *memory_,
+  CFIFrameInfo::RegisterFile<uint32_t> caller_registers;
+  if (!cfi_frame_info->FindCallerRegs(names, callee_registers, *memory_,
                                       &caller_registers))
     return NULL;
 
   // Construct a new stack frame given the values the CFI recovered.
   scoped_ptr<StackFrameARM> frame(new StackFrameARM());
-  for (int i = 0; register_names[i]; i++) {
-    CFIFrameInfo::RegisterValueMap<uint32_t>::iterator entry =
-      caller_registers.find(register_names[i]);
-    if (entry != caller_registers.end()) {
+  for (int i = 0; i < register_count; i++) {
+    const uint32_t* caller_value = caller_registers.Find(i);
+    if (caller_value) {
       // We recovered the value of this register; fill the context with the
       // value from caller_registers.
       frame->context_validity |= StackFrameARM::RegisterValidFlag(i);
-      frame->context.iregs[i] = entry->second;
+      frame->context.iregs[i] = *caller_value;
     } else if (4 <= i && i <= 11 && (last_frame->context_validity &
                                      StackFrameARM::RegisterValidFlag(i))) {
       // If the STACK CFI data doesn't mention some callee-saves register, and
@@ -123,18 +126,17 @@ StackFrameARM* StackwalkerARM::GetCallerByCFIFrameInfo(
   }
   // If the CFI doesn't recover the PC explicitly, then use .ra.
   if (!(frame->context_validity & StackFrameARM::CONTEXT_VALID_PC)) {
-    CFIFrameInfo::RegisterValueMap<uint32_t>::iterator entry =
-      caller_registers.find(".ra");
-    if (entry != caller_registers.end()) {
+    const uint32_t* ra = caller_registers.Find(names.ra_index());
+    if (ra) {
       if (fp_register_ == -1) {
         frame->context_validity |= StackFrameARM::CONTEXT_VALID_PC;
-        frame->context.iregs[MD_CONTEXT_ARM_REG_PC] = entry->second;
+        frame->context.iregs[MD_CONTEXT_ARM_REG_PC] = *ra;
       } else {
         // The CFI updated the link register and not the program counter.
         // Handle getting the program counter from the link register.
         frame->context_validity |= StackFrameARM::CONTEXT_VALID_PC;
         frame->context_validity |= StackFrameARM::CONTEXT_VALID_LR;
-        frame->context.iregs[MD_CONTEXT_ARM_REG_LR] = entry->second;
+        frame->context.iregs[MD_CONTEXT_ARM_REG_LR] = *ra;
         frame->context.iregs[MD_CONTEXT_ARM_REG_PC] =
             last_frame->context.iregs[MD_CONTEXT_ARM_REG_LR];
       }
@@ -142,11 +144,10 @@ StackFrameARM* StackwalkerARM::GetCallerByCFIFrameInfo(
   }
   // If the CFI doesn't recover the SP explicitly, then use .cfa.
   if (!(frame->context_validity & StackFrameARM::CONTEXT_VALID_SP)) {
-    CFIFrameInfo::RegisterValueMap<uint32_t>::iterator entry =
-      caller_registers.find(".cfa");
-    if (entry != caller_registers.end()) {
+    const uint32_t* cfa = caller_registers.Find(names.cfa_index());
+    if (cfa) {
       frame->context_validity |= StackFrameARM::CONTEXT_VALID_SP;
-      frame->context.iregs[MD_CONTEXT_ARM_REG_SP] = entry->second;
+      frame->context.iregs[MD_CONTEXT_ARM_REG_SP] = *cfa;
     }
   }
 
@@ -249,8 +250,7 @@ StackFrame* StackwalkerARM::GetCallerFrame(const CallStack* stack,
   scoped_ptr<StackFrameARM> frame;
 
   // See if there is DWARF call frame information covering this address.
-  scoped_ptr<CFIFrameInfo> cfi_frame_info(
-      frame_symbolizer_->FindCFIFrameInfo(last_frame));
+  scoped_ptr<CFIFrameInfo> cfi_frame_info(FindCFIFrameInfo(last_frame));
   if (cfi_frame_info.get())
     frame.reset(GetCallerByCFIFrameInfo(frames, cfi_frame_info.get()));
 
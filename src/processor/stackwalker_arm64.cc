@@ -80,37 +80,41 @@ StackFrameARM64* StackwalkerARM64::GetCallerByCFIFrameInfo(
     CFIFrameInfo* cfi_frame_info) {
   StackFrameARM64* last_frame = static_cast<StackFrameARM64*>(frames.back());
 
-  static const char* register_names[] = {
+  // The registers, numbered as in context.iregs, which matches their
+  // DWARF numbering.
+  static const char* const register_names[] = {
     "x0",  "x1",  "x2",  "x3",  "x4",  "x5",  "x6",  "x7",
     "x8",  "x9",  "x10", "x11", "x12", "x13", "x14", "x15",
     "x16", "x17", "x18", "x19", "x20", "x21", "x22", "x23",
     "x24", "x25", "x26", "x27", "x28", "x29", "x30", "sp",
-    "pc",  NULL
+    "pc"
   };
+  static const int register_count =
+      sizeof(register_names) / sizeof(register_names[0]);
+  CFIFrameInfo::RegisterNames names(register_names, register_count);
 
-  // Populate a dictionary with the valid register values in last_frame.
-  CFIFrameInfo::RegisterValueMap<uint64_t> callee_registers;
-  for (int i = 0; register_names[i]; i++) {
+  // Populate a register file with the valid register values in last_frame.
+  CFIFrameInfo::RegisterFile<uint64_t> callee_registers;
+  for (int i = 0; i < register_count; i++) {
     if (last_frame->context_validity & StackFrameARM64::RegisterValidFlag(i))
-      callee_registers[register_names[i]] = last_frame->context.iregs[i];
+      callee_registers.Set(i, last_frame->context.iregs[i]);
   }
 
   // Use the STACK CFI data to recover the caller's register values.
-  CFIFrameInfo::RegisterValueMap<uint64_t> caller_registers;
-  if (!cfi_frame_info->FindCallerRegs(callee_registers, *memory_,
+  CFIFrameInfo::RegisterFile<uint64_t> caller_registers;
+  if (!cfi_frame_info->FindCallerRegs(names, callee_registers, *memory_,
                                       &caller_registers)) {
     return NULL;
   }
   // Construct a new stack frame given the values the CFI recovered.
   scoped_ptr<StackFrameARM64> frame(new StackFrameARM64());
-  for (int i = 0; register_names[i]; i++) {
-    CFIFrameInfo::RegisterValueMap<uint64_t>::iterator entry =
-      caller_registers.find(register_names[i]);
-    if (entry != caller_registers.end()) {
+  for (int i = 0; i < register_count; i++) {
+    const uint64_t* caller_value = caller_registers.Find(i);
+    if (caller_value) {
       // We recovered the value of this register; fill the context with the
       // value from caller_registers.
       frame->context_validity |= StackFrameARM64::RegisterValidFlag(i);
-      frame->context.iregs[i] = entry->second;
+      frame->context.iregs[i] = *caller_value;
     } else if (19 <= i && i <= 29 && (last_frame->context_validity &
                                       StackFrameARM64::RegisterValidFlag(i))) {
       // If the STACK CFI data doesn't mention some callee-saves register, and
@@ -124,20 +128,18 @@ StackFrameARM64* StackwalkerARM64::GetCallerByCFIFrameInfo(
   }
   // If the CFI doesn't recover the PC explicitly, then use .ra.
   if (!(frame->context_validity & StackFrameARM64::CONTEXT_VALID_PC)) {
-    CFIFrameInfo::RegisterValueMap<uint64_t>::iterator entry =
-      caller_registers.find(".ra");
-    if (entry != caller_registers.end()) {
+    const uint64_t* ra = caller_registers.Find(names.ra_index());
+    if (ra) {
       frame->context_validity |= StackFrameARM64::CONTEXT_VALID_PC;
-      frame->context.iregs[MD_CONTEXT_ARM64_REG_PC] = entry->second;
+      frame->context.iregs[MD_CONTEXT_ARM64_REG_PC] = *ra;
     }
   }
   // If the CFI doesn't recover the SP explicitly, then use .cfa.
   if (!(frame->context_validity & StackFrameARM64::CONTEXT_VALID_SP)) {
-    CFIFrameInfo::RegisterValueMap<uint64_t>::iterator entry =
-      caller_registers.find(".cfa");
-    if (entry != caller_registers.end()) {
+    const uint64_t* cfa = caller_registers.Find(names.cfa_index());
+    if (cfa) {
       frame->context_validity |= StackFrameARM64::CONTEXT_VALID_SP;
-      frame->context.iregs[MD_CONTEXT_ARM64_REG_SP] = entry->second;
+      frame->context.iregs[MD_CONTEXT_ARM64_REG_SP] = *cfa;
     }
   }
 
@@ -235,8 +237,7 @@ StackFrame* StackwalkerARM64::GetCallerFrame(const CallStack* stack,
   scoped_ptr<StackFrameARM64> frame;
 
   // See if there is DWARF call frame information covering this address.
-  scoped_ptr<CFIFrameInfo> cfi_frame_info(
-      frame_symbolizer_->FindCFIFrameInfo(last_frame));
+  scoped_ptr<CFIFrameInfo> cfi_frame_info(FindCFIFrameInfo(last_frame));
   if (cfi_frame_info.get())
     frame.reset(GetCallerByCFIFrameInfo(frames, cfi_frame_info.get()));
 
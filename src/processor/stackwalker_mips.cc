@@ -82,62 +82,61 @@ StackFrame* StackwalkerMIPS::GetContextFrame() {
   return frame;
 }
 
-// Register names for mips.
+// Register names for mips, numbered as in context.iregs, which matches
+// their DWARF numbering.
 static const char* const kRegisterNames[] = {
    "$zero", "$at", "$v0", "$v1", "$a0", "$a1", "$a2", "$a3", "$to", "$t1",
    "$t2",   "$t3", "$t4", "$t5", "$t6", "$t7", "$s0", "$s1", "$s2", "$s3",
    "$s4",   "$s5", "$s6", "$s7", "$t8", "$t9", "$k0", "$k1", "$gp", "$sp",
-   "$fp",   "$ra", NULL
+   "$fp",   "$ra"
   // TODO(gordanac): add float point save registers
 };
+static const int kRegisterCount =
+    sizeof(kRegisterNames) / sizeof(kRegisterNames[0]);
 
 StackFrameMIPS* StackwalkerMIPS::GetCallerByCFIFrameInfo(
     const vector<StackFrame*>& frames,
     CFIFrameInfo* cfi_frame_info) {
   StackFrameMIPS* last_frame = static_cast<StackFrameMIPS*>(frames.back());
 
-  uint32_t sp = 0, pc = 0;
+  uint32_t pc = 0;
 
-  // Populate a dictionary with the valid register values in last_frame.
-  CFIFrameInfo::RegisterValueMap<uint32_t> callee_registers;
+  CFIFrameInfo::RegisterNames names(kRegisterNames, kRegisterCount);
+
+  // Populate a register file with the register values in last_frame.
+  CFIFrameInfo::RegisterFile<uint32_t> callee_registers;
   // Use the STACK CFI data to recover the caller's register values.
-  CFIFrameInfo::RegisterValueMap<uint32_t> caller_registers;
+  CFIFrameInfo::RegisterFile<uint32_t> caller_registers;
 
-  for (int i = 0; kRegisterNames[i]; ++i) {
-    caller_registers[kRegisterNames[i]] = last_frame->context.iregs[i];
-    callee_registers[kRegisterNames[i]] = last_frame->context.iregs[i];
-  }
+  for (int i = 0; i < kRegisterCount; ++i)
+    callee_registers.Set(i, last_frame->context.iregs[i]);
 
-  if (!cfi_frame_info->FindCallerRegs(callee_registers, *memory_,
+  if (!cfi_frame_info->FindCallerRegs(names, callee_registers, *memory_,
                                       &caller_registers))  {
     return NULL;
   }
 
-  CFIFrameInfo::RegisterValueMap<uint32_t>::const_iterator entry =
-      caller_registers.find(".cfa");
-
-  if (entry != caller_registers.end()) {
-    sp = entry->second;
-    caller_registers["$sp"] = entry->second;
-  }
+  const uint32_t* cfa = caller_registers.Find(names.cfa_index());
+  if (cfa)
+    caller_registers.Set(MD_CONTEXT_MIPS_REG_SP, *cfa);
 
-  entry = caller_registers.find(".ra");
-  if (entry != caller_registers.end()) {
-    caller_registers["$ra"] = entry->second;
-    pc = entry->second - 2 * sizeof(pc);
+  uint32_t ra = 0;
+  const uint32_t* caller_ra = caller_registers.Find(names.ra_index());
+  if (caller_ra) {
+    ra = *caller_ra;
+    caller_registers.Set(MD_CONTEXT_MIPS_REG_RA, ra);
+    pc = ra - 2 * sizeof(pc);
   }
-  caller_registers["$pc"] = pc;
   // Construct a new stack frame given the values the CFI recovered.
   scoped_ptr<StackFrameMIPS> frame(new StackFrameMIPS());
 
-  for (int i = 0; kRegisterNames[i]; ++i) {
-    CFIFrameInfo::RegisterValueMap<uint32_t>::const_iterator caller_entry =
-        caller_registers.find(kRegisterNames[i]);
+  for (int i = 0; i < kRegisterCount; ++i) {
+    const uint32_t* caller_value = caller_registers.Find(i);
 
-    if (caller_entry != caller_registers.end()) {
+    if (caller_value) {
       // The value of this register is recovered; fill the context with the
       // value from caller_registers.
-      frame->context.iregs[i] = caller_entry->second;
+      frame->context.iregs[i] = *caller_value;
       frame->context_validity |= StackFrameMIPS::RegisterValidFlag(i);
     } else if (((i >= INDEX_MIPS_REG_S0 && i <= INDEX_MIPS_REG_S7) ||
                 (i > INDEX_MIPS_REG_GP && i < INDEX_MIPS_REG_RA)) &&
@@ -153,11 +152,11 @@ StackFrameMIPS* StackwalkerMIPS::GetCallerByCFIFrameInfo(
     }
   }
 
-  frame->context.epc = caller_registers["$pc"];
-  frame->instruction = caller_registers["$pc"];
+  frame->context.epc = pc;
+  frame->instruction = pc;
   frame->context_validity |= StackFrameMIPS::CONTEXT_VALID_PC;
   
-  frame->context.iregs[MD_CONTEXT_MIPS_REG_RA] = caller_registers["$ra"];
+  frame->context.iregs[MD_CONTEXT_MIPS_REG_RA] = ra;
   frame->context_validity |= StackFrameMIPS::CONTEXT_VALID_RA;
 
   frame->trust = StackFrame::FRAME_TRUST_CFI;
@@ -177,8 +176,7 @@ StackFrame* StackwalkerMIPS::GetCallerFrame(const CallStack* stack,
   scoped_ptr<StackFrameMIPS> new_frame;
 
   // See if there is DWARF call frame information covering this address.
-  scoped_ptr<CFIFrameInfo> cfi_frame_info(
-    frame_symbolizer_->FindCFIFrameInfo(last_frame));
+  scoped_ptr<CFIFrameInfo> cfi_frame_info(FindCFIFrameInfo(last_frame));
   if (cfi_frame_info.get())
     new_frame.reset(GetCallerByCFIFrameInfo(frames, cfi_frame_info.get()));
 
@@ -76,6 +76,18 @@ class MockMemoryRegion: public google_breakpad::MemoryRegion {
   bool GetMemoryAtAddress(uint64_t address, uint64_t *value) const {
     return GetMemoryLittleEndian(address, value);
   }
+  const uint8_t *GetBytesAtAddress(uint64_t address,
+                                   uint64_t *available) const {
+    // The contents are little-endian.
+    const uint16_t kOne = 1;
+    if (*reinterpret_cast<const uint8_t *>(&kOne) != 1 ||
+        address < base_address_ ||
+        address - base_address_ >= contents_.size())
+      return NULL;
+    *available = contents_.size() - (address - base_address_);
+    return reinterpret_cast<const uint8_t *>(contents_.data()) +
+           (address - base_address_);
+  }
   void Print() const {
     assert(false);
   }
@@ -627,16 +627,14 @@ StackFrame* StackwalkerX86::GetCallerFrame(const CallStack* stack,
   scoped_ptr<StackFrameX86> new_frame;
 
   // If the resolver has Windows stack walking information, use that.
-  WindowsFrameInfo* windows_frame_info
-      = frame_symbolizer_->FindWindowsFrameInfo(last_frame);
+  WindowsFrameInfo* windows_frame_info = FindWindowsFrameInfo(last_frame);
   if (windows_frame_info)
     new_frame.reset(GetCallerByWindowsFrameInfo(frames, windows_frame_info,
                                                 stack_scan_allowed));
 
   // If the resolver has DWARF CFI information, use that.
   if (!new_frame.get()) {
-    CFIFrameInfo* cfi_frame_info =
-        frame_symbolizer_->FindCFIFrameInfo(last_frame);
+    CFIFrameInfo* cfi_frame_info = FindCFIFrameInfo(last_frame);
     if (cfi_frame_info)
       new_frame.reset(GetCallerByCFIFrameInfo(frames, cfi_frame_info));
   }
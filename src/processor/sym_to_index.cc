@@ -0,0 +1,85 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// sym_to_index.cc: Write the sidecar index of a text format symbol file,
+// which lets BasicSourceLineResolver read only the records it needs from
+// the file.  See symbol_file_index.h.
+
+#include <stdio.h>
+
+#include <string>
+
+#include "common/scoped_ptr.h"
+#include "common/using_std_string.h"
+#include "google_breakpad/processor/source_line_resolver_base.h"
+#include "processor/compressed_symbol_file.h"
+#include "processor/logging.h"
+#include "processor/symbol_file_index.h"
+
+int main(int argc, char **argv) {
+  BPLOG_INIT(&argc, &argv);
+
+  if (argc != 2 && argc != 3) {
+    fprintf(stderr, "usage: %s <symbol-file> [<index-file>]\n"
+            "The index file defaults to <symbol-file>%s.\n", argv[0],
+            google_breakpad::kSymbolFileIndexSuffix);
+    return 1;
+  }
+
+  string symbol_file = argv[1];
+  string index_file = argc == 3 ? string(argv[2]) :
+      symbol_file + google_breakpad::kSymbolFileIndexSuffix;
+  if (google_breakpad::IsCompressedSymbolFile(symbol_file)) {
+    fprintf(stderr, "%s: compressed symbol files can't be indexed\n",
+            argv[0]);
+    return 1;
+  }
+
+  // Take the modification time before reading the file, so that a change
+  // made while it is read leaves the index out of date, not wrong.
+  uint64_t symbol_file_mtime;
+  if (!google_breakpad::SymbolFileIndex::GetModificationTime(
+          symbol_file, &symbol_file_mtime)) {
+    return 1;
+  }
+
+  char *symbol_data;
+  size_t symbol_data_size;
+  if (!google_breakpad::SourceLineResolverBase::ReadSymbolFile(
+          symbol_file, &symbol_data, &symbol_data_size)) {
+    return 1;
+  }
+  google_breakpad::scoped_array<char> buffer(symbol_data);
+
+  // ReadSymbolFile adds a null terminator, which isn't part of the file.
+  google_breakpad::SymbolFileIndex index;
+  index.Build(buffer.get(), symbol_data_size - 1, symbol_file_mtime);
+  return index.Write(index_file) ? 0 : 1;
+}
@@ -0,0 +1,429 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// symbol_file_index.cc: A sidecar index of a text format symbol file.
+//
+// See symbol_file_index.h for documentation.
+
+#include "processor/symbol_file_index.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+
+#include "processor/logging.h"
+#include "processor/symbol_scanner.h"
+
+namespace google_breakpad {
+
+const char kSymbolFileIndexSuffix[] = ".idx";
+
+namespace {
+
+// Orders entries by address.
+struct EntryLess {
+  bool operator()(const SymbolFileIndex::Entry &a,
+                  const SymbolFileIndex::Entry &b) const {
+    return a.address < b.address;
+  }
+  bool operator()(uint64_t address, const SymbolFileIndex::Entry &entry) const {
+    return address < entry.address;
+  }
+};
+
+bool HasPrefix(const char *record, const char *end, const char *prefix) {
+  size_t length = strlen(prefix);
+  return static_cast<size_t>(end - record) >= length &&
+         memcmp(record, prefix, length) == 0;
+}
+
+// Parses the hexadecimal field at |*cursor|, which must be followed by a
+// space, and moves |*cursor| past the space.
+bool ParseHexField(const char **cursor, const char *end, uint64_t *value) {
+  const char *p = *cursor;
+  uint64_t result = 0;
+  int digits = 0;
+  int digit;
+  while (p < end &&
+         (digit = kHexDigitValue[static_cast<unsigned char>(*p)]) >= 0) {
+    if (++digits > 16)
+      return false;
+    result = (result << 4) | digit;
+    ++p;
+  }
+  if (digits == 0 || p == end || *p != ' ')
+    return false;
+  *cursor = p + 1;
+  *value = result;
+  return true;
+}
+
+// Parses the address and size fields that follow |prefix| in |record|
+// into |entry|.
+bool ParseEntry(const char *record, const char *end, const char *prefix,
+                uint64_t offset, SymbolFileIndex::Entry *entry) {
+  const char *cursor = record + strlen(prefix);
+  if (!ParseHexField(&cursor, end, &entry->address) ||
+      !ParseHexField(&cursor, end, &entry->size)) {
+    return false;
+  }
+  entry->records.offset = offset;
+  entry->records.size = end - record;
+  return true;
+}
+
+bool WriteArray(FILE *f, const void *data, size_t element_size,
+                size_t count) {
+  return count == 0 || fwrite(data, element_size, count, f) == count;
+}
+
+// Returns the modification time in |buf|, in nanoseconds where the
+// platform records them, so that rewriting a file within a second of
+// indexing it still changes it.
+uint64_t ModificationTime(const struct stat &buf) {
+#if defined(__APPLE__)
+  return static_cast<uint64_t>(buf.st_mtimespec.tv_sec) * 1000000000 +
+         buf.st_mtimespec.tv_nsec;
+#elif defined(__linux__)
+  return static_cast<uint64_t>(buf.st_mtim.tv_sec) * 1000000000 +
+         buf.st_mtim.tv_nsec;
+#else
+  return static_cast<uint64_t>(buf.st_mtime) * 1000000000;
+#endif
+}
+
+template<typename T>
+bool ReadArray(FILE *f, uint64_t count, std::vector<T> *array) {
+  array->resize(count);
+  return count == 0 || fread(&(*array)[0], sizeof(T), count, f) == count;
+}
+
+}  // namespace
+
+SymbolFileIndex::SymbolFileIndex()
+    : symbol_file_size_(0),
+      symbol_file_mtime_(0) {
+}
+
+void SymbolFileIndex::Build(const char *symbol_data,
+                            size_t symbol_data_size,
+                            uint64_t symbol_file_mtime) {
+  symbol_file_size_ = symbol_data_size;
+  symbol_file_mtime_ = symbol_file_mtime;
+  global_spans_.clear();
+  functions_.clear();
+  cfi_.clear();
+
+  // The entries whose last element the records being read belong to:
+  // LINE records follow a FUNC record, and STACK CFI records follow a
+  // STACK CFI INIT record.
+  std::vector<Entry> *open_entries = NULL;
+
+  const char *data_end = symbol_data + symbol_data_size;
+  const char *record = symbol_data;
+  while (record < data_end) {
+    const char *newline = static_cast<const char*>(
+        memchr(record, '\n', data_end - record));
+    const char *end = newline ? newline + 1 : data_end;
+    uint64_t offset = record - symbol_data;
+
+    Entry entry;
+    if (HasPrefix(record, end, "FUNC ")) {
+      if (ParseEntry(record, end, "FUNC ", offset, &entry)) {
+        functions_.push_back(entry);
+        open_entries = &functions_;
+      } else {
+        open_entries = NULL;
+      }
+    } else if (HasPrefix(record, end, "STACK CFI INIT ")) {
+      if (ParseEntry(record, end, "STACK CFI INIT ", offset, &entry)) {
+        cfi_.push_back(entry);
+        open_entries = &cfi_;
+      } else {
+        open_entries = NULL;
+      }
+    } else if (HasPrefix(record, end, "STACK CFI ")) {
+      if (open_entries != &cfi_)
+        open_entries = NULL;
+    } else if (HasPrefix(record, end, "FILE ") ||
+               HasPrefix(record, end, "PUBLIC ") ||
+               HasPrefix(record, end, "MODULE ") ||
+               HasPrefix(record, end, "INFO ") ||
+               HasPrefix(record, end, "STACK ")) {
+      open_entries = NULL;
+    } else if (open_entries != &functions_) {
+      // Line records outside of a function are an error, which loading
+      // them will report.
+      open_entries = NULL;
+    }
+
+    if (open_entries) {
+      Span &span = open_entries->back().records;
+      span.size = end - symbol_data - span.offset;
+    } else if (!global_spans_.empty() &&
+               global_spans_.back().offset + global_spans_.back().size ==
+                   offset) {
+      global_spans_.back().size += end - record;
+    } else {
+      Span span = { offset, static_cast<uint64_t>(end - record) };
+      global_spans_.push_back(span);
+    }
+    record = end;
+  }
+
+  RemoveRejectedEntries(&functions_);
+  RemoveRejectedEntries(&cfi_);
+
+  // No two entries overlap now, so no two start at the same address.
+  std::sort(functions_.begin(), functions_.end(), EntryLess());
+  std::sort(cfi_.begin(), cfi_.end(), EntryLess());
+}
+
+// static
+void SymbolFileIndex::RemoveRejectedEntries(std::vector<Entry> *entries) {
+  // This follows RangeMap::StoreRange, which resolvers store FUNC and
+  // STACK CFI INIT records with.  Maps the last address of each kept
+  // range to its first.
+  std::map<uint64_t, uint64_t> kept;
+  size_t kept_count = 0;
+  for (size_t i = 0; i < entries->size(); ++i) {
+    const Entry &entry = (*entries)[i];
+    uint64_t high = entry.address + entry.size - 1;
+    if (entry.size == 0 || high < entry.address)
+      continue;
+
+    // Kept ranges don't overlap, so the first one ending at or after
+    // this entry's start is the lowest that could overlap it.  It does if
+    // it starts at or before this entry's end.
+    std::map<uint64_t, uint64_t>::const_iterator next =
+        kept.lower_bound(entry.address);
+    if (next != kept.end() && next->second <= high)
+      continue;
+
+    kept[high] = entry.address;
+    (*entries)[kept_count++] = entry;
+  }
+  entries->resize(kept_count);
+}
+
+bool SymbolFileIndex::Write(const string &path) const {
+  Header header;
+  header.magic = Header::kMagic;
+  header.byte_order_mark = Header::kByteOrderMark;
+  header.version = Header::kVersion;
+  header.reserved = 0;
+  header.symbol_file_size = symbol_file_size_;
+  header.symbol_file_mtime = symbol_file_mtime_;
+  header.global_span_count = global_spans_.size();
+  header.function_count = functions_.size();
+  header.cfi_count = cfi_.size();
+
+  // Several processes may index the same file at once, so each writes
+  // its own temporary file.
+  string temp_path = path + ".XXXXXX";
+  int fd = mkstemp(&temp_path[0]);
+  FILE *f = NULL;
+  if (fd != -1) {
+    // mkstemp creates the file readable only by its owner.
+    fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    f = fdopen(fd, "wb");
+    if (!f) {
+      close(fd);
+      remove(temp_path.c_str());
+    }
+  }
+  if (!f) {
+    string error_string;
+    int error_code = ErrnoString(&error_string);
+    BPLOG(ERROR) << "Could not open " << temp_path << ", error "
+                 << error_code << ": " << error_string;
+    return false;
+  }
+
+  bool written =
+      WriteArray(f, &header, sizeof(header), 1) &&
+      WriteArray(f, global_spans_.empty() ? NULL : &global_spans_[0],
+                 sizeof(Span), global_spans_.size()) &&
+      WriteArray(f, functions_.empty() ? NULL : &functions_[0],
+                 sizeof(Entry), functions_.size()) &&
+      WriteArray(f, cfi_.empty() ? NULL : &cfi_[0], sizeof(Entry),
+                 cfi_.size());
+  if (fclose(f) != 0)
+    written = false;
+  if (!written || rename(temp_path.c_str(), path.c_str()) != 0) {
+    string error_string;
+    int error_code = ErrnoString(&error_string);
+    BPLOG(ERROR) << "Could not write " << path << ", error "
+                 << error_code << ": " << error_string;
+    remove(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool SymbolFileIndex::Read(const string &path) {
+  FILE *f = fopen(path.c_str(), "rb");
+  if (!f) {
+    string error_string;
+    int error_code = ErrnoString(&error_string);
+    BPLOG(ERROR) << "Could not open " << path << ", error "
+                 << error_code << ": " << error_string;
+    return false;
+  }
+
+  struct stat buf;
+  Header header;
+  bool valid = fstat(fileno(f), &buf) == 0 &&
+               fread(&header, sizeof(header), 1, f) == 1 &&
+               header.magic == Header::kMagic &&
+               header.byte_order_mark == Header::kByteOrderMark &&
+               header.version == Header::kVersion;
+  if (valid) {
+    // Check the counts against the size of the file before allocating
+    // anything for them.
+    uint64_t size = static_cast<uint64_t>(buf.st_size) - sizeof(header);
+    valid = header.global_span_count <= size / sizeof(Span) &&
+            header.function_count <= size / sizeof(Entry) &&
+            header.cfi_count <= size / sizeof(Entry) &&
+            header.global_span_count * sizeof(Span) +
+                (header.function_count + header.cfi_count) *
+                    sizeof(Entry) == size &&
+            ReadArray(f, header.global_span_count, &global_spans_) &&
+            ReadArray(f, header.function_count, &functions_) &&
+            ReadArray(f, header.cfi_count, &cfi_);
+  }
+  fclose(f);
+
+  if (!valid) {
+    BPLOG(ERROR) << "Invalid symbol file index " << path;
+    global_spans_.clear();
+    functions_.clear();
+    cfi_.clear();
+    symbol_file_size_ = 0;
+    symbol_file_mtime_ = 0;
+    return false;
+  }
+  symbol_file_size_ = header.symbol_file_size;
+  symbol_file_mtime_ = header.symbol_file_mtime;
+  return true;
+}
+
+bool SymbolFileIndex::Matches(const string &symbol_file) const {
+  struct stat buf;
+  return stat(symbol_file.c_str(), &buf) == 0 &&
+         static_cast<uint64_t>(buf.st_size) == symbol_file_size_ &&
+         ModificationTime(buf) == symbol_file_mtime_;
+}
+
+// static
+bool SymbolFileIndex::GetModificationTime(const string &file,
+                                          uint64_t *mtime) {
+  struct stat buf;
+  if (stat(file.c_str(), &buf) != 0) {
+    string error_string;
+    int error_code = ErrnoString(&error_string);
+    BPLOG(ERROR) << "Could not stat " << file << ", error "
+                 << error_code << ": " << error_string;
+    return false;
+  }
+  *mtime = ModificationTime(buf);
+  return true;
+}
+
+// static
+bool SymbolFileIndex::ReadSpan(const string &symbol_file, const Span &span,
+                               std::vector<char> *records) {
+  int fd = open(symbol_file.c_str(), O_RDONLY);
+  if (fd == -1) {
+    string error_string;
+    int error_code = ErrnoString(&error_string);
+    BPLOG(ERROR) << "Could not open " << symbol_file << ", error "
+                 << error_code << ": " << error_string;
+    return false;
+  }
+
+  records->resize(span.size + 1);
+  size_t done = 0;
+  while (done < span.size) {
+    ssize_t result = pread(fd, &(*records)[done], span.size - done,
+                           span.offset + done);
+    if (result <= 0)
+      break;
+    done += result;
+  }
+  close(fd);
+
+  if (done != span.size) {
+    BPLOG(ERROR) << "Could not read " << span.size << " bytes at offset "
+                 << span.offset << " of " << symbol_file;
+    records->clear();
+    return false;
+  }
+  (*records)[span.size] = '\0';
+  return true;
+}
+
+bool SymbolFileIndex::ReadGlobalRecords(const string &symbol_file,
+                                        string *records) const {
+  records->clear();
+  std::vector<char> span_records;
+  for (size_t i = 0; i < global_spans_.size(); ++i) {
+    if (!ReadSpan(symbol_file, global_spans_[i], &span_records))
+      return false;
+    records->append(&span_records[0], global_spans_[i].size);
+    // The last record in the file may not end with a newline.
+    if (!records->empty() && (*records)[records->size() - 1] != '\n')
+      *records += '\n';
+  }
+  return true;
+}
+
+int SymbolFileIndex::FindFunction(uint64_t address) const {
+  return FindEntry(functions_, address);
+}
+
+int SymbolFileIndex::FindCFI(uint64_t address) const {
+  return FindEntry(cfi_, address);
+}
+
+// static
+int SymbolFileIndex::FindEntry(const std::vector<Entry> &entries,
+                               uint64_t address) {
+  std::vector<Entry>::const_iterator entry =
+      std::upper_bound(entries.begin(), entries.end(), address, EntryLess());
+  return static_cast<int>(entry - entries.begin()) - 1;
+}
+
+}  // namespace google_breakpad
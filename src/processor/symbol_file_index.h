@@ -0,0 +1,168 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// symbol_file_index.h: A sidecar index of a text format symbol file.
+//
+// Loading a symbol file means parsing all of it, although symbolizing a
+// stack only needs the few FUNC and STACK CFI records covering the
+// addresses on it.  A SymbolFileIndex records the byte offset of every
+// FUNC record, with the LINE records following it, and of every STACK CFI
+// INIT record, with the STACK CFI records following it, sorted by
+// address.  The remaining records (MODULE, INFO, FILE, PUBLIC and STACK
+// WIN) are kept as a list of spans that are always loaded.  sym_to_index
+// writes the index next to the symbol file, and BasicSourceLineResolver
+// uses it, when asked to, to read only the records it needs.
+//
+// The index refers to the uncompressed text, so it can't be used with
+// compressed symbol files.
+
+#ifndef PROCESSOR_SYMBOL_FILE_INDEX_H__
+#define PROCESSOR_SYMBOL_FILE_INDEX_H__
+
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+#include "common/using_std_string.h"
+#include "google_breakpad/common/breakpad_types.h"
+
+namespace google_breakpad {
+
+// The suffix added to a symbol file's name to name its index.
+extern const char kSymbolFileIndexSuffix[];
+
+class SymbolFileIndex {
+ public:
+  // A run of records: |size| bytes at |offset| in the symbol file.
+  struct Span {
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  // A FUNC record and its LINE records, or a STACK CFI INIT record and
+  // its STACK CFI records, covering [address, address + size).
+  struct Entry {
+    uint64_t address;
+    uint64_t size;
+    Span records;
+  };
+
+  SymbolFileIndex();
+
+  // Indexes the |symbol_data_size| bytes of symbol file text at
+  // |symbol_data|, which should not include a null terminator, read from
+  // a file last modified at |symbol_file_mtime|.  Records that can't be
+  // parsed are indexed as global, so that loading them reports the error.
+  //
+  // Loading a whole file keeps the first FUNC or STACK CFI INIT record
+  // covering an address and ignores any later record overlapping it,
+  // with the records that follow it.  The index leaves those records
+  // out, so that no entry overlaps another and a lookup finds the same
+  // record either way.
+  void Build(const char *symbol_data, size_t symbol_data_size,
+             uint64_t symbol_file_mtime);
+
+  // Writes the index to |path|, under a unique temporary name that is
+  // then renamed into place.
+  bool Write(const string &path) const;
+
+  // Replaces the index with the one in the file at |path|.
+  bool Read(const string &path);
+
+  // Returns true if the index could describe the symbol file at
+  // |symbol_file|, which must have the size and modification time of the
+  // file it was built from.
+  bool Matches(const string &symbol_file) const;
+
+  // Sets |mtime| to the modification time of |file|, in the units Build
+  // and Matches use.  Returns false if the file can't be examined.
+  static bool GetModificationTime(const string &file, uint64_t *mtime);
+
+  // Reads the records in |span| from |symbol_file|, and returns them
+  // null-terminated in |records|.
+  static bool ReadSpan(const string &symbol_file, const Span &span,
+                       std::vector<char> *records);
+
+  // Reads the records that are always loaded from |symbol_file| into
+  // |records|.
+  bool ReadGlobalRecords(const string &symbol_file, string *records) const;
+
+  // Returns the index in functions() or cfi() of the last entry that
+  // starts at or before |address|, or -1 if there is none.  The entry
+  // doesn't necessarily cover |address|.
+  int FindFunction(uint64_t address) const;
+  int FindCFI(uint64_t address) const;
+
+  uint64_t symbol_file_size() const { return symbol_file_size_; }
+  uint64_t symbol_file_mtime() const { return symbol_file_mtime_; }
+  const std::vector<Span> &global_spans() const { return global_spans_; }
+  const std::vector<Entry> &functions() const { return functions_; }
+  const std::vector<Entry> &cfi() const { return cfi_; }
+
+ private:
+  // The index file starts with this header, followed by the global
+  // spans, the functions and the CFI entries.  All fields use the byte
+  // order of the machine that wrote the file; byte_order_mark lets the
+  // reader reject files written on a machine of different endianness.
+  struct Header {
+    static const uint32_t kMagic = 0x49535042;  // "BPSI" in little-endian.
+    static const uint32_t kByteOrderMark = 0x01020304;
+    // Increment whenever the layout of the file changes.
+    static const uint32_t kVersion = 2;
+
+    uint32_t magic;
+    uint32_t byte_order_mark;
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t symbol_file_size;
+    uint64_t symbol_file_mtime;
+    uint64_t global_span_count;
+    uint64_t function_count;
+    uint64_t cfi_count;
+  };
+
+  static int FindEntry(const std::vector<Entry> &entries, uint64_t address);
+
+  // Removes the entries in |entries|, in file order, that a full load
+  // would reject: empty ones, ones that wrap around the address space,
+  // and ones overlapping an entry kept before them.
+  static void RemoveRejectedEntries(std::vector<Entry> *entries);
+
+  uint64_t symbol_file_size_;
+  uint64_t symbol_file_mtime_;
+  std::vector<Span> global_spans_;
+  std::vector<Entry> functions_;
+  std::vector<Entry> cfi_;
+};
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_SYMBOL_FILE_INDEX_H__
@@ -0,0 +1,270 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// symbol_file_index_unittest.cc: Unit tests for SymbolFileIndex.
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <string>
+#include <vector>
+
+#include "breakpad_googletest_includes.h"
+#include "common/tests/auto_tempdir.h"
+#include "common/using_std_string.h"
+#include "processor/symbol_file_index.h"
+
+namespace {
+
+using google_breakpad::AutoTempDir;
+using google_breakpad::SymbolFileIndex;
+
+const char kSymbols[] =
+    "MODULE Linux x86 000000000000000000000000000000000 test\n"
+    "FILE 1 file1.cc\n"
+    "FUNC 2000 10 0 Function2\n"
+    "2000 8 10 1\n"
+    "2008 8 11 1\n"
+    "FUNC 1000 20 0 Function1\n"
+    "1000 20 5 1\n"
+    "FUNC 3000 0 0 EmptyFunction\n"
+    "3000 4 1 1\n"
+    "PUBLIC 4000 0 Public1\n"
+    "PUBLIC 5000 0 Public2\n"
+    "STACK WIN 4 1000 20 1 0 0 0 0 0 1 $eip 4 + ^ =\n"
+    "STACK CFI INIT 1000 20 .cfa: $esp 4 + .ra: .cfa 4 - ^\n"
+    "STACK CFI 1001 .cfa: $esp 8 +\n"
+    "STACK CFI INIT 800 10 .cfa: $esp 4 + .ra: .cfa 4 - ^\n"
+    "FUNC zzz 10 0 BadFunction\n"
+    "PUBLIC 6000 0 Public3";
+
+const uint64_t kMTime = 1234567890123456789ULL;
+
+// Returns the text of |span| in |symbols|.
+string SpanText(const SymbolFileIndex::Span &span,
+                const char *symbols = kSymbols) {
+  return string(symbols + span.offset, span.size);
+}
+
+class SymbolFileIndexTest : public ::testing::Test {
+ public:
+  void SetUp() {
+    index_.Build(kSymbols, strlen(kSymbols), kMTime);
+  }
+
+  SymbolFileIndex index_;
+};
+
+TEST_F(SymbolFileIndexTest, Build) {
+  EXPECT_EQ(strlen(kSymbols), index_.symbol_file_size());
+  EXPECT_EQ(kMTime, index_.symbol_file_mtime());
+
+  // Functions are sorted by address, and empty ones are left out.
+  ASSERT_EQ(2U, index_.functions().size());
+  EXPECT_EQ(0x1000U, index_.functions()[0].address);
+  EXPECT_EQ(0x20U, index_.functions()[0].size);
+  EXPECT_EQ("FUNC 1000 20 0 Function1\n1000 20 5 1\n",
+            SpanText(index_.functions()[0].records));
+  EXPECT_EQ(0x2000U, index_.functions()[1].address);
+  EXPECT_EQ("FUNC 2000 10 0 Function2\n2000 8 10 1\n2008 8 11 1\n",
+            SpanText(index_.functions()[1].records));
+
+  ASSERT_EQ(2U, index_.cfi().size());
+  EXPECT_EQ(0x800U, index_.cfi()[0].address);
+  EXPECT_EQ("STACK CFI INIT 800 10 .cfa: $esp 4 + .ra: .cfa 4 - ^\n",
+            SpanText(index_.cfi()[0].records));
+  EXPECT_EQ(0x1000U, index_.cfi()[1].address);
+  EXPECT_EQ("STACK CFI INIT 1000 20 .cfa: $esp 4 + .ra: .cfa 4 - ^\n"
+            "STACK CFI 1001 .cfa: $esp 8 +\n",
+            SpanText(index_.cfi()[1].records));
+
+  // Everything else is global, including records that can't be parsed,
+  // with adjacent records merged into one span.
+  ASSERT_EQ(3U, index_.global_spans().size());
+  EXPECT_EQ("MODULE Linux x86 000000000000000000000000000000000 test\n"
+            "FILE 1 file1.cc\n", SpanText(index_.global_spans()[0]));
+  EXPECT_EQ("PUBLIC 4000 0 Public1\n"
+            "PUBLIC 5000 0 Public2\n"
+            "STACK WIN 4 1000 20 1 0 0 0 0 0 1 $eip 4 + ^ =\n",
+            SpanText(index_.global_spans()[1]));
+  EXPECT_EQ("FUNC zzz 10 0 BadFunction\nPUBLIC 6000 0 Public3",
+            SpanText(index_.global_spans()[2]));
+}
+
+TEST_F(SymbolFileIndexTest, OverlappingEntries) {
+  // Loading the whole file keeps the first record covering an address
+  // and ignores later ones overlapping it, so the index leaves those out.
+  const char kOverlapping[] =
+      "FUNC 1000 20 0 First\n"
+      "1000 20 1 1\n"
+      "FUNC 1000 20 0 Folded\n"
+      "1000 20 2 1\n"
+      "FUNC 2000 1000 0 Outer\n"
+      "FUNC 2400 20 0 Inner\n"
+      "FUNC 1800 1000 0 Straddling\n"
+      "FUNC fffffffffffffff0 20 0 Wrapping\n"
+      "FUNC 1020 10 0 Adjacent\n"
+      "STACK CFI INIT 2400 20 .cfa: $esp 4 + .ra: .cfa 4 - ^\n"
+      "STACK CFI 2401 .cfa: $esp 8 +\n"
+      "STACK CFI INIT 2000 1000 .cfa: $esp 4 + .ra: .cfa 4 - ^\n"
+      "STACK CFI 2001 .cfa: $esp 8 +\n"
+      "STACK CFI INIT 2410 4 .cfa: $esp 4 + .ra: .cfa 4 - ^\n";
+  SymbolFileIndex index;
+  index.Build(kOverlapping, strlen(kOverlapping), kMTime);
+
+  ASSERT_EQ(3U, index.functions().size());
+  EXPECT_EQ("FUNC 1000 20 0 First\n1000 20 1 1\n",
+            SpanText(index.functions()[0].records, kOverlapping));
+  EXPECT_EQ("FUNC 1020 10 0 Adjacent\n",
+            SpanText(index.functions()[1].records, kOverlapping));
+  EXPECT_EQ("FUNC 2000 1000 0 Outer\n",
+            SpanText(index.functions()[2].records, kOverlapping));
+
+  ASSERT_EQ(1U, index.cfi().size());
+  EXPECT_EQ("STACK CFI INIT 2400 20 .cfa: $esp 4 + .ra: .cfa 4 - ^\n"
+            "STACK CFI 2401 .cfa: $esp 8 +\n",
+            SpanText(index.cfi()[0].records, kOverlapping));
+  EXPECT_TRUE(index.global_spans().empty());
+}
+
+TEST_F(SymbolFileIndexTest, Find) {
+  EXPECT_EQ(-1, index_.FindFunction(0xfff));
+  EXPECT_EQ(0, index_.FindFunction(0x1000));
+  EXPECT_EQ(0, index_.FindFunction(0x1fff));
+  EXPECT_EQ(1, index_.FindFunction(0x2000));
+  EXPECT_EQ(1, index_.FindFunction(0xffffffffffffffffULL));
+
+  EXPECT_EQ(-1, index_.FindCFI(0x7ff));
+  EXPECT_EQ(0, index_.FindCFI(0x800));
+  EXPECT_EQ(0, index_.FindCFI(0x900));
+  EXPECT_EQ(1, index_.FindCFI(0x1001));
+
+  SymbolFileIndex empty;
+  EXPECT_EQ(-1, empty.FindFunction(0x1000));
+  EXPECT_EQ(-1, empty.FindCFI(0x1000));
+}
+
+TEST_F(SymbolFileIndexTest, WriteAndRead) {
+  AutoTempDir temp_dir;
+  const string symbol_file = temp_dir.path() + "/test.sym";
+  const string index_file = symbol_file + ".idx";
+  FILE *f = fopen(symbol_file.c_str(), "wb");
+  ASSERT_TRUE(f);
+  fputs(kSymbols, f);
+  fclose(f);
+
+  uint64_t mtime;
+  ASSERT_TRUE(SymbolFileIndex::GetModificationTime(symbol_file, &mtime));
+  index_.Build(kSymbols, strlen(kSymbols), mtime);
+  ASSERT_TRUE(index_.Write(index_file));
+  SymbolFileIndex read;
+  ASSERT_TRUE(read.Read(index_file));
+  EXPECT_EQ(index_.symbol_file_size(), read.symbol_file_size());
+  EXPECT_EQ(mtime, read.symbol_file_mtime());
+  ASSERT_EQ(index_.functions().size(), read.functions().size());
+  ASSERT_EQ(index_.cfi().size(), read.cfi().size());
+  ASSERT_EQ(index_.global_spans().size(), read.global_spans().size());
+  for (size_t i = 0; i < read.functions().size(); ++i) {
+    EXPECT_EQ(index_.functions()[i].address, read.functions()[i].address);
+    EXPECT_EQ(index_.functions()[i].records.offset,
+              read.functions()[i].records.offset);
+  }
+
+  std::vector<char> records;
+  ASSERT_TRUE(SymbolFileIndex::ReadSpan(symbol_file,
+                                        read.functions()[1].records,
+                                        &records));
+  EXPECT_STREQ("FUNC 2000 10 0 Function2\n2000 8 10 1\n2008 8 11 1\n",
+               &records[0]);
+
+  // The global records are joined, with a newline added at the end of
+  // the file.
+  string global_records;
+  ASSERT_TRUE(read.ReadGlobalRecords(symbol_file, &global_records));
+  EXPECT_EQ(SpanText(index_.global_spans()[0]) +
+            SpanText(index_.global_spans()[1]) +
+            SpanText(index_.global_spans()[2]) + "\n", global_records);
+
+  // An index doesn't match a file of the same size modified since.
+  EXPECT_TRUE(read.Matches(symbol_file));
+  struct timeval times[2] = { { 1000000000, 0 }, { 1000000000, 0 } };
+  ASSERT_EQ(0, utimes(symbol_file.c_str(), times));
+  EXPECT_FALSE(read.Matches(symbol_file));
+  ASSERT_TRUE(SymbolFileIndex::GetModificationTime(symbol_file, &mtime));
+  index_.Build(kSymbols, strlen(kSymbols), mtime);
+  ASSERT_TRUE(index_.Write(index_file));
+  ASSERT_TRUE(read.Read(index_file));
+  EXPECT_TRUE(read.Matches(symbol_file));
+
+  // An index doesn't match a file of a different size.
+  f = fopen(symbol_file.c_str(), "ab");
+  ASSERT_TRUE(f);
+  fputs("\n", f);
+  fclose(f);
+  EXPECT_FALSE(read.Matches(symbol_file));
+  EXPECT_FALSE(read.Matches(temp_dir.path() + "/missing.sym"));
+}
+
+TEST_F(SymbolFileIndexTest, ReadInvalid) {
+  AutoTempDir temp_dir;
+  const string index_file = temp_dir.path() + "/test.sym.idx";
+  SymbolFileIndex read;
+  EXPECT_FALSE(read.Read(index_file));
+
+  ASSERT_TRUE(index_.Write(index_file));
+  FILE *f = fopen(index_file.c_str(), "rb");
+  ASSERT_TRUE(f);
+  std::vector<char> contents(4096);
+  contents.resize(fread(&contents[0], 1, contents.size(), f));
+  fclose(f);
+
+  // Truncated, or with a bad magic number.
+  for (int i = 0; i < 2; ++i) {
+    std::vector<char> bad(contents);
+    if (i == 0)
+      bad.pop_back();
+    else
+      bad[0] ^= 1;
+    f = fopen(index_file.c_str(), "wb");
+    ASSERT_TRUE(f);
+    ASSERT_EQ(bad.size(), fwrite(&bad[0], 1, bad.size(), f));
+    fclose(f);
+    EXPECT_FALSE(read.Read(index_file));
+    EXPECT_TRUE(read.functions().empty());
+  }
+
+  // A span past the end of the file can't be read.
+  SymbolFileIndex::Span span = { 0x10000, 10 };
+  std::vector<char> records;
+  EXPECT_FALSE(SymbolFileIndex::ReadSpan(index_file, span, &records));
+}
+
+}  // namespace
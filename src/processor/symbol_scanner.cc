@@ -0,0 +1,212 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// symbol_scanner.cc: Fast scanning of symbol file text.
+//
+// See symbol_scanner.h for documentation.
+
+#include "processor/symbol_scanner.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace google_breakpad {
+
+#ifdef _WIN32
+#define strtoull _strtoui64
+#endif
+
+namespace {
+
+inline bool IsRecordSeparator(char c) {
+  return c == '\r' || c == '\n';
+}
+
+inline bool IsFieldSeparator(char c) {
+  return c == ' ' || c == '\r' || c == '\n';
+}
+
+}  // namespace
+
+#define HEX_DIGIT_ROW_INVALID \
+  -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+
+const signed char kHexDigitValue[256] = {
+  HEX_DIGIT_ROW_INVALID,                                     // 0x00
+  HEX_DIGIT_ROW_INVALID,                                     // 0x10
+  HEX_DIGIT_ROW_INVALID,                                     // 0x20
+  0, 1, 2, 3, 4, 5, 6, 7, 8, 9, -1, -1, -1, -1, -1, -1,      // 0x30
+  -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,  // 0x40
+  HEX_DIGIT_ROW_INVALID,                                     // 0x50
+  -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,  // 0x60
+  HEX_DIGIT_ROW_INVALID,                                     // 0x70
+  HEX_DIGIT_ROW_INVALID,                                     // 0x80
+  HEX_DIGIT_ROW_INVALID,                                     // 0x90
+  HEX_DIGIT_ROW_INVALID,                                     // 0xa0
+  HEX_DIGIT_ROW_INVALID,                                     // 0xb0
+  HEX_DIGIT_ROW_INVALID,                                     // 0xc0
+  HEX_DIGIT_ROW_INVALID,                                     // 0xd0
+  HEX_DIGIT_ROW_INVALID,                                     // 0xe0
+  HEX_DIGIT_ROW_INVALID,                                     // 0xf0
+};
+
+#undef HEX_DIGIT_ROW_INVALID
+
+// The vector versions read whole aligned blocks, which may extend past the
+// terminating null.  An aligned block never crosses a page boundary, so
+// this is safe, but AddressSanitizer can't know that.
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define SYMBOL_SCANNER_NO_ASAN __attribute__((no_sanitize_address))
+#endif
+#endif
+#if !defined(SYMBOL_SCANNER_NO_ASAN) && defined(__SANITIZE_ADDRESS__)
+#define SYMBOL_SCANNER_NO_ASAN __attribute__((no_sanitize_address))
+#endif
+#if !defined(SYMBOL_SCANNER_NO_ASAN)
+#define SYMBOL_SCANNER_NO_ASAN
+#endif
+
+#if defined(__AVX2__)
+
+SYMBOL_SCANNER_NO_ASAN
+const char *FindRecordEnd(const char *text) {
+  const __m256i newline = _mm256_set1_epi8('\n');
+  const __m256i carriage_return = _mm256_set1_epi8('\r');
+  const __m256i zero = _mm256_setzero_si256();
+
+  uintptr_t offset = reinterpret_cast<uintptr_t>(text) & 31;
+  const char *block = text - offset;
+  for (;;) {
+    __m256i bytes = _mm256_load_si256(reinterpret_cast<const __m256i*>(block));
+    __m256i matches = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(bytes, newline),
+                        _mm256_cmpeq_epi8(bytes, carriage_return)),
+        _mm256_cmpeq_epi8(bytes, zero));
+    uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(matches));
+    // Ignore the bytes of the first block that come before |text|.
+    mask &= ~0U << offset;
+    if (mask)
+      return block + __builtin_ctz(mask);
+    block += 32;
+    offset = 0;
+  }
+}
+
+#elif defined(__SSE2__)
+
+SYMBOL_SCANNER_NO_ASAN
+const char *FindRecordEnd(const char *text) {
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i carriage_return = _mm_set1_epi8('\r');
+  const __m128i zero = _mm_setzero_si128();
+
+  uintptr_t offset = reinterpret_cast<uintptr_t>(text) & 15;
+  const char *block = text - offset;
+  for (;;) {
+    __m128i bytes = _mm_load_si128(reinterpret_cast<const __m128i*>(block));
+    __m128i matches = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(bytes, newline),
+                     _mm_cmpeq_epi8(bytes, carriage_return)),
+        _mm_cmpeq_epi8(bytes, zero));
+    uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(matches));
+    // Ignore the bytes of the first block that come before |text|.
+    mask &= ~0U << offset;
+    if (mask)
+      return block + __builtin_ctz(mask);
+    block += 16;
+    offset = 0;
+  }
+}
+
+#else  // !__AVX2__ && !__SSE2__
+
+const char *FindRecordEnd(const char *text) {
+  while (*text && !IsRecordSeparator(*text))
+    ++text;
+  return text;
+}
+
+#endif  // !__AVX2__ && !__SSE2__
+
+uint64_t ScanHexUInt64Slow(const char *text, char **end) {
+  return strtoull(text, end, 16);
+}
+
+long ScanLongSlow(const char *text, char **end, int base) {
+  return strtol(text, end, base);
+}
+
+char *SymbolRecordScanner::Next() {
+  while (IsRecordSeparator(*cursor_))
+    ++cursor_;
+  if (*cursor_ == '\0')
+    return NULL;
+
+  char *record = cursor_;
+  cursor_ = const_cast<char*>(FindRecordEnd(cursor_));
+  if (*cursor_ != '\0')
+    *cursor_++ = '\0';
+  return record;
+}
+
+bool SplitSymbolRecord(char *line, int max_tokens, char **tokens) {
+  assert(max_tokens >= 2);
+  char *cursor = line;
+  for (int i = 0; i < max_tokens - 1; ++i) {
+    while (IsFieldSeparator(*cursor))
+      ++cursor;
+    if (*cursor == '\0')
+      return false;
+    tokens[i] = cursor;
+    while (*cursor && !IsFieldSeparator(*cursor))
+      ++cursor;
+    if (*cursor != '\0')
+      *cursor++ = '\0';
+  }
+
+  // Like Tokenize, take the rest of the line as the last field, without
+  // skipping any spaces at its start.
+  while (IsRecordSeparator(*cursor))
+    ++cursor;
+  if (*cursor == '\0')
+    return false;
+  tokens[max_tokens - 1] = cursor;
+  cursor = const_cast<char*>(FindRecordEnd(cursor));
+  *cursor = '\0';
+  return true;
+}
+
+}  // namespace google_breakpad
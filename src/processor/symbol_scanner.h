@@ -0,0 +1,126 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// symbol_scanner.h: Fast scanning of symbol file text.
+//
+// BasicSourceLineResolver parses symbol files that can have millions of
+// records.  The functions here split the text into records and fields and
+// decode the numbers in them.  They give exactly the same results as the
+// strtok_r, Tokenize, strtoull and strtol calls they replace, but don't
+// allocate memory, and don't consult the locale.
+
+#ifndef PROCESSOR_SYMBOL_SCANNER_H__
+#define PROCESSOR_SYMBOL_SCANNER_H__
+
+#include "google_breakpad/common/breakpad_types.h"
+
+namespace google_breakpad {
+
+// Splits a null-terminated buffer into records, the way repeated calls to
+// strtok_r(buffer, "\r\n", ...) do: empty lines are skipped, and each
+// record is null-terminated in place.  The end of each record is found
+// with SSE2 or AVX2 when the compiler targets them.
+class SymbolRecordScanner {
+ public:
+  explicit SymbolRecordScanner(char *buffer) : cursor_(buffer) { }
+
+  // Returns the next record, or NULL if there are no more.
+  char *Next();
+
+ private:
+  char *cursor_;
+};
+
+// Returns the first '\r', '\n' or '\0' at or after |text|.
+const char *FindRecordEnd(const char *text);
+
+// Splits |line| into |max_tokens| fields, the way
+// Tokenize(line, " \r\n", max_tokens, ...) does, storing them in
+// |tokens|.  Returns false if there are fewer fields.  |max_tokens| must
+// be at least 2.
+bool SplitSymbolRecord(char *line, int max_tokens, char **tokens);
+
+// The value of each hexadecimal digit, indexed by character, or -1 for
+// characters that are not hexadecimal digits.
+extern const signed char kHexDigitValue[256];
+
+// Call strtoull and strtol, for the numbers the inline functions below
+// don't decode themselves.
+uint64_t ScanHexUInt64Slow(const char *text, char **end);
+long ScanLongSlow(const char *text, char **end, int base);
+
+// Equivalent to strtoull(text, end, 16).  Plain hexadecimal numbers of up
+// to 16 digits are decoded directly; anything else is left to strtoull.
+inline uint64_t ScanHexUInt64(const char *text, char **end) {
+  const unsigned char *cursor = reinterpret_cast<const unsigned char*>(text);
+  uint64_t value = 0;
+  int digits = 0;
+  int digit;
+  while ((digit = kHexDigitValue[*cursor]) >= 0 && digits <= 16) {
+    value = (value << 4) | digit;
+    ++cursor;
+    ++digits;
+  }
+  // strtoull skips leading whitespace and accepts a sign and an "0x"
+  // prefix, and it saturates on overflow.
+  if (digits == 0 || digits > 16 || (digits == 1 && text[0] == '0' &&
+                                     (text[1] == 'x' || text[1] == 'X'))) {
+    return ScanHexUInt64Slow(text, end);
+  }
+  *end = reinterpret_cast<char*>(const_cast<unsigned char*>(cursor));
+  return value;
+}
+
+// Equivalent to strtol(text, end, base), for a base of 10 or 16.  Numbers
+// that fit in 32 bits without a sign or prefix are decoded directly.
+inline long ScanLong(const char *text, char **end, int base) {
+  const unsigned char *cursor = reinterpret_cast<const unsigned char*>(text);
+  long value = 0;
+  int digits = 0;
+  // Both limits keep the value below 2^31.
+  const int max_digits = base == 16 ? 7 : 9;
+  int digit;
+  while ((digit = kHexDigitValue[*cursor]) >= 0 && digit < base &&
+         digits <= max_digits) {
+    value = value * base + digit;
+    ++cursor;
+    ++digits;
+  }
+  if (digits == 0 || digits > max_digits ||
+      (base == 16 && digits == 1 && text[0] == '0' &&
+       (text[1] == 'x' || text[1] == 'X'))) {
+    return ScanLongSlow(text, end, base);
+  }
+  *end = reinterpret_cast<char*>(const_cast<unsigned char*>(cursor));
+  return value;
+}
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_SYMBOL_SCANNER_H__
@@ -0,0 +1,242 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// symbol_scanner_unittest.cc: Unit tests for the symbol file scanner.
+// Each function is checked against the library call it replaces.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "breakpad_googletest_includes.h"
+#include "common/using_std_string.h"
+#include "processor/symbol_scanner.h"
+#include "processor/tokenize.h"
+
+#ifdef _WIN32
+#define strtok_r strtok_s
+#define strtoull _strtoui64
+#endif
+
+namespace {
+
+using google_breakpad::FindRecordEnd;
+using google_breakpad::ScanHexUInt64;
+using google_breakpad::ScanLong;
+using google_breakpad::SplitSymbolRecord;
+using google_breakpad::SymbolRecordScanner;
+using google_breakpad::Tokenize;
+
+// Returns the records strtok_r finds in |text|.
+std::vector<string> StrtokRecords(const string &text) {
+  std::vector<char> buffer(text.begin(), text.end());
+  buffer.push_back('\0');
+  std::vector<string> records;
+  char *save_ptr;
+  for (char *record = strtok_r(&buffer[0], "\r\n", &save_ptr); record;
+       record = strtok_r(NULL, "\r\n", &save_ptr)) {
+    records.push_back(record);
+  }
+  return records;
+}
+
+// Returns the records SymbolRecordScanner finds in |text|, placing the
+// text |offset| bytes into the buffer to try different alignments.
+std::vector<string> ScannerRecords(const string &text, size_t offset) {
+  std::vector<char> buffer(offset, 'x');
+  buffer.insert(buffer.end(), text.begin(), text.end());
+  buffer.push_back('\0');
+  std::vector<string> records;
+  SymbolRecordScanner scanner(&buffer[offset]);
+  for (char *record = scanner.Next(); record; record = scanner.Next())
+    records.push_back(record);
+  return records;
+}
+
+void CheckRecords(const string &text) {
+  std::vector<string> expected = StrtokRecords(text);
+  for (size_t offset = 0; offset < 64; ++offset)
+    EXPECT_EQ(expected, ScannerRecords(text, offset)) << "offset " << offset;
+}
+
+// Checks that SplitSymbolRecord and Tokenize agree on |line|.
+void CheckSplit(const string &line, int max_tokens) {
+  std::vector<char> tokenize_buffer(line.begin(), line.end());
+  tokenize_buffer.push_back('\0');
+  std::vector<char*> expected;
+  bool expected_result = Tokenize(&tokenize_buffer[0], " \r\n", max_tokens,
+                                  &expected);
+
+  std::vector<char> split_buffer(line.begin(), line.end());
+  split_buffer.push_back('\0');
+  std::vector<char*> tokens(max_tokens);
+  bool result = SplitSymbolRecord(&split_buffer[0], max_tokens, &tokens[0]);
+
+  ASSERT_EQ(expected_result, result) << "'" << line << "'";
+  if (!result)
+    return;
+  ASSERT_EQ(static_cast<size_t>(max_tokens), expected.size());
+  for (int i = 0; i < max_tokens; ++i)
+    EXPECT_STREQ(expected[i], tokens[i]) << "'" << line << "' field " << i;
+}
+
+// Checks that ScanHexUInt64 and ScanLong agree with strtoull and strtol
+// on |text|, both for the value and the end of the number.
+void CheckNumbers(const char *text) {
+  char *expected_end;
+  char *end;
+  uint64_t expected_hex = strtoull(text, &expected_end, 16);
+  uint64_t hex = ScanHexUInt64(text, &end);
+  EXPECT_EQ(expected_hex, hex) << "'" << text << "'";
+  EXPECT_EQ(expected_end, end) << "'" << text << "'";
+
+  long expected_long = strtol(text, &expected_end, 16);
+  long value = ScanLong(text, &end, 16);
+  EXPECT_EQ(expected_long, value) << "'" << text << "' base 16";
+  EXPECT_EQ(expected_end, end) << "'" << text << "' base 16";
+
+  expected_long = strtol(text, &expected_end, 10);
+  value = ScanLong(text, &end, 10);
+  EXPECT_EQ(expected_long, value) << "'" << text << "' base 10";
+  EXPECT_EQ(expected_end, end) << "'" << text << "' base 10";
+}
+
+// A small deterministic generator, so that failures can be reproduced.
+class Random {
+ public:
+  Random() : state_(0x853c49e6748fea9bULL) { }
+  unsigned int Next(unsigned int limit) {
+    state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+    return static_cast<unsigned int>(state_ >> 33) % limit;
+  }
+
+ private:
+  uint64_t state_;
+};
+
+TEST(SymbolScannerTest, FindRecordEnd) {
+  const char text[] = "FUNC 1000 10 0 f\r\nLINE";
+  EXPECT_EQ(text + 16, FindRecordEnd(text));
+  EXPECT_EQ(text + 16, FindRecordEnd(text + 16));
+  EXPECT_EQ(text + 17, FindRecordEnd(text + 17));
+  EXPECT_EQ(text + strlen(text), FindRecordEnd(text + 18));
+  EXPECT_EQ(text + strlen(text), FindRecordEnd(text + strlen(text)));
+}
+
+TEST(SymbolScannerTest, Records) {
+  CheckRecords("");
+  CheckRecords("\n");
+  CheckRecords("\r\n\r\n");
+  CheckRecords("MODULE Linux x86 000000000000000000000000000000000 test");
+  CheckRecords("FILE 1 a.cc\nFUNC 1000 10 0 f\n1000 10 1 1\n");
+  CheckRecords("FILE 1 a.cc\r\nFUNC 1000 10 0 f\r\n\r\n1000 10 1 1");
+  CheckRecords("\n\nPUBLIC 2000 0 g\n\n");
+  // Records longer than any vector block.
+  CheckRecords(string(100, 'a') + "\n" + string(33, 'b') + "\r" +
+               string(31, 'c'));
+}
+
+TEST(SymbolScannerTest, RandomRecords) {
+  const char kAlphabet[] = "ab \r\n";
+  Random random;
+  for (int i = 0; i < 500; ++i) {
+    string text;
+    unsigned int length = random.Next(200);
+    for (unsigned int j = 0; j < length; ++j)
+      text += kAlphabet[random.Next(sizeof(kAlphabet) - 1)];
+    CheckRecords(text);
+  }
+}
+
+TEST(SymbolScannerTest, Split) {
+  CheckSplit("1 a.cc", 2);
+  CheckSplit("1 a file with spaces.cc", 2);
+  CheckSplit("1000 10 0 function name (int, char)", 4);
+  CheckSplit("1000 10 0 ", 4);
+  CheckSplit("1000 10 0", 4);
+  CheckSplit("1000  10   0  f", 4);
+  CheckSplit("  1000 10 0 f", 4);
+  CheckSplit("1000 10 0  leading spaces kept", 4);
+  CheckSplit("1000 10 0 f\r", 4);
+  CheckSplit("1000 10 0 f\r\n", 4);
+  CheckSplit("1000 10 1 2", 4);
+  CheckSplit("1000 10 1 2 extra", 4);
+  CheckSplit("", 2);
+  CheckSplit(" ", 2);
+  CheckSplit("1", 2);
+}
+
+TEST(SymbolScannerTest, RandomSplit) {
+  const char kAlphabet[] = "ab  \r\n";
+  Random random;
+  for (int i = 0; i < 2000; ++i) {
+    string line;
+    unsigned int length = random.Next(30);
+    for (unsigned int j = 0; j < length; ++j)
+      line += kAlphabet[random.Next(sizeof(kAlphabet) - 1)];
+    CheckSplit(line, 2 + random.Next(4));
+  }
+}
+
+TEST(SymbolScannerTest, Numbers) {
+  const char *const kNumbers[] = {
+    "0", "1", "f", "F", "a0", "10 ", "1000 10", "7fffffff", "80000000",
+    "ffffffff", "100000000", "7fffffffffffffff", "ffffffffffffffff",
+    "10000000000000000", "00000000000000000001", "fffffffffffffffff",
+    "1234567", "12345678", "123456789", "1234567890", "2147483647",
+    "2147483648", "99999999999", "0x10", "0X1f", "0x", "0xg", "0", "00x1",
+    "-1", "+1", "-ff", " 1", "\t1", "", " ", "g", "1g", "12z", "-",
+  };
+  for (size_t i = 0; i < sizeof(kNumbers) / sizeof(kNumbers[0]); ++i)
+    CheckNumbers(kNumbers[i]);
+}
+
+TEST(SymbolScannerTest, RandomNumbers) {
+  const char kAlphabet[] = "0123456789abcdefABCDEFxX -+g";
+  Random random;
+  for (int i = 0; i < 20000; ++i) {
+    string text;
+    unsigned int length = random.Next(22);
+    for (unsigned int j = 0; j < length; ++j) {
+      // Mostly digits, so that long numbers come up.
+      unsigned int limit = random.Next(4) ? 22 : sizeof(kAlphabet) - 1;
+      text += kAlphabet[random.Next(limit)];
+    }
+    CheckNumbers(text.c_str());
+  }
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
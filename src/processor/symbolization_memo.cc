@@ -0,0 +1,172 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// symbolization_memo.cc: Remembers the symbols found for each address in
+// a minidump.
+//
+// See symbolization_memo.h for documentation.
+
+#include "processor/symbolization_memo.h"
+
+#include <assert.h>
+
+#include <utility>
+
+#include "google_breakpad/processor/stack_frame.h"
+#include "processor/cfi_frame_info.h"
+#include "processor/windows_frame_info.h"
+
+namespace google_breakpad {
+
+SymbolizationMemo::SymbolizationMemo(const CodeModules *modules,
+                                     const SystemInfo *system_info,
+                                     StackFrameSymbolizer *frame_symbolizer)
+    : modules_(modules),
+      system_info_(system_info),
+      frame_symbolizer_(frame_symbolizer),
+      lookups_(0),
+      hits_(0) {
+  assert(frame_symbolizer_);
+}
+
+SymbolizationMemo::~SymbolizationMemo() {
+  for (WindowsFrameInfoMap::iterator it = windows_frame_info_.begin();
+       it != windows_frame_info_.end(); ++it) {
+    delete it->second.info;
+  }
+  for (CFIFrameInfoMap::iterator it = cfi_frame_info_.begin();
+       it != cfi_frame_info_.end(); ++it) {
+    delete it->second.info;
+  }
+}
+
+SymbolizationMemo::SymbolizerResult SymbolizationMemo::FillSourceLineInfo(
+    StackFrame *frame) {
+  assert(frame);
+  mutex_.Acquire();
+  SourceLineMap::const_iterator found = source_lines_.find(frame->instruction);
+  CountLookup(found != source_lines_.end());
+  if (found != source_lines_.end()) {
+    const SourceLineInfo &info = found->second;
+    if (info.module)
+      frame->module = info.module;
+    frame->function_name = info.function_name;
+    frame->function_base = info.function_base;
+    frame->source_file_name = info.source_file_name;
+    frame->source_line = info.source_line;
+    frame->source_line_base = info.source_line_base;
+    SymbolizerResult result = info.result;
+    mutex_.Release();
+    return result;
+  }
+  mutex_.Release();
+
+  SymbolizerResult result =
+      frame_symbolizer_->FillSourceLineInfo(modules_, system_info_, frame);
+  if (result == StackFrameSymbolizer::kInterrupt)
+    return result;
+
+  SourceLineInfo info;
+  info.result = result;
+  info.module = frame->module;
+  info.function_name = frame->function_name;
+  info.function_base = frame->function_base;
+  info.source_file_name = frame->source_file_name;
+  info.source_line = frame->source_line;
+  info.source_line_base = frame->source_line_base;
+  mutex_.Acquire();
+  source_lines_.insert(std::make_pair(frame->instruction, info));
+  mutex_.Release();
+  return result;
+}
+
+WindowsFrameInfo *SymbolizationMemo::FindWindowsFrameInfo(
+    const StackFrame *frame) {
+  return FindFrameInfo(frame, &windows_frame_info_,
+                       &StackFrameSymbolizer::FindWindowsFrameInfo);
+}
+
+CFIFrameInfo *SymbolizationMemo::FindCFIFrameInfo(const StackFrame *frame) {
+  return FindFrameInfo(frame, &cfi_frame_info_,
+                       &StackFrameSymbolizer::FindCFIFrameInfo);
+}
+
+template<typename FrameInfo>
+FrameInfo *SymbolizationMemo::FindFrameInfo(
+    const StackFrame *frame,
+    unordered_map<uint64_t, FrameInfoEntry<FrameInfo> > *memo,
+    FrameInfo *(StackFrameSymbolizer::*find)(const StackFrame*)) {
+  typedef unordered_map<uint64_t, FrameInfoEntry<FrameInfo> > Map;
+  assert(frame);
+  mutex_.Acquire();
+  typename Map::const_iterator found = memo->find(frame->instruction);
+  // The frame info also depends on the frame's module, which a caller may
+  // have set differently for the same address.  Such lookups are passed
+  // on without being remembered.
+  bool hit = found != memo->end() && found->second.module == frame->module;
+  CountLookup(hit);
+  if (hit) {
+    FrameInfo *info = found->second.info ?
+        new FrameInfo(*found->second.info) : NULL;
+    mutex_.Release();
+    return info;
+  }
+  bool remember = found == memo->end();
+  mutex_.Release();
+
+  FrameInfo *info = (frame_symbolizer_->*find)(frame);
+  if (!remember)
+    return info;
+
+  FrameInfoEntry<FrameInfo> entry;
+  entry.module = frame->module;
+  entry.info = info ? new FrameInfo(*info) : NULL;
+  mutex_.Acquire();
+  bool inserted = memo->insert(std::make_pair(frame->instruction,
+                                              entry)).second;
+  mutex_.Release();
+  if (!inserted)
+    delete entry.info;
+  return info;
+}
+
+void SymbolizationMemo::GetStats(uint64_t *lookups, uint64_t *hits) const {
+  mutex_.Acquire();
+  *lookups = lookups_;
+  *hits = hits_;
+  mutex_.Release();
+}
+
+void SymbolizationMemo::CountLookup(bool hit) {
+  ++lookups_;
+  if (hit)
+    ++hits_;
+}
+
+}  // namespace google_breakpad
@@ -0,0 +1,156 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// symbolization_memo.h: Remembers the symbols found for each address in
+// a minidump.
+//
+// In a process with many similar threads, most frames land on the same
+// few hundred instructions.  Each lookup through StackFrameSymbolizer
+// finds the address's module and searches the module's symbols again,
+// and FindCFIFrameInfo also parses the module's STACK CFI rules again.
+// A SymbolizationMemo keeps what the symbolizer found for each address,
+// so that a repeated frame costs a hash table lookup.
+//
+// CFIFrameInfo and WindowsFrameInfo objects are owned by the caller that
+// asked for them, so the memo keeps its own copy of each and hands out
+// new copies of it.
+//
+// The modules' addresses only mean the same thing within one minidump, so
+// a memo must not outlive the stack walks of the minidump it was made
+// for.  One memo serves all the stacks of a minidump, and it may be used
+// by several threads at once if its StackFrameSymbolizer is thread-safe.
+
+#ifndef PROCESSOR_SYMBOLIZATION_MEMO_H__
+#define PROCESSOR_SYMBOLIZATION_MEMO_H__
+
+#include <string>
+
+#include "common/unordered.h"
+#include "common/using_std_string.h"
+#include "google_breakpad/common/breakpad_types.h"
+#include "google_breakpad/processor/stack_frame_symbolizer.h"
+#include "processor/thread_primitives.h"
+
+namespace google_breakpad {
+
+class CFIFrameInfo;
+class CodeModule;
+class CodeModules;
+struct StackFrame;
+struct SystemInfo;
+struct WindowsFrameInfo;
+
+class SymbolizationMemo {
+ public:
+  typedef StackFrameSymbolizer::SymbolizerResult SymbolizerResult;
+
+  // Does not take ownership of its arguments, which must outlive the
+  // memo.
+  SymbolizationMemo(const CodeModules *modules,
+                    const SystemInfo *system_info,
+                    StackFrameSymbolizer *frame_symbolizer);
+  ~SymbolizationMemo();
+
+  // Fills in |frame| as StackFrameSymbolizer::FillSourceLineInfo would
+  // for the memo's modules.  |frame|'s symbol fields must be unset, as
+  // they are in a frame a stackwalker has just found.  Interrupted
+  // lookups are not remembered, so that they are retried.
+  SymbolizerResult FillSourceLineInfo(StackFrame *frame);
+
+  // Return what the StackFrameSymbolizer methods of the same names return
+  // for |frame|, which the caller takes ownership of.
+  WindowsFrameInfo *FindWindowsFrameInfo(const StackFrame *frame);
+  CFIFrameInfo *FindCFIFrameInfo(const StackFrame *frame);
+
+  // Sets |lookups| to the number of calls to the methods above, and
+  // |hits| to the number of them answered from the memo.
+  void GetStats(uint64_t *lookups, uint64_t *hits) const;
+
+ private:
+  // What FillSourceLineInfo found for an address.
+  struct SourceLineInfo {
+    SymbolizerResult result;
+    const CodeModule *module;
+    string function_name;
+    uint64_t function_base;
+    string source_file_name;
+    int source_line;
+    uint64_t source_line_base;
+  };
+
+  // A copy of the frame info found for an address in |module|, or NULL
+  // if there was none.
+  template<typename FrameInfo>
+  struct FrameInfoEntry {
+    const CodeModule *module;
+    FrameInfo *info;
+  };
+
+  typedef unordered_map<uint64_t, SourceLineInfo> SourceLineMap;
+  typedef unordered_map<uint64_t, FrameInfoEntry<WindowsFrameInfo> >
+      WindowsFrameInfoMap;
+  typedef unordered_map<uint64_t, FrameInfoEntry<CFIFrameInfo> >
+      CFIFrameInfoMap;
+
+  // Looks |frame| up in |memo|, asking |find| on a miss, and returns a
+  // new copy of the frame info found.
+  template<typename FrameInfo>
+  FrameInfo *FindFrameInfo(
+      const StackFrame *frame,
+      unordered_map<uint64_t, FrameInfoEntry<FrameInfo> > *memo,
+      FrameInfo *(StackFrameSymbolizer::*find)(const StackFrame*));
+
+  // Counts a lookup, and a hit if |hit| is true.  Must be called with
+  // mutex_ held.
+  void CountLookup(bool hit);
+
+  const CodeModules *modules_;
+  const SystemInfo *system_info_;
+  StackFrameSymbolizer *frame_symbolizer_;
+
+  SourceLineMap source_lines_;
+  WindowsFrameInfoMap windows_frame_info_;
+  CFIFrameInfoMap cfi_frame_info_;
+
+  uint64_t lookups_;
+  uint64_t hits_;
+
+  // Guards the maps and the counts.  It is not held while calling the
+  // symbolizer, so two threads may look the same address up at once; the
+  // first to finish adds the result.
+  mutable Mutex mutex_;
+
+  // Disallow copy constructor and assignment operator.
+  SymbolizationMemo(const SymbolizationMemo&);
+  void operator=(const SymbolizationMemo&);
+};
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_SYMBOLIZATION_MEMO_H__
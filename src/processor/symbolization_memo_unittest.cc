@@ -0,0 +1,251 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// symbolization_memo_unittest.cc: Unit tests for SymbolizationMemo.
+// Each answer is checked against the symbolizer's own.
+
+#include <string>
+
+#include "breakpad_googletest_includes.h"
+#include "common/scoped_ptr.h"
+#include "common/using_std_string.h"
+#include "google_breakpad/processor/basic_source_line_resolver.h"
+#include "google_breakpad/processor/stack_frame.h"
+#include "google_breakpad/processor/stack_frame_symbolizer.h"
+#include "google_breakpad/processor/system_info.h"
+#include "processor/cfi_frame_info.h"
+#include "processor/stackwalker_unittest_utils.h"
+#include "processor/symbolization_memo.h"
+#include "processor/windows_frame_info.h"
+
+namespace {
+
+using google_breakpad::BasicSourceLineResolver;
+using google_breakpad::CFIFrameInfo;
+using google_breakpad::CodeModules;
+using google_breakpad::StackFrame;
+using google_breakpad::StackFrameSymbolizer;
+using google_breakpad::SymbolizationMemo;
+using google_breakpad::SymbolSupplier;
+using google_breakpad::SystemInfo;
+using google_breakpad::WindowsFrameInfo;
+using google_breakpad::scoped_ptr;
+using testing::_;
+using testing::AnyNumber;
+using testing::DoAll;
+using testing::Return;
+using testing::SetArgumentPointee;
+
+const char kSymbols[] =
+    "MODULE Windows x86 000102030405060708090a0b0c0d0e0f0 module1\n"
+    "FILE 1 file.cc\n"
+    "FUNC 1000 100 0 first_function\n"
+    "1000 80 10 1\n"
+    "1080 80 11 1\n"
+    "FUNC 2000 40 0 second_function\n"
+    "PUBLIC 3000 0 public_function\n"
+    "STACK WIN 4 1000 100 0 0 4 10 4 0 1 $eip 4 + ^ = $esp $ebp 8 + =\n"
+    "STACK CFI INIT 2000 40 .cfa: $esp 4 + .ra: .cfa 4 - ^\n"
+    "STACK CFI 2010 .cfa: $esp 8 + $ebp: .cfa 8 - ^\n";
+
+// Counts the lookups that reach the symbolizer.
+class CountingSymbolizer : public StackFrameSymbolizer {
+ public:
+  CountingSymbolizer(SymbolSupplier *supplier,
+                     BasicSourceLineResolver *resolver)
+      : StackFrameSymbolizer(supplier, resolver),
+        source_line_lookups(0),
+        frame_info_lookups(0),
+        interrupts(0) { }
+
+  virtual SymbolizerResult FillSourceLineInfo(const CodeModules *modules,
+                                              const SystemInfo *system_info,
+                                              StackFrame *frame) {
+    ++source_line_lookups;
+    if (interrupts > 0) {
+      --interrupts;
+      return kInterrupt;
+    }
+    return StackFrameSymbolizer::FillSourceLineInfo(modules, system_info,
+                                                    frame);
+  }
+  virtual WindowsFrameInfo *FindWindowsFrameInfo(const StackFrame *frame) {
+    ++frame_info_lookups;
+    return StackFrameSymbolizer::FindWindowsFrameInfo(frame);
+  }
+  virtual CFIFrameInfo *FindCFIFrameInfo(const StackFrame *frame) {
+    ++frame_info_lookups;
+    return StackFrameSymbolizer::FindCFIFrameInfo(frame);
+  }
+
+  int source_line_lookups;
+  int frame_info_lookups;
+  // The number of lookups to interrupt before looking addresses up.
+  int interrupts;
+};
+
+class SymbolizationMemoTest : public testing::Test {
+ public:
+  SymbolizationMemoTest()
+      : module1(0x10000, 0x8000, "module1", "version1"),
+        module2(0x20000, 0x1000, "module2", "version2"),
+        frame_symbolizer(&supplier, &resolver),
+        memo(&modules, &system_info, &frame_symbolizer) {
+    system_info.os = "Windows NT";
+    system_info.os_short = "windows";
+    system_info.cpu = "x86";
+    modules.Add(&module1);
+    modules.Add(&module2);
+
+    // Only module1 has symbols.
+    EXPECT_CALL(supplier, GetCStringSymbolData(_, _, _, _, _))
+      .WillRepeatedly(Return(MockSymbolSupplier::NOT_FOUND));
+    EXPECT_CALL(supplier, FreeSymbolData(_)).Times(AnyNumber());
+    size_t buffer_size;
+    char *buffer = supplier.CopySymbolDataAndOwnTheCopy(kSymbols,
+                                                        &buffer_size);
+    EXPECT_CALL(supplier, GetCStringSymbolData(&module1, _, _, _, _))
+      .WillRepeatedly(DoAll(SetArgumentPointee<3>(buffer),
+                            SetArgumentPointee<4>(buffer_size),
+                            Return(MockSymbolSupplier::FOUND)));
+  }
+
+  // Looks |address| up through the memo and directly, and checks that
+  // the results are the same.
+  void CheckSourceLineInfo(uint64_t address) {
+    StackFrame expected;
+    expected.instruction = address;
+    StackFrameSymbolizer::SymbolizerResult expected_result =
+        frame_symbolizer.StackFrameSymbolizer::FillSourceLineInfo(
+            &modules, &system_info, &expected);
+
+    StackFrame frame;
+    frame.instruction = address;
+    EXPECT_EQ(expected_result, memo.FillSourceLineInfo(&frame));
+    EXPECT_EQ(expected.module, frame.module);
+    EXPECT_EQ(expected.function_name, frame.function_name);
+    EXPECT_EQ(expected.function_base, frame.function_base);
+    EXPECT_EQ(expected.source_file_name, frame.source_file_name);
+    EXPECT_EQ(expected.source_line, frame.source_line);
+    EXPECT_EQ(expected.source_line_base, frame.source_line_base);
+  }
+
+  SystemInfo system_info;
+  MockCodeModule module1;
+  MockCodeModule module2;
+  MockCodeModules modules;
+  MockSymbolSupplier supplier;
+  BasicSourceLineResolver resolver;
+  CountingSymbolizer frame_symbolizer;
+  SymbolizationMemo memo;
+};
+
+TEST_F(SymbolizationMemoTest, SourceLineInfo) {
+  const uint64_t kAddresses[] = {
+    0x11000, 0x11040, 0x11090, 0x11100, 0x12010, 0x13000, 0x13100,
+    0x20010, 0x30000,
+  };
+  const int kAddressCount = sizeof(kAddresses) / sizeof(kAddresses[0]);
+  for (int pass = 0; pass < 3; ++pass) {
+    for (int i = 0; i < kAddressCount; ++i)
+      CheckSourceLineInfo(kAddresses[i]);
+  }
+  EXPECT_EQ(kAddressCount, frame_symbolizer.source_line_lookups);
+
+  uint64_t lookups, hits;
+  memo.GetStats(&lookups, &hits);
+  EXPECT_EQ(3U * kAddressCount, lookups);
+  EXPECT_EQ(2U * kAddressCount, hits);
+}
+
+TEST_F(SymbolizationMemoTest, InterruptedLookupsAreRetried) {
+  frame_symbolizer.interrupts = 1;
+  StackFrame frame;
+  frame.instruction = 0x11000;
+  EXPECT_EQ(StackFrameSymbolizer::kInterrupt, memo.FillSourceLineInfo(&frame));
+  CheckSourceLineInfo(0x11000);
+  CheckSourceLineInfo(0x11000);
+  EXPECT_EQ(2, frame_symbolizer.source_line_lookups);
+}
+
+TEST_F(SymbolizationMemoTest, CFIFrameInfo) {
+  for (uint64_t address = 0x11ff0; address < 0x12050; address += 8) {
+    StackFrame frame;
+    frame.instruction = address;
+    memo.FillSourceLineInfo(&frame);
+    scoped_ptr<CFIFrameInfo> expected(
+        frame_symbolizer.StackFrameSymbolizer::FindCFIFrameInfo(&frame));
+    for (int pass = 0; pass < 2; ++pass) {
+      scoped_ptr<CFIFrameInfo> info(memo.FindCFIFrameInfo(&frame));
+      ASSERT_EQ(expected.get() != NULL, info.get() != NULL)
+          << "address 0x" << std::hex << address;
+      if (info.get()) {
+        EXPECT_EQ(expected->Serialize(), info->Serialize());
+      }
+    }
+  }
+  EXPECT_EQ(12, frame_symbolizer.frame_info_lookups);
+}
+
+TEST_F(SymbolizationMemoTest, WindowsFrameInfo) {
+  for (uint64_t address = 0x10ff0; address < 0x11110; address += 0x10) {
+    StackFrame frame;
+    frame.instruction = address;
+    memo.FillSourceLineInfo(&frame);
+    scoped_ptr<WindowsFrameInfo> expected(
+        frame_symbolizer.StackFrameSymbolizer::FindWindowsFrameInfo(&frame));
+    for (int pass = 0; pass < 2; ++pass) {
+      scoped_ptr<WindowsFrameInfo> info(memo.FindWindowsFrameInfo(&frame));
+      ASSERT_EQ(expected.get() != NULL, info.get() != NULL)
+          << "address 0x" << std::hex << address;
+      if (info.get()) {
+        EXPECT_EQ(expected->valid, info->valid);
+        EXPECT_EQ(expected->parameter_size, info->parameter_size);
+        EXPECT_EQ(expected->program_string, info->program_string);
+      }
+    }
+  }
+  EXPECT_EQ(18, frame_symbolizer.frame_info_lookups);
+}
+
+// Frame info depends on the frame's module as well as its address.
+TEST_F(SymbolizationMemoTest, FrameInfoForAnotherModule) {
+  StackFrame frame;
+  frame.instruction = 0x12010;
+  memo.FillSourceLineInfo(&frame);
+  scoped_ptr<CFIFrameInfo> info(memo.FindCFIFrameInfo(&frame));
+  EXPECT_TRUE(info.get() != NULL);
+
+  frame.module = &module2;
+  info.reset(memo.FindCFIFrameInfo(&frame));
+  EXPECT_TRUE(info.get() == NULL);
+  EXPECT_EQ(2, frame_symbolizer.frame_info_lookups);
+}
+
+}  // namespace
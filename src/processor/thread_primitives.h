@@ -0,0 +1,301 @@
+// Copyright (c) 2016, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// thread_primitives.h: Locks, threads and atomic operations for the
+// processor, on pthreads and the GCC atomic builtins, or on the Win32
+// equivalents.
+//
+// The processor doesn't start threads of its own on Windows: there,
+// WorkerThread::Start always fails and the callers that would use
+// threads do their work on the calling thread.  The locks and atomic
+// operations work everywhere, so the thread-safe classes stay
+// thread-safe for callers with threads of their own.
+//
+// This header is only for the processor's .cc files and internal
+// headers.  The public headers in google_breakpad/processor hold these
+// classes through pointers so that they don't pull in platform headers.
+
+#ifndef PROCESSOR_THREAD_PRIMITIVES_H__
+#define PROCESSOR_THREAD_PRIMITIVES_H__
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else  // _WIN32
+#include <pthread.h>
+#include <sched.h>
+#endif  // _WIN32
+
+#include <stddef.h>
+
+namespace google_breakpad {
+
+// A mutex.  Not recursive.
+class Mutex {
+ public:
+  Mutex() {
+#ifdef _WIN32
+    InitializeCriticalSection(&section_);
+#else  // _WIN32
+    pthread_mutex_init(&mutex_, NULL);
+#endif  // _WIN32
+  }
+
+  ~Mutex() {
+#ifdef _WIN32
+    DeleteCriticalSection(&section_);
+#else  // _WIN32
+    pthread_mutex_destroy(&mutex_);
+#endif  // _WIN32
+  }
+
+  void Acquire() {
+#ifdef _WIN32
+    EnterCriticalSection(&section_);
+#else  // _WIN32
+    pthread_mutex_lock(&mutex_);
+#endif  // _WIN32
+  }
+
+  void Release() {
+#ifdef _WIN32
+    LeaveCriticalSection(&section_);
+#else  // _WIN32
+    pthread_mutex_unlock(&mutex_);
+#endif  // _WIN32
+  }
+
+ private:
+  friend class ConditionVariable;
+
+#ifdef _WIN32
+  CRITICAL_SECTION section_;
+#else  // _WIN32
+  pthread_mutex_t mutex_;
+#endif  // _WIN32
+
+  // Disallow copy constructor and assignment operator.
+  Mutex(const Mutex&);
+  void operator=(const Mutex&);
+};
+
+// A condition variable, waited on with a Mutex held.
+class ConditionVariable {
+ public:
+  ConditionVariable() {
+#ifdef _WIN32
+    InitializeConditionVariable(&condition_);
+#else  // _WIN32
+    pthread_cond_init(&condition_, NULL);
+#endif  // _WIN32
+  }
+
+  ~ConditionVariable() {
+#ifndef _WIN32
+    pthread_cond_destroy(&condition_);
+#endif  // _WIN32
+  }
+
+  // Releases |mutex|, which must be held, until the condition variable
+  // is signalled, and acquires it again.  May return spuriously.
+  void Wait(Mutex *mutex) {
+#ifdef _WIN32
+    SleepConditionVariableCS(&condition_, &mutex->section_, INFINITE);
+#else  // _WIN32
+    pthread_cond_wait(&condition_, &mutex->mutex_);
+#endif  // _WIN32
+  }
+
+  // Wakes every thread waiting on the condition variable.
+  void Broadcast() {
+#ifdef _WIN32
+    WakeAllConditionVariable(&condition_);
+#else  // _WIN32
+    pthread_cond_broadcast(&condition_);
+#endif  // _WIN32
+  }
+
+ private:
+#ifdef _WIN32
+  CONDITION_VARIABLE condition_;
+#else  // _WIN32
+  pthread_cond_t condition_;
+#endif  // _WIN32
+
+  // Disallow copy constructor and assignment operator.
+  ConditionVariable(const ConditionVariable&);
+  void operator=(const ConditionVariable&);
+};
+
+// A thread running a function.  A started thread must be joined before
+// the WorkerThread is destroyed.
+class WorkerThread {
+ public:
+  WorkerThread() {}
+
+  // Returns false if the processor doesn't start threads on this
+  // platform.
+  static bool IsSupported() {
+#ifdef _WIN32
+    return false;
+#else  // _WIN32
+    return true;
+#endif  // _WIN32
+  }
+
+  // Starts running |function(argument)| on a new thread.  Returns false
+  // if the thread couldn't be started, which is always the case if
+  // IsSupported() returns false.
+  bool Start(void *(*function)(void*), void *argument) {
+#ifdef _WIN32
+    return false;
+#else  // _WIN32
+    return pthread_create(&thread_, NULL, function, argument) == 0;
+#endif  // _WIN32
+  }
+
+  // Waits for a thread that Start started to finish.
+  void Join() {
+#ifndef _WIN32
+    pthread_join(thread_, NULL);
+#endif  // _WIN32
+  }
+
+ private:
+#ifndef _WIN32
+  pthread_t thread_;
+#endif  // _WIN32
+
+  // Disallow copy constructor and assignment operator.
+  WorkerThread(const WorkerThread&);
+  void operator=(const WorkerThread&);
+};
+
+// Lets other threads run before the calling thread continues.
+inline void YieldThread() {
+#ifdef _WIN32
+  SwitchToThread();
+#else  // _WIN32
+  sched_yield();
+#endif  // _WIN32
+}
+
+// Sequentially consistent atomic operations on ints and pointers.
+#ifdef _MSC_VER
+
+inline int AtomicLoad(const int *location) {
+  return InterlockedCompareExchange(
+      reinterpret_cast<volatile LONG*>(const_cast<int*>(location)), 0, 0);
+}
+
+template<typename T>
+inline T *AtomicLoad(T *const *location) {
+  return static_cast<T*>(InterlockedCompareExchangePointer(
+      reinterpret_cast<PVOID volatile*>(const_cast<T**>(location)),
+      NULL, NULL));
+}
+
+inline void AtomicStore(int *location, int value) {
+  InterlockedExchange(reinterpret_cast<volatile LONG*>(location), value);
+}
+
+template<typename T>
+inline void AtomicStore(T **location, T *value) {
+  InterlockedExchangePointer(reinterpret_cast<PVOID volatile*>(location),
+                             const_cast<void*>(
+                                 static_cast<const void*>(value)));
+}
+
+// Adds |delta| to |*location|, returning the old value.
+inline int AtomicFetchAdd(int *location, int delta) {
+  return InterlockedExchangeAdd(reinterpret_cast<volatile LONG*>(location),
+                                delta);
+}
+
+// Stores |desired| in |*location| if it holds |expected|.  Returns true
+// if it did.
+template<typename T>
+inline bool AtomicCompareExchange(T **location, T *expected, T *desired) {
+  void *exchanged = InterlockedCompareExchangePointer(
+      reinterpret_cast<PVOID volatile*>(location),
+      const_cast<void*>(static_cast<const void*>(desired)),
+      const_cast<void*>(static_cast<const void*>(expected)));
+  return exchanged == expected;
+}
+
+#else  // _MSC_VER
+
+inline int AtomicLoad(const int *location) {
+  return __atomic_load_n(location, __ATOMIC_SEQ_CST);
+}
+
+template<typename T>
+inline T *AtomicLoad(T *const *location) {
+  return __atomic_load_n(location, __ATOMIC_SEQ_CST);
+}
+
+inline void AtomicStore(int *location, int value) {
+  __atomic_store_n(location, value, __ATOMIC_SEQ_CST);
+}
+
+template<typename T>
+inline void AtomicStore(T **location, T *value) {
+  __atomic_store_n(location, value, __ATOMIC_SEQ_CST);
+}
+
+// Adds |delta| to |*location|, returning the old value.
+inline int AtomicFetchAdd(int *location, int delta) {
+  return __atomic_fetch_add(location, delta, __ATOMIC_SEQ_CST);
+}
+
+// Stores |desired| in |*location| if it holds |expected|.  Returns true
+// if it did.
+template<typename T>
+inline bool AtomicCompareExchange(T **location, T *expected, T *desired) {
+  return __atomic_compare_exchange_n(location, &expected, desired, false,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+#endif  // _MSC_VER
+
+// Adds one to |*location|, returning the new value.
+inline int AtomicIncrement(int *location) {
+  return AtomicFetchAdd(location, 1) + 1;
+}
+
+// Subtracts one from |*location|, returning the new value.
+inline int AtomicDecrement(int *location) {
+  return AtomicFetchAdd(location, -1) - 1;
+}
+
+}  // namespace google_breakpad
+
+#endif  // PROCESSOR_THREAD_PRIMITIVES_H__